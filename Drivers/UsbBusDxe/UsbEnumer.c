@@ -708,9 +708,11 @@ UsbEnumerateNewDev (
   Bus     = Parent->Bus;
   HubApi  = HubIf->HubApi;  
   Address = Bus->MaxDevices;
-  DBG("USB_WAIT_PORT_STABLE_STALL\n");
-  gBS->Stall (USB_WAIT_PORT_STABLE_STALL); //100ms
-  
+  //
+  // The port has been debounced for USB_WAIT_PORT_STABLE_STALL by the
+  // caller, together with all other ports connected in the same pass.
+  //
+
   //
   // Hub resets the device for at least 10 milliseconds.
   // Host learns device speed. If device is of low/full speed
@@ -916,8 +918,12 @@ ON_ERROR:
 
   @param  HubIf                 The HUB that has the device connected.
   @param  Port                  The port index of the hub (started with zero).
+  @param  Debounced             TRUE if the caller has already waited USB_WAIT_PORT_STABLE_STALL
+                                since the port change was seen.
 
   @retval EFI_SUCCESS           The device is enumerated (added or removed).
+  @retval EFI_NOT_READY         A device is connected, but the port isn't debounced yet.
+                                Nothing is done, call again with Debounced TRUE after the stall.
   @retval EFI_OUT_OF_RESOURCES  Failed to allocate resource for the device.
   @retval Others                Failed to enumerate the device.
 
@@ -925,7 +931,8 @@ ON_ERROR:
 EFI_STATUS
 UsbEnumeratePort (
   IN USB_INTERFACE        *HubIf,
-  IN UINT8                Port
+  IN UINT8                Port,
+  IN BOOLEAN              Debounced
   )
 {
   USB_HUB_API             *HubApi;
@@ -1009,6 +1016,13 @@ UsbEnumeratePort (
     DBG("UsbEnumeratePort: Device Connect/Discount Normally\n");
   }
 
+  if (!Debounced && USB_BIT_IS_SET (PortState.PortStatus, USB_PORT_STAT_CONNECTION)) {
+    //
+    // Leave the change pending, the caller waits for all such ports at once.
+    //
+    return EFI_NOT_READY;
+  }
+
   // 
   // Following as the above cases, it's safety to remove and create again.
   //
@@ -1039,6 +1053,35 @@ UsbEnumeratePort (
 }
 
 
+/**
+  Wait once for all the ports where a device was connected to become stable,
+  then enumerate them in port order. Device reset and address assignment stay
+  serialized, as only one device may answer at the default address.
+
+  @param  HubIf                 The HUB that has the devices connected.
+  @param  Pending               Ports to enumerate, bit N of byte N / 8 for port N.
+
+**/
+VOID
+UsbEnumerateDebouncedPorts (
+  IN USB_INTERFACE        *HubIf,
+  IN UINT8                *Pending
+  )
+{
+  UINT8                   Index;
+
+  DBG("USB_WAIT_PORT_STABLE_STALL\n");
+  gBS->Stall (USB_WAIT_PORT_STABLE_STALL); //100ms for all the ports
+
+  for (Index = 0; Index < HubIf->NumOfPort; Index++) {
+    if (USB_BIT_IS_SET (Pending[Index / 8], USB_BIT (Index % 8))) {
+      UsbEnumeratePort (HubIf, Index, TRUE);
+      DBG("Port %d enumerated\n", Index);
+    }
+  }
+}
+
+
 /**
   Enumerate all the changed hub ports.
 
@@ -1058,6 +1101,8 @@ UsbHubEnumeration (
   UINT8                   Bit;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  UINT8                   Pending[32];
+  BOOLEAN                 AnyPending;
 
 //  ASSERT (Context != NULL);
   if (!Context) {
@@ -1084,16 +1129,26 @@ UsbHubEnumeration (
   //
   Byte  = 0;
   Bit   = 1;
+  ZeroMem (Pending, sizeof (Pending));
+  AnyPending = FALSE;
   DBG("Enumerate %d ports\n", HubIf->NumOfPort);
   for (Index = 0; Index < HubIf->NumOfPort; Index++) {
     if (USB_BIT_IS_SET (HubIf->ChangeMap[Byte], USB_BIT (Bit))) {
-      UsbEnumeratePort (HubIf, Index);
-      DBG("Port %d enumerated\n", Index);
+      if (UsbEnumeratePort (HubIf, Index, FALSE) == EFI_NOT_READY) {
+        Pending[Index / 8] |= (UINT8) USB_BIT (Index % 8);
+        AnyPending = TRUE;
+      } else {
+        DBG("Port %d enumerated\n", Index);
+      }
     }
 
     USB_NEXT_BIT (Byte, Bit);
   }
 
+  if (AnyPending) {
+    UsbEnumerateDebouncedPorts (HubIf, Pending);
+  }
+
   UsbHubAckHubStatus (HubIf->Device);
 
   gBS->FreePool(HubIf->ChangeMap);
@@ -1119,12 +1174,16 @@ UsbRootHubEnumeration (
   USB_INTERFACE           *RootHub;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  UINT8                   Pending[32];
+  BOOLEAN                 AnyPending;
 
   RootHub = (USB_INTERFACE *) Context;
   if (!RootHub) {
     return;
   }
   DBG("USB event happen, NumOfPort=%d\n", RootHub->NumOfPort);
+  ZeroMem (Pending, sizeof (Pending));
+  AnyPending = FALSE;
   for (Index = 0; Index < RootHub->NumOfPort; Index++) {
     Child = UsbFindChild (RootHub, Index);
     if ((Child != NULL) && (Child->DisconnectFail == TRUE)) {
@@ -1134,6 +1193,13 @@ UsbRootHubEnumeration (
       DBG("device removed\n");
     }
     
-    UsbEnumeratePort (RootHub, Index);
+    if (UsbEnumeratePort (RootHub, Index, FALSE) == EFI_NOT_READY) {
+      Pending[Index / 8] |= (UINT8) USB_BIT (Index % 8);
+      AnyPending = TRUE;
+    }
+  }
+
+  if (AnyPending) {
+    UsbEnumerateDebouncedPorts (RootHub, Pending);
   }
 }
@@ -71,6 +71,13 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 //
 #define XHC_POLL_DELAY               (100)
 //
+// Synchronous transfer completion polling: number of event ring checks
+// without any delay right after the doorbell, then the delay between
+// checks doubles from 1us up to this cap. The unit is microsecond.
+//
+#define XHC_SYNC_POLL_SPIN_COUNT     (64)
+#define XHC_SYNC_POLL_MAX_DELAY      (64)
+//
 #define XHC_ASYNC_TIMER_INTERVAL     EFI_TIMER_PERIOD_MILLISECONDS(1)
 
 //
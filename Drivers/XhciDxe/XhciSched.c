@@ -1321,6 +1321,12 @@ EXIT:
   @param  Urb               The URB to execute.
   @param  Timeout           The time to wait before abort, in millisecond.
 
+  The event ring is checked in a tight loop first, so that short transfers
+  complete without waiting for a whole Stall(), then the delay between checks
+  grows up to XHC_SYNC_POLL_MAX_DELAY. The deadline comes from a timer event,
+  so slow MMIO doesn't stretch the timeout; if the event can't be created,
+  the stalled time is counted instead.
+
   @return EFI_DEVICE_ERROR  The transfer failed due to transfer error.
   @return EFI_TIMEOUT       The transfer failed due to time out.
   @return EFI_SUCCESS       The transfer finished OK.
@@ -1336,10 +1342,14 @@ XhcExecTransfer (
 {
   EFI_STATUS              Status;
   UINTN                   Index;
-  UINT64                  Loop;
+  UINT64                  Stalled;
+  UINT64                  Budget;
+  UINTN                   Delay;
   UINT8                   SlotId;
   UINT8                   Dci;
   BOOLEAN                 Finished;
+  BOOLEAN                 TimedOut;
+  EFI_EVENT               TimeoutEvent;
 
   if (CmdTransfer) {
     SlotId = 0;
@@ -1357,23 +1367,55 @@ XhcExecTransfer (
     }
   }
 
-  Status = EFI_SUCCESS;
-  Loop   = Timeout * XHC_1_MILLISECOND;
-  if (Timeout == 0) {
-    Loop = 0xFFFFFFFF;
+  Status       = EFI_SUCCESS;
+  TimeoutEvent = NULL;
+  Budget       = 0xFFFFFFFF;
+  if (Timeout != 0) {
+    Budget = MultU64x32 (Timeout, XHC_1_MILLISECOND);
+    Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL, &TimeoutEvent);
+    if (!EFI_ERROR (Status)) {
+      Status = gBS->SetTimer (TimeoutEvent, TimerRelative, EFI_TIMER_PERIOD_MILLISECONDS (Timeout));
+      if (EFI_ERROR (Status)) {
+        gBS->CloseEvent (TimeoutEvent);
+        TimeoutEvent = NULL;
+      }
+    }
+    Status = EFI_SUCCESS;
   }
 
   XhcRingDoorBell (Xhc, SlotId, Dci);
 
-  for (Index = 0; Index < Loop; Index++) {
+  Stalled  = 0;
+  Delay    = XHC_1_MICROSECOND;
+  TimedOut = FALSE;
+  for (Index = 0; ; Index++) {
     Finished = XhcCheckUrbResult (Xhc, Urb);
     if (Finished) {
       break;
     }
-    gBS->Stall (XHC_1_MICROSECOND);
+    if (TimeoutEvent != NULL) {
+      TimedOut = !EFI_ERROR (gBS->CheckEvent (TimeoutEvent));
+    } else {
+      TimedOut = (Stalled >= Budget);
+    }
+    if (TimedOut) {
+      break;
+    }
+    if (Index < XHC_SYNC_POLL_SPIN_COUNT) {
+      continue;
+    }
+    gBS->Stall (Delay);
+    Stalled += Delay;
+    if (Delay < XHC_SYNC_POLL_MAX_DELAY) {
+      Delay <<= 1;
+    }
+  }
+
+  if (TimeoutEvent != NULL) {
+    gBS->CloseEvent (TimeoutEvent);
   }
 
-  if (Index == Loop) {
+  if (TimedOut) {
     Urb->Result = EFI_USB_ERR_TIMEOUT;
     Status      = EFI_TIMEOUT;
   } else if (Urb->Result != EFI_USB_NOERROR) {
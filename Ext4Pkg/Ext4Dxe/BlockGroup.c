@@ -27,9 +27,147 @@ Ext4GetBlockGroupDesc (
   return (EXT4_BLOCK_GROUP_DESC *)((CHAR8 *)Partition->BlockGroups + BlockGroup * Partition->DescSize);
 }
 
+/**
+   Returns the size of the inode structures handed out by Ext4AllocateInode.
+
+   @param[in]    Partition  Pointer to the opened partition.
+
+   @return Size of an inode, in bytes.
+**/
+STATIC
+UINTN
+Ext4InodeStructSize (
+  IN CONST EXT4_PARTITION  *Partition
+  )
+{
+  return MAX (Partition->InodeSize, sizeof (EXT4_INODE));
+}
+
+/**
+   Initialises the (empty) inode cache of a partition.
+
+   @param[in]    Partition  Pointer to the opened partition.
+**/
+VOID
+Ext4InitInodeCache (
+  IN EXT4_PARTITION  *Partition
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < EXT4_INODE_CACHE_BUCKETS; Index++) {
+    InitializeListHead (&Partition->InodeCacheBuckets[Index]);
+  }
+
+  InitializeListHead (&Partition->InodeCacheLru);
+  Partition->InodeCacheEntries = 0;
+}
+
+/**
+   Frees the inode cache of a partition.
+
+   @param[in]    Partition  Pointer to the opened partition.
+**/
+VOID
+Ext4FreeInodeCache (
+  IN EXT4_PARTITION  *Partition
+  )
+{
+  LIST_ENTRY              *Node;
+  LIST_ENTRY              *NextNode;
+  EXT4_INODE_CACHE_ENTRY  *Entry;
+
+  BASE_LIST_FOR_EACH_SAFE (Node, NextNode, &Partition->InodeCacheLru) {
+    Entry = EXT4_INODE_CACHE_ENTRY_FROM_LRU_NODE (Node);
+    FreePool (Entry);
+  }
+
+  Ext4InitInodeCache (Partition);
+}
+
+/**
+   Looks up an inode in the inode cache.
+
+   @param[in]    Partition  Pointer to the opened partition.
+   @param[in]    InodeNum   Number of the desired Inode
+
+   @return The cache entry, or NULL if the inode isn't cached.
+**/
+STATIC
+EXT4_INODE_CACHE_ENTRY *
+Ext4InodeCacheLookup (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_INO_NR     InodeNum
+  )
+{
+  LIST_ENTRY              *Bucket;
+  LIST_ENTRY              *Node;
+  EXT4_INODE_CACHE_ENTRY  *Entry;
+
+  Bucket = &Partition->InodeCacheBuckets[InodeNum & (EXT4_INODE_CACHE_BUCKETS - 1)];
+
+  BASE_LIST_FOR_EACH (Node, Bucket) {
+    Entry = EXT4_INODE_CACHE_ENTRY_FROM_BUCKET_NODE (Node);
+
+    if (Entry->InodeNum == InodeNum) {
+      // Move it to the front of the LRU list
+      RemoveEntryList (&Entry->LruNode);
+      InsertHeadList (&Partition->InodeCacheLru, &Entry->LruNode);
+      return Entry;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+   Adds an inode to the inode cache, evicting the least recently used inode if the cache is full.
+
+   @param[in]    Partition  Pointer to the opened partition.
+   @param[in]    InodeNum   Number of the inode.
+   @param[in]    Inode      Pointer to the checksum-verified inode, of Ext4InodeStructSize bytes.
+**/
+STATIC
+VOID
+Ext4InodeCacheInsert (
+  IN EXT4_PARTITION    *Partition,
+  IN EXT4_INO_NR       InodeNum,
+  IN CONST EXT4_INODE  *Inode
+  )
+{
+  EXT4_INODE_CACHE_ENTRY  *Entry;
+
+  if (Ext4InodeCacheLookup (Partition, InodeNum) != NULL) {
+    return;
+  }
+
+  if (Partition->InodeCacheEntries < EXT4_INODE_CACHE_MAX_ENTRIES) {
+    Entry = AllocatePool (OFFSET_OF (EXT4_INODE_CACHE_ENTRY, Inode) + Ext4InodeStructSize (Partition));
+    if (Entry == NULL) {
+      return;
+    }
+
+    Partition->InodeCacheEntries++;
+  } else {
+    Entry = EXT4_INODE_CACHE_ENTRY_FROM_LRU_NODE (GetPreviousNode (&Partition->InodeCacheLru, &Partition->InodeCacheLru));
+    RemoveEntryList (&Entry->BucketNode);
+    RemoveEntryList (&Entry->LruNode);
+  }
+
+  Entry->InodeNum = InodeNum;
+  CopyMem (&Entry->Inode, Inode, Ext4InodeStructSize (Partition));
+
+  InsertHeadList (&Partition->InodeCacheBuckets[InodeNum & (EXT4_INODE_CACHE_BUCKETS - 1)], &Entry->BucketNode);
+  InsertHeadList (&Partition->InodeCacheLru, &Entry->LruNode);
+}
+
 /**
    Reads an inode from disk.
 
+   Inodes are served from the partition's inode cache when possible. On a miss, the whole
+   inode table block holding the inode is read, and its other in-use inodes are cached too,
+   so walking a directory's files doesn't need one disk read per inode.
+
    @param[in]    Partition  Pointer to the opened partition.
    @param[in]    InodeNum   Number of the desired Inode
    @param[out]   OutIno     Pointer to where it will be stored a pointer to the read inode.
@@ -43,12 +181,19 @@ Ext4ReadInode (
   OUT EXT4_INODE     **OutIno
   )
 {
-  UINT64                 InodeOffset;
-  UINT32                 BlockGroupNumber;
-  EXT4_INODE             *Inode;
-  EXT4_BLOCK_GROUP_DESC  *BlockGroup;
-  EXT4_BLOCK_NR          InodeTableStart;
-  EFI_STATUS             Status;
+  UINT64                  InodeOffset;
+  UINT32                  BlockGroupNumber;
+  EXT4_INODE              *Inode;
+  EXT4_BLOCK_GROUP_DESC   *BlockGroup;
+  EXT4_BLOCK_NR           InodeTableStart;
+  EFI_STATUS              Status;
+  EXT4_INODE_CACHE_ENTRY  *Entry;
+  UINT8                   *Table;
+  UINT32                  InodesPerBlock;
+  UINT32                  First;
+  UINT32                  Count;
+  UINT32                  Index;
+  EXT4_INO_NR             Neighbour;
 
   if (!EXT4_IS_VALID_INODE_NR (Partition, InodeNum)) {
     DEBUG ((DEBUG_ERROR, "[ext4] Error reading inode: inode number %lu isn't valid\n", InodeNum));
@@ -72,6 +217,17 @@ Ext4ReadInode (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  Entry = Ext4InodeCacheLookup (Partition, InodeNum);
+
+  if (Entry != NULL) {
+    Partition->InodeCacheHits++;
+    CopyMem (Inode, &Entry->Inode, Ext4InodeStructSize (Partition));
+    *OutIno = Inode;
+    return EFI_SUCCESS;
+  }
+
+  Partition->InodeCacheMisses++;
+
   BlockGroup = Ext4GetBlockGroupDesc (Partition, BlockGroupNumber);
 
   // Note: We'll need to check INODE_UNINIT and friends when/if we add write support
@@ -82,11 +238,23 @@ Ext4ReadInode (
                       BlockGroup->bg_inode_table_hi
                       );
 
+  // Read the inodes of the group that share the inode's inode table block
+  InodesPerBlock = MAX (Partition->BlockSize / Partition->InodeSize, 1);
+  First          = (UINT32)InodeOffset - (UINT32)InodeOffset % InodesPerBlock;
+  Count          = MIN (InodesPerBlock, Partition->SuperBlock.s_inodes_per_group - First);
+
+  Table = AllocatePool (Count * Partition->InodeSize);
+
+  if (Table == NULL) {
+    FreePool (Inode);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   Status = Ext4ReadDiskIo (
              Partition,
-             Inode,
-             Partition->InodeSize,
-             EXT4_BLOCK_TO_BYTES (Partition, InodeTableStart) + MultU64x32 (InodeOffset, Partition->InodeSize)
+             Table,
+             Count * Partition->InodeSize,
+             EXT4_BLOCK_TO_BYTES (Partition, InodeTableStart) + MultU64x32 (First, Partition->InodeSize)
              );
 
   if (EFI_ERROR (Status)) {
@@ -99,10 +267,29 @@ Ext4ReadInode (
       InodeTableStart,
       BlockGroupNumber
       ));
+    FreePool (Table);
     FreePool (Inode);
     return Status;
   }
 
+  // Cache the neighbours that are in use and intact. Inode is used as scratch space,
+  // since the on-disk inodes may be smaller than EXT4_INODE.
+  for (Index = 0; Index < Count; Index++) {
+    if (First + Index == InodeOffset) {
+      continue;
+    }
+
+    CopyMem (Inode, Table + Index * Partition->InodeSize, Partition->InodeSize);
+    Neighbour = InodeNum - (UINT32)InodeOffset + First + Index;
+
+    if ((Inode->i_links != 0) && Ext4CheckInodeChecksum (Partition, Inode, Neighbour)) {
+      Ext4InodeCacheInsert (Partition, Neighbour, Inode);
+    }
+  }
+
+  CopyMem (Inode, Table + ((UINT32)InodeOffset - First) * Partition->InodeSize, Partition->InodeSize);
+  FreePool (Table);
+
   if (!Ext4CheckInodeChecksum (Partition, Inode, InodeNum)) {
     DEBUG ((
       DEBUG_ERROR,
@@ -114,6 +301,8 @@ Ext4ReadInode (
     return EFI_VOLUME_CORRUPTED;
   }
 
+  Ext4InodeCacheInsert (Partition, InodeNum, Inode);
+
   *OutIno = Inode;
   return EFI_SUCCESS;
 }
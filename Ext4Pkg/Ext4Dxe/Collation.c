@@ -193,3 +193,18 @@ Ext4StrCmpInsensitive (
   ASSERT (gUnicodeCollationInterface != NULL);
   return gUnicodeCollationInterface->StriColl (gUnicodeCollationInterface, Str1, Str2);
 }
+
+/**
+   Converts a string to upper case in place, using the same collation as Ext4StrCmpInsensitive,
+   so that strings that compare equal end up identical.
+
+   @param[in out]  Str    Pointer to a null terminated string.
+**/
+VOID
+Ext4StrUpr (
+  IN OUT CHAR16  *Str
+  )
+{
+  ASSERT (gUnicodeCollationInterface != NULL);
+  gUnicodeCollationInterface->StrUpr (gUnicodeCollationInterface, Str);
+}
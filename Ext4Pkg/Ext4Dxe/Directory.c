@@ -89,9 +89,644 @@ Ext4ValidDirent (
   return TRUE;
 }
 
+//
+// Total size of the directory caches of a partition
+//
+#define EXT4_DIR_CACHE_MAX_SIZE  SIZE_8MB
+
+#define EXT4_DIR_CACHE_INITIAL_SLOTS  64
+
+/**
+   The names of a directory, cached the first time the directory is scanned linearly,
+   so that later lookups in it don't need to read and convert every entry again.
+   The driver is read-only, so the cache stays valid until the partition is unmounted.
+**/
+typedef struct {
+  EXT4_INO_NR    DirInode;
+
+  // Open addressing table: Slots holds 1 + the offset of the record in Records,
+  // 0 for free slots, and Hashes the hash of the record's upper-cased name.
+  UINT32         *Slots;
+  UINT32         *Hashes;
+  UINT32         SlotMask;
+  UINT32         Count;
+
+  // Copies of the directory entries (EXT4_DIR_ENTRY headers and names), in directory order
+  UINT8          *Records;
+  UINTN          RecordsSize;
+  UINTN          RecordsCapacity;
+} EXT4_DIR_CACHE;
+
+/**
+   Hashes a name case-insensitively, by hashing its upper-cased version (FNV-1a).
+
+   @param[in]      Name        Pointer to the UCS-2 formatted name, at most EXT4_NAME_MAX long.
+
+   @return The hash.
+**/
+STATIC
+UINT32
+Ext4DirCacheHashName (
+  IN CONST CHAR16  *Name
+  )
+{
+  CHAR16  Upper[EXT4_NAME_MAX + 1];
+  UINT32  Hash;
+  UINTN   Index;
+
+  StrCpyS (Upper, EXT4_NAME_MAX + 1, Name);
+  Ext4StrUpr (Upper);
+
+  Hash = 0x811C9DC5;
+  for (Index = 0; Upper[Index] != L'\0'; Index++) {
+    Hash = (Hash ^ Upper[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+   Frees a directory cache.
+
+   @param[in]      Cache       Pointer to the cache.
+**/
+STATIC
+VOID
+Ext4DirCacheFree (
+  IN EXT4_DIR_CACHE  *Cache
+  )
+{
+  if (Cache->Slots != NULL) {
+    FreePool (Cache->Slots);
+  }
+
+  if (Cache->Hashes != NULL) {
+    FreePool (Cache->Hashes);
+  }
+
+  if (Cache->Records != NULL) {
+    FreePool (Cache->Records);
+  }
+
+  FreePool (Cache);
+}
+
+/**
+   Returns the memory used by a directory cache.
+
+   @param[in]      Cache       Pointer to the cache.
+
+   @return Size of the cache, in bytes.
+**/
+STATIC
+UINTN
+Ext4DirCacheSize (
+  IN CONST EXT4_DIR_CACHE  *Cache
+  )
+{
+  return sizeof (*Cache) + Cache->RecordsCapacity + (Cache->SlotMask + 1) * 2 * sizeof (UINT32);
+}
+
+/**
+   Creates an empty cache for a directory, to be filled while scanning it.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Directory   Pointer to the opened directory.
+
+   @return The new cache, or NULL if the directory can't be cached.
+**/
+STATIC
+EXT4_DIR_CACHE *
+Ext4DirCacheCreate (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_FILE       *Directory
+  )
+{
+  EXT4_DIR_CACHE  *Cache;
+  UINT64          DirInoSize;
+
+  // Records are never bigger than the entries they copy, so the directory's size
+  // bounds the space they need.
+  DirInoSize = EXT4_INODE_SIZE (Directory->Inode);
+  if ((DirInoSize == 0) || (DirInoSize > EXT4_DIR_CACHE_MAX_SIZE - Partition->DirCacheSize)) {
+    return NULL;
+  }
+
+  Cache = AllocateZeroPool (sizeof (*Cache));
+  if (Cache == NULL) {
+    return NULL;
+  }
+
+  Cache->DirInode        = Directory->InodeNum;
+  Cache->SlotMask        = EXT4_DIR_CACHE_INITIAL_SLOTS - 1;
+  Cache->RecordsCapacity = (UINTN)DirInoSize;
+  Cache->Slots           = AllocateZeroPool (EXT4_DIR_CACHE_INITIAL_SLOTS * sizeof (UINT32));
+  Cache->Hashes          = AllocatePool (EXT4_DIR_CACHE_INITIAL_SLOTS * sizeof (UINT32));
+  Cache->Records         = AllocatePool (Cache->RecordsCapacity);
+
+  if ((Cache->Slots == NULL) || (Cache->Hashes == NULL) || (Cache->Records == NULL)) {
+    Ext4DirCacheFree (Cache);
+    return NULL;
+  }
+
+  return Cache;
+}
+
+/**
+   Inserts a record in the slot table of a directory cache. The table must have a free slot.
+
+   @param[in out]  Cache       Pointer to the cache.
+   @param[in]      Hash        Hash of the record's name.
+   @param[in]      Slot        1 + offset of the record.
+**/
+STATIC
+VOID
+Ext4DirCacheInsertSlot (
+  IN OUT EXT4_DIR_CACHE  *Cache,
+  IN UINT32              Hash,
+  IN UINT32              Slot
+  )
+{
+  UINT32  Index;
+
+  for (Index = Hash & Cache->SlotMask; Cache->Slots[Index] != 0; Index = (Index + 1) & Cache->SlotMask) {
+  }
+
+  Cache->Slots[Index]  = Slot;
+  Cache->Hashes[Index] = Hash;
+}
+
+/**
+   Adds a directory entry to a directory cache.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in out]  Cache       Pointer to the cache.
+   @param[in]      Entry       Pointer to the directory entry.
+   @param[in]      Ucs2Name    Pointer to the entry's name, converted to UCS-2.
+
+   @return Result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4DirCacheAdd (
+  IN EXT4_PARTITION        *Partition,
+  IN OUT EXT4_DIR_CACHE    *Cache,
+  IN CONST EXT4_DIR_ENTRY  *Entry,
+  IN CONST CHAR16          *Ucs2Name
+  )
+{
+  UINTN   RecordSize;
+  UINT32  *OldSlots;
+  UINT32  *OldHashes;
+  UINT32  OldMask;
+  UINT32  Index;
+
+  RecordSize = ALIGN_VALUE (EXT4_MIN_DIR_ENTRY_LEN + Entry->name_len, 4);
+  if (RecordSize > Cache->RecordsCapacity - Cache->RecordsSize) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Keep the table at most half full
+  if ((Cache->Count + 1) * 2 > Cache->SlotMask + 1) {
+    if (Ext4DirCacheSize (Cache) + (Cache->SlotMask + 1) * 2 * sizeof (UINT32) >
+        EXT4_DIR_CACHE_MAX_SIZE - Partition->DirCacheSize)
+    {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    OldSlots        = Cache->Slots;
+    OldHashes       = Cache->Hashes;
+    OldMask         = Cache->SlotMask;
+    Cache->Slots    = AllocateZeroPool ((OldMask + 1) * 2 * sizeof (UINT32));
+    Cache->Hashes   = AllocatePool ((OldMask + 1) * 2 * sizeof (UINT32));
+    Cache->SlotMask = OldMask * 2 + 1;
+
+    if ((Cache->Slots == NULL) || (Cache->Hashes == NULL)) {
+      if (Cache->Slots != NULL) {
+        FreePool (Cache->Slots);
+      }
+
+      if (Cache->Hashes != NULL) {
+        FreePool (Cache->Hashes);
+      }
+
+      Cache->Slots    = OldSlots;
+      Cache->Hashes   = OldHashes;
+      Cache->SlotMask = OldMask;
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    for (Index = 0; Index <= OldMask; Index++) {
+      if (OldSlots[Index] != 0) {
+        Ext4DirCacheInsertSlot (Cache, OldHashes[Index], OldSlots[Index]);
+      }
+    }
+
+    FreePool (OldSlots);
+    FreePool (OldHashes);
+  }
+
+  CopyMem (Cache->Records + Cache->RecordsSize, Entry, EXT4_MIN_DIR_ENTRY_LEN + Entry->name_len);
+  Ext4DirCacheInsertSlot (Cache, Ext4DirCacheHashName (Ucs2Name), (UINT32)Cache->RecordsSize + 1);
+
+  Cache->RecordsSize += RecordSize;
+  Cache->Count++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Looks up a name in a directory cache, the same way the linear scan does.
+
+   @param[in]      Cache       Pointer to the cache.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS      The entry was found.
+   @retval EFI_NOT_FOUND    The directory has no such entry.
+   @retval !EFI_SUCCESS     Failure.
+**/
+STATIC
+EFI_STATUS
+Ext4DirCacheFind (
+  IN CONST EXT4_DIR_CACHE  *Cache,
+  IN CONST CHAR16          *Name,
+  OUT EXT4_DIR_ENTRY       *Result
+  )
+{
+  EFI_STATUS      Status;
+  UINTN           NameLength;
+  UINT32          Hash;
+  UINT32          Index;
+  EXT4_DIR_ENTRY  *Record;
+  EXT4_DIR_ENTRY  *Match;
+  BOOLEAN         Exact;
+  CHAR16          RecordUcs2Name[EXT4_NAME_MAX + 1];
+
+  NameLength = StrLen (Name);
+  if (NameLength > EXT4_NAME_MAX) {
+    return EFI_NOT_FOUND;
+  }
+
+  Hash  = Ext4DirCacheHashName (Name);
+  Match = NULL;
+  Exact = FALSE;
+
+  for (Index = Hash & Cache->SlotMask; Cache->Slots[Index] != 0; Index = (Index + 1) & Cache->SlotMask) {
+    if (Cache->Hashes[Index] != Hash) {
+      continue;
+    }
+
+    Record = (EXT4_DIR_ENTRY *)(Cache->Records + Cache->Slots[Index] - 1);
+
+    // Same length check as the linear scan
+    if (Record->name_len != NameLength) {
+      continue;
+    }
+
+    Status = Ext4GetUcs2DirentName (Record, RecordUcs2Name);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (StrCmp (RecordUcs2Name, Name) == 0) {
+      Match = Record;
+      Exact = TRUE;
+    } else if (!Exact && ((Match == NULL) || (Record < Match)) &&
+               !Ext4StrCmpInsensitive (RecordUcs2Name, (CHAR16 *)Name))
+    {
+      Match = Record;
+    }
+  }
+
+  if (Match == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  CopyMem (Result, Match, EXT4_MIN_DIR_ENTRY_LEN + Match->name_len);
+  return EFI_SUCCESS;
+}
+
+/**
+   Compares two EXT4_DIR_CACHE structures by directory inode.
+   Used in the partition's directory cache ORDERED_COLLECTION.
+
+   @param[in] UserStruct1  Pointer to the first user structure.
+
+   @param[in] UserStruct2  Pointer to the second user structure.
+
+   @retval <0  If UserStruct1 compares less than UserStruct2.
+
+   @retval  0  If UserStruct1 compares equal to UserStruct2.
+
+   @retval >0  If UserStruct1 compares greater than UserStruct2.
+**/
+STATIC
+INTN
+EFIAPI
+Ext4DirCacheStructCompare (
+  IN CONST VOID  *UserStruct1,
+  IN CONST VOID  *UserStruct2
+  )
+{
+  CONST EXT4_DIR_CACHE  *Cache1;
+  CONST EXT4_DIR_CACHE  *Cache2;
+
+  Cache1 = UserStruct1;
+  Cache2 = UserStruct2;
+
+  return Cache1->DirInode < Cache2->DirInode ? -1 :
+         Cache1->DirInode > Cache2->DirInode ? 1 : 0;
+}
+
+/**
+   Compares a directory inode number against an EXT4_DIR_CACHE.
+   Used in the partition's directory cache ORDERED_COLLECTION.
+
+   @param[in] StandaloneKey  Pointer to the bare key.
+
+   @param[in] UserStruct     Pointer to the user structure with the embedded
+                             key.
+
+   @retval <0  If StandaloneKey compares less than UserStruct's key.
+
+   @retval  0  If StandaloneKey compares equal to UserStruct's key.
+
+   @retval >0  If StandaloneKey compares greater than UserStruct's key.
+**/
+STATIC
+INTN
+EFIAPI
+Ext4DirCacheKeyCompare (
+  IN CONST VOID  *StandaloneKey,
+  IN CONST VOID  *UserStruct
+  )
+{
+  CONST EXT4_DIR_CACHE  *Cache;
+  EXT4_INO_NR           DirInode;
+
+  Cache    = UserStruct;
+  DirInode = (EXT4_INO_NR)(UINTN)StandaloneKey;
+
+  return DirInode < Cache->DirInode ? -1 :
+         DirInode > Cache->DirInode ? 1 : 0;
+}
+
+/**
+   Retrieves the cache of a directory.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Directory   Pointer to the opened directory.
+
+   @return The directory's cache, or NULL if it isn't cached.
+**/
+STATIC
+EXT4_DIR_CACHE *
+Ext4DirCacheGet (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_FILE       *Directory
+  )
+{
+  ORDERED_COLLECTION_ENTRY  *Entry;
+
+  if (Partition->DirCaches == NULL) {
+    return NULL;
+  }
+
+  Entry = OrderedCollectionFind (Partition->DirCaches, (CONST VOID *)(UINTN)Directory->InodeNum);
+  if (Entry == NULL) {
+    return NULL;
+  }
+
+  return OrderedCollectionUserStruct (Entry);
+}
+
+/**
+   Adds a complete directory cache to the partition, or frees it if that fails.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Cache       Pointer to the cache.
+**/
+STATIC
+VOID
+Ext4DirCacheInsert (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_DIR_CACHE  *Cache
+  )
+{
+  RETURN_STATUS  Status;
+
+  if (Ext4DirCacheSize (Cache) > EXT4_DIR_CACHE_MAX_SIZE - Partition->DirCacheSize) {
+    Ext4DirCacheFree (Cache);
+    return;
+  }
+
+  if (Partition->DirCaches == NULL) {
+    Partition->DirCaches = OrderedCollectionInit (Ext4DirCacheStructCompare, Ext4DirCacheKeyCompare);
+    if (Partition->DirCaches == NULL) {
+      Ext4DirCacheFree (Cache);
+      return;
+    }
+  }
+
+  Status = OrderedCollectionInsert (Partition->DirCaches, NULL, Cache);
+  if (EFI_ERROR (Status)) {
+    Ext4DirCacheFree (Cache);
+    return;
+  }
+
+  Partition->DirCacheSize += Ext4DirCacheSize (Cache);
+}
+
+/**
+   Frees the directory caches of a partition.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+**/
+VOID
+Ext4FreeDirCaches (
+  IN EXT4_PARTITION  *Partition
+  )
+{
+  ORDERED_COLLECTION_ENTRY  *MinEntry;
+  EXT4_DIR_CACHE            *Cache;
+
+  if (Partition->DirCaches == NULL) {
+    return;
+  }
+
+  while ((MinEntry = OrderedCollectionMin (Partition->DirCaches)) != NULL) {
+    OrderedCollectionDelete (Partition->DirCaches, MinEntry, (VOID **)&Cache);
+    Ext4DirCacheFree (Cache);
+  }
+
+  OrderedCollectionUninit (Partition->DirCaches);
+  Partition->DirCaches    = NULL;
+  Partition->DirCacheSize = 0;
+}
+
+/**
+   Scans a directory block for an entry, optionally adding every entry to a directory cache.
+   An entry spelled exactly like Name is preferred; otherwise the first entry that matches
+   Name case-insensitively is the one found.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Block       Pointer to the directory block.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+   @param[in out]  Found       Set to TRUE when a matching entry is found.
+   @param[in out]  Exact       Set to TRUE when an entry spelled exactly like Name is found.
+                               Once it's TRUE, Result isn't changed anymore.
+   @param[in out]  Cache       Pointer to the cache being filled, or to NULL. The cache is freed
+                               and the pointer set to NULL if it can't be filled.
+
+   @return Result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4ScanDirBlock (
+  IN EXT4_PARTITION      *Partition,
+  IN CONST CHAR8         *Block,
+  IN CONST CHAR16        *Name,
+  OUT EXT4_DIR_ENTRY     *Result,
+  IN OUT BOOLEAN         *Found,
+  IN OUT BOOLEAN         *Exact,
+  IN OUT EXT4_DIR_CACHE  **Cache
+  )
+{
+  EFI_STATUS      Status;
+  EXT4_DIR_ENTRY  *Entry;
+  UINTN           RemainingBlock;
+  CHAR16          DirentUcs2Name[EXT4_NAME_MAX + 1];
+  UINTN           ToCopy;
+  UINTN           BlockOffset;
+  UINTN           NameLength;
+  BOOLEAN         IsExact;
+
+  NameLength = StrLen (Name);
+
+  for (BlockOffset = 0; BlockOffset < Partition->BlockSize; ) {
+    Entry          = (EXT4_DIR_ENTRY *)(Block + BlockOffset);
+    RemainingBlock = Partition->BlockSize - BlockOffset;
+    // Check if the minimum directory entry fits inside [BlockOffset, EndOfBlock]
+    if (RemainingBlock < EXT4_MIN_DIR_ENTRY_LEN) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    if (!Ext4ValidDirent (Entry)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    if ((Entry->name_len > RemainingBlock) || (Entry->rec_len > RemainingBlock)) {
+      // Corrupted filesystem
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    // Unused entry. Unless we're filling a cache, entries whose names can't match don't
+    // need their names converted either.
+    if ((Entry->inode == 0) || ((*Cache == NULL) && (Entry->name_len != NameLength))) {
+      BlockOffset += Entry->rec_len;
+      continue;
+    }
+
+    Status = Ext4GetUcs2DirentName (Entry, DirentUcs2Name);
+
+    /* In theory, this should never fail.
+     * In reality, it's quite possible that it can fail, considering filenames in
+     * Linux (and probably other nixes) are just null-terminated bags of bytes, and don't
+     * need to form valid ASCII/UTF-8 sequences.
+     */
+    if (EFI_ERROR (Status)) {
+      if (Status == EFI_INVALID_PARAMETER) {
+        // If we error out due to a bad UTF-8 sequence (see Ext4GetUcs2DirentName), skip this entry.
+        // I'm not sure if this is correct behaviour, but I don't think there's a precedent here.
+        BlockOffset += Entry->rec_len;
+        continue;
+      }
+
+      // Other sorts of errors should just error out.
+      return Status;
+    }
+
+    if ((*Cache != NULL) && EFI_ERROR (Ext4DirCacheAdd (Partition, *Cache, Entry, DirentUcs2Name))) {
+      Ext4DirCacheFree (*Cache);
+      *Cache = NULL;
+    }
+
+    if (!*Exact && (Entry->name_len == NameLength) &&
+        !Ext4StrCmpInsensitive (DirentUcs2Name, (CHAR16 *)Name))
+    {
+      IsExact = StrCmp (DirentUcs2Name, Name) == 0;
+
+      if (!*Found || IsExact) {
+        ToCopy = MIN (Entry->rec_len, sizeof (EXT4_DIR_ENTRY));
+
+        CopyMem (Result, Entry, ToCopy);
+        *Found = TRUE;
+        *Exact = IsExact;
+      }
+
+      if (*Exact && (*Cache == NULL)) {
+        return EFI_SUCCESS;
+      }
+    }
+
+    BlockOffset += Entry->rec_len;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Searches a directory block for an entry spelled exactly like Name.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Block       Pointer to the directory block.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS      The entry was found.
+   @retval EFI_NOT_FOUND    The block has no such entry.
+   @retval !EFI_SUCCESS     Failure.
+**/
+EFI_STATUS
+Ext4SearchDirBlock (
+  IN EXT4_PARTITION   *Partition,
+  IN CONST CHAR8      *Block,
+  IN CONST CHAR16     *Name,
+  OUT EXT4_DIR_ENTRY  *Result
+  )
+{
+  EFI_STATUS      Status;
+  BOOLEAN         Found;
+  BOOLEAN         Exact;
+  EXT4_DIR_CACHE  *Cache;
+  EXT4_DIR_ENTRY  Entry;
+
+  Found  = FALSE;
+  Exact  = FALSE;
+  Cache  = NULL;
+  Status = Ext4ScanDirBlock (Partition, Block, Name, &Entry, &Found, &Exact, &Cache);
+
+  if (!EFI_ERROR (Status) && Exact) {
+    CopyMem (Result, &Entry, sizeof (Entry));
+  } else if (!EFI_ERROR (Status)) {
+    Status = EFI_NOT_FOUND;
+  }
+
+  return Status;
+}
+
 /**
    Retrieves a directory entry.
 
+   An entry spelled exactly like Name is preferred; otherwise the first entry that matches
+   Name case-insensitively is the one found.
+
+   Directories that were already scanned are looked up in their cache. Otherwise the
+   hash tree index is tried first, and the linear scan that follows when it doesn't
+   find the name fills the directory's cache.
+
    @param[in]      Directory   Pointer to the opened directory.
    @param[in]      NameUnicode Pointer to the UCS-2 formatted filename.
    @param[in]      Partition   Pointer to the ext4 partition.
@@ -114,11 +749,21 @@ Ext4RetrieveDirent (
   UINT64          DirInoSize;
   UINT32          BlockRemainder;
   UINTN           Length;
-  EXT4_DIR_ENTRY  *Entry;
-  UINTN           RemainingBlock;
-  CHAR16          DirentUcs2Name[EXT4_NAME_MAX + 1];
-  UINTN           ToCopy;
-  UINTN           BlockOffset;
+  EXT4_DIR_CACHE  *Cache;
+  BOOLEAN         Found;
+  BOOLEAN         Exact;
+
+  Cache = Ext4DirCacheGet (Partition, Directory);
+  if (Cache != NULL) {
+    return Ext4DirCacheFind (Cache, Name, Result);
+  }
+
+  // The index only finds names spelled exactly like Name, and a corrupted index
+  // doesn't make the entries themselves unreadable: fall back to a linear scan.
+  Status = Ext4HTreeLookup (Partition, Directory, Name, Result);
+  if ((Status != EFI_NOT_FOUND) && (Status != EFI_UNSUPPORTED) && (Status != EFI_VOLUME_CORRUPTED)) {
+    return Status;
+  }
 
   Buf = AllocatePool (Partition->BlockSize);
 
@@ -138,6 +783,10 @@ Ext4RetrieveDirent (
     goto Out;
   }
 
+  Cache = Ext4DirCacheCreate (Partition, Directory);
+  Found = FALSE;
+  Exact = FALSE;
+
   while (Off < DirInoSize) {
     Length = Partition->BlockSize;
 
@@ -147,71 +796,32 @@ Ext4RetrieveDirent (
       goto Out;
     }
 
-    for (BlockOffset = 0; BlockOffset < Partition->BlockSize; ) {
-      Entry          = (EXT4_DIR_ENTRY *)(Buf + BlockOffset);
-      RemainingBlock = Partition->BlockSize - BlockOffset;
-      // Check if the minimum directory entry fits inside [BlockOffset, EndOfBlock]
-      if (RemainingBlock < EXT4_MIN_DIR_ENTRY_LEN) {
-        Status = EFI_VOLUME_CORRUPTED;
-        goto Out;
-      }
-
-      if (!Ext4ValidDirent (Entry)) {
-        Status = EFI_VOLUME_CORRUPTED;
-        goto Out;
-      }
-
-      if ((Entry->name_len > RemainingBlock) || (Entry->rec_len > RemainingBlock)) {
-        // Corrupted filesystem
-        Status = EFI_VOLUME_CORRUPTED;
-        goto Out;
-      }
-
-      // Unused entry
-      if (Entry->inode == 0) {
-        BlockOffset += Entry->rec_len;
-        continue;
-      }
-
-      Status = Ext4GetUcs2DirentName (Entry, DirentUcs2Name);
-
-      /* In theory, this should never fail.
-       * In reality, it's quite possible that it can fail, considering filenames in
-       * Linux (and probably other nixes) are just null-terminated bags of bytes, and don't
-       * need to form valid ASCII/UTF-8 sequences.
-       */
-      if (EFI_ERROR (Status)) {
-        if (Status == EFI_INVALID_PARAMETER) {
-          // If we error out due to a bad UTF-8 sequence (see Ext4GetUcs2DirentName), skip this entry.
-          // I'm not sure if this is correct behaviour, but I don't think there's a precedent here.
-          BlockOffset += Entry->rec_len;
-          continue;
-        }
-
-        // Other sorts of errors should just error out.
-        FreePool (Buf);
-        return Status;
-      }
-
-      if ((Entry->name_len == StrLen (Name)) &&
-          !Ext4StrCmpInsensitive (DirentUcs2Name, (CHAR16 *)Name))
-      {
-        ToCopy = MIN (Entry->rec_len, sizeof (EXT4_DIR_ENTRY));
+    Status = Ext4ScanDirBlock (Partition, Buf, Name, Result, &Found, &Exact, &Cache);
 
-        CopyMem (Result, Entry, ToCopy);
-        Status = EFI_SUCCESS;
-        goto Out;
-      }
+    if (EFI_ERROR (Status)) {
+      goto Out;
+    }
 
-      BlockOffset += Entry->rec_len;
+    // The cache needs the whole directory
+    if (Exact && (Cache == NULL)) {
+      break;
     }
 
     Off += Partition->BlockSize;
   }
 
-  Status = EFI_NOT_FOUND;
+  if (Cache != NULL) {
+    Ext4DirCacheInsert (Partition, Cache);
+    Cache = NULL;
+  }
+
+  Status = Found ? EFI_SUCCESS : EFI_NOT_FOUND;
 
 Out:
+  if (Cache != NULL) {
+    Ext4DirCacheFree (Cache);
+  }
+
   FreePool (Buf);
   return Status;
 }
@@ -68,7 +68,8 @@
           mostly-list of EXT4_DIR_ENTRY.
        2) Hash tree directories: These are used for larger directories, with
           hundreds of entries, and are designed in a backwards compatible way.
-          These are not yet implemented in the Ext4Dxe driver.
+          Ext4Dxe uses the index for lookups (see HTree.c); the leaf blocks
+          are still walked linearly by ReadDir.
 
   7) Journal
      Ext3/4 filesystems have a journal to help protect the filesystem against
@@ -173,7 +174,8 @@
 #define EXT4_NOCOMPR_FL       0x00000400
 #define EXT4_ENCRYPT_FL       0x00000800
 #define EXT4_BTREE_FL         0x00001000
-#define EXT4_INDEX_FL         0x00002000
+#define EXT4_INDEX_FL         0x00001000
+#define EXT4_IMAGIC_FL        0x00002000
 #define EXT4_JOURNAL_DATA_FL  0x00004000
 #define EXT4_NOTAIL_FL        0x00008000
 #define EXT4_DIRSYNC_FL       0x00010000
@@ -182,6 +184,7 @@
 #define EXT4_EXTENTS_FL       0x00080000
 #define EXT4_VERITY_FL        0x00100000
 #define EXT4_EA_INODE_FL      0x00200000
+#define EXT4_CASEFOLD_FL      0x40000000
 #define EXT4_RESERVED_FL      0x80000000
 
 /* File type flags that are stored in the directory entries */
@@ -424,6 +427,56 @@ typedef struct {
 
 #define EXT4_MIN_DIR_ENTRY_LEN  8
 
+// Hash tree (htree) directories. Block 0 of an indexed directory holds the "." and ".." entries,
+// with ".." covering the rest of the block, followed by an EXT4_DX_ROOT_INFO and the root's
+// EXT4_DX_ENTRY array. Interior nodes are blocks holding a single empty directory entry that
+// covers the whole block, followed by an EXT4_DX_ENTRY array. Old implementations see both as
+// ordinary directory blocks.
+
+#define EXT4_DX_HASH_LEGACY             0
+#define EXT4_DX_HASH_HALF_MD4           1
+#define EXT4_DX_HASH_TEA                2
+#define EXT4_DX_HASH_LEGACY_UNSIGNED    3
+#define EXT4_DX_HASH_HALF_MD4_UNSIGNED  4
+#define EXT4_DX_HASH_TEA_UNSIGNED       5
+
+// s_flags: whether the hash functions treat the name as signed or unsigned chars
+#define EXT4_FLAGS_SIGNED_HASH    0x0001
+#define EXT4_FLAGS_UNSIGNED_HASH  0x0002
+
+typedef struct {
+  UINT32    reserved_zero;
+  UINT8     hash_version;
+  // Length of this structure, 8
+  UINT8     info_length;
+  // Depth of the tree below the root, 0 when the root points to leaf blocks directly
+  UINT8     indirect_levels;
+  UINT8     unused_flags;
+} EXT4_DX_ROOT_INFO;
+
+// The first EXT4_DX_ENTRY of every node has no hash (it covers hash 0 and up).
+// Its hash field holds the number of entries of the node instead.
+typedef struct {
+  UINT16    limit;
+  UINT16    count;
+} EXT4_DX_COUNT_LIMIT;
+
+typedef struct {
+  UINT32    hash;
+  // Logical block of the directory
+  UINT32    block;
+} EXT4_DX_ENTRY;
+
+#define EXT4_DX_ROOT_INFO_OFFSET     24
+#define EXT4_DX_NODE_ENTRIES_OFFSET  8
+
+// Only the low 28 bits of EXT4_DX_ENTRY.block are the block number
+#define EXT4_DX_BLOCK_MASK  0x0FFFFFFF
+
+// Maximum depth of the tree, counting the root; indirect_levels is always smaller
+#define EXT4_DX_MAX_LEVELS           2
+#define EXT4_DX_MAX_LEVELS_LARGEDIR  3
+
 // This on-disk structure is present at the bottom of the extent tree
 typedef struct {
   // First logical block
@@ -77,6 +77,27 @@ Ext4OpenPartition (
 typedef struct _Ext4File     EXT4_FILE;
 typedef struct _Ext4_Dentry  EXT4_DENTRY;
 
+//
+// Inode cache (see BlockGroup.c). Bounds the number of cached inodes per partition;
+// the buckets of the hash table must be a power of 2.
+//
+#define EXT4_INODE_CACHE_MAX_ENTRIES  1024
+#define EXT4_INODE_CACHE_BUCKETS      256
+
+typedef struct {
+  LIST_ENTRY     BucketNode;
+  LIST_ENTRY     LruNode;
+  EXT4_INO_NR    InodeNum;
+  // Checksum-verified copy of the inode, of MAX (InodeSize, sizeof (EXT4_INODE)) bytes
+  EXT4_INODE     Inode;
+} EXT4_INODE_CACHE_ENTRY;
+
+#define EXT4_INODE_CACHE_ENTRY_FROM_BUCKET_NODE(Node) \
+  BASE_CR (Node, EXT4_INODE_CACHE_ENTRY, BucketNode)
+
+#define EXT4_INODE_CACHE_ENTRY_FROM_LRU_NODE(Node) \
+  BASE_CR (Node, EXT4_INODE_CACHE_ENTRY, LruNode)
+
 typedef struct _Ext4_PARTITION {
   EFI_SIMPLE_FILE_SYSTEM_PROTOCOL    Interface;
   EFI_DISK_IO_PROTOCOL               *DiskIo;
@@ -104,6 +125,17 @@ typedef struct _Ext4_PARTITION {
   LIST_ENTRY                         OpenFiles;
 
   EXT4_DENTRY                        *RootDentry;
+
+  // Directory caches (see Directory.c), keyed by directory inode, and their total size
+  ORDERED_COLLECTION                 *DirCaches;
+  UINTN                              DirCacheSize;
+
+  // Inode cache: hash buckets, and the entries from most to least recently used
+  LIST_ENTRY                         InodeCacheBuckets[EXT4_INODE_CACHE_BUCKETS];
+  LIST_ENTRY                         InodeCacheLru;
+  UINTN                              InodeCacheEntries;
+  UINT64                             InodeCacheHits;
+  UINT64                             InodeCacheMisses;
 } EXT4_PARTITION;
 
 /**
@@ -328,6 +360,26 @@ Ext4ReadInode (
   OUT EXT4_INODE     **OutIno
   );
 
+/**
+   Initialises the (empty) inode cache of a partition.
+
+   @param[in]    Partition  Pointer to the opened partition.
+**/
+VOID
+Ext4InitInodeCache (
+  IN EXT4_PARTITION  *Partition
+  );
+
+/**
+   Frees the inode cache of a partition.
+
+   @param[in]    Partition  Pointer to the opened partition.
+**/
+VOID
+Ext4FreeInodeCache (
+  IN EXT4_PARTITION  *Partition
+  );
+
 /**
    Converts blocks to bytes.
 
@@ -415,7 +467,8 @@ struct _Ext4File {
   BASE_CR(Node, EXT4_FILE, OpenFilesListNode)
 
 /**
-   Retrieves a directory entry.
+   Retrieves a directory entry. An entry spelled exactly like the name is
+preferred; otherwise the first entry that matches it case-insensitively is used.
 
    @param[in]      Directory   Pointer to the opened directory.
    @param[in]      NameUnicode Pointer to the UCS-2 formatted filename.
@@ -432,6 +485,59 @@ Ext4RetrieveDirent (
   OUT EXT4_DIR_ENTRY  *Result
   );
 
+/**
+   Searches a directory block for an entry spelled exactly like Name.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+   @param[in]      Block       Pointer to the directory block.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS      The entry was found.
+   @retval EFI_NOT_FOUND    The block has no such entry.
+   @retval !EFI_SUCCESS     Failure.
+**/
+EFI_STATUS
+Ext4SearchDirBlock (
+  IN EXT4_PARTITION   *Partition,
+  IN CONST CHAR8      *Block,
+  IN CONST CHAR16     *Name,
+  OUT EXT4_DIR_ENTRY  *Result
+  );
+
+/**
+   Looks up a name in a directory through its hash tree index.
+   Only entries spelled exactly like Name are found.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS           The entry was found.
+   @retval EFI_NOT_FOUND         No entry spelled like Name exists.
+   @retval EFI_UNSUPPORTED       The directory has no usable index.
+   @retval EFI_VOLUME_CORRUPTED  The index is corrupted.
+   @retval !EFI_SUCCESS          Failure.
+**/
+EFI_STATUS
+Ext4HTreeLookup (
+  IN EXT4_PARTITION   *Partition,
+  IN EXT4_FILE        *Directory,
+  IN CONST CHAR16     *Name,
+  OUT EXT4_DIR_ENTRY  *Result
+  );
+
+/**
+   Frees the directory caches of a partition.
+
+   @param[in]      Partition   Pointer to the ext4 partition.
+**/
+VOID
+Ext4FreeDirCaches (
+  IN EXT4_PARTITION  *Partition
+  );
+
 /**
    Opens a file.
 
@@ -964,6 +1070,17 @@ Ext4StrCmpInsensitive (
   IN CHAR16  *Str2
   );
 
+/**
+   Converts a string to upper case in place, using the same collation as
+Ext4StrCmpInsensitive, so that strings that compare equal end up identical.
+
+   @param[in out]  Str    Pointer to a null terminated string.
+**/
+VOID
+Ext4StrUpr (
+  IN OUT CHAR16  *Str
+  );
+
 /**
    Retrieves the filename of the directory entry and converts it to UTF-16/UCS-2
 
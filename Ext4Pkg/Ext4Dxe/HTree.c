@@ -0,0 +1,693 @@
+/** @file
+  Hash tree (htree) directory lookups
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include "Ext4Dxe.h"
+
+#include <Library/BaseUcs2Utf8Lib.h>
+
+//
+// The directory hash functions below must give the same results as the ones the
+// filesystem was indexed with, which are described in the ext4 documentation
+// (and implemented in Linux's fs/ext4/hash.c).
+//
+
+#define EXT4_TEA_DELTA      0x9E3779B9
+#define EXT4_HALF_MD4_K2    0x5A827999
+#define EXT4_HALF_MD4_K3    0x6ED9EBA1
+#define EXT4_HTREE_EOF_32   0x7FFFFFFFU
+
+#define EXT4_MD4_F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define EXT4_MD4_G(x, y, z)  (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define EXT4_MD4_H(x, y, z)  ((x) ^ (y) ^ (z))
+
+#define EXT4_MD4_ROUND(f, a, b, c, d, x, s)                                    \
+  do {                                                                         \
+    (a) += f ((b), (c), (d)) + (x);                                            \
+    (a)  = LRotU32 ((a), (s));                                                 \
+  } while (0)
+
+typedef struct {
+  // Node block, as read from the directory
+  CHAR8            *Buffer;
+  EXT4_DX_ENTRY    *Entries;
+  UINT16           Count;
+  // Index of the entry we descended through
+  UINT16           At;
+} EXT4_DX_FRAME;
+
+/**
+   The TEA transform, used by the EXT4_DX_HASH_TEA hash.
+
+   @param[in out]  Buf    Hash state.
+   @param[in]      In     Next 16 bytes of input.
+**/
+STATIC
+VOID
+Ext4TeaTransform (
+  IN OUT UINT32    Buf[4],
+  IN CONST UINT32  In[4]
+  )
+{
+  UINT32  Sum;
+  UINT32  B0;
+  UINT32  B1;
+  UINTN   Round;
+
+  Sum = 0;
+  B0  = Buf[0];
+  B1  = Buf[1];
+
+  for (Round = 0; Round < 16; Round++) {
+    Sum += EXT4_TEA_DELTA;
+    B0  += ((B1 << 4) + In[0]) ^ (B1 + Sum) ^ ((B1 >> 5) + In[1]);
+    B1  += ((B0 << 4) + In[2]) ^ (B0 + Sum) ^ ((B0 >> 5) + In[3]);
+  }
+
+  Buf[0] += B0;
+  Buf[1] += B1;
+}
+
+/**
+   A cut-down MD4 transform, used by the EXT4_DX_HASH_HALF_MD4 hash.
+
+   @param[in out]  Buf    Hash state.
+   @param[in]      In     Next 32 bytes of input.
+**/
+STATIC
+VOID
+Ext4HalfMd4Transform (
+  IN OUT UINT32    Buf[4],
+  IN CONST UINT32  In[8]
+  )
+{
+  UINT32  A;
+  UINT32  B;
+  UINT32  C;
+  UINT32  D;
+
+  A = Buf[0];
+  B = Buf[1];
+  C = Buf[2];
+  D = Buf[3];
+
+  EXT4_MD4_ROUND (EXT4_MD4_F, A, B, C, D, In[0], 3);
+  EXT4_MD4_ROUND (EXT4_MD4_F, D, A, B, C, In[1], 7);
+  EXT4_MD4_ROUND (EXT4_MD4_F, C, D, A, B, In[2], 11);
+  EXT4_MD4_ROUND (EXT4_MD4_F, B, C, D, A, In[3], 19);
+  EXT4_MD4_ROUND (EXT4_MD4_F, A, B, C, D, In[4], 3);
+  EXT4_MD4_ROUND (EXT4_MD4_F, D, A, B, C, In[5], 7);
+  EXT4_MD4_ROUND (EXT4_MD4_F, C, D, A, B, In[6], 11);
+  EXT4_MD4_ROUND (EXT4_MD4_F, B, C, D, A, In[7], 19);
+
+  EXT4_MD4_ROUND (EXT4_MD4_G, A, B, C, D, In[1] + EXT4_HALF_MD4_K2, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_G, D, A, B, C, In[3] + EXT4_HALF_MD4_K2, 5);
+  EXT4_MD4_ROUND (EXT4_MD4_G, C, D, A, B, In[5] + EXT4_HALF_MD4_K2, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_G, B, C, D, A, In[7] + EXT4_HALF_MD4_K2, 13);
+  EXT4_MD4_ROUND (EXT4_MD4_G, A, B, C, D, In[0] + EXT4_HALF_MD4_K2, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_G, D, A, B, C, In[2] + EXT4_HALF_MD4_K2, 5);
+  EXT4_MD4_ROUND (EXT4_MD4_G, C, D, A, B, In[4] + EXT4_HALF_MD4_K2, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_G, B, C, D, A, In[6] + EXT4_HALF_MD4_K2, 13);
+
+  EXT4_MD4_ROUND (EXT4_MD4_H, A, B, C, D, In[3] + EXT4_HALF_MD4_K3, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_H, D, A, B, C, In[7] + EXT4_HALF_MD4_K3, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_H, C, D, A, B, In[2] + EXT4_HALF_MD4_K3, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_H, B, C, D, A, In[6] + EXT4_HALF_MD4_K3, 15);
+  EXT4_MD4_ROUND (EXT4_MD4_H, A, B, C, D, In[1] + EXT4_HALF_MD4_K3, 3);
+  EXT4_MD4_ROUND (EXT4_MD4_H, D, A, B, C, In[5] + EXT4_HALF_MD4_K3, 9);
+  EXT4_MD4_ROUND (EXT4_MD4_H, C, D, A, B, In[0] + EXT4_HALF_MD4_K3, 11);
+  EXT4_MD4_ROUND (EXT4_MD4_H, B, C, D, A, In[4] + EXT4_HALF_MD4_K3, 15);
+
+  Buf[0] += A;
+  Buf[1] += B;
+  Buf[2] += C;
+  Buf[3] += D;
+}
+
+/**
+   Reads a name byte the way the hash functions see it: as a signed char, unless
+   the filesystem was indexed with the unsigned variants of the hashes.
+
+   @param[in]      Char      Name byte.
+   @param[in]      Unsigned  TRUE if the hash treats names as unsigned chars.
+
+   @return The byte, sign- or zero-extended.
+**/
+STATIC
+UINT32
+Ext4HashChar (
+  IN CHAR8    Char,
+  IN BOOLEAN  Unsigned
+  )
+{
+  return Unsigned ? (UINT32)(UINT8)Char : (UINT32)(INT32)(INT8)Char;
+}
+
+/**
+   The legacy ("dx_hack") directory hash.
+
+   @param[in]      Name      Pointer to the name.
+   @param[in]      Length    Length of the name.
+   @param[in]      Unsigned  TRUE if the hash treats names as unsigned chars.
+
+   @return The hash.
+**/
+STATIC
+UINT32
+Ext4LegacyHash (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Length,
+  IN BOOLEAN      Unsigned
+  )
+{
+  UINT32  Hash;
+  UINT32  Hash0;
+  UINT32  Hash1;
+
+  Hash0 = 0x12A3FE2D;
+  Hash1 = 0x37ABE8F9;
+
+  while (Length-- != 0) {
+    Hash = Hash1 + (Hash0 ^ (Ext4HashChar (*Name++, Unsigned) * 7152373));
+
+    if ((Hash & BIT31) != 0) {
+      Hash -= 0x7FFFFFFF;
+    }
+
+    Hash1 = Hash0;
+    Hash0 = Hash;
+  }
+
+  return Hash0 << 1;
+}
+
+/**
+   Packs (up to) Num * 4 bytes of the name into the input words of a hash transform,
+   padding with the name's length.
+
+   @param[in]      Name      Pointer to the rest of the name.
+   @param[in]      Length    Length of the rest of the name.
+   @param[out]     Buf       Input words.
+   @param[in]      Num       Number of input words.
+   @param[in]      Unsigned  TRUE if the hash treats names as unsigned chars.
+**/
+STATIC
+VOID
+Ext4StrToHashBuf (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Length,
+  OUT UINT32      *Buf,
+  IN UINTN        Num,
+  IN BOOLEAN      Unsigned
+  )
+{
+  UINT32  Pad;
+  UINT32  Val;
+  UINTN   Index;
+  UINTN   Word;
+
+  Pad  = (UINT32)Length | ((UINT32)Length << 8);
+  Pad |= Pad << 16;
+
+  Val = Pad;
+  if (Length > Num * 4) {
+    Length = Num * 4;
+  }
+
+  Word = 0;
+  for (Index = 0; Index < Length; Index++) {
+    Val = Ext4HashChar (Name[Index], Unsigned) + (Val << 8);
+    if ((Index % 4) == 3) {
+      Buf[Word++] = Val;
+      Val         = Pad;
+    }
+  }
+
+  if (Word < Num) {
+    Buf[Word++] = Val;
+  }
+
+  while (Word < Num) {
+    Buf[Word++] = Pad;
+  }
+}
+
+/**
+   Hashes a name with one of the directory hash functions.
+
+   @param[in]      Partition    Pointer to the opened partition.
+   @param[in]      HashVersion  One of the EXT4_DX_HASH_* hashes.
+   @param[in]      Name         Pointer to the name.
+   @param[in]      Length       Length of the name.
+   @param[out]     Hash         Major hash of the name, as stored in the index.
+
+   @retval EFI_SUCCESS      The name was hashed.
+   @retval EFI_UNSUPPORTED  Unknown hash function.
+**/
+STATIC
+EFI_STATUS
+Ext4DirHash (
+  IN CONST EXT4_PARTITION  *Partition,
+  IN UINT8                 HashVersion,
+  IN CONST CHAR8           *Name,
+  IN UINTN                 Length,
+  OUT UINT32               *Hash
+  )
+{
+  UINT32   Buf[4];
+  UINT32   In[8];
+  UINT32   Result;
+  UINTN    Index;
+  BOOLEAN  Unsigned;
+
+  Buf[0] = 0x67452301;
+  Buf[1] = 0xEFCDAB89;
+  Buf[2] = 0x98BADCFE;
+  Buf[3] = 0x10325476;
+
+  // An all-zero seed means the default one
+  for (Index = 0; Index < 4; Index++) {
+    if (Partition->SuperBlock.s_hash_seed[Index] != 0) {
+      CopyMem (Buf, Partition->SuperBlock.s_hash_seed, sizeof (Buf));
+      break;
+    }
+  }
+
+  Unsigned = HashVersion >= EXT4_DX_HASH_LEGACY_UNSIGNED;
+
+  switch (HashVersion) {
+    case EXT4_DX_HASH_LEGACY:
+    case EXT4_DX_HASH_LEGACY_UNSIGNED:
+      Result = Ext4LegacyHash (Name, Length, Unsigned);
+      break;
+
+    case EXT4_DX_HASH_HALF_MD4:
+    case EXT4_DX_HASH_HALF_MD4_UNSIGNED:
+      do {
+        Ext4StrToHashBuf (Name, Length, In, 8, Unsigned);
+        Ext4HalfMd4Transform (Buf, In);
+        Name   += 32;
+        Length -= MIN (Length, 32);
+      } while (Length != 0);
+
+      Result = Buf[1];
+      break;
+
+    case EXT4_DX_HASH_TEA:
+    case EXT4_DX_HASH_TEA_UNSIGNED:
+      do {
+        Ext4StrToHashBuf (Name, Length, In, 4, Unsigned);
+        Ext4TeaTransform (Buf, In);
+        Name   += 16;
+        Length -= MIN (Length, 16);
+      } while (Length != 0);
+
+      Result = Buf[0];
+      break;
+
+    default:
+      return EFI_UNSUPPORTED;
+  }
+
+  Result &= ~1U;
+  if (Result == (EXT4_HTREE_EOF_32 << 1)) {
+    Result = (EXT4_HTREE_EOF_32 - 1) << 1;
+  }
+
+  *Hash = Result;
+  return EFI_SUCCESS;
+}
+
+/**
+   Reads a whole block of a directory.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Block       Logical block number.
+   @param[out]     Buffer      Pointer to a buffer of BlockSize bytes.
+
+   @return Result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4ReadDirBlock (
+  IN EXT4_PARTITION  *Partition,
+  IN EXT4_FILE       *Directory,
+  IN UINT32          Block,
+  OUT CHAR8          *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Length;
+
+  Length = Partition->BlockSize;
+  Status = Ext4Read (Partition, Directory, Buffer, MultU64x32 (Block, Partition->BlockSize), &Length);
+
+  if (!EFI_ERROR (Status) && (Length != Partition->BlockSize)) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+  return Status;
+}
+
+/**
+   Validates the EXT4_DX_ENTRY array of an index node and fills in its frame.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in out]  Frame       Frame of the node, with Buffer set.
+   @param[in]      Offset      Offset of the array in the node's block.
+
+   @retval EFI_SUCCESS           The array is sane.
+   @retval EFI_VOLUME_CORRUPTED  The node is corrupted.
+**/
+STATIC
+EFI_STATUS
+Ext4SetupDxFrame (
+  IN EXT4_PARTITION     *Partition,
+  IN OUT EXT4_DX_FRAME  *Frame,
+  IN UINTN              Offset
+  )
+{
+  EXT4_DX_COUNT_LIMIT  *CountLimit;
+
+  CountLimit = (EXT4_DX_COUNT_LIMIT *)(Frame->Buffer + Offset);
+
+  if ((CountLimit->count == 0) || (CountLimit->count > CountLimit->limit) ||
+      (Offset + CountLimit->limit * sizeof (EXT4_DX_ENTRY) > Partition->BlockSize))
+  {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Frame->Entries = (EXT4_DX_ENTRY *)CountLimit;
+  Frame->Count   = CountLimit->count;
+  Frame->At      = 0;
+
+  return EFI_SUCCESS;
+}
+
+/**
+   Finds the entry of an index node that covers a hash: the last entry whose hash
+   is not larger than it. Entry 0 has no hash and covers everything below entry 1.
+
+   @param[in]      Frame       Frame of the node.
+   @param[in]      Hash        Hash of the name being looked up.
+
+   @return Index of the entry.
+**/
+STATIC
+UINT16
+Ext4DxSearch (
+  IN CONST EXT4_DX_FRAME  *Frame,
+  IN UINT32               Hash
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+
+  Low  = 1;
+  High = Frame->Count;
+
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Frame->Entries[Middle].hash > Hash) {
+      High = Middle;
+    } else {
+      Low = Middle + 1;
+    }
+  }
+
+  return (UINT16)(Low - 1);
+}
+
+/**
+   Descends through the entry Frames[Level].At, down to the leaf, following the first
+   entry of every node below Level unless FollowHash is set.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in out]  Frames      Frames of the path, Frames[0] being the root.
+   @param[in]      Level       Level to descend from.
+   @param[in]      Levels      Number of index levels, counting the root.
+   @param[in]      FollowHash  TRUE to search each node for Hash.
+   @param[in]      Hash        Hash of the name being looked up.
+   @param[out]     Leaf        Logical block number of the leaf.
+
+   @return Result of the operation.
+**/
+STATIC
+EFI_STATUS
+Ext4DxDescend (
+  IN EXT4_PARTITION     *Partition,
+  IN EXT4_FILE          *Directory,
+  IN OUT EXT4_DX_FRAME  *Frames,
+  IN UINTN              Level,
+  IN UINTN              Levels,
+  IN BOOLEAN            FollowHash,
+  IN UINT32             Hash,
+  OUT UINT32            *Leaf
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Block;
+  UINT32      NumBlocks;
+
+  NumBlocks = (UINT32)DivU64x32 (EXT4_INODE_SIZE (Directory->Inode), Partition->BlockSize);
+
+  while (TRUE) {
+    Block = Frames[Level].Entries[Frames[Level].At].block & EXT4_DX_BLOCK_MASK;
+
+    if (Block >= NumBlocks) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    if (++Level == Levels) {
+      *Leaf = Block;
+      return EFI_SUCCESS;
+    }
+
+    Status = Ext4ReadDirBlock (Partition, Directory, Block, Frames[Level].Buffer);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Status = Ext4SetupDxFrame (Partition, &Frames[Level], EXT4_DX_NODE_ENTRIES_OFFSET);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (FollowHash) {
+      Frames[Level].At = Ext4DxSearch (&Frames[Level], Hash);
+    }
+  }
+}
+
+/**
+   Moves to the next leaf whose names may still hash to Hash. Names with the same
+   hash can spill over into the following leaves, which is then flagged by setting
+   the low bit of the hash of the next index entry.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in out]  Frames      Frames of the path, Frames[0] being the root.
+   @param[in]      Levels      Number of index levels, counting the root.
+   @param[in]      Hash        Hash of the name being looked up.
+   @param[out]     Leaf        Logical block number of the next leaf.
+
+   @retval EFI_SUCCESS      Leaf is the next leaf to scan.
+   @retval EFI_NOT_FOUND    No more leaves can hold the name.
+   @retval !EFI_SUCCESS     Failure.
+**/
+STATIC
+EFI_STATUS
+Ext4DxNextLeaf (
+  IN EXT4_PARTITION     *Partition,
+  IN EXT4_FILE          *Directory,
+  IN OUT EXT4_DX_FRAME  *Frames,
+  IN UINTN              Levels,
+  IN UINT32             Hash,
+  OUT UINT32            *Leaf
+  )
+{
+  UINTN  Level;
+
+  Level = Levels - 1;
+
+  while (Frames[Level].At + 1 >= Frames[Level].Count) {
+    if (Level == 0) {
+      return EFI_NOT_FOUND;
+    }
+
+    Level--;
+  }
+
+  Frames[Level].At++;
+
+  if ((Frames[Level].Entries[Frames[Level].At].hash & ~1U) != Hash) {
+    return EFI_NOT_FOUND;
+  }
+
+  return Ext4DxDescend (Partition, Directory, Frames, Level, Levels, FALSE, Hash, Leaf);
+}
+
+/**
+   Looks up a name in a directory through its hash tree index, reading only the
+   index blocks on the path to the name and the leaves its hash maps to.
+
+   The name's hash only finds entries spelled exactly like Name; callers fall back
+   to a linear scan when this returns EFI_NOT_FOUND, to find entries that only match
+   Name case-insensitively.
+
+   @param[in]      Partition   Pointer to the opened partition.
+   @param[in]      Directory   Pointer to the opened directory.
+   @param[in]      Name        Pointer to the UCS-2 formatted filename.
+   @param[out]     Result      Pointer to the destination directory entry.
+
+   @retval EFI_SUCCESS           The entry was found.
+   @retval EFI_NOT_FOUND         No entry spelled like Name exists.
+   @retval EFI_UNSUPPORTED       The directory has no usable index.
+   @retval EFI_VOLUME_CORRUPTED  The index is corrupted.
+   @retval !EFI_SUCCESS          Failure.
+**/
+EFI_STATUS
+Ext4HTreeLookup (
+  IN EXT4_PARTITION   *Partition,
+  IN EXT4_FILE        *Directory,
+  IN CONST CHAR16     *Name,
+  OUT EXT4_DIR_ENTRY  *Result
+  )
+{
+  EFI_STATUS         Status;
+  EXT4_INODE         *Inode;
+  CHAR8              *Utf8Name;
+  UINTN              NameLength;
+  CHAR8              *Buffer;
+  CHAR8              *LeafBuffer;
+  EXT4_DIR_ENTRY     *Dot;
+  EXT4_DIR_ENTRY     *DotDot;
+  EXT4_DX_ROOT_INFO  *Info;
+  EXT4_DX_FRAME      Frames[EXT4_DX_MAX_LEVELS_LARGEDIR];
+  UINTN              MaxLevels;
+  UINTN              Levels;
+  UINTN              Level;
+  UINT8              HashVersion;
+  UINT32             Hash;
+  UINT32             Leaf;
+  UINT32             NumBlocks;
+  UINT32             Scanned;
+
+  Inode = Directory->Inode;
+
+  if (!EXT4_HAS_COMPAT (Partition, EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+      ((Inode->i_flags & EXT4_INDEX_FL) == 0) ||
+      ((Inode->i_flags & (EXT4_ENCRYPT_FL | EXT4_CASEFOLD_FL)) != 0))
+  {
+    return EFI_UNSUPPORTED;
+  }
+
+  // "." and ".." live in block 0, outside of the index
+  if ((StrCmp (Name, L".") == 0) || (StrCmp (Name, L"..") == 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = UCS2StrToUTF8 ((CHAR16 *)Name, &Utf8Name);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NameLength = AsciiStrLen (Utf8Name);
+  if ((NameLength == 0) || (NameLength > EXT4_NAME_MAX)) {
+    FreePool (Utf8Name);
+    return EFI_NOT_FOUND;
+  }
+
+  MaxLevels = EXT4_HAS_INCOMPAT (Partition, EXT4_FEATURE_INCOMPAT_LARGEDIR) ?
+              EXT4_DX_MAX_LEVELS_LARGEDIR : EXT4_DX_MAX_LEVELS;
+
+  // One buffer per index level, plus the leaf
+  Buffer = AllocatePool ((MaxLevels + 1) * Partition->BlockSize);
+  if (Buffer == NULL) {
+    FreePool (Utf8Name);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Level = 0; Level < MaxLevels; Level++) {
+    Frames[Level].Buffer = Buffer + Level * Partition->BlockSize;
+  }
+
+  LeafBuffer = Buffer + MaxLevels * Partition->BlockSize;
+
+  Status = Ext4ReadDirBlock (Partition, Directory, 0, Frames[0].Buffer);
+  if (EFI_ERROR (Status)) {
+    goto Out;
+  }
+
+  // The root block starts with "." (12 bytes) and "..", which covers the rest of the block
+  // and hides the index from implementations that don't know about it.
+  Dot    = (EXT4_DIR_ENTRY *)Frames[0].Buffer;
+  DotDot = (EXT4_DIR_ENTRY *)(Frames[0].Buffer + 12);
+  Info   = (EXT4_DX_ROOT_INFO *)(Frames[0].Buffer + EXT4_DX_ROOT_INFO_OFFSET);
+
+  if ((Partition->BlockSize < EXT4_DX_ROOT_INFO_OFFSET + sizeof (EXT4_DX_ROOT_INFO) + sizeof (EXT4_DX_ENTRY)) ||
+      (Dot->rec_len != 12) || (DotDot->rec_len != Partition->BlockSize - 12) ||
+      (Info->info_length != sizeof (EXT4_DX_ROOT_INFO)) || (Info->indirect_levels >= MaxLevels))
+  {
+    Status = EFI_VOLUME_CORRUPTED;
+    goto Out;
+  }
+
+  // Bit 0 of unused_flags flags an index we don't know how to read
+  if (((Info->unused_flags & 1) != 0) || (Info->hash_version > EXT4_DX_HASH_TEA)) {
+    Status = EFI_UNSUPPORTED;
+    goto Out;
+  }
+
+  HashVersion = Info->hash_version;
+  if ((HashVersion <= EXT4_DX_HASH_TEA) &&
+      ((Partition->SuperBlock.s_flags & EXT4_FLAGS_UNSIGNED_HASH) != 0))
+  {
+    HashVersion += EXT4_DX_HASH_LEGACY_UNSIGNED;
+  }
+
+  Status = Ext4DirHash (Partition, HashVersion, Utf8Name, NameLength, &Hash);
+  if (EFI_ERROR (Status)) {
+    goto Out;
+  }
+
+  Status = Ext4SetupDxFrame (Partition, &Frames[0], EXT4_DX_ROOT_INFO_OFFSET + Info->info_length);
+  if (EFI_ERROR (Status)) {
+    goto Out;
+  }
+
+  Levels       = Info->indirect_levels + 1;
+  Frames[0].At = Ext4DxSearch (&Frames[0], Hash);
+  NumBlocks    = (UINT32)DivU64x32 (EXT4_INODE_SIZE (Inode), Partition->BlockSize);
+
+  Status = Ext4DxDescend (Partition, Directory, Frames, 0, Levels, TRUE, Hash, &Leaf);
+
+  // Scanned bounds the walk in case the index loops
+  for (Scanned = 0; !EFI_ERROR (Status) && Scanned < NumBlocks; Scanned++) {
+    Status = Ext4ReadDirBlock (Partition, Directory, Leaf, LeafBuffer);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Status = Ext4SearchDirBlock (Partition, LeafBuffer, Name, Result);
+    if (Status != EFI_NOT_FOUND) {
+      break;
+    }
+
+    Status = Ext4DxNextLeaf (Partition, Directory, Frames, Levels, Hash, &Leaf);
+  }
+
+  if (!EFI_ERROR (Status) && (Scanned == NumBlocks)) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+Out:
+  FreePool (Buffer);
+  FreePool (Utf8Name);
+  return Status;
+}
@@ -36,6 +36,7 @@ Ext4OpenPartition (
   }
 
   InitializeListHead (&Part->OpenFiles);
+  Ext4InitInodeCache (Part);
 
   Part->BlockIo = BlockIo;
   Part->DiskIo  = DiskIo;
@@ -125,6 +126,9 @@ Ext4UnmountAndFreePartition (
     DEBUG ((DEBUG_ERROR, "[ext4] Failed to delete root dentry - resource leak present.\n"));
   }
 
+  Ext4FreeDirCaches (Partition);
+  Ext4FreeInodeCache (Partition);
+
   FreePool (Partition->BlockGroups);
   FreePool (Partition);
 
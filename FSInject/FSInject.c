@@ -328,6 +328,344 @@ GetInjectionFName(IN CHAR16 *TgtDir, IN CHAR16 *SrcDir, IN CHAR16 *FName)
 	return Str1;
 }
 
+/** Adds String to the blacklist trie under Root. Returns FALSE if out of memory. */
+BOOLEAN
+EFIAPI
+BlacklistTrieAdd(IN FSI_BLACKLIST_NODE *Root, IN CHAR16 *String)
+{
+	FSI_BLACKLIST_NODE	*Node;
+	FSI_BLACKLIST_NODE	*Child;
+	CHAR16				Chr;
+	
+	if (String == NULL || *String == L'\0') {
+		// StriStartsWithBasic() never matched an empty name against a path
+		return TRUE;
+	}
+	Node = Root;
+	for (; *String != L'\0'; String++) {
+		Chr = ToUpperChar(*String);
+		for (Child = Node->Child; Child != NULL && Child->Chr != Chr; Child = Child->Next) {
+		}
+		if (Child == NULL) {
+			Child = AllocateZeroPool(sizeof(FSI_BLACKLIST_NODE));
+			if (Child == NULL) {
+				return FALSE;
+			}
+			Child->Chr = Chr;
+			Child->Next = Node->Child;
+			Node->Child = Child;
+		}
+		Node = Child;
+	}
+	Node->IsEnd = TRUE;
+	return TRUE;
+}
+
+/** Releases blacklist trie nodes: Node, its siblings and all their children. */
+VOID
+EFIAPI
+BlacklistTrieFree(IN FSI_BLACKLIST_NODE *Node)
+{
+	FSI_BLACKLIST_NODE	*Next;
+	
+	while (Node != NULL) {
+		Next = Node->Next;
+		BlacklistTrieFree(Node->Child);
+		FreePool(Node);
+		Node = Next;
+	}
+}
+
+/** Compiles blacklist string list into a prefix trie. Returns NULL if list is empty or there is no memory. */
+FSI_BLACKLIST_NODE*
+EFIAPI
+BlacklistTrieCompile(IN FSI_STRING_LIST *StringList)
+{
+	FSI_BLACKLIST_NODE		*Root;
+	FSI_STRING_LIST_ENTRY	*StringEntry;
+	
+	if (StringList == NULL || IsListEmpty(&StringList->List)) {
+		return NULL;
+	}
+	Root = AllocateZeroPool(sizeof(FSI_BLACKLIST_NODE));
+	if (Root == NULL) {
+		return NULL;
+	}
+	for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&StringList->List);
+		 !IsNull (&StringList->List, &StringEntry->List);
+		 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&StringList->List, &StringEntry->List)
+		 )
+	{
+		if (!BlacklistTrieAdd(Root, StringEntry->String)) {
+			BlacklistTrieFree(Root);
+			return NULL;
+		}
+	}
+	return Root;
+}
+
+/** Walks String down the trie from Node. Sets *Blocked if a blacklisted name ends on the way.
+  * Returns reached node, or NULL if no blacklisted name continues with String.
+  */
+FSI_BLACKLIST_NODE*
+EFIAPI
+BlacklistTrieWalk(IN FSI_BLACKLIST_NODE *Node, IN CHAR16 *String, IN OUT BOOLEAN *Blocked)
+{
+	CHAR16		Chr;
+	
+	for (; Node != NULL && *String != L'\0' && !*Blocked; String++) {
+		Chr = ToUpperChar(*String);
+		for (Node = Node->Child; Node != NULL && Node->Chr != Chr; Node = Node->Next) {
+		}
+		if (Node != NULL && Node->IsEnd) {
+			*Blocked = TRUE;
+		}
+	}
+	return Node;
+}
+
+/** Returns TRUE if Path (or Path\Name if Name is given) starts with some blacklisted name.
+  * Same result as StriStartsWithBasic() against every list entry, but in one pass over the path.
+  */
+BOOLEAN
+EFIAPI
+IsBlacklisted(IN FSI_BLACKLIST_NODE *Root, IN CHAR16 *Path, IN CHAR16 *Name OPTIONAL)
+{
+	FSI_BLACKLIST_NODE	*Node;
+	CHAR16				*LastChar;
+	BOOLEAN				Blocked = FALSE;
+	
+	if (Root == NULL || Path == NULL) {
+		return FALSE;
+	}
+	Node = BlacklistTrieWalk(Root, Path, &Blocked);
+	if (Name != NULL) {
+		LastChar = GetStrLastChar(Path);
+		if (LastChar == NULL || *LastChar != L'\\') {
+			Node = BlacklistTrieWalk(Node, L"\\", &Blocked);
+		}
+		BlacklistTrieWalk(Node, Name, &Blocked);
+	}
+	return Blocked;
+}
+
+/** Merged dir listing entry: UINT64 size of EFI_FILE_INFO, then EFI_FILE_INFO padded to 8 bytes. */
+#define MERGED_DIR_ENTRY_SIZE(InfoSize) (sizeof(UINT64) + ALIGN_VALUE((InfoSize), 8))
+
+/** Releases cached merged listing of injection point. Called when target volume may change. */
+VOID
+EFIAPI
+DropMergedDir(IN FSI_SIMPLE_FILE_SYSTEM_PROTOCOL *FSIFS)
+{
+	if (FSIFS != NULL && FSIFS->MergedDir != NULL) {
+		FreePool(FSIFS->MergedDir);
+		FSIFS->MergedDir = NULL;
+		FSIFS->MergedDirSize = 0;
+		// read positions of open handles point into the dropped listing
+		FSIFS->MergedDirGeneration++;
+	}
+}
+
+/** Reads all dir entries from FP into merged dir entries. Caller frees *Buffer. */
+EFI_STATUS
+EFIAPI
+ReadAllDirEntries(IN EFI_FILE_PROTOCOL *FP, OUT UINT8 **Buffer, OUT UINTN *Size)
+{
+	EFI_STATUS		Status;
+	EFI_FILE_INFO	*FInfo;
+	UINTN			FInfoCapacity;
+	UINTN			ReadSize;
+	UINTN			EntrySize;
+	UINTN			Capacity;
+	UINT8			*NewBuffer;
+	
+	*Size = 0;
+	Capacity = SIZE_4KB;
+	*Buffer = AllocatePool(Capacity);
+	FInfoCapacity = SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16);
+	FInfo = AllocatePool(FInfoCapacity);
+	if (*Buffer == NULL || FInfo == NULL) {
+		Status = EFI_OUT_OF_RESOURCES;
+		goto Exit;
+	}
+	
+	Status = FP->SetPosition(FP, 0);
+	while (!EFI_ERROR(Status)) {
+		ReadSize = FInfoCapacity;
+		Status = FP->Read(FP, &ReadSize, FInfo);
+		if (Status == EFI_BUFFER_TOO_SMALL) {
+			FreePool(FInfo);
+			FInfoCapacity = ReadSize;
+			FInfo = AllocatePool(FInfoCapacity);
+			if (FInfo == NULL) {
+				Status = EFI_OUT_OF_RESOURCES;
+				break;
+			}
+			Status = FP->Read(FP, &ReadSize, FInfo);
+		}
+		if (EFI_ERROR(Status) || ReadSize == 0) {
+			break;
+		}
+		EntrySize = MERGED_DIR_ENTRY_SIZE(ReadSize);
+		if (*Size + EntrySize > Capacity) {
+			NewBuffer = ReallocatePool(Capacity, MAX(Capacity * 2, *Size + EntrySize), *Buffer);
+			if (NewBuffer == NULL) {
+				Status = EFI_OUT_OF_RESOURCES;
+				break;
+			}
+			Capacity = MAX(Capacity * 2, *Size + EntrySize);
+			*Buffer = NewBuffer;
+		}
+		*(UINT64 *)(*Buffer + *Size) = ReadSize;
+		CopyMem(*Buffer + *Size + sizeof(UINT64), FInfo, ReadSize);
+		*Size += EntrySize;
+	}
+	
+Exit:
+	if (FInfo != NULL) {
+		FreePool(FInfo);
+	}
+	if (EFI_ERROR(Status) && *Buffer != NULL) {
+		FreePool(*Buffer);
+		*Buffer = NULL;
+	}
+	// leave positions as after SetPosition(0), as caller expects from new listing
+	FP->SetPosition(FP, 0);
+	return Status;
+}
+
+/** Returns TRUE if merged dir entries in Buffer contain FileName (case insensitive). */
+BOOLEAN
+EFIAPI
+MergedDirContains(IN UINT8 *Buffer, IN UINTN Size, IN CHAR16 *FileName)
+{
+	UINTN			Pos;
+	EFI_FILE_INFO	*FInfo;
+	
+	for (Pos = 0; Pos < Size; Pos += MERGED_DIR_ENTRY_SIZE(*(UINT64 *)(Buffer + Pos))) {
+		FInfo = (EFI_FILE_INFO *)(Buffer + Pos + sizeof(UINT64));
+		if (StrCmpiBasic(FInfo->FileName, FileName) == 0) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** Appends non blacklisted entries from Buffer to FSIFS->MergedDir. If Tgt is given, skips entries also in Tgt. */
+VOID
+EFIAPI
+MergeDirEntries(
+	IN FSI_SIMPLE_FILE_SYSTEM_PROTOCOL	*FSIFS,
+	IN CHAR16							*DirName,
+	IN UINT8							*Buffer,
+	IN UINTN							Size,
+	IN UINT8							*Tgt OPTIONAL,
+	IN UINTN							TgtSize
+)
+{
+	UINTN			Pos;
+	UINTN			EntrySize;
+	EFI_FILE_INFO	*FInfo;
+	
+	for (Pos = 0; Pos < Size; Pos += EntrySize) {
+		EntrySize = MERGED_DIR_ENTRY_SIZE(*(UINT64 *)(Buffer + Pos));
+		FInfo = (EFI_FILE_INFO *)(Buffer + Pos + sizeof(UINT64));
+		if (Tgt != NULL && MergedDirContains(Tgt, TgtSize, FInfo->FileName)) {
+			// Open() of this name gives target file - do not list it twice
+			continue;
+		}
+		if (IsBlacklisted(FSIFS->BlacklistTrie, DirName, FInfo->FileName)) {
+			DBG("Blacklisted dir entry '%s'\n", FInfo->FileName);
+			continue;
+		}
+		CopyMem(FSIFS->MergedDir + FSIFS->MergedDirSize, Buffer + Pos, EntrySize);
+		FSIFS->MergedDirSize += EntrySize;
+	}
+}
+
+/** Builds FSI_FS->MergedDir: injected entries from Src first, then entries from Tgt. */
+EFI_STATUS
+EFIAPI
+BuildMergedDir(IN FSI_FILE_PROTOCOL *FSIThis)
+{
+	EFI_STATUS							Status;
+	FSI_SIMPLE_FILE_SYSTEM_PROTOCOL		*FSIFS = FSIThis->FSI_FS;
+	UINT8								*SrcBuffer = NULL;
+	UINTN								SrcSize = 0;
+	UINT8								*TgtBuffer = NULL;
+	UINTN								TgtSize = 0;
+	
+	Status = ReadAllDirEntries(FSIThis->SrcFP, &SrcBuffer, &SrcSize);
+	if (!EFI_ERROR(Status)) {
+		Status = ReadAllDirEntries(FSIThis->TgtFP, &TgtBuffer, &TgtSize);
+	}
+	if (!EFI_ERROR(Status)) {
+		// never bigger than both listings together, +1 so that empty dir still gets a buffer
+		FSIFS->MergedDir = AllocatePool(SrcSize + TgtSize + 1);
+		if (FSIFS->MergedDir == NULL) {
+			Status = EFI_OUT_OF_RESOURCES;
+		}
+	}
+	if (!EFI_ERROR(Status)) {
+		FSIFS->MergedDirSize = 0;
+		MergeDirEntries(FSIFS, FSIThis->FName, SrcBuffer, SrcSize, TgtBuffer, TgtSize);
+		MergeDirEntries(FSIFS, FSIThis->FName, TgtBuffer, TgtSize, NULL, 0);
+		DBG("MergedDir built: %d bytes ", FSIFS->MergedDirSize);
+	}
+	if (SrcBuffer != NULL) {
+		FreePool(SrcBuffer);
+	}
+	if (TgtBuffer != NULL) {
+		FreePool(TgtBuffer);
+	}
+	return Status;
+}
+
+/** Reads next dir entry of injection point from FSI_FS->MergedDir. */
+EFI_STATUS
+EFIAPI
+ReadMergedDir(
+	IN FSI_FILE_PROTOCOL	*FSIThis,
+	IN OUT UINTN			*BufferSize,
+	OUT VOID				*Buffer
+)
+{
+	FSI_SIMPLE_FILE_SYSTEM_PROTOCOL		*FSIFS = FSIThis->FSI_FS;
+	UINTN								InfoSize;
+	UINTN								Index;
+	
+	if (FSIThis->DirGeneration != FSIFS->MergedDirGeneration) {
+		// listing was rebuilt since last read - find our entry by its index
+		FSIThis->DirPos = 0;
+		for (Index = 0; Index < FSIThis->DirIndex && FSIThis->DirPos < FSIFS->MergedDirSize; Index++) {
+			FSIThis->DirPos += MERGED_DIR_ENTRY_SIZE(*(UINT64 *)(FSIFS->MergedDir + FSIThis->DirPos));
+		}
+		FSIThis->DirGeneration = FSIFS->MergedDirGeneration;
+	}
+	if (FSIThis->DirPos >= FSIFS->MergedDirSize) {
+		// no more entries
+		*BufferSize = 0;
+		return EFI_SUCCESS;
+	}
+	// entry must be whole inside the listing
+	if (FSIFS->MergedDirSize - FSIThis->DirPos < sizeof(UINT64)) {
+		return EFI_VOLUME_CORRUPTED;
+	}
+	InfoSize = (UINTN)*(UINT64 *)(FSIFS->MergedDir + FSIThis->DirPos);
+	if (InfoSize > FSIFS->MergedDirSize - FSIThis->DirPos - sizeof(UINT64)) {
+		return EFI_VOLUME_CORRUPTED;
+	}
+	if (*BufferSize < InfoSize) {
+		*BufferSize = InfoSize;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+	CopyMem(Buffer, FSIFS->MergedDir + FSIThis->DirPos + sizeof(UINT64), InfoSize);
+	*BufferSize = InfoSize;
+	FSIThis->DirPos += MERGED_DIR_ENTRY_SIZE(InfoSize);
+	FSIThis->DirIndex++;
+	return EFI_SUCCESS;
+}
+
 /** Openes EFI_FILE_PROTOCOL on given VolumeFS for given FName. */
 EFI_FILE_PROTOCOL*
 EFIAPI
@@ -380,26 +718,21 @@ FSI_FP_Open(
 	CHAR16					*InjFName = NULL;
 	FSI_FILE_PROTOCOL		*FSIThis;
 	FSI_FILE_PROTOCOL		*FSINew;
-	FSI_STRING_LIST			*StringList;
-	FSI_STRING_LIST_ENTRY	*StringEntry;
 
 	DBG("FSI_FP %p.Open('%s', %x, %x) ", This, FileName, OpenMode, Attributes);
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
 	NewFName = GetNormalizedFName(FSIThis->FName, FileName);
 	
-	StringList = FSIThis->FSI_FS->Blacklist;
-	if (StringList != NULL && !IsListEmpty(&StringList->List)) {
-		// blocking files in Blacklist
-		for (StringEntry = (FSI_STRING_LIST_ENTRY *)GetFirstNode(&StringList->List);
-			 !IsNull (&StringList->List, &StringEntry->List);
-			 StringEntry = (FSI_STRING_LIST_ENTRY *)GetNextNode(&StringList->List, &StringEntry->List)
-			 )
-		{
-			if (StriStartsWithBasic(NewFName, StringEntry->String)) {
-				DBG("Blacklisted\n");
-				return EFI_NOT_FOUND;
-			}
-		}
+	// blocking files in Blacklist
+	if (IsBlacklisted(FSIThis->FSI_FS->BlacklistTrie, NewFName, NULL)) {
+		DBG("Blacklisted\n");
+		FreePool(NewFName);
+		return EFI_NOT_FOUND;
+	}
+	
+	// new files on target volume may show up in injected dir
+	if ((OpenMode & EFI_FILE_MODE_CREATE) != 0) {
+		DropMergedDir(FSIThis->FSI_FS);
 	}
 	
 	// create our FP implementation
@@ -615,6 +948,7 @@ FSI_FP_Delete(IN EFI_FILE_PROTOCOL  *This)
 	DBG("FSI_FP %p.Delete()\n", This);
 	
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
+	DropMergedDir(FSIThis->FSI_FS);
 	
 	if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
@@ -661,13 +995,24 @@ FSI_FP_Read(
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
 	if (FSIThis->TgtFP != NULL && FSIThis->SrcFP != NULL) {
 		// this is injection point
-		// first read dir entries from Src and then from Tgt
-		BufferSizeOrig = *BufferSize;
-		Status = FSIThis->SrcFP->Read(FSIThis->SrcFP, BufferSize, Buffer);
-		if (*BufferSize == 0) {
-			// no more in Src - read from Tgt
-			*BufferSize = BufferSizeOrig;
-			Status = FSIThis->TgtFP->Read(FSIThis->TgtFP, BufferSize, Buffer);
+		// dir listing is merged once per FS and then served from memory to all openers
+		if (FSIThis->FSI_FS->MergedDir == NULL) {
+			Status = BuildMergedDir(FSIThis);
+			if (EFI_ERROR(Status)) {
+				DBG("BuildMergedDir: %r ", Status);
+			}
+		}
+		if (FSIThis->FSI_FS->MergedDir != NULL) {
+			Status = ReadMergedDir(FSIThis, BufferSize, Buffer);
+		} else {
+			// first read dir entries from Src and then from Tgt
+			BufferSizeOrig = *BufferSize;
+			Status = FSIThis->SrcFP->Read(FSIThis->SrcFP, BufferSize, Buffer);
+			if (*BufferSize == 0) {
+				// no more in Src - read from Tgt
+				*BufferSize = BufferSizeOrig;
+				Status = FSIThis->TgtFP->Read(FSIThis->TgtFP, BufferSize, Buffer);
+			}
 		}
 	} else if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
@@ -752,6 +1097,7 @@ FSI_FP_Write(
 	DBG("FSI_FP %p.Write(%d, %p) ", This, *BufferSize, Buffer);
 	
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
+	DropMergedDir(FSIThis->FSI_FS);
 	
 	if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
@@ -778,6 +1124,11 @@ FSI_FP_SetPosition(
 	DBG("FSI_FP %p.SetPosition(%d) ", This, Position);
 	
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
+	if (Position == 0) {
+		// rewind merged listing of injection point
+		FSIThis->DirPos = 0;
+		FSIThis->DirIndex = 0;
+	}
 	
 	if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
@@ -870,6 +1221,7 @@ FSI_FP_SetInfo(
 	DBG("FSI_FP %p.SetInfo(%s, %d, %p) ", This, GuidStr(InformationType), BufferSize, Buffer);
 	
 	FSIThis = FSI_FROM_FILE_PROTOCOL(This);
+	DropMergedDir(FSIThis->FSI_FS);
 	
 	if (FSIThis->TgtFP != NULL) {
 		// do it with target FP
@@ -939,6 +1291,9 @@ CreateFSInjectFP(VOID)
 	FSINew->TgtFP = NULL;
 	FSINew->SrcFP = NULL;
 	FSINew->FromTgt = FALSE;
+	FSINew->DirPos = 0;
+	FSINew->DirIndex = 0;
+	FSINew->DirGeneration = 0;
 	
 	return FSINew;
 }
@@ -1067,6 +1422,13 @@ FSInjectionInstall (
 	
 	if (Blacklist != NULL && !IsListEmpty(&Blacklist->List)) {
 		OurFS->Blacklist = Blacklist;
+		// Open() and dir listing check every path against it
+		OurFS->BlacklistTrie = BlacklistTrieCompile(Blacklist);
+		if (OurFS->BlacklistTrie == NULL) {
+			Status = EFI_OUT_OF_RESOURCES;
+			DBG("- BlacklistTrieCompile: %r\n", Status);
+			goto ErrorExit;
+		}
 	}
 	
 	if (ForceLoadKexts != NULL && !IsListEmpty(&ForceLoadKexts->List)) {
@@ -1086,6 +1448,7 @@ FSInjectionInstall (
 ErrorExit:
 	if (OurFS->TgtDir != NULL) FreePool(OurFS->TgtDir);
 	if (OurFS->SrcDir != NULL) FreePool(OurFS->SrcDir);
+	BlacklistTrieFree(OurFS->BlacklistTrie);
 	FreePool(OurFS);
 	return Status;
 }
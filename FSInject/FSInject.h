@@ -13,6 +13,18 @@ Module Name:
 #ifndef __FSInject_H__
 #define __FSInject_H__
 
+/**
+ * Blacklist compiled into a prefix trie of upper cased chars.
+ * A path is blocked if a node with IsEnd is reached while walking it.
+ */
+typedef struct _FSI_BLACKLIST_NODE FSI_BLACKLIST_NODE;
+struct _FSI_BLACKLIST_NODE {
+	CHAR16								Chr;			// upper cased char of this node, 0 for root
+	BOOLEAN								IsEnd;			// TRUE if some blacklisted name ends here
+	FSI_BLACKLIST_NODE					*Child;			// first child
+	FSI_BLACKLIST_NODE					*Next;			// next sibling
+};
+
 /**
  * FSInjection EFI_SIMPLE_FILE_SYSTEM_PROTOCOL private structure
  */
@@ -30,7 +42,12 @@ typedef struct {
 	CHAR16								*SrcDir;		// injection dir that contains files that will be injected into TgtDir
 	
 	FSI_STRING_LIST						*Blacklist;		// linked list of file names to be blocked on target volume
+	FSI_BLACKLIST_NODE					*BlacklistTrie;	// Blacklist compiled at install, NULL if empty
 	FSI_STRING_LIST						*ForceLoadKexts;// linked list of kext plists
+
+	UINT8								*MergedDir;		// cached listing of TgtDir with SrcDir injected: UINT64 size + EFI_FILE_INFO, 8 bytes aligned
+	UINTN								MergedDirSize;	// bytes used in MergedDir
+	UINTN								MergedDirGeneration; // incremented when MergedDir is dropped
 } FSI_SIMPLE_FILE_SYSTEM_PROTOCOL;
 
 /** Signature for FSI_SIMPLE_FILE_SYSTEM_PROTOCOL */
@@ -55,6 +72,9 @@ typedef struct {
 	EFI_FILE_PROTOCOL					*TgtFP;			// target EFI_FILE_PROTOCOL
 	EFI_FILE_PROTOCOL					*SrcFP;			// EFI_FILE_PROTOCOL from injection volume
 	BOOLEAN								FromTgt;		// TRUE if file is opened from original target volume, FALSE if from injection volume
+	UINTN								DirPos;			// read position in FSI_FS->MergedDir, for injection point
+	UINTN								DirIndex;		// number of entries read from merged listing, survives its rebuild
+	UINTN								DirGeneration;	// FSI_FS->MergedDirGeneration that DirPos is valid for
 } FSI_FILE_PROTOCOL;
 
 /** Signature for FSI_FILE_PROTOCOL */
@@ -115,6 +115,22 @@ extern Print_t PrintExtra;
 /* Forward declaration */
 struct _EFI_FS;
 
+/* Size of the read-ahead buffer of a file */
+#define FS_READAHEAD_SIZE       (512 * 1024)
+
+/* Read-ahead state of a file: one asynchronous DiskIo2 read of the disk area
+ * following the last read, started when the file is read sequentially */
+typedef struct _EFI_FS_READAHEAD {
+	EFI_DISK_IO2_TOKEN     Token;
+	EFI_DISK_IO2_PROTOCOL *DiskIo2;       /* Protocol the read was issued on, to cancel it */
+	UINT8                 *Buffer;
+	UINT64                 Offset;
+	UINTN                  Size;
+	UINT64                 NextOffset;
+	BOOLEAN                Pending;
+	BOOLEAN                Valid;
+} EFI_FS_READAHEAD;
+
 /* A file instance */
 typedef struct _EFI_GRUB_FILE {
 	EFI_FILE               EfiFile;
@@ -126,6 +142,7 @@ typedef struct _EFI_GRUB_FILE {
 	INTN                   RefCount;
 	VOID                  *GrubFile;
 	struct _EFI_FS        *FileSystem;
+	EFI_FS_READAHEAD       ReadAhead;
 } EFI_GRUB_FILE;
 
 /* A file system instance */
@@ -142,6 +159,7 @@ typedef struct _EFI_FS {
 	EFI_GRUB_FILE         *RootFile;
 	VOID                  *GrubDevice;
 	CHAR16                *DevicePathString;
+	EFI_FS_READAHEAD      *ReadAhead;     /* Read-ahead of the file being read, or NULL */
 } EFI_FS;
 
 /* Mirrors a similar construct from GRUB, while EFI-zing it */
@@ -183,6 +201,7 @@ extern EFI_STATUS GrubRead(EFI_GRUB_FILE *File, VOID *Data, UINTN *Len);
 extern EFI_STATUS GrubLabel(EFI_GRUB_FILE *File, CHAR8 **label);
 extern EFI_STATUS GrubCreateFile(EFI_GRUB_FILE **File, EFI_FS *This);
 extern VOID GrubDestroyFile(EFI_GRUB_FILE *File);
+extern VOID ReadAheadFree(EFI_FS_READAHEAD *Ra);
 extern UINT64 GrubGetFileSize(EFI_GRUB_FILE *File);
 extern UINT64 GrubGetFileOffset(EFI_GRUB_FILE *File);
 extern VOID GrubSetFileOffset(EFI_GRUB_FILE *File, UINT64 Offset);
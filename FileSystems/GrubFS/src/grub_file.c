@@ -137,6 +137,126 @@ grub_device_iterate(grub_device_iterate_hook_t hook, void *hook_data)
 */
 grub_disk_read_hook_t grub_file_progress_hook = NULL;
 
+/* Give up a cancelled read-ahead. The disk may still transfer into the buffer,
+ * so it stays allocated and a new one is used next time */
+static VOID
+ReadAheadAbandon(EFI_FS_READAHEAD *Ra)
+{
+	if (Ra->Token.Event != NULL) {
+		BS->CloseEvent(Ra->Token.Event);
+		Ra->Token.Event = NULL;
+	}
+	Ra->Buffer = NULL;
+	Ra->Pending = FALSE;
+	Ra->Valid = FALSE;
+}
+
+/* Wait for the asynchronous read of a read-ahead buffer, if one is in flight.
+ * The completion is delivered at TPL_CALLBACK, so above TPL_APPLICATION the
+ * read is cancelled instead */
+static VOID
+ReadAheadWait(EFI_FS_READAHEAD *Ra)
+{
+	EFI_STATUS Status;
+
+	if (!Ra->Pending)
+		return;
+	Status = BS->CheckEvent(Ra->Token.Event);
+	if (Status == EFI_NOT_READY && EfiGetCurrentTpl() > TPL_APPLICATION) {
+		Ra->DiskIo2->Cancel(Ra->DiskIo2);
+		ReadAheadAbandon(Ra);
+		return;
+	}
+	while (Status == EFI_NOT_READY)
+		Status = BS->CheckEvent(Ra->Token.Event);
+	/* Cancel() aborts the reads of every file on the disk */
+	if (Ra->Token.TransactionStatus == EFI_ABORTED) {
+		ReadAheadAbandon(Ra);
+		return;
+	}
+	Ra->Pending = FALSE;
+	Ra->Valid = !EFI_ERROR(Ra->Token.TransactionStatus);
+}
+
+/* Start an asynchronous read of the disk area at Offset into the read-ahead buffer */
+static VOID
+ReadAheadStart(EFI_FS *FileSystem, EFI_FS_READAHEAD *Ra, UINT32 MediaId,
+		UINT64 Offset, UINT64 DiskSize)
+{
+	EFI_STATUS Status;
+	UINTN Size = FS_READAHEAD_SIZE;
+
+	/* Completion is polled, which needs the firmware's timer to run */
+	if (FileSystem->DiskIo2 == NULL || EfiGetCurrentTpl() != TPL_APPLICATION)
+		return;
+	if (Offset >= DiskSize)
+		return;
+	if (DiskSize - Offset < Size)
+		Size = (UINTN)(DiskSize - Offset);
+	/* Still inside the data that is already buffered or on its way */
+	if ((Ra->Pending || Ra->Valid) && Offset >= Ra->Offset && Offset < Ra->Offset + Ra->Size)
+		return;
+	ReadAheadWait(Ra);
+
+	if (Ra->Buffer == NULL) {
+		Ra->Buffer = AllocatePool(FS_READAHEAD_SIZE);
+		if (Ra->Buffer == NULL)
+			return;
+	}
+	if (Ra->Token.Event == NULL) {
+		Status = BS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &Ra->Token.Event);
+		if (EFI_ERROR(Status)) {
+			Ra->Token.Event = NULL;
+			return;
+		}
+	}
+
+	Ra->Offset = Offset;
+	Ra->Size = Size;
+	Ra->Valid = FALSE;
+	Ra->Token.TransactionStatus = EFI_NOT_READY;
+	Ra->DiskIo2 = FileSystem->DiskIo2;
+	Status = FileSystem->DiskIo2->ReadDiskEx(FileSystem->DiskIo2, MediaId, Offset,
+			&Ra->Token, Size, Ra->Buffer);
+	Ra->Pending = !EFI_ERROR(Status);
+}
+
+/* Serve the start of a read from the read-ahead buffer, if it holds that data.
+ * Returns the number of bytes copied to Buf */
+static UINTN
+ReadAheadCopy(EFI_FS_READAHEAD *Ra, UINT64 Offset, UINTN Size, UINT8 *Buf)
+{
+	UINTN Copy;
+
+	if (!(Ra->Pending || Ra->Valid) || Offset < Ra->Offset || Offset >= Ra->Offset + Ra->Size)
+		return 0;
+	ReadAheadWait(Ra);
+	if (!Ra->Valid)
+		return 0;
+	Copy = (UINTN)(Ra->Offset + Ra->Size - Offset);
+	if (Copy > Size)
+		Copy = Size;
+	CopyMem(Buf, Ra->Buffer + (UINTN)(Offset - Ra->Offset), Copy);
+	return Copy;
+}
+
+/* Release the read-ahead state of a file, after any outstanding read completed
+ * or was cancelled */
+VOID
+ReadAheadFree(EFI_FS_READAHEAD *Ra)
+{
+	ReadAheadWait(Ra);
+	if (Ra->Token.Event != NULL) {
+		BS->CloseEvent(Ra->Token.Event);
+		Ra->Token.Event = NULL;
+	}
+	if (Ra->Buffer != NULL) {
+		FreePool(Ra->Buffer);
+		Ra->Buffer = NULL;
+	}
+	Ra->Valid = FALSE;
+}
+
 grub_err_t
 grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,   //SL - here grub_disk_read
 		grub_off_t offset, grub_size_t size, void *buf)
@@ -144,6 +264,10 @@ grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,   //SL - here grub_dis
 	EFI_STATUS Status;
 	EFI_FS* FileSystem = (EFI_FS *) disk->data;
   EFI_BLOCK_IO_MEDIA *Media;
+	EFI_FS_READAHEAD *Ra;
+	UINT64 Start;
+	UINTN Copied = 0;
+	BOOLEAN Sequential = FALSE;
 
 //	ASSERT(FileSystem != NULL);
 //	ASSERT(FileSystem->DiskIo != NULL);
@@ -163,13 +287,28 @@ grub_disk_read(grub_disk_t disk, grub_disk_addr_t sector,   //SL - here grub_dis
 	/* NB: We could get the actual blocksize through FileSystem->BlockIo->Media->BlockSize
 	 * but GRUB uses the fixed GRUB_DISK_SECTOR_SIZE, so we follow suit
 	 */
+	Start = sector * GRUB_DISK_SECTOR_SIZE + offset;
+
+	/* File data may already sit in the read-ahead buffer */
+	Ra = FileSystem->ReadAhead;
+	if (Ra != NULL) {
+		Sequential = (Start == Ra->NextOffset);
+		Ra->NextOffset = Start + size;
+		Copied = ReadAheadCopy(Ra, Start, size, (UINT8 *) buf);
+		if (Sequential)
+			ReadAheadStart(FileSystem, Ra, Media->MediaId, Start + size,
+					MultU64x32(Media->LastBlock + 1, Media->BlockSize));
+	}
+	if (Copied == size)
+		return 0;
+
     if (FileSystem->DiskIo2 != NULL)
     {
       Status = FileSystem->DiskIo2->ReadDiskEx(FileSystem->DiskIo2, Media->MediaId,
-                                               sector * GRUB_DISK_SECTOR_SIZE + offset, &(FileSystem->DiskIo2Token), size, buf);
+                                               Start + Copied, &(FileSystem->DiskIo2Token), size - Copied, (UINT8 *) buf + Copied);
     } else {
         Status = FileSystem->DiskIo->ReadDisk(FileSystem->DiskIo, Media->MediaId,
-			sector * GRUB_DISK_SECTOR_SIZE + offset, size, buf);
+			Start + Copied, size - Copied, (UINT8 *) buf + Copied);
     }
 
 	if (EFI_ERROR(Status)) {
@@ -331,6 +470,8 @@ GrubCreateFile(EFI_GRUB_FILE **File, EFI_FS *FileSystem)
 VOID
 GrubDestroyFile(EFI_GRUB_FILE *File)
 {
+    ReadAheadFree(&File->ReadAhead);
+
     if (File->GrubFile != NULL)
     {
         FreePool(File->GrubFile);
@@ -419,7 +560,9 @@ GrubRead(EFI_GRUB_FILE *File, VOID *Data, UINTN *Len)
     *Len = Remaining;
   }
 
+	File->FileSystem->ReadAhead = &File->ReadAhead;
 	len = p->read(f, (char *) Data, *Len);
+	File->FileSystem->ReadAhead = NULL;
 
 	if (len < 0) {
 		*Len = 0;
@@ -62,8 +62,13 @@ const char* fsw_errors[] = {
 // functions
 
 static void fsw_blockcache_free(struct fsw_volume *vol);
+static fsw_status_t fsw_blockcache_init(struct fsw_volume *vol);
+static fsw_u32 fsw_blockcache_hash(struct fsw_volume *vol, fsw_u64 phys_bno);
+static void fsw_blockcache_lru_insert(struct fsw_volume *vol, struct fsw_blockcache *bc);
+static void fsw_blockcache_lru_remove(struct fsw_volume *vol, struct fsw_blockcache *bc);
+static struct fsw_blockcache *fsw_blockcache_evict(struct fsw_volume *vol);
 
-#define MAX_CACHE_LEVEL (5)
+#define MAX_CACHE_LEVEL FSW_MAX_CACHE_LEVEL
 
 
 /**
@@ -101,6 +106,7 @@ fsw_status_t fsw_mount(void *host_data,
     vol->host_table     = host_table;
     vol->fstype_table   = fstype_table;
     vol->host_string_type = host_table->native_string_type;
+    vol->bcache_budget  = FSW_BCACHE_BUDGET;
 
     // let the fs driver mount the file system
     status = vol->fstype_table->volume_mount(vol);
@@ -201,13 +207,16 @@ void fsw_set_blocksize_(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32
  *
  * If this function returns successfully, the returned data pointer is valid until the
  * caller calls fsw_block_release.
+ *
+ * Cached blocks are found through a hash table. Once the cache holds vol->bcache_budget
+ * bytes, the least recently released block of the lowest level is recycled.
  */
 
 fsw_status_t fsw_block_get_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32 cache_level, void **buffer_out)
 {
   fsw_status_t    status;
-  fsw_u32         i, discard_level, new_bcache_size;
-  struct fsw_blockcache *new_bcache = NULL;
+  fsw_u32         hash;
+  struct fsw_blockcache *bc;
   
   // TODO: allow the host driver to do its own caching; just call through if
   //  the appropriate function pointers are set
@@ -215,79 +224,57 @@ fsw_status_t fsw_block_get_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32
   if (cache_level > MAX_CACHE_LEVEL)
     cache_level = MAX_CACHE_LEVEL;
   
+  if (vol->bcache_hash == NULL) {
+    status = fsw_blockcache_init(vol);
+    if (status)
+      return status;
+  }
+  
   // check block cache
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == phys_bno) {
+  hash = fsw_blockcache_hash(vol, phys_bno);
+  for (bc = vol->bcache_hash[hash]; bc != NULL; bc = bc->hash_next) {
+    if (bc->phys_bno == phys_bno) {
       // cache hit!
-      if (vol->bcache[i].cache_level < cache_level)
-        vol->bcache[i].cache_level = cache_level;  // promote the entry
-      vol->bcache[i].refcount++;
-      *buffer_out = vol->bcache[i].data;
+      if (bc->refcount == 0)
+        fsw_blockcache_lru_remove(vol, bc);
+      if (bc->cache_level < cache_level)
+        bc->cache_level = cache_level;  // promote the entry
+      bc->refcount++;
+      vol->bcache_hits++;
+      *buffer_out = bc->data;
       return FSW_SUCCESS;
     }
   }
-  
-  // find a free entry in the cache table
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == (fsw_u32)FSW_INVALID_BNO)
-      break;
-  }
-  if (i >= vol->bcache_size) {
-    for (discard_level = 0; discard_level <= MAX_CACHE_LEVEL; discard_level++) {
-      for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].refcount == 0 && vol->bcache[i].cache_level <= discard_level)
-          break;
-      }
-      if (i < vol->bcache_size)
-        break;
-    }
-  }
-  if (i >= vol->bcache_size) {
-    // enlarge / create the cache
-    if (vol->bcache_size < 16)
-      new_bcache_size = 16;
-    else
-      new_bcache_size = vol->bcache_size << 1;
-    status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
-    if (status != FSW_SUCCESS) {
-      if (new_bcache) {
-        fsw_free(new_bcache);
-      }
+  vol->bcache_misses++;
+  
+  // recycle the least important unused entry if the cache is full, else make a new one
+  bc = NULL;
+  if ((fsw_u64)(vol->bcache_size + 1) * vol->phys_blocksize > vol->bcache_budget)
+    bc = fsw_blockcache_evict(vol);
+  if (bc == NULL) {
+    status = fsw_alloc(sizeof(struct fsw_blockcache) + vol->phys_blocksize, &bc);
+    if (status)
       return status;
-    }
-    if (vol->bcache_size > 0) {
-      fsw_memcpy(new_bcache, vol->bcache, vol->bcache_size * sizeof(struct fsw_blockcache));
-    }
-    for (i = vol->bcache_size; i < new_bcache_size; i++) {
-      new_bcache[i].refcount = 0;
-      new_bcache[i].cache_level = 0;
-      new_bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
-      new_bcache[i].data = NULL;
-    }
-    i = vol->bcache_size;
-    
-    // switch caches
-    if (vol->bcache != NULL)
-      fsw_free(vol->bcache);
-    vol->bcache = new_bcache;
-    vol->bcache_size = new_bcache_size;
+    bc->data = (fsw_u8 *)bc + sizeof(struct fsw_blockcache);
+    vol->bcache_size++;
   }
-  vol->bcache[i].phys_bno = (fsw_u32)FSW_INVALID_BNO;
   
   // read the data
-  if (vol->bcache[i].data == NULL) {
-    status = fsw_alloc(vol->phys_blocksize, &vol->bcache[i].data);
-    if (status)
-      return status;
-  }
-  status = vol->host_table->read_block(vol, phys_bno, vol->bcache[i].data);
-  if (status)
+  status = vol->host_table->read_block(vol, phys_bno, bc->data);
+  if (status) {
+    fsw_free(bc);
+    vol->bcache_size--;
     return status;
+  }
   
-  vol->bcache[i].phys_bno = phys_bno;
-  vol->bcache[i].cache_level = cache_level;
-  vol->bcache[i].refcount = 1;
-  *buffer_out = vol->bcache[i].data;
+  bc->phys_bno = phys_bno;
+  bc->cache_level = cache_level;
+  bc->refcount = 1;
+  bc->lru_prev = NULL;
+  bc->lru_next = NULL;
+  bc->hash_next = vol->bcache_hash[hash];
+  vol->bcache_hash[hash] = bc;
+  *buffer_out = bc->data;
   return FSW_SUCCESS;
 }
 
@@ -298,8 +285,8 @@ fsw_status_t fsw_block_get_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, fsw_u32
 
 void fsw_block_release_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffer)
 {
-  fsw_u32 i;
-  if (!vol) {
+  struct fsw_blockcache *bc;
+  if (!vol || vol->bcache_hash == NULL) {
     return;
   }
   
@@ -307,9 +294,124 @@ void fsw_block_release_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffe
   //  the appropriate function pointers are set
   
   // update block cache
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].phys_bno == phys_bno && vol->bcache[i].refcount > 0)
-      vol->bcache[i].refcount--;
+  for (bc = vol->bcache_hash[fsw_blockcache_hash(vol, phys_bno)]; bc != NULL; bc = bc->hash_next) {
+    if (bc->phys_bno == phys_bno) {
+      if (bc->refcount > 0) {
+        bc->refcount--;
+        if (bc->refcount == 0)
+          fsw_blockcache_lru_insert(vol, bc);
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * Set up the hash table of the block cache. The number of buckets is derived from the
+ * byte budget and the current physical block size, so chains stay short when the cache
+ * is full. Called on the first fsw_block_get after mounting or a block size change.
+ */
+
+static fsw_status_t fsw_blockcache_init(struct fsw_volume *vol)
+{
+  fsw_status_t    status;
+  fsw_u32         entries, bits, i;
+  
+  entries = vol->bcache_budget / vol->phys_blocksize;
+  for (bits = 4; bits < 16 && ((fsw_u32)1 << bits) < entries; bits++)
+    ;
+  
+  status = fsw_alloc(sizeof(struct fsw_blockcache *) << bits, &vol->bcache_hash);
+  if (status)
+    return status;
+  for (i = 0; i < ((fsw_u32)1 << bits); i++)
+    vol->bcache_hash[i] = NULL;
+  for (i = 0; i <= MAX_CACHE_LEVEL; i++) {
+    vol->bcache_lru_head[i] = NULL;
+    vol->bcache_lru_tail[i] = NULL;
+  }
+  vol->bcache_hash_bits = bits;
+  vol->bcache_size = 0;
+  return FSW_SUCCESS;
+}
+
+/**
+ * Hash bucket index of a physical block number (multiplicative hashing).
+ */
+
+static fsw_u32 fsw_blockcache_hash(struct fsw_volume *vol, fsw_u64 phys_bno)
+{
+  fsw_u32 key = (fsw_u32)phys_bno ^ (fsw_u32)FSW_U64_SHR(phys_bno, 32);
+  return (key * 0x9E3779B1U) >> (32 - vol->bcache_hash_bits);
+}
+
+/**
+ * Put an entry whose reference count dropped to zero at the head of its level's LRU list.
+ */
+
+static void fsw_blockcache_lru_insert(struct fsw_volume *vol, struct fsw_blockcache *bc)
+{
+  bc->lru_prev = NULL;
+  bc->lru_next = vol->bcache_lru_head[bc->cache_level];
+  if (bc->lru_next != NULL)
+    bc->lru_next->lru_prev = bc;
+  else
+    vol->bcache_lru_tail[bc->cache_level] = bc;
+  vol->bcache_lru_head[bc->cache_level] = bc;
+}
+
+/**
+ * Take an entry off its level's LRU list, because it is referenced again or recycled.
+ */
+
+static void fsw_blockcache_lru_remove(struct fsw_volume *vol, struct fsw_blockcache *bc)
+{
+  if (bc->lru_prev != NULL)
+    bc->lru_prev->lru_next = bc->lru_next;
+  else
+    vol->bcache_lru_head[bc->cache_level] = bc->lru_next;
+  if (bc->lru_next != NULL)
+    bc->lru_next->lru_prev = bc->lru_prev;
+  else
+    vol->bcache_lru_tail[bc->cache_level] = bc->lru_prev;
+  bc->lru_prev = NULL;
+  bc->lru_next = NULL;
+}
+
+/**
+ * Detach the least recently used unreferenced entry of the lowest cache level from the
+ * cache and return it for reuse. Surplus entries left over from a shrunk budget are
+ * freed on the way. Returns NULL if every entry is in use.
+ */
+
+static struct fsw_blockcache *fsw_blockcache_evict(struct fsw_volume *vol)
+{
+  struct fsw_blockcache *bc, **link;
+  fsw_u32         level;
+  
+  for (;;) {
+    bc = NULL;
+    for (level = 0; level <= MAX_CACHE_LEVEL; level++) {
+      bc = vol->bcache_lru_tail[level];
+      if (bc != NULL)
+        break;
+    }
+    if (bc == NULL)
+      return NULL;
+    
+    fsw_blockcache_lru_remove(vol, bc);
+    for (link = &vol->bcache_hash[fsw_blockcache_hash(vol, bc->phys_bno)]; *link != NULL; link = &(*link)->hash_next) {
+      if (*link == bc) {
+        *link = bc->hash_next;
+        break;
+      }
+    }
+    vol->bcache_evictions++;
+    
+    if ((fsw_u64)vol->bcache_size * vol->phys_blocksize <= vol->bcache_budget || vol->bcache_size <= 1)
+      return bc;
+    fsw_free(bc);
+    vol->bcache_size--;
   }
 }
 
@@ -321,17 +423,20 @@ void fsw_block_release_(struct VOLSTRUCTNAME *vol, fsw_u32 phys_bno, void *buffe
 static void fsw_blockcache_free(struct fsw_volume *vol)
 {
   fsw_u32 i;
+  struct fsw_blockcache *bc, *next;
   if (!vol) {
     return;
   }
   
-  for (i = 0; i < vol->bcache_size; i++) {
-    if (vol->bcache[i].data != NULL)
-      fsw_free(vol->bcache[i].data);
-  }
-  if (vol->bcache != NULL) {
-    fsw_free(vol->bcache);
-    vol->bcache = NULL;
+  if (vol->bcache_hash != NULL) {
+    for (i = 0; i < ((fsw_u32)1 << vol->bcache_hash_bits); i++) {
+      for (bc = vol->bcache_hash[i]; bc != NULL; bc = next) {
+        next = bc->hash_next;
+        fsw_free(bc);
+      }
+    }
+    fsw_free(vol->bcache_hash);
+    vol->bcache_hash = NULL;
   }
   vol->bcache_size = 0;
 }
@@ -1023,6 +1128,7 @@ fsw_status_t fsw_shandle_open_(struct fsw_dnode *dno, struct fsw_shandle *shand)
   
   shand->dnode = dno;
   shand->pos = 0;
+  shand->next_pos = 0;
   shand->extent.type = FSW_EXTENT_TYPE_INVALID;
   
   return FSW_SUCCESS;
@@ -1043,9 +1149,117 @@ void fsw_shandle_close(struct fsw_shandle *shand)
   fsw_dnode_release(shand->dnode);
 }
 
+/**
+ * Read a run of whole physical blocks of file data directly into the caller's buffer.
+ * The run starts at phys_bno inside the shandle's current PHYSBLOCK extent and is
+ * extended over the following extents as long as they continue on disk, so drivers
+ * that map one block per extent (ext2, hfs) still get a single large read. The data
+ * bypasses the block cache, which is kept for metadata. Only whole blocks that fit
+ * into buflen are read; the number of bytes transferred is returned in *copylen_out.
+ * On return the shandle holds the last extent looked at, which usually is the one
+ * covering the next position to read.
+ */
+
+static fsw_status_t fsw_shandle_read_run(struct fsw_shandle *shand, fsw_u64 phys_bno,
+                                         fsw_u32 pos_in_extent, fsw_u32 buflen,
+                                         fsw_u8 *buffer, fsw_u32 *copylen_out)
+{
+  fsw_status_t    status;
+  struct fsw_dnode *dno = shand->dnode;
+  struct fsw_volume *vol = dno->vol;
+  struct fsw_extent next_extent;
+  fsw_u32         max_count, run_count, extent_count;
+  
+  max_count = buflen / vol->phys_blocksize;
+  
+  // blocks left in the current extent
+  extent_count = (shand->extent.log_count * vol->log_blocksize - pos_in_extent) / vol->phys_blocksize;
+  run_count = (extent_count < max_count) ? extent_count : max_count;
+  
+  // extend the run over physically adjacent extents
+  while (run_count < max_count) {
+    next_extent.type = FSW_EXTENT_TYPE_INVALID;
+    next_extent.log_start = shand->extent.log_start + shand->extent.log_count;
+    next_extent.buffer = NULL;
+    if ((fsw_u64)next_extent.log_start * vol->log_blocksize >= dno->size)
+      break;
+    status = vol->fstype_table->get_extent(vol, dno, &next_extent);
+    if (status)
+      break;    // let the regular path report the error for this position
+    
+    if (next_extent.type != FSW_EXTENT_TYPE_PHYSBLOCK ||
+        next_extent.phys_start != phys_bno + run_count) {
+      // not contiguous; keep it for the next iteration of fsw_shandle_read
+      status = vol->host_table->read_blocks(vol, phys_bno, run_count, buffer);
+      if (status) {
+        if (next_extent.type == FSW_EXTENT_TYPE_BUFFER)
+          fsw_free(next_extent.buffer);
+        return status;
+      }
+      shand->extent = next_extent;
+      *copylen_out = run_count * vol->phys_blocksize;
+      return FSW_SUCCESS;
+    }
+    
+    shand->extent = next_extent;
+    extent_count = next_extent.log_count * vol->log_blocksize / vol->phys_blocksize;
+    run_count += (extent_count < max_count - run_count) ? extent_count : max_count - run_count;
+  }
+  
+  status = vol->host_table->read_blocks(vol, phys_bno, run_count, buffer);
+  if (status)
+    return status;
+  
+  *copylen_out = run_count * vol->phys_blocksize;
+  return FSW_SUCCESS;
+}
+
+/**
+ * Pass the physical location of the file data following pos to the host's read_ahead
+ * function, so it can start reading it while the caller processes the current data.
+ * Only the rest of the extent containing pos is announced, and only if pos is on a
+ * block boundary, which is where the next fsw_shandle_read will read whole blocks.
+ */
+
+static void fsw_shandle_read_ahead(struct fsw_shandle *shand, fsw_u32 pos)
+{
+  struct fsw_dnode *dno = shand->dnode;
+  struct fsw_volume *vol = dno->vol;
+  fsw_u32         log_bno, pos_in_extent, count;
+  
+  if ((pos & (vol->phys_blocksize - 1)) != 0)
+    return;
+  
+  log_bno = pos / vol->log_blocksize;
+  if (shand->extent.type == FSW_EXTENT_TYPE_INVALID ||
+      log_bno < shand->extent.log_start ||
+      log_bno >= shand->extent.log_start + shand->extent.log_count) {
+    
+    if (shand->extent.type == FSW_EXTENT_TYPE_BUFFER)
+      fsw_free(shand->extent.buffer);
+    
+    shand->extent.log_start = log_bno;
+    if (vol->fstype_table->get_extent(vol, dno, &shand->extent)) {
+      shand->extent.type = FSW_EXTENT_TYPE_INVALID;
+      return;
+    }
+  }
+  if (shand->extent.type != FSW_EXTENT_TYPE_PHYSBLOCK)
+    return;
+  
+  pos_in_extent = pos - shand->extent.log_start * vol->log_blocksize;
+  count = (shand->extent.log_count * vol->log_blocksize - pos_in_extent) / vol->phys_blocksize;
+  if ((fsw_u64)count * vol->phys_blocksize > dno->size - pos)
+    count = ((fsw_u32)(dno->size - pos) + vol->phys_blocksize - 1) / vol->phys_blocksize;
+  if (count > 0)
+    vol->host_table->read_ahead(vol, shand->extent.phys_start + pos_in_extent / vol->phys_blocksize, count);
+}
+
 /**
  * Read data from a shandle (storage handle for a dnode). This function is called by the
- * host driver or internally when data is read from a file. TODO: more
+ * host driver or internally when data is read from a file. Whole physical blocks of
+ * regular files are read in runs through the host's read_blocks function when it is
+ * available; partial blocks and directory/symlink data go through the block cache.
  */
 
 fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in)
@@ -1102,6 +1316,19 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
       if (copylen > buflen)
         copylen = buflen;
       
+      // whole blocks of file data go straight from disk into the caller's buffer
+      if (cache_level == 0 && pos_in_physblock == 0 && buflen >= vol->phys_blocksize &&
+          vol->host_table->read_blocks != NULL) {
+        status = fsw_shandle_read_run(shand, phys_bno, pos_in_extent, buflen, buffer, &copylen);
+        if (status)
+          return status;
+        
+        buffer += copylen;
+        buflen -= copylen;
+        pos    += copylen;
+        continue;
+      }
+      
       // get one physical block
       status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
       if (status)
@@ -1131,7 +1358,14 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
   }
   
   *buffer_size_inout = (fsw_u32)(pos - shand->pos);
+  
+  // sequential reader: tell the host where the file continues on disk
+  if (shand->pos == shand->next_pos && cache_level == 0 && pos < dno->size &&
+      vol->host_table->read_ahead != NULL)
+    fsw_shandle_read_ahead(shand, pos);
+  
   shand->pos = pos;
+  shand->next_pos = pos;
   
   return FSW_SUCCESS;
 }
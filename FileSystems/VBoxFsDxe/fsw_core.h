@@ -78,6 +78,14 @@ extern const char* fsw_errors[];
 /** Indicates that the block cache entry is empty. */
 #define FSW_INVALID_BNO (~0UL)
 
+/** Highest cache level accepted by fsw_block_get. */
+#define FSW_MAX_CACHE_LEVEL (5)
+
+/** Default number of bytes of block data the per-volume block cache may hold. */
+#ifndef FSW_BCACHE_BUDGET
+#define FSW_BCACHE_BUDGET (4 * 1024 * 1024)
+#endif
+
 #define USE_FULL_LOWERCASE 0
 //
 // Byte-swapping macros
@@ -256,6 +264,9 @@ struct fsw_blockcache {
     fsw_u32     cache_level;        //!< Level of importance of this block
     fsw_u64     phys_bno;           //!< Physical block number
     void        *data;              //!< Block data buffer
+    struct fsw_blockcache *hash_next;   //!< Next entry in the same hash bucket
+    struct fsw_blockcache *lru_prev;    //!< LRU list of unreferenced entries of one level: more recently used entry
+    struct fsw_blockcache *lru_next;    //!< LRU list of unreferenced entries of one level: less recently used entry
 };
 
 /**
@@ -271,8 +282,15 @@ struct fsw_volume {
 
     struct fsw_dnode *dnode_head;   //!< List of all dnodes allocated for this volume
 
-    struct fsw_blockcache *bcache;  //!< Array of block cache entries
-    fsw_u32     bcache_size;        //!< Number of entries in the block cache array
+    struct fsw_blockcache **bcache_hash;    //!< Hash buckets of block cache entries, indexed by block number
+    fsw_u32     bcache_hash_bits;   //!< log2 of the number of hash buckets
+    fsw_u32     bcache_size;        //!< Number of entries in the block cache
+    fsw_u32     bcache_budget;      //!< Maximum number of bytes of block data to keep cached
+    struct fsw_blockcache *bcache_lru_head[FSW_MAX_CACHE_LEVEL + 1];    //!< Most recently released entry per cache level
+    struct fsw_blockcache *bcache_lru_tail[FSW_MAX_CACHE_LEVEL + 1];    //!< Least recently released entry per cache level
+    fsw_u32     bcache_hits;        //!< Statistics: lookups served from the cache
+    fsw_u32     bcache_misses;      //!< Statistics: lookups that had to read from disk
+    fsw_u32     bcache_evictions;   //!< Statistics: entries recycled to stay within the budget
 
     void        *host_data;         //!< Hook for a host-specific data structure
     struct fsw_host_table *host_table;      //!< Dispatch table for host-specific functions
@@ -349,6 +367,7 @@ struct fsw_shandle {
     struct fsw_dnode *dnode;        //!< The dnode this handle reads data from
 
     fsw_u64     pos;                //!< Current file pointer in bytes
+    fsw_u64     next_pos;           //!< File pointer after the previous read, to detect sequential access
     struct fsw_extent extent;       //!< Current extent
 };
 
@@ -393,6 +412,8 @@ struct fsw_host_table
                                      fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                                      fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
     fsw_status_t EFIAPI (*read_block)(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+    fsw_status_t EFIAPI (*read_blocks)(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);  //!< Optional: read count contiguous blocks into a caller buffer
+    void         EFIAPI (*read_ahead)(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count);  //!< Optional: hint that these blocks will be read next
 };
 
 /**
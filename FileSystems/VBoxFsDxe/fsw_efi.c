@@ -104,9 +104,16 @@ void fsw_efi_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
 fsw_status_t fsw_efi_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+void fsw_efi_read_ahead(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count);
 
 EFI_STATUS fsw_efi_map_status(fsw_status_t fsw_status, FSW_VOLUME_DATA *Volume);
 
+static VOID fsw_efi_readahead_wait(FSW_EFI_READAHEAD *Ra);
+static EFI_STATUS fsw_efi_readahead_read(FSW_VOLUME_DATA *Volume, FSW_EFI_READAHEAD *Ra,
+                                         UINT64 Offset, UINTN Size, VOID *Buffer);
+static VOID fsw_efi_readahead_free(FSW_EFI_READAHEAD *Ra);
+
 EFI_STATUS EFIAPI fsw_efi_FileSystem_OpenVolume(IN EFI_FILE_IO_INTERFACE *This,
                                                 OUT EFI_FILE_PROTOCOL **Root);
 EFI_STATUS fsw_efi_dnode_to_FileHandle(IN struct fsw_dnode *dno,
@@ -181,7 +188,9 @@ struct fsw_host_table   fsw_efi_host_table = {
     FSW_STRING_TYPE_UTF16,
 
     fsw_efi_change_blocksize,
-    fsw_efi_read_block
+    fsw_efi_read_block,
+    fsw_efi_read_blocks,
+    fsw_efi_read_ahead
 };
 
 extern struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME (
@@ -403,8 +412,10 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Start(IN EFI_DRIVER_BINDING_PROTOCOL  *T
 
     if (BlockIo2 != NULL) {
       Volume->MediaId         = BlockIo2->Media->MediaId;
+      Volume->DiskSize        = MultU64x32(BlockIo2->Media->LastBlock + 1, BlockIo2->Media->BlockSize);
     } else {
       Volume->MediaId         = BlockIo->Media->MediaId;
+      Volume->DiskSize        = MultU64x32(BlockIo->Media->LastBlock + 1, BlockIo->Media->BlockSize);
     }
 
     // mount the filesystem
@@ -586,6 +597,188 @@ fsw_status_t fsw_efi_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *
     return FSW_SUCCESS;
 }
 
+/**
+ * FSW interface function to read a run of contiguous data blocks. This function is called
+ * by the FSW core to read file data straight into the caller's buffer with a single
+ * Disk I/O request instead of going block by block through the block cache.
+ */
+
+fsw_status_t fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer)
+{
+    EFI_STATUS          Status;
+    FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+    UINTN               Size = (UINTN)count * vol->phys_blocksize;
+
+    // read from disk, through the read-ahead buffer of the file being read
+    if (Volume->ReadAhead != NULL)
+    {
+      Status = fsw_efi_readahead_read(Volume, Volume->ReadAhead, (UINT64)phys_bno * vol->phys_blocksize, Size, buffer);
+    } else if (Volume->DiskIo2 != NULL)
+    {
+      Status = Volume->DiskIo2->ReadDiskEx(Volume->DiskIo2, Volume->MediaId, (UINT64)phys_bno * vol->phys_blocksize, &(Volume->DiskIo2Token), Size, buffer);
+    } else {
+      Status = Volume->DiskIo->ReadDisk(Volume->DiskIo, Volume->MediaId,
+                                      (UINT64)phys_bno * vol->phys_blocksize,
+                                      Size,
+                                      buffer);
+    }
+
+    Volume->LastIOStatus = Status;
+    if (EFI_ERROR(Status))
+        return FSW_IO_ERROR;
+    return FSW_SUCCESS;
+}
+
+/**
+ * FSW interface function for read-ahead hints. The FSW core calls it after a sequential
+ * read with the blocks where the file continues. If a file read is in progress and
+ * Disk I/O 2 is available, an asynchronous read of (the start of) these blocks into the
+ * file's read-ahead buffer is started, to be picked up by the next fsw_efi_read_blocks.
+ */
+
+void fsw_efi_read_ahead(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count)
+{
+    EFI_STATUS          Status;
+    FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+    FSW_EFI_READAHEAD   *Ra = Volume->ReadAhead;
+    UINT64              Offset = (UINT64)phys_bno * vol->phys_blocksize;
+    UINTN               Size;
+
+    // completion is polled, which needs the firmware's timer to run
+    if (Ra == NULL || Volume->DiskIo2 == NULL || EfiGetCurrentTpl() != TPL_APPLICATION)
+        return;
+
+    Size = FSW_EFI_READAHEAD_SIZE;
+    if ((UINT64)count * vol->phys_blocksize < Size)
+        Size = (UINTN)count * vol->phys_blocksize;
+    if (Offset >= Volume->DiskSize)
+        return;
+    if (Volume->DiskSize - Offset < Size)
+        Size = (UINTN)(Volume->DiskSize - Offset);
+
+    // still inside the data that is already buffered or on its way?
+    if ((Ra->Pending || Ra->Valid) && Offset >= Ra->Offset && Offset < Ra->Offset + Ra->Size)
+        return;
+    fsw_efi_readahead_wait(Ra);
+
+    if (Ra->Buffer == NULL) {
+        Ra->Buffer = AllocatePool(FSW_EFI_READAHEAD_SIZE);
+        if (Ra->Buffer == NULL)
+            return;
+    }
+    if (Ra->Token.Event == NULL) {
+        Status = BS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &Ra->Token.Event);
+        if (EFI_ERROR(Status)) {
+            Ra->Token.Event = NULL;
+            return;
+        }
+    }
+
+    Ra->Offset = Offset;
+    Ra->Size = Size;
+    Ra->Valid = FALSE;
+    Ra->Token.TransactionStatus = EFI_NOT_READY;
+    Ra->DiskIo2 = Volume->DiskIo2;
+    Status = Volume->DiskIo2->ReadDiskEx(Volume->DiskIo2, Volume->MediaId, Offset, &Ra->Token, Size, Ra->Buffer);
+    Ra->Pending = !EFI_ERROR(Status);
+}
+
+/**
+ * Give up the read of a read-ahead buffer that was cancelled. The disk may still
+ * transfer into the buffer, so it is left allocated and a new one is used next time.
+ */
+
+static VOID fsw_efi_readahead_abandon(FSW_EFI_READAHEAD *Ra)
+{
+    if (Ra->Token.Event != NULL) {
+        BS->CloseEvent(Ra->Token.Event);
+        Ra->Token.Event = NULL;
+    }
+    Ra->Buffer = NULL;
+    Ra->Pending = FALSE;
+    Ra->Valid = FALSE;
+}
+
+/**
+ * Wait for the asynchronous read of a read-ahead buffer to complete, if one is in flight.
+ * The completion is delivered at TPL_CALLBACK, so above TPL_APPLICATION the read is
+ * cancelled instead of waited for.
+ */
+
+static VOID fsw_efi_readahead_wait(FSW_EFI_READAHEAD *Ra)
+{
+    EFI_STATUS          Status;
+
+    if (!Ra->Pending)
+        return;
+    Status = BS->CheckEvent(Ra->Token.Event);
+    if (Status == EFI_NOT_READY && EfiGetCurrentTpl() > TPL_APPLICATION) {
+        Ra->DiskIo2->Cancel(Ra->DiskIo2);
+        fsw_efi_readahead_abandon(Ra);
+        return;
+    }
+    while (Status == EFI_NOT_READY)
+        Status = BS->CheckEvent(Ra->Token.Event);
+    // Cancel() aborts the reads of every handle on the volume
+    if (Ra->Token.TransactionStatus == EFI_ABORTED) {
+        fsw_efi_readahead_abandon(Ra);
+        return;
+    }
+    Ra->Pending = FALSE;
+    Ra->Valid = !EFI_ERROR(Ra->Token.TransactionStatus);
+}
+
+/**
+ * Read from disk for a file that has read-ahead state. The part of the request that
+ * was prefetched is copied from the read-ahead buffer, waiting for the prefetch to
+ * complete if necessary; the rest is read synchronously.
+ */
+
+static EFI_STATUS fsw_efi_readahead_read(FSW_VOLUME_DATA *Volume, FSW_EFI_READAHEAD *Ra,
+                                         UINT64 Offset, UINTN Size, VOID *Buffer)
+{
+    UINT8               *Dest = (UINT8 *)Buffer;
+    UINTN               Copy;
+
+    if ((Ra->Pending || Ra->Valid) && Offset >= Ra->Offset && Offset < Ra->Offset + Ra->Size) {
+        fsw_efi_readahead_wait(Ra);
+        if (Ra->Valid) {
+            Copy = (UINTN)(Ra->Offset + Ra->Size - Offset);
+            if (Copy > Size)
+                Copy = Size;
+            CopyMem(Dest, Ra->Buffer + (UINTN)(Offset - Ra->Offset), Copy);
+            Dest   += Copy;
+            Offset += Copy;
+            Size   -= Copy;
+        }
+    }
+    if (Size == 0)
+        return EFI_SUCCESS;
+
+    if (Volume->DiskIo2 != NULL)
+        return Volume->DiskIo2->ReadDiskEx(Volume->DiskIo2, Volume->MediaId, Offset, &(Volume->DiskIo2Token), Size, Dest);
+    return Volume->DiskIo->ReadDisk(Volume->DiskIo, Volume->MediaId, Offset, Size, Dest);
+}
+
+/**
+ * Release the read-ahead state of a file handle. An outstanding read must finish
+ * or be cancelled before its buffer can be freed.
+ */
+
+static VOID fsw_efi_readahead_free(FSW_EFI_READAHEAD *Ra)
+{
+    fsw_efi_readahead_wait(Ra);
+    if (Ra->Token.Event != NULL) {
+        BS->CloseEvent(Ra->Token.Event);
+        Ra->Token.Event = NULL;
+    }
+    if (Ra->Buffer != NULL) {
+        FreePool(Ra->Buffer);
+        Ra->Buffer = NULL;
+    }
+    Ra->Valid = FALSE;
+}
+
 /**
  * Map FSW status codes to EFI status codes. The FSW_IO_ERROR code is only produced
  * by fsw_efi_read_block, so we map it back to the EFI status code remembered from
@@ -677,6 +870,7 @@ EFI_STATUS EFIAPI fsw_efi_FileHandle_Close(IN EFI_FILE_PROTOCOL *This)
 //    Print(L"fsw_efi_FileHandle_Close\n");
 #endif
 
+    fsw_efi_readahead_free(&File->ReadAhead);
     fsw_shandle_close(&File->shand);
     FreePool(File);
 
@@ -890,6 +1084,7 @@ EFI_STATUS fsw_efi_file_read(IN FSW_FILE_DATA *File,
                              OUT VOID *Buffer)
 {
   EFI_STATUS          Status;
+  FSW_VOLUME_DATA     *Volume;
   fsw_u32             buffer_size;
   
 #if DEBUG_LEVEL
@@ -897,8 +1092,10 @@ EFI_STATUS fsw_efi_file_read(IN FSW_FILE_DATA *File,
 #endif
   
   buffer_size = (fsw_u32)*BufferSize;
-  Status = fsw_efi_map_status(fsw_shandle_read(&File->shand, &buffer_size, Buffer),
-                              (FSW_VOLUME_DATA *)File->shand.dnode->vol->host_data);
+  Volume = (FSW_VOLUME_DATA *)File->shand.dnode->vol->host_data;
+  Volume->ReadAhead = &File->ReadAhead;
+  Status = fsw_efi_map_status(fsw_shandle_read(&File->shand, &buffer_size, Buffer), Volume);
+  Volume->ReadAhead = NULL;
   *BufferSize = buffer_size;
   
   return Status;
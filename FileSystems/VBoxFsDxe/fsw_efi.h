@@ -57,6 +57,24 @@
 extern CHAR8     *msgCursor;
 extern MESSAGE_LOG_PROTOCOL *Msg;
 
+/** Size of the read-ahead buffer of a file handle. */
+#define FSW_EFI_READAHEAD_SIZE  (1024 * 1024)
+
+/**
+ * EFI Host: Read-ahead state of a file handle. Holds one asynchronous Disk I/O 2
+ * request for the file data that a sequential reader is expected to ask for next.
+ */
+
+typedef struct {
+    EFI_DISK_IO2_TOKEN          Token;          //!< Token of the asynchronous read, Event is created on first use
+    EFI_DISK_IO2_PROTOCOL       *DiskIo2;       //!< Protocol the read was issued on, to cancel it
+    UINT8                       *Buffer;        //!< Prefetch buffer of FSW_EFI_READAHEAD_SIZE bytes
+    UINT64                      Offset;         //!< Disk offset of the data in Buffer
+    UINTN                       Size;           //!< Number of bytes requested into Buffer
+    BOOLEAN                     Pending;        //!< The read is still in flight
+    BOOLEAN                     Valid;          //!< Buffer holds the requested data
+} FSW_EFI_READAHEAD;
+
 /**
  * EFI Host: Private per-volume structure.
  */
@@ -72,6 +90,8 @@ typedef struct {
     EFI_DISK_IO_PROTOCOL       *DiskIo;         //!< The Disk I/O protocol we use for disk access (V1)
     UINT32                      MediaId;        //!< The media ID from the Block I/O protocol
     EFI_STATUS                  LastIOStatus;   //!< Last status from Disk I/O
+    UINT64                      DiskSize;       //!< Size of the partition in bytes, bounds read-ahead requests
+    FSW_EFI_READAHEAD           *ReadAhead;     //!< Read-ahead state of the file being read, NULL otherwise
 
     struct fsw_volume           *vol;           //!< FSW volume structure
 
@@ -93,6 +113,7 @@ typedef struct {
 
     UINT64                      Type;           //!< File type used for dispatching
     struct fsw_shandle          shand;          //!< FSW handle for this file
+    FSW_EFI_READAHEAD           ReadAhead;      //!< Read-ahead state for sequential file reads
 
 } FSW_FILE_DATA;
 
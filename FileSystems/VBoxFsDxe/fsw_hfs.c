@@ -27,8 +27,10 @@
 
 #include "fsw_hfs.h"
 
+#ifdef VBOX
 #include <Library/MemLogLib.h>
 #include <Library/PrintLib.h>
+#endif
 
 
 #define VBOXHFS_BTREE_BINSEARCH 0
@@ -37,6 +37,8 @@
 
 #include "fsw_posix.h"
 
+#include <stdarg.h>
+
 
 #ifndef FSTYPE
 /** The file system type name to use. */
@@ -52,7 +54,8 @@ fsw_status_t fsw_posix_open_dno(struct fsw_posix_volume *pvol, const char *path,
 void fsw_posix_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
-fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
+fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t fsw_posix_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
 
 /**
  * Dispatch table for our FSW host driver.
@@ -62,7 +65,8 @@ struct fsw_host_table   fsw_posix_host_table = {
     FSW_STRING_TYPE_ISO88591,
 
     fsw_posix_change_blocksize,
-    fsw_posix_read_block
+    fsw_posix_read_block,
+    fsw_posix_read_blocks
 };
 
 extern struct fsw_fstype_table   FSW_FSTYPE_TABLE_NAME(FSTYPE);
@@ -362,26 +366,82 @@ void fsw_posix_change_blocksize(struct fsw_volume *vol,
  * to read a block of data from the device. The buffer is allocated by the core code.
  */
 
-fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer)
+fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer)
+{
+    return fsw_posix_read_blocks(vol, phys_bno, 1, buffer);
+}
+
+/**
+ * FSW interface function to read a run of contiguous data blocks straight into
+ * a buffer provided by the caller.
+ */
+
+fsw_status_t fsw_posix_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer)
 {
     struct fsw_posix_volume *pvol = (struct fsw_posix_volume *)vol->host_data;
-    off_t           block_offset, seek_result;
+    off_t           block_offset;
+    size_t          size;
     ssize_t         read_result;
 
-    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_read_block: %d  (%d)\n"), phys_bno, vol->phys_blocksize));
+    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_read_blocks: %llu %u  (%d)\n"), phys_bno, count, vol->phys_blocksize));
 
     // read from disk
     block_offset = (off_t)phys_bno * vol->phys_blocksize;
-    seek_result = lseek(pvol->fd, block_offset, SEEK_SET);
-    if (seek_result != block_offset)
-        return FSW_IO_ERROR;
-    read_result = read(pvol->fd, buffer, vol->phys_blocksize);
-    if (read_result != vol->phys_blocksize)
+    size = (size_t)count * vol->phys_blocksize;
+    read_result = pread(pvol->fd, buffer, size, block_offset);
+    if (read_result != (ssize_t)size)
         return FSW_IO_ERROR;
 
+    pvol->read_calls++;
+    pvol->read_bytes += size;
     return FSW_SUCCESS;
 }
 
+/**
+ * Minimal UnicodeSPrint for the drivers: formats with the C library and
+ * narrows the result to UTF-16 code units. Returns the number of characters.
+ */
+
+int UnicodeSPrint(CHAR16 *buffer, int buffer_size, const wchar_t *format, ...)
+{
+    va_list         args;
+    wchar_t         tmp[256];
+    int             i, len;
+
+    va_start(args, format);
+    len = vswprintf(tmp, sizeof(tmp) / sizeof(tmp[0]), format, args);
+    va_end(args);
+    if (len < 0)
+        len = 0;
+    if (len > buffer_size / (int)sizeof(CHAR16) - 1)
+        len = buffer_size / (int)sizeof(CHAR16) - 1;
+    for (i = 0; i < len; i++)
+        buffer[i] = (CHAR16)tmp[i];
+    buffer[len] = 0;
+    return len;
+}
+
+
+/**
+ * Stat helpers called by the file system drivers. The POSIX host just passes
+ * the values on to the callbacks of the caller, if any.
+ */
+
+void fsw_store_time_posix(struct fsw_dnode_stat_str *sb, int which, fsw_u32 posix_time)
+{
+    if (sb->store_time_posix != NULL)
+        sb->store_time_posix(sb, which, posix_time);
+}
+
+void fsw_store_attr_posix(struct fsw_dnode_stat_str *sb, fsw_u16 posix_mode)
+{
+    if (sb->store_attr_posix != NULL)
+        sb->store_attr_posix(sb, posix_mode);
+}
+
+void fsw_store_attr_efi(struct fsw_dnode_stat_str *sb, fsw_u16 attr)
+{
+}
 
 /**
  * Time mapping callback for the fsw_dnode_stat call. This function converts
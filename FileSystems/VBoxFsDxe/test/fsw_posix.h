@@ -54,6 +54,8 @@ struct fsw_posix_volume {
 
     int                         fd;             //!< System file descriptor for data access
 
+    unsigned long               read_calls;     //!< Statistics: number of disk read requests
+    unsigned long long          read_bytes;     //!< Statistics: number of bytes read from disk
 };
 
 /**
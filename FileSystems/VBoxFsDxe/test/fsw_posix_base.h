@@ -44,6 +44,8 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stddef.h>
+#include <wchar.h>
 
 #define FSW_LITTLE_ENDIAN (1)
 // TODO: use info from the headers to define FSW_LITTLE_ENDIAN or FSW_BIG_ENDIAN
@@ -55,8 +57,8 @@ typedef signed char         fsw_s8;
 typedef unsigned char       fsw_u8;
 typedef short               fsw_s16;
 typedef unsigned short      fsw_u16;
-typedef long                fsw_s32;
-typedef unsigned long       fsw_u32;
+typedef int                 fsw_s32;
+typedef unsigned int        fsw_u32;
 typedef long long           fsw_s64;
 typedef unsigned long long  fsw_u64;
 
@@ -72,6 +74,10 @@ typedef unsigned long long  fsw_u64;
 #define fsw_memcpy(dest,src,size) memcpy(dest,src,size)
 #define fsw_memeq(p1,p2,size) (memcmp(p1,p2,size) == 0)
 
+// calling convention of the host table functions
+
+#define EFIAPI
+
 // message printing
 
 #define FSW_MSGSTR(s) s
@@ -86,4 +92,30 @@ typedef unsigned long long  fsw_u64;
 #define RShiftU64(val, shift) ((val) >> (shift))
 #define LShiftU64(val, shift) ((val) << (shift))
 
+// EDK2 helpers used by the file system drivers
+
+#define SwapBytes16(x) __builtin_bswap16(x)
+#define SwapBytes32(x) __builtin_bswap32(x)
+#define SwapBytes64(x) __builtin_bswap64(x)
+
+static inline fsw_u32 ReadUnaligned32(const void *p) { fsw_u32 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline fsw_u64 ReadUnaligned64(const void *p) { fsw_u64 v; memcpy(&v, p, sizeof(v)); return v; }
+
+typedef long                INTN;
+typedef unsigned char       UINT8;
+typedef unsigned short      CHAR16;
+
+#define OFFSET_OF(type, field) offsetof(type, field)
+#define MultU64x32(val, mul) ((fsw_u64)(val) * (fsw_u32)(mul))
+#define AsciiSPrint snprintf
+
+int UnicodeSPrint(CHAR16 *buffer, int buffer_size, const wchar_t *format, ...);
+
+typedef struct {
+    fsw_u32 Data1;
+    fsw_u16 Data2;
+    fsw_u16 Data3;
+    fsw_u8  Data4[8];
+} EFI_GUID;
+
 #endif
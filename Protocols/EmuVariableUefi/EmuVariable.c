@@ -274,6 +274,270 @@ GetEndPointer (
   return (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) VolHeader + VolHeader->Size);
 }
 
+/**
+  Tells whether a variable header is live and visible to the caller.
+
+  Only completely added variables are visible, and after ExitBootServices
+  only those with the runtime access attribute.
+
+  @param  Variable      Pointer to the variable header.
+
+  @retval TRUE          The variable can be returned to the caller.
+  @retval FALSE         The variable is deleted, in transition or hidden at runtime.
+
+**/
+BOOLEAN
+IsVisibleVariable (
+  IN  VARIABLE_HEADER   *Variable
+  )
+{
+  if (Variable->StartId != VARIABLE_DATA || Variable->State != VAR_ADDED) {
+    return FALSE;
+  }
+  return !(VariableClassAtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0));
+}
+
+/**
+  Compares the key of a variable header with a name and vendor GUID.
+
+  @param  Variable      Pointer to the variable header.
+  @param  VariableName  Null-terminated name to compare.
+  @param  NameSize      Size of VariableName in bytes, including the terminator.
+  @param  VendorGuid    Vendor GUID to compare.
+
+  @retval TRUE          The variable has this name and GUID.
+
+**/
+BOOLEAN
+IsVariableKey (
+  IN  VARIABLE_HEADER   *Variable,
+  IN  CHAR16            *VariableName,
+  IN  UINTN             NameSize,
+  IN  EFI_GUID          *VendorGuid
+  )
+{
+  return Variable->NameSize == NameSize &&
+         CompareGuid (VendorGuid, &Variable->VendorGuid) &&
+         CompareMem (VariableName, GET_VARIABLE_NAME_PTR (Variable), NameSize) == 0;
+}
+
+/**
+  Hashes a (VendorGuid, Name) key with FNV-1a.
+
+  @param  VariableName  Name of the variable.
+  @param  NameSize      Size of VariableName in bytes, including the terminator.
+  @param  VendorGuid    Vendor GUID of the variable.
+
+  @return The 32-bit hash of the key.
+
+**/
+UINT32
+VariableIndexHash (
+  IN  CHAR16            *VariableName,
+  IN  UINTN             NameSize,
+  IN  EFI_GUID          *VendorGuid
+  )
+{
+  UINT32      Hash;
+  CONST UINT8 *Bytes;
+  UINTN       Index;
+
+  Hash  = 2166136261U;
+  Bytes = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Bytes[Index]) * 16777619U;
+  }
+  Bytes = (CONST UINT8 *) VariableName;
+  for (Index = 0; Index < NameSize; Index++) {
+    Hash = (Hash ^ Bytes[Index]) * 16777619U;
+  }
+  return Hash;
+}
+
+/**
+  Converts an index reference into a pointer to the variable header.
+
+  @param  Ref           Store offset tagged with VARIABLE_INDEX_VOLATILE.
+  @param  Global        Pointer to VARIABLE_GLOBAL structure.
+
+  @return Pointer to the variable header.
+
+**/
+VARIABLE_HEADER *
+VariableIndexRefToPtr (
+  IN  UINT32            Ref,
+  IN  VARIABLE_GLOBAL   *Global
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Base;
+
+  Base = ((Ref & VARIABLE_INDEX_VOLATILE) != 0) ? Global->VolatileVariableBase : Global->NonVolatileVariableBase;
+  return (VARIABLE_HEADER *) (UINTN) (Base + (Ref & ~VARIABLE_INDEX_VOLATILE));
+}
+
+/**
+  Converts a pointer to a variable header into an index reference.
+
+  @param  Variable      Pointer to the variable header.
+  @param  Volatile      TRUE if the variable lives in the volatile store.
+  @param  Global        Pointer to VARIABLE_GLOBAL structure.
+
+  @return Store offset tagged with VARIABLE_INDEX_VOLATILE.
+
+**/
+UINT32
+VariableIndexPtrToRef (
+  IN  VARIABLE_HEADER   *Variable,
+  IN  BOOLEAN           Volatile,
+  IN  VARIABLE_GLOBAL   *Global
+  )
+{
+  if (Volatile) {
+    return (UINT32) ((UINTN) Variable - (UINTN) Global->VolatileVariableBase) | VARIABLE_INDEX_VOLATILE;
+  }
+  return (UINT32) ((UINTN) Variable - (UINTN) Global->NonVolatileVariableBase);
+}
+
+/**
+  Looks up the index slot of a (VendorGuid, Name) key.
+
+  The index uses linear probing and never removes slots: a deleted variable
+  keeps its slot, and the slot is reused when the same key is set again.
+
+  @param  VariableName  Name of the variable.
+  @param  NameSize      Size of VariableName in bytes, including the terminator.
+  @param  VendorGuid    Vendor GUID of the variable.
+  @param  Hash          VariableIndexHash() of the key.
+  @param  Global        Pointer to VARIABLE_GLOBAL structure.
+
+  @return The slot holding the key, or the free slot where it belongs.
+  @retval NULL          The key is absent and the index is full.
+
+**/
+VARIABLE_INDEX_ENTRY *
+VariableIndexFind (
+  IN  CHAR16            *VariableName,
+  IN  UINTN             NameSize,
+  IN  EFI_GUID          *VendorGuid,
+  IN  UINT32            Hash,
+  IN  VARIABLE_GLOBAL   *Global
+  )
+{
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINTN                 Index;
+  UINTN                 Probe;
+
+  Index = Hash & mVariableModuleGlobal->VariableIndexMask;
+  for (Probe = 0; Probe <= mVariableModuleGlobal->VariableIndexMask; Probe++) {
+    Entry = &mVariableModuleGlobal->VariableIndex[Index];
+    if (Entry->Ref == 0) {
+      return Entry;
+    }
+    if (Entry->Hash == Hash &&
+        IsVariableKey (VariableIndexRefToPtr (Entry->Ref, Global), VariableName, NameSize, VendorGuid)) {
+      return Entry;
+    }
+    Index = (Index + 1) & mVariableModuleGlobal->VariableIndexMask;
+  }
+  return NULL;
+}
+
+/**
+  Records a variable header in the index.
+
+  @param  Variable      Pointer to the variable header.
+  @param  Volatile      TRUE if the variable lives in the volatile store.
+  @param  Replace       TRUE to point the key at Variable even if the slot still
+                        references a live variable, FALSE to keep that one.
+  @param  Global        Pointer to VARIABLE_GLOBAL structure.
+
+**/
+VOID
+VariableIndexInsert (
+  IN  VARIABLE_HEADER   *Variable,
+  IN  BOOLEAN           Volatile,
+  IN  BOOLEAN           Replace,
+  IN  VARIABLE_GLOBAL   *Global
+  )
+{
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINT32                Hash;
+
+  if (mVariableModuleGlobal->VariableIndex == NULL) {
+    return;
+  }
+
+  Hash  = VariableIndexHash (GET_VARIABLE_NAME_PTR (Variable), Variable->NameSize, &Variable->VendorGuid);
+  Entry = VariableIndexFind (GET_VARIABLE_NAME_PTR (Variable), Variable->NameSize, &Variable->VendorGuid, Hash, Global);
+  if (Entry == NULL) {
+    //
+    // Cannot happen with the size picked in InitializeVariableIndex(), but if it
+    // does, drop the index and let FindVariable() walk the stores again.
+    //
+    mVariableModuleGlobal->VariableIndex = NULL;
+    return;
+  }
+  if (!Replace && Entry->Ref != 0 && IsVisibleVariable (VariableIndexRefToPtr (Entry->Ref, Global))) {
+    return;
+  }
+  Entry->Hash = Hash;
+  Entry->Ref  = VariableIndexPtrToRef (Variable, Volatile, Global);
+}
+
+/**
+  Adds the variables already present in a variable store to the index.
+
+  Used for a reserved NV store preserved across resets.
+
+  @param  VariableStore Pointer to the start of the variable store.
+  @param  Volatile      TRUE if VariableStore is the volatile store.
+
+**/
+VOID
+IndexVariableStore (
+  IN  VARIABLE_STORE_HEADER *VariableStore,
+  IN  BOOLEAN               Volatile
+  )
+{
+  VARIABLE_HEADER *Variable;
+
+  for ( Variable = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStore + 1)
+      ; (Variable < GetEndPointer (VariableStore) && (Variable != NULL))
+      ; Variable = GetNextVariablePtr (Variable)
+      ) {
+    if (Variable->State == VAR_ADDED) {
+      VariableIndexInsert (Variable, Volatile, FALSE, &mVariableModuleGlobal->VariableGlobal[Physical]);
+    }
+  }
+}
+
+/**
+  Allocates the (VendorGuid, Name) hash index.
+
+  The stores are append-only, so the number of distinct keys can never exceed
+  the number of smallest possible variables that fit in both of them. The index
+  is sized for that bound, so it never fills up and never needs to grow at runtime.
+  Without the index, FindVariable() falls back to walking the stores.
+
+**/
+VOID
+InitializeVariableIndex (
+  VOID
+  )
+{
+  UINTN   MaxVariables;
+  UINTN   Slots;
+
+  MaxVariables = 2 * (PcdGet32 (PcdVariableStoreSize) / HEADER_ALIGN (sizeof (VARIABLE_HEADER) + 2 * sizeof (CHAR16) + 1));
+  Slots = 1;
+  while (Slots < MaxVariables + MaxVariables / 4) {
+    Slots <<= 1;
+  }
+
+  mVariableModuleGlobal->VariableIndex = (VARIABLE_INDEX_ENTRY *) AllocateRuntimeZeroPool (Slots * sizeof (VARIABLE_INDEX_ENTRY));
+  mVariableModuleGlobal->VariableIndexMask = Slots - 1;
+}
+
 /**
   Routine used to track statistical information about variable usage. 
   The data is stored in the EFI system table so it can be accessed later.
@@ -1057,6 +1321,7 @@ UpdateVariable (
   if (Variable->CurrPtr != NULL) {
     Variable->CurrPtr->State &= VAR_DELETED;
   }
+  VariableIndexInsert (NextVariable, (BOOLEAN) ((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0), TRUE, Global);
 
   UpdateVariableInfo (VariableName, VendorGuid, Variable->Volatile, FALSE, TRUE, FALSE, FALSE);
 
@@ -1099,6 +1364,8 @@ FindVariable (
   VARIABLE_HEADER       *Variable[2];
   VARIABLE_STORE_HEADER *VariableStoreHeader[2];
   UINTN                 Index;
+  UINTN                 NameSize;
+  VARIABLE_INDEX_ENTRY  *Entry;
 
   //
   // 0: Non-Volatile, 1: Volatile
@@ -1116,6 +1383,30 @@ FindVariable (
   if (VariableName[0] != 0 && VendorGuid == NULL) {
     return EFI_INVALID_PARAMETER;
   }
+
+  if (VariableName[0] != 0 && mVariableModuleGlobal->VariableIndex != NULL) {
+    //
+    // The index points at the newest header of every key ever set; when that
+    // one is not visible, no older header of the key is either.
+    //
+    NameSize = StrSize (VariableName);
+    Entry    = VariableIndexFind (VariableName, NameSize, VendorGuid, VariableIndexHash (VariableName, NameSize, VendorGuid), Global);
+    if (Entry != NULL && Entry->Ref != 0) {
+      PtrTrack->CurrPtr = VariableIndexRefToPtr (Entry->Ref, Global);
+      if (IsVisibleVariable (PtrTrack->CurrPtr)) {
+        Index = ((Entry->Ref & VARIABLE_INDEX_VOLATILE) != 0) ? 1 : 0;
+        PtrTrack->StartPtr  = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStoreHeader[Index] + 1);
+        PtrTrack->EndPtr    = GetEndPointer (VariableStoreHeader[Index]);
+        PtrTrack->Volatile  = (BOOLEAN) Index;
+        return EFI_SUCCESS;
+      }
+    }
+    PtrTrack->StartPtr  = Variable[1];
+    PtrTrack->EndPtr    = GetEndPointer (VariableStoreHeader[1]);
+    PtrTrack->CurrPtr   = NULL;
+    return EFI_NOT_FOUND;
+  }
+
   //
   // Find the variable by walk through non-volatile and volatile variable store
   //
@@ -1266,6 +1557,8 @@ EmuGetNextVariableName (
   VARIABLE_POINTER_TRACK  Variable;
   UINTN                   VarNameSize;
   EFI_STATUS              Status;
+  UINT32                  Cursor;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
 
   if (VariableNameSize == NULL || VariableName == NULL || VendorGuid == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -1273,7 +1566,29 @@ EmuGetNextVariableName (
 
   AcquireLockOnlyAtBootTime(&Global->VariableServicesLock);
 
-  Status = FindVariable (VariableName, VendorGuid, &Variable, Global);
+  //
+  // Callers enumerate by passing back the name we returned last time, so
+  // resume from there instead of looking the name up again.
+  //
+  Cursor = mVariableModuleGlobal->EnumerationCursor;
+  Variable.CurrPtr = NULL;
+  if (VariableName[0] != 0 && Cursor != 0) {
+    Variable.CurrPtr = VariableIndexRefToPtr (Cursor, Global);
+    if (IsVisibleVariable (Variable.CurrPtr) &&
+        IsVariableKey (Variable.CurrPtr, VariableName, StrSize (VariableName), VendorGuid)) {
+      Variable.Volatile   = (BOOLEAN) ((Cursor & VARIABLE_INDEX_VOLATILE) != 0);
+      VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) (Variable.Volatile ? Global->VolatileVariableBase : Global->NonVolatileVariableBase);
+      Variable.StartPtr   = (VARIABLE_HEADER *) HEADER_ALIGN (VariableStoreHeader + 1);
+      Variable.EndPtr     = GetEndPointer (VariableStoreHeader);
+      Status              = EFI_SUCCESS;
+    } else {
+      Variable.CurrPtr = NULL;
+    }
+  }
+
+  if (Variable.CurrPtr == NULL) {
+    Status = FindVariable (VariableName, VendorGuid, &Variable, Global);
+  }
 
   if (Variable.CurrPtr == NULL || EFI_ERROR(Status)) {
     goto Done;
@@ -1322,6 +1637,7 @@ EmuGetNextVariableName (
             &Variable.CurrPtr->VendorGuid,
             sizeof (EFI_GUID)
             );
+          mVariableModuleGlobal->EnumerationCursor = VariableIndexPtrToRef (Variable.CurrPtr, Variable.Volatile, Global);
           Status = EFI_SUCCESS;
         } else {
           Status = EFI_BUFFER_TOO_SMALL;
@@ -1699,6 +2015,9 @@ InitializeVariableStore (
   //
   *VariableBase             = (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStore;
   InitializeLocationForLastVariableOffset (VariableStore, LastVariableOffset);
+  if (!FullyInitializeStore) {
+    IndexVariableStore (VariableStore, VolatileStore);
+  }
 
   CopyGuid (&VariableStore->Signature, &gEfiVariableGuid);
   VariableStore->Size       = PcdGet32 (PcdVariableStoreSize);
@@ -1787,6 +2106,8 @@ VariableCommonInitialize (
 
   EfiInitializeLock(&mVariableModuleGlobal->VariableGlobal[Physical].VariableServicesLock, TPL_NOTIFY);
 
+  InitializeVariableIndex ();
+
   //
   // Intialize volatile variable store
   //
@@ -209,6 +209,7 @@ VariableClassAddressChangeEvent (
     0x0,
     (VOID **) &mVariableModuleGlobal->VariableGlobal[Physical].VolatileVariableBase
     );
+  gRT->ConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableIndex);
   gRT->ConvertPointer (0x0, (VOID **) &mVariableModuleGlobal);
 }
 
@@ -68,6 +68,19 @@ typedef struct {
   BOOLEAN         Volatile;
 } VARIABLE_POINTER_TRACK;
 
+///
+/// Slot of the (VendorGuid, Name) hash index over both variable stores.
+/// Ref is the offset of the newest VARIABLE_HEADER for the key inside its store,
+/// tagged with VARIABLE_INDEX_VOLATILE for the volatile one; 0 marks a free slot.
+/// Offsets instead of pointers keep the index valid after SetVirtualAddressMap.
+///
+#define VARIABLE_INDEX_VOLATILE   BIT31
+
+typedef struct {
+  UINT32          Hash;
+  UINT32          Ref;
+} VARIABLE_INDEX_ENTRY;
+
 typedef struct {
   EFI_PHYSICAL_ADDRESS  VolatileVariableBase;
   EFI_PHYSICAL_ADDRESS  NonVolatileVariableBase;
@@ -84,6 +97,9 @@ typedef struct {
   CHAR8           *LangCodes;
   CHAR8           *PlatformLang;
   CHAR8           Lang[ISO_639_2_ENTRY_SIZE + 1];
+  VARIABLE_INDEX_ENTRY  *VariableIndex;
+  UINTN                 VariableIndexMask;
+  UINT32                EnumerationCursor;
 } ESAL_VARIABLE_GLOBAL;
 
 ///
@@ -2314,9 +2314,10 @@ EFI_STATUS PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion)
 
   if (gSettings.ACPI.SSDT.Generate.GeneratePStates || gSettings.ACPI.SSDT.Generate.GeneratePluginType) {
     Status = EFI_NOT_FOUND;
-    Ssdt = generate_pss_ssdt(ApicCPUNum);
+    Ssdt = cached_pss_ssdt(ApicCPUNum);
     if (Ssdt) {
       Status = InsertTable(Ssdt, Ssdt->Length);
+      FreePool(Ssdt);
     }
     if(EFI_ERROR(Status)){
       DBG("GeneratePStates failed: Status=%s\n", efiStrError(Status));
@@ -2325,9 +2326,10 @@ EFI_STATUS PatchACPI(IN REFIT_VOLUME *Volume, const MacOsVersion& OSVersion)
 
   if (gSettings.ACPI.SSDT.Generate.GenerateCStates) {
     Status = EFI_NOT_FOUND;
-    Ssdt = generate_cst_ssdt(FadtPointer, ApicCPUNum);
+    Ssdt = cached_cst_ssdt(FadtPointer, ApicCPUNum);
     if (Ssdt) {
       Status = InsertTable(Ssdt, Ssdt->Length);
+      FreePool(Ssdt);
     }
     if(EFI_ERROR(Status)){
       DBG("GenerateCStates failed Status=%s\n", efiStrError(Status));
@@ -11,6 +11,53 @@
 #include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
 #include "AmlGenerator.h"
 
+#define AML_ARENA_BLOCK_SIZE 4096
+
+struct aml_arena_block
+{
+	struct aml_arena_block* Next;
+	UINTN                   Used;
+	UINTN                   Size;
+};
+
+struct aml_arena
+{
+	struct aml_arena_block* Blocks;    // current block first
+	UINTN                   EmitBound; // upper bound of the bytes aml_generate() can write for this tree
+};
+
+// Zeroed memory from the arena. Blocks are allocated with AllocateZeroPool and never reused.
+static void* aml_arena_alloc(struct aml_arena* arena, UINTN size)
+{
+	struct aml_arena_block* block = arena->Blocks;
+	void* ptr;
+
+	size = (size + 7) & ~((UINTN)7);
+	if (block == NULL || block->Used + size > block->Size)
+	{
+		UINTN blockSize = AML_ARENA_BLOCK_SIZE;
+		if (blockSize < sizeof(struct aml_arena_block) + size)
+			blockSize = sizeof(struct aml_arena_block) + size;
+		block = (struct aml_arena_block*)AllocateZeroPool(blockSize);
+		if (!block)
+			return NULL;
+		block->Used = sizeof(struct aml_arena_block);
+		block->Size = blockSize;
+		block->Next = arena->Blocks;
+		arena->Blocks = block;
+	}
+	ptr = (UINT8*)block + block->Used;
+	block->Used += size;
+	return ptr;
+}
+
+// Buffer of a node, from the arena of the tree
+static CHAR8* aml_alloc_buffer(AML_CHUNK* node, UINTN size)
+{
+	node->Arena->EmitBound += size;
+	return (CHAR8*)aml_arena_alloc(node->Arena, size);
+}
+
 XBool aml_add_to_parent(AML_CHUNK* parent, AML_CHUNK* node)
 {
 	if (parent && node)
@@ -43,6 +90,7 @@ XBool aml_add_to_parent(AML_CHUNK* parent, AML_CHUNK* node)
 		if (parent->Last)
 			parent->Last->Next = node;
 		
+		node->Prev = parent->Last;
 		parent->Last = node;
 		
 		return true;
@@ -53,35 +101,51 @@ XBool aml_add_to_parent(AML_CHUNK* parent, AML_CHUNK* node)
 
 AML_CHUNK* aml_create_node(AML_CHUNK* parent)
 {
-	AML_CHUNK* node = (AML_CHUNK*)AllocateZeroPool(sizeof(AML_CHUNK));
+	struct aml_arena* arena;
+	AML_CHUNK* node;
+	
+	if (parent)
+	{
+		arena = parent->Arena;
+	}
+	else
+	{
+		// New tree : the arena descriptor lives in its own first block
+		struct aml_arena newArena = { NULL, 0 };
+		arena = (struct aml_arena*)aml_arena_alloc(&newArena, sizeof(struct aml_arena));
+		if (!arena)
+			return NULL;
+		arena->Blocks = newArena.Blocks;
+	}
+	
+	node = (AML_CHUNK*)aml_arena_alloc(arena, sizeof(AML_CHUNK));
+	if (!node)
+		return NULL;
+	node->Arena = arena;
+	arena->EmitBound += 6; // opcode (2) and package length (4)
 	
 	aml_add_to_parent(parent, node);
 	
 	return node;
 }
 
+/*
+ * Release the whole tree node belongs to, in one go.
+ */
 void aml_destroy_node(AML_CHUNK* node)
 {
-	// Delete child nodes
-	AML_CHUNK* child = node->First;
+	struct aml_arena_block* block;
+	
+	if (!node)
+		return;
 	
-	while (child) 
+	block = node->Arena->Blocks; // the arena descriptor is in the last block of the list
+	while (block)
 	{
-		AML_CHUNK* next = child->Next;
-		
-		if (child->Buffer)
-			FreePool(child->Buffer);
-		
-		FreePool(child);
-		
-		child = next;
+		struct aml_arena_block* next = block->Next;
+		FreePool(block);
+		block = next;
 	}
-	
-	// Free node
-	if (node->Buffer)
-		FreePool(node->Buffer);
-	
-	FreePool(node);
 }
 
 AML_CHUNK* aml_add_buffer(AML_CHUNK* parent,  CONST UINT8* buffer, UINT32 size)
@@ -92,7 +156,7 @@ AML_CHUNK* aml_add_buffer(AML_CHUNK* parent,  CONST UINT8* buffer, UINT32 size)
 	{
 		node->Type = AML_CHUNK_NONE;
 		node->Length = (UINT16)size;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		CopyMem(node->Buffer, buffer, node->Length);
 	}
 	
@@ -108,7 +172,7 @@ AML_CHUNK* aml_add_byte(AML_CHUNK* parent, UINT8 value)
 		node->Type = AML_CHUNK_BYTE;
 		
 		node->Length = 1;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value;
 	}
 	
@@ -123,7 +187,7 @@ AML_CHUNK* aml_add_word(AML_CHUNK* parent, UINT16 value)
 	{
 		node->Type = AML_CHUNK_WORD;
 		node->Length = 2;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
 		node->Buffer[1] = value >> 8;
 	}
@@ -139,7 +203,7 @@ AML_CHUNK* aml_add_dword(AML_CHUNK* parent, UINT32 value)
 	{
 		node->Type = AML_CHUNK_DWORD;
 		node->Length = 4;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
 		node->Buffer[1] = (value >> 8) & 0xff;
 		node->Buffer[2] = (value >> 16) & 0xff;
@@ -157,7 +221,7 @@ AML_CHUNK* aml_add_qword(AML_CHUNK* parent, UINT64 value)
 	{
 		node->Type = AML_CHUNK_QWORD;
 		node->Length = 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		node->Buffer[0] = value & 0xff;
     node->Buffer[1] = RShiftU64(value, 8) & 0xff;
     node->Buffer[2] = RShiftU64(value, 16) & 0xff;
@@ -207,7 +271,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	if (count == 1) 
 	{
 		node->Length = (UINT16)(4 + root);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+		node->Buffer = aml_alloc_buffer(node, node->Length+4);
 		CopyMem(node->Buffer, name, 4 + root);
     offset += 4 + root;
 		return (UINT32)offset;
@@ -216,7 +280,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	if (count == 2) 
 	{
 		node->Length = 2 + 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+		node->Buffer = aml_alloc_buffer(node, node->Length+4);
 		node->Buffer[offset++] = 0x5c; // Root Char
 		node->Buffer[offset++] = 0x2e; // Double name
 		CopyMem(node->Buffer+offset, name + root, 8);
@@ -225,7 +289,7 @@ UINT32 aml_fill_name(AML_CHUNK* node, CONST CHAR8* name)
 	}
 	
 	node->Length = (UINT16)(3 + (count << 2));
-	node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length+4);
+	node->Buffer = aml_alloc_buffer(node, node->Length+4);
 	node->Buffer[offset++] = 0x5c; // Root Char
 	node->Buffer[offset++] = 0x2f; // Multi name
 	node->Buffer[offset++] = (CHAR8)count; // Names count
@@ -289,7 +353,7 @@ AML_CHUNK* aml_add_package(AML_CHUNK* parent)
 		node->Type = AML_CHUNK_PACKAGE;
 		
 		node->Length = 1;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 	}
 	
 	return node;
@@ -304,7 +368,7 @@ AML_CHUNK* aml_add_alias(AML_CHUNK* parent, /* CONST*/ CHAR8* name1, /* CONST*/
 		node->Type = AML_CHUNK_ALIAS;
 		
 		node->Length = 8;
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length);
 		aml_fill_simple_name(node->Buffer, name1);
 		aml_fill_simple_name(node->Buffer+4, name2);
 	}
@@ -386,10 +450,11 @@ AML_CHUNK* aml_add_byte_buffer(AML_CHUNK* parent, CONST UINT8* data, UINT32 size
 	    INTN offset=0;
 		node->Type = AML_CHUNK_BUFFER;
 		node->Length = (UINT8)(size + 2);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, node->Length + 2);
 		node->Buffer[offset++] = AML_CHUNK_BYTE;  //0x0A
 		node->Buffer[offset++] = (CHAR8)size;
-		CopyMem(node->Buffer+offset, data, node->Length);
+		if (node->Length > 2)
+			CopyMem(node->Buffer+offset, data, node->Length - 2);
 	}
 	
 	return node;
@@ -405,7 +470,7 @@ AML_CHUNK* aml_add_string_buffer(AML_CHUNK* parent, CONST CHAR8* StringBuf)
 	    UINTN len = AsciiStrLen(StringBuf);
 		node->Type = AML_CHUNK_BUFFER;
 		node->Length = (UINT8)(len + 3);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(node->Length);
+		node->Buffer = aml_alloc_buffer(node, len + 3);
 		node->Buffer[offset++] = AML_CHUNK_BYTE;
 		node->Buffer[offset++] = (CHAR8)(len + 1);
 		CopyMem(node->Buffer+offset, StringBuf, len);
@@ -424,7 +489,7 @@ AML_CHUNK* aml_add_string(AML_CHUNK* parent, CONST CHAR8* StringBuf)
 	    INTN len = AsciiStrLen(StringBuf);
 		node->Type = AML_CHUNK_STRING;
 		node->Length = (UINT8)(len + 1);
-		node->Buffer = (__typeof__(node->Buffer))AllocateZeroPool(len + 1);
+		node->Buffer = aml_alloc_buffer(node, len + 1);
 		CopyMem(node->Buffer, StringBuf, len);
 //		node->Buffer[len] = '\0';
 	}
@@ -471,7 +536,7 @@ UINT32 aml_calculate_size(AML_CHUNK* node)
 		{
 			child_count++;
 			
-			node->Size += (UINT16)aml_calculate_size(child);
+			node->Size += aml_calculate_size(child);
 			
 			child = child->Next;
 		}
@@ -672,10 +737,133 @@ UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset)
 		}
 		
 		if (offset - old != node->Size) {
-			MsgLog("Node size incorrect: type=0x%hhX size=%hX offset=%X\n",
+			MsgLog("Node size incorrect: type=0x%hhX size=%X offset=%X\n",
              node->Type, node->Size, (offset - old));
     }
 	}
 	
 	return offset;
 }
+
+/*
+ * Bottom-up emission : the children are written first, backwards from end, so
+ * the package length of a node is known when its header is written in front
+ * of them. Sizes are the same as aml_calculate_size(), bytes the same as
+ * aml_write_node().
+ */
+static CHAR8* aml_emit_node(AML_CHUNK* node, CHAR8* end)
+{
+	CHAR8 header[8];
+	UINT32 headerLength = 0;
+	UINT32 children = 0;
+	UINT8 child_count = 0;
+	CHAR8* p = end;
+	AML_CHUNK* child;
+	
+	for (child = node->Last; child; child = child->Prev)
+	{
+		p = aml_emit_node(child, p);
+		children += child->Size;
+		child_count++;
+	}
+	
+	node->Size = children;
+	switch (node->Type)
+	{
+		case AML_CHUNK_NONE:
+			node->Size += node->Length;
+			break;
+			
+		case AML_CHUNK_LOCAL0:
+		case AML_STORE_OP:
+			node->Size += node->Length;
+			headerLength = aml_write_byte(node->Type, header, headerLength);
+			break;
+			
+		case AML_CHUNK_DEVICE:
+			node->Size += 2 + node->Length;
+			node->Size += aml_get_size_length(node->Size);
+			headerLength = aml_write_byte(AML_CHUNK_OP, header, headerLength);
+			headerLength = aml_write_byte(node->Type, header, headerLength);
+			headerLength = aml_write_size(node->Size-2, header, headerLength);
+			break;
+			
+		case AML_CHUNK_PACKAGE:
+			node->Buffer[0] = child_count;
+			// fall through
+		case AML_CHUNK_METHOD:
+		case AML_CHUNK_SCOPE:
+		case AML_CHUNK_BUFFER:
+			node->Size += 1 + node->Length;
+			node->Size += aml_get_size_length(node->Size);
+			headerLength = aml_write_byte(node->Type, header, headerLength);
+			headerLength = aml_write_size(node->Size-1, header, headerLength);
+			break;
+			
+		case AML_CHUNK_BYTE:
+			if (node->Buffer[0] == 0x0 || node->Buffer[0] == 0x1)
+			{
+				node->Size += node->Length;
+			}
+			else
+			{
+				node->Size += 1 + node->Length;
+				headerLength = aml_write_byte(node->Type, header, headerLength);
+			}
+			break;
+			
+		case AML_CHUNK_WORD:
+		case AML_CHUNK_DWORD:
+		case AML_CHUNK_QWORD:
+		case AML_CHUNK_ALIAS:
+		case AML_CHUNK_NAME:
+		case AML_CHUNK_RETURN:
+		case AML_CHUNK_STRING:
+			node->Size += 1 + node->Length;
+			headerLength = aml_write_byte(node->Type, header, headerLength);
+			break;
+			
+		default:
+			return p; // nothing written by aml_write_node
+	}
+	
+	if (node->Type != AML_CHUNK_LOCAL0 && node->Type != AML_STORE_OP)
+	{
+		p -= node->Length;
+		aml_write_buffer(node->Buffer, node->Length, p, 0);
+	}
+	p -= headerLength;
+	CopyMem(p, header, headerLength);
+	
+	if ((UINT32)(end - p) != node->Size) {
+		MsgLog("Node size incorrect: type=0x%hhX size=%X offset=%X\n",
+		       node->Type, node->Size, (UINT32)(end - p));
+	}
+	return p;
+}
+
+CHAR8* aml_generate(AML_CHUNK* node, UINT32* size)
+{
+	UINTN bound;
+	UINTN written;
+	CHAR8* buffer;
+	CHAR8* start;
+	
+	*size = 0;
+	if (!node)
+		return NULL;
+	
+	bound = node->Arena->EmitBound;
+	buffer = (CHAR8*)AllocatePool(bound);
+	if (!buffer)
+		return NULL;
+	
+	start = aml_emit_node(node, buffer + bound);
+	written = (UINTN)(buffer + bound - start);
+	CopyMem(buffer, start, written); // CopyMem handles overlapping buffers
+	if (written < node->Size)
+		ZeroMem(buffer + written, node->Size - written);
+	
+	*size = node->Size;
+	return buffer;
+}
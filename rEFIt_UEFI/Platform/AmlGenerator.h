@@ -19,6 +19,13 @@ static inline XBool aml_isvalidchar(char c)
 */
 
 
+/*
+ * All the nodes of a tree, and their buffers, are allocated from the arena of
+ * the root node (the one created with aml_create_node(NULL)).
+ * aml_destroy_node() releases the whole arena.
+ */
+struct aml_arena;
+
 struct aml_chunk
 {
   UINT8              Type;
@@ -27,12 +34,14 @@ struct aml_chunk
   UINT32             pad2;
   CHAR8              *Buffer;
 
-  UINT16             Size;
-  UINT16             pad3[3];
+  UINT32             Size;
+  UINT32             pad3;
 
   struct aml_chunk*  Next;
   struct aml_chunk*  First;
   struct aml_chunk*  Last;
+  struct aml_chunk*  Prev;
+  struct aml_arena*  Arena;
 };
 typedef struct aml_chunk AML_CHUNK;
 
@@ -87,6 +96,7 @@ AML_CHUNK* aml_add_package(AML_CHUNK* parent);
 AML_CHUNK* aml_add_alias(AML_CHUNK* parent, /* CONST*/ CHAR8* name1, /* CONST*/ CHAR8* name2);
 UINT32 aml_calculate_size(AML_CHUNK* node);
 UINT32 aml_write_node(AML_CHUNK* node, CHAR8* buffer, UINT32 offset);
+CHAR8* aml_generate(AML_CHUNK* node, UINT32* size); // size and write in one pass. Result must be freed with FreePool
 UINT32 aml_write_size(UINT32 size, CHAR8* buffer, UINT32 offset);
 
 // add by pcj
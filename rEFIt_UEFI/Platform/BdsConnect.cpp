@@ -16,6 +16,18 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "../include/Handle.h"
 #include "../Platform/Settings.h"
 
+#ifndef DEBUG_ALL
+#define DEBUG_BDS 1
+#else
+#define DEBUG_BDS DEBUG_ALL
+#endif
+
+#if DEBUG_BDS == 0
+#define DBG(...)
+#else
+#define DBG(...) DebugLog(DEBUG_BDS, __VA_ARGS__)
+#endif
+
 
 /**
   This function will connect all the system driver to controller
@@ -287,132 +299,297 @@ BdsLibDisconnectAllEfi (
   return EFI_SUCCESS;
 }
 
-EFI_STATUS ScanDeviceHandles(EFI_HANDLE ControllerHandle,
-                             UINTN *HandleCount,
-                             EFI_HANDLE **HandleBuffer,
-                             UINT32 **HandleType)
+//
+// Snapshot of the handle database : every handle, the protocols installed on it
+// and, for each protocol, who opened it BY_DRIVER or BY_CHILD_CONTROLLER.
+// Built with one ProtocolsPerHandle() per handle and one OpenProtocolInformation()
+// per (handle, protocol). Classifying handles relative to a controller is then
+// done from memory, instead of walking the whole database again for each controller.
+//
+#define HANDLE_GRAPH_NONE  MAX_UINTN
+
+typedef struct {
+  UINTN   HandleIndex;        // handle on which the protocol is installed
+  UINTN   AgentIndex;         // HANDLE_GRAPH_NONE if the agent is not in the snapshot
+  UINT32  Attributes;
+  UINTN   NextForController;  // next open with the same ControllerHandle, or HANDLE_GRAPH_NONE
+} HANDLE_GRAPH_OPEN;
+
+typedef struct {
+  UINTN              HandleCount;
+  EFI_HANDLE         *Handles;
+  UINT32             *Types;        // types that don't depend on a controller (image, driver binding, device...)
+  UINTN              *FirstOpen;    // per controller, first entry in Opens. HANDLE_GRAPH_NONE if none
+  UINTN              *Slots;        // hash index of Handles. Contains index+1, 0 is an empty slot
+  UINTN              SlotMask;
+  HANDLE_GRAPH_OPEN  *Opens;
+  UINTN              OpenCount;
+  UINTN              OpenAllocated;
+  UINTN              ProtocolCount;
+  UINTN              FirmwareCalls; // LocateHandleBuffer + ProtocolsPerHandle + OpenProtocolInformation
+} HANDLE_GRAPH;
+
+STATIC
+UINTN
+HandleGraphSlot (
+  IN CONST HANDLE_GRAPH  *Graph,
+  IN EFI_HANDLE          Handle
+  )
+{
+  UINTN Slot = (UINTN)(((UINT64)(UINTN)Handle >> 3) * 0x9E3779B97F4A7C15ull >> 32) & Graph->SlotMask;
+
+  while (Graph->Slots[Slot] != 0 && Graph->Handles[Graph->Slots[Slot] - 1] != Handle) {
+    Slot = (Slot + 1) & Graph->SlotMask;
+  }
+  return Slot;
+}
+
+STATIC
+UINTN
+HandleGraphIndexOf (
+  IN CONST HANDLE_GRAPH  *Graph,
+  IN EFI_HANDLE          Handle
+  )
+{
+  UINTN Slot;
+
+  if (Handle == NULL || Graph->Slots == NULL) {
+    return HANDLE_GRAPH_NONE;
+  }
+  Slot = HandleGraphSlot(Graph, Handle);
+  return Graph->Slots[Slot] == 0 ? HANDLE_GRAPH_NONE : Graph->Slots[Slot] - 1;
+}
+
+STATIC
+void
+HandleGraphFree (
+  IN OUT HANDLE_GRAPH  *Graph
+  )
+{
+  if (Graph->Handles != NULL) {
+    gBS->FreePool(Graph->Handles); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
+  }
+  if (Graph->Types != NULL) {
+    FreePool(Graph->Types);
+  }
+  if (Graph->FirstOpen != NULL) {
+    FreePool(Graph->FirstOpen);
+  }
+  if (Graph->Slots != NULL) {
+    FreePool(Graph->Slots);
+  }
+  if (Graph->Opens != NULL) {
+    FreePool(Graph->Opens);
+  }
+  ZeroMem(Graph, sizeof(*Graph));
+}
+
+STATIC
+EFI_STATUS
+HandleGraphAddOpen (
+  IN OUT HANDLE_GRAPH                       *Graph,
+  IN     UINTN                              HandleIndex,
+  IN     EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *OpenInfo
+  )
+{
+  HANDLE_GRAPH_OPEN *Open;
+  UINTN             ControllerIndex;
+
+  ControllerIndex = HandleGraphIndexOf(Graph, OpenInfo->ControllerHandle);
+  if (ControllerIndex == HANDLE_GRAPH_NONE) {
+    return EFI_SUCCESS; // can't be the controller of a classification
+  }
+  if (Graph->OpenCount == Graph->OpenAllocated) {
+    UINTN NewAllocated = Graph->OpenAllocated == 0 ? 64 : Graph->OpenAllocated * 2;
+    Open = (__typeof__(Open))ReallocatePool(Graph->OpenAllocated * sizeof(*Open), NewAllocated * sizeof(*Open), Graph->Opens);
+    if (Open == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Graph->Opens = Open;
+    Graph->OpenAllocated = NewAllocated;
+  }
+  Open = &Graph->Opens[Graph->OpenCount];
+  Open->HandleIndex       = HandleIndex;
+  Open->AgentIndex        = HandleGraphIndexOf(Graph, OpenInfo->AgentHandle);
+  Open->Attributes        = OpenInfo->Attributes;
+  Open->NextForController = Graph->FirstOpen[ControllerIndex];
+  Graph->FirstOpen[ControllerIndex] = Graph->OpenCount;
+  Graph->OpenCount += 1;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+HandleGraphBuild (
+  OUT HANDLE_GRAPH  *Graph
+  )
 {
   EFI_STATUS                          Status;
   UINTN                               HandleIndex;
+  UINTN                               SlotCount;
   EFI_GUID                            **ProtocolGuidArray;
   UINTN                               ArrayCount;
   UINTN                               ProtocolIndex;
   EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *OpenInfo;
   UINTN                               OpenInfoCount;
   UINTN                               OpenInfoIndex;
-  UINTN                               ChildIndex;
-  
-  *HandleCount  = 0;
-  *HandleBuffer = NULL;
-  *HandleType   = NULL;
-  
+  UINT32                              Attributes;
+
+  ZeroMem(Graph, sizeof(*Graph));
+
   //
   // Retrieve the list of all handles from the handle database
   //
-  Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, HandleCount, HandleBuffer);
-  if (EFI_ERROR(Status)) goto Error;
-  
-  *HandleType = (__typeof_am__(*HandleType))AllocatePool (*HandleCount * sizeof (**HandleType));
-  if (*HandleType == NULL) goto Error;
-    
-  for (HandleIndex = 0; HandleIndex < *HandleCount; HandleIndex++) {
-    (*HandleType)[HandleIndex] = EFI_HANDLE_TYPE_UNKNOWN;
+  Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, &Graph->HandleCount, &Graph->Handles);
+  Graph->FirmwareCalls += 1;
+  if (EFI_ERROR(Status)) {
+    Graph->Handles = NULL;
+    Graph->HandleCount = 0;
+    return Status;
+  }
+
+  for (SlotCount = 16; SlotCount < Graph->HandleCount * 2; SlotCount *= 2);
+  Graph->SlotMask  = SlotCount - 1;
+  Graph->Slots     = (__typeof__(Graph->Slots))AllocateZeroPool(SlotCount * sizeof(*Graph->Slots));
+  Graph->Types     = (__typeof__(Graph->Types))AllocateZeroPool(Graph->HandleCount * sizeof(*Graph->Types));
+  Graph->FirstOpen = (__typeof__(Graph->FirstOpen))AllocatePool(Graph->HandleCount * sizeof(*Graph->FirstOpen));
+  if (Graph->Slots == NULL || Graph->Types == NULL || Graph->FirstOpen == NULL) {
+    HandleGraphFree(Graph);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (HandleIndex = 0; HandleIndex < Graph->HandleCount; HandleIndex++) {
+    Graph->FirstOpen[HandleIndex] = HANDLE_GRAPH_NONE;
+    Graph->Slots[HandleGraphSlot(Graph, Graph->Handles[HandleIndex])] = HandleIndex + 1;
+  }
+
+  for (HandleIndex = 0; HandleIndex < Graph->HandleCount; HandleIndex++) {
     //
     // Retrieve the list of all the protocols on each handle
     //
-    Status = gBS->ProtocolsPerHandle (
-                  (*HandleBuffer)[HandleIndex],
-                  &ProtocolGuidArray,
-                  &ArrayCount
-                  );
-    if (!EFI_ERROR(Status)) {      
-      for (ProtocolIndex = 0; ProtocolIndex < ArrayCount; ProtocolIndex++) {
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiLoadedImageProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_IMAGE_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverBindingProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverConfigurationProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_CONFIGURATION_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverDiagnosticsProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_DIAGNOSTICS_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiComponentName2ProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiComponentNameProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
-        }
-        
-        if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDevicePathProtocolGuid ) {
-          (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_DEVICE_HANDLE;
-        }
-        
-        //
-        // Retrieve the list of agents that have opened each protocol
-        //
-        Status = gBS->OpenProtocolInformation (
-                                               (*HandleBuffer)[HandleIndex],
-                                               ProtocolGuidArray[ProtocolIndex],
-                                               &OpenInfo,
-                                               &OpenInfoCount
-                                               );
-        if (!EFI_ERROR(Status)) {
-          
-          for (OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount; OpenInfoIndex++) {
-            
-            if (OpenInfo[OpenInfoIndex].ControllerHandle == ControllerHandle) {
-              if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER) {
-                for (ChildIndex = 0; ChildIndex < *HandleCount; ChildIndex++) {
-                  if ((*HandleBuffer)[ChildIndex] == OpenInfo[OpenInfoIndex].AgentHandle) {
-                    (*HandleType)[ChildIndex] |= EFI_HANDLE_TYPE_DEVICE_DRIVER;
-                  }
-                }
-              }
-              
-              if ((OpenInfo[OpenInfoIndex].Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) {
-                (*HandleType)[HandleIndex] |= EFI_HANDLE_TYPE_PARENT_HANDLE;
-                for (ChildIndex = 0; ChildIndex < *HandleCount; ChildIndex++) 
-                {
-                  if ((*HandleBuffer)[ChildIndex] == OpenInfo[OpenInfoIndex].AgentHandle) {
-                    (*HandleType)[ChildIndex] |= EFI_HANDLE_TYPE_BUS_DRIVER;
-                  }
-                }
-              }
-            }
-          }
-          
-          gBS->FreePool(OpenInfo); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
+    Status = gBS->ProtocolsPerHandle (Graph->Handles[HandleIndex], &ProtocolGuidArray, &ArrayCount);
+    Graph->FirmwareCalls += 1;
+    if (EFI_ERROR(Status)) {
+      continue;
+    }
+    for (ProtocolIndex = 0; ProtocolIndex < ArrayCount; ProtocolIndex++) {
+      Graph->ProtocolCount += 1;
+
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiLoadedImageProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_IMAGE_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverBindingProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverConfigurationProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_CONFIGURATION_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDriverDiagnosticsProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_DRIVER_DIAGNOSTICS_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiComponentName2ProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiComponentNameProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE;
+      }
+      if ( *(ProtocolGuidArray[ProtocolIndex]) == gEfiDevicePathProtocolGuid ) {
+        Graph->Types[HandleIndex] |= EFI_HANDLE_TYPE_DEVICE_HANDLE;
+      }
+
+      //
+      // Retrieve the list of agents that have opened each protocol.
+      // Only opens by a driver or for a child controller are used to classify handles.
+      //
+      Status = gBS->OpenProtocolInformation (Graph->Handles[HandleIndex], ProtocolGuidArray[ProtocolIndex], &OpenInfo, &OpenInfoCount);
+      Graph->FirmwareCalls += 1;
+      if (EFI_ERROR(Status)) {
+        continue;
+      }
+      for (OpenInfoIndex = 0; OpenInfoIndex < OpenInfoCount && !EFI_ERROR(Status); OpenInfoIndex++) {
+        Attributes = OpenInfo[OpenInfoIndex].Attributes;
+        if ((Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER ||
+            (Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) {
+          Status = HandleGraphAddOpen(Graph, HandleIndex, &OpenInfo[OpenInfoIndex]);
         }
       }
-      gBS->FreePool(ProtocolGuidArray); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
+      gBS->FreePool(OpenInfo); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
+      if (EFI_ERROR(Status)) {
+        gBS->FreePool(ProtocolGuidArray);
+        HandleGraphFree(Graph);
+        return Status;
+      }
     }
+    gBS->FreePool(ProtocolGuidArray); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
   }
-  
+
   return EFI_SUCCESS;
-  
-Error:
-  if (*HandleType != NULL) {
-    FreePool(*HandleType);
+}
+
+/*
+ * Fill HandleType (HandleCount entries) as ScanDeviceHandles does for the
+ * controller at ControllerIndex. No firmware call.
+ */
+STATIC
+void
+HandleGraphClassify (
+  IN  CONST HANDLE_GRAPH  *Graph,
+  IN  UINTN               ControllerIndex,
+  OUT UINT32              *HandleType
+  )
+{
+  UINTN                   OpenIndex;
+  CONST HANDLE_GRAPH_OPEN *Open;
+
+  CopyMem(HandleType, Graph->Types, Graph->HandleCount * sizeof(*HandleType));
+  if (ControllerIndex == HANDLE_GRAPH_NONE) {
+    return;
   }
-  
-  if (*HandleBuffer != NULL) {
-    gBS->FreePool(*HandleBuffer); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
+  for (OpenIndex = Graph->FirstOpen[ControllerIndex]; OpenIndex != HANDLE_GRAPH_NONE; OpenIndex = Open->NextForController) {
+    Open = &Graph->Opens[OpenIndex];
+    if ((Open->Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) == EFI_OPEN_PROTOCOL_BY_DRIVER) {
+      if (Open->AgentIndex != HANDLE_GRAPH_NONE) {
+        HandleType[Open->AgentIndex] |= EFI_HANDLE_TYPE_DEVICE_DRIVER;
+      }
+    }
+    if ((Open->Attributes & EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) == EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER) {
+      HandleType[Open->HandleIndex] |= EFI_HANDLE_TYPE_PARENT_HANDLE;
+      if (Open->AgentIndex != HANDLE_GRAPH_NONE) {
+        HandleType[Open->AgentIndex] |= EFI_HANDLE_TYPE_BUS_DRIVER;
+      }
+    }
   }
-  
+}
+
+EFI_STATUS ScanDeviceHandles(EFI_HANDLE ControllerHandle,
+                             UINTN *HandleCount,
+                             EFI_HANDLE **HandleBuffer,
+                             UINT32 **HandleType)
+{
+  EFI_STATUS    Status;
+  HANDLE_GRAPH  Graph;
+
   *HandleCount  = 0;
   *HandleBuffer = NULL;
   *HandleType   = NULL;
-  
-  return Status;
+
+  Status = HandleGraphBuild(&Graph);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  *HandleType = (__typeof_am__(*HandleType))AllocatePool (Graph.HandleCount * sizeof (**HandleType));
+  if (*HandleType == NULL) {
+    HandleGraphFree(&Graph);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  HandleGraphClassify(&Graph, HandleGraphIndexOf(&Graph, ControllerHandle), *HandleType);
+
+  // The handle buffer is given to the caller
+  *HandleCount  = Graph.HandleCount;
+  *HandleBuffer = Graph.Handles;
+  Graph.Handles = NULL;
+  HandleGraphFree(&Graph);
+  return EFI_SUCCESS;
 }
 
 
@@ -423,60 +600,94 @@ EFI_STATUS BdsLibConnectMostlyAllEfi()
 	UINTN             AllHandleCount = 0;
 	EFI_HANDLE				*AllHandleBuffer = NULL;
 	UINTN             Index;
-	UINTN             HandleCount = 0;
-	EFI_HANDLE				*HandleBuffer = NULL;
+	HANDLE_GRAPH      Graph;
+	XBool             GraphIsStale = true;
+	UINTN             Snapshots = 0;
+	UINT64            FirmwareCalls = 0;
 	UINT32            *HandleType = NULL;
+	UINTN             ControllerIndex;
 	UINTN             HandleIndex;
 	XBool             Parent;
 	XBool             Device;
 	EFI_PCI_IO_PROTOCOL*	PciIo = NULL;
 	PCI_TYPE00				Pci;
-  
+
+	ZeroMem(&Graph, sizeof(Graph));
 	Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, &AllHandleCount, &AllHandleBuffer);
 	if (EFI_ERROR(Status)) 
 		return Status;
-  
+
 	for (Index = 0; Index < AllHandleCount; Index++) {
-		Status = ScanDeviceHandles(AllHandleBuffer[Index], &HandleCount, &HandleBuffer, &HandleType);
-    
-		if (EFI_ERROR(Status))
-			goto Done;
-    
+		//
+		// The snapshot is only rebuilt when a connect may have changed the handle database
+		//
+		if (GraphIsStale) {
+			HandleGraphFree(&Graph);
+			if (HandleType != NULL) {
+				FreePool(HandleType);
+				HandleType = NULL;
+			}
+			Status = HandleGraphBuild(&Graph);
+			FirmwareCalls += Graph.FirmwareCalls;
+			if (EFI_ERROR(Status))
+				goto Done;
+			HandleType = (__typeof__(HandleType))AllocatePool(Graph.HandleCount * sizeof(*HandleType));
+			if (HandleType == NULL) {
+				Status = EFI_OUT_OF_RESOURCES;
+				goto Done;
+			}
+			Snapshots += 1;
+			GraphIsStale = false;
+		}
+
+		ControllerIndex = HandleGraphIndexOf(&Graph, AllHandleBuffer[Index]);
+		if (ControllerIndex == HANDLE_GRAPH_NONE) {
+			continue; // this handle was removed by a previous connect
+		}
+		HandleGraphClassify(&Graph, ControllerIndex, HandleType);
+
 		Device = true;
 		
-		if (HandleType[Index] & EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE)
+		if (HandleType[ControllerIndex] & EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE)
 			Device = false;
-		if (HandleType[Index] & EFI_HANDLE_TYPE_IMAGE_HANDLE)
+		if (HandleType[ControllerIndex] & EFI_HANDLE_TYPE_IMAGE_HANDLE)
 			Device = false;
     
 		if (Device) {					
 			Parent = false;
-			for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+			for (HandleIndex = 0; HandleIndex < Graph.HandleCount; HandleIndex++) {
 				if (HandleType[HandleIndex] & EFI_HANDLE_TYPE_PARENT_HANDLE)
 					Parent = true;
 			}
       
 			if (!Parent) {
-				if (HandleType[Index] & EFI_HANDLE_TYPE_DEVICE_HANDLE) {
+				if (HandleType[ControllerIndex] & EFI_HANDLE_TYPE_DEVICE_HANDLE) {
 					Status = gBS->HandleProtocol (AllHandleBuffer[Index], &gEfiPciIoProtocolGuid, (void**)&PciIo);
 					if (!EFI_ERROR(Status)) {
 						Status = PciIo->Pci.Read (PciIo,EfiPciIoWidthUint32, 0, sizeof (Pci) / sizeof (UINT32), &Pci);
 						if (!EFI_ERROR(Status)) {
 							if(IS_PCI_VGA(&Pci)==true) {
 								gBS->DisconnectController(AllHandleBuffer[Index], NULL, NULL);
+								GraphIsStale = true;
 							}
 						}
 					}
 					Status = gBS->ConnectController(AllHandleBuffer[Index], NULL, NULL, true);
+					if (!EFI_ERROR(Status)) {
+						GraphIsStale = true;
+					}
 				}
 			}
 		}
-    
-		gBS->FreePool(HandleBuffer); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
-		FreePool(HandleType);
 	}
   
 Done:
+	DBG("ConnectMostlyAll: %llu handles, %llu protocols, %llu snapshot(s), %llu firmware calls\n",
+	    (UINT64)Graph.HandleCount, (UINT64)Graph.ProtocolCount, (UINT64)Snapshots, FirmwareCalls);
+	HandleGraphFree(&Graph);
+	if (HandleType != NULL) {
+		FreePool(HandleType);
+	}
 	gBS->FreePool(AllHandleBuffer); // use gBS->FreePool instead of FreePool to avoid message from MemoryTracker
 	return Status;
 }
@@ -446,14 +446,14 @@ AddToBootOrder (
   //
   // Save it
   //
-  Status = gRT->SetVariable (BOOT_ORDER_VAR,
-                             gEfiGlobalVariableGuid,
-                             EFI_VARIABLE_NON_VOLATILE
-                             | EFI_VARIABLE_BOOTSERVICE_ACCESS
-                             | EFI_VARIABLE_RUNTIME_ACCESS,
-                             BootOrderLen * sizeof(UINT16),
-                             BootOrderNew
-                             );
+  Status = WriteNvramVariable (BOOT_ORDER_VAR,
+                               gEfiGlobalVariableGuid,
+                               EFI_VARIABLE_NON_VOLATILE
+                               | EFI_VARIABLE_BOOTSERVICE_ACCESS
+                               | EFI_VARIABLE_RUNTIME_ACCESS,
+                               BootOrderLen * sizeof(UINT16),
+                               BootOrderNew
+                               );
   DBG("SetVariable: %ls = %s\n", BOOT_ORDER_VAR, efiStrError(Status));
   PrintBootOrder(BootOrderNew, BootOrderLen);
 
@@ -516,14 +516,14 @@ DeleteFromBootOrder (
     //
     // Save it
     //
-    Status = gRT->SetVariable (BOOT_ORDER_VAR,
-                               gEfiGlobalVariableGuid,
-                               EFI_VARIABLE_NON_VOLATILE
-                               | EFI_VARIABLE_BOOTSERVICE_ACCESS
-                               | EFI_VARIABLE_RUNTIME_ACCESS,
-                               BootOrderLen * sizeof(UINT16),
-                               BootOrder
-                               );
+    Status = WriteNvramVariable (BOOT_ORDER_VAR,
+                                 gEfiGlobalVariableGuid,
+                                 EFI_VARIABLE_NON_VOLATILE
+                                 | EFI_VARIABLE_BOOTSERVICE_ACCESS
+                                 | EFI_VARIABLE_RUNTIME_ACCESS,
+                                 BootOrderLen * sizeof(UINT16),
+                                 BootOrder
+                                 );
     DBG("SetVariable: %ls = %s\n", BOOT_ORDER_VAR, efiStrError(Status));
     
     FreePool(BootOrder);
@@ -977,14 +977,14 @@ AddBootOption (
   //
   // Save BootXXXX var
   //
-  Status = gRT->SetVariable(VarName,
-                             gEfiGlobalVariableGuid,
-                             EFI_VARIABLE_NON_VOLATILE
-                             | EFI_VARIABLE_BOOTSERVICE_ACCESS
-                             | EFI_VARIABLE_RUNTIME_ACCESS,
-                             BootOption->VariableSize,
-                             BootOption->Variable
-                             );
+  Status = WriteNvramVariable(VarName,
+                               gEfiGlobalVariableGuid,
+                               EFI_VARIABLE_NON_VOLATILE
+                               | EFI_VARIABLE_BOOTSERVICE_ACCESS
+                               | EFI_VARIABLE_RUNTIME_ACCESS,
+                               BootOption->VariableSize,
+                               BootOption->Variable
+                               );
   if (EFI_ERROR(Status)) {
     DBG("SetVariable: %ls = %s\n", VarName, efiStrError(Status));
     return Status;
@@ -1094,12 +1094,12 @@ DeleteBootOption (
   //
   // Delete BootXXXX var
   //
-  Status = gRT->SetVariable (VarName,
-                             gEfiGlobalVariableGuid,
-                             0,
-                             0,
-                             NULL
-                             );
+  Status = WriteNvramVariable (VarName,
+                               gEfiGlobalVariableGuid,
+                               0,
+                               0,
+                               NULL
+                               );
   if (EFI_ERROR(Status)) {
     DBG(" Error del. variable: %ls = %s\n", VarName, efiStrError(Status));
     return Status;
@@ -941,9 +941,9 @@ IsOsxHibernated (IN LOADER_ENTRY *Entry)
               DBG("    boot-image corrected: %ls\n", FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL*)Value).wc_str());
               PrintBytes(Value, Size);
               
-              Status = gRT->SetVariable(L"boot-image", gEfiAppleBootGuid,
-                                        EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
-                                        Size , Value);
+              Status = WriteNvramVariable(L"boot-image", gEfiAppleBootGuid,
+                                          EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                                          Size , Value);
               if (EFI_ERROR(Status)) {
                 DBG(" can not write boot-image -> %s\n", efiStrError(Status));
                 ret = false;
@@ -1019,9 +1019,9 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     //  VarData[25] = 0xFF;
     //  DBG("boot-image corrected: %ls\n", FileDevicePathToStr(BootImageDevPath));
     
-    Status = gRT->SetVariable(L"boot-image", gEfiAppleBootGuid,
-                              EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
-                              Size , BootImageDevPath);
+    Status = WriteNvramVariable(L"boot-image", gEfiAppleBootGuid,
+                                EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                                Size , BootImageDevPath);
     if (EFI_ERROR(Status)) {
       DBG(" can not write boot-image -> %s\n", efiStrError(Status));
       return false;
@@ -1077,9 +1077,9 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     // Erase RTC variables in NVRAM.
     //
     if (!EFI_ERROR(Status)) {
-      Status = gRT->SetVariable (L"IOHibernateRTCVariables", gEfiAppleBootGuid,
-                                 EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
-                                 0, NULL);
+      Status = WriteNvramVariable (L"IOHibernateRTCVariables", gEfiAppleBootGuid,
+                                   EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                                   0, NULL);
       ZeroMem (Value, Size);
       gBS->FreePool(Value);
     }
@@ -1088,10 +1088,10 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     // Convert RTC data to boot-key and boot-signature
     //
     if (HasHibernateInfo) {
-      gRT->SetVariable (L"boot-image-key", gEfiAppleBootGuid,
-                        EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.wiredCryptKey), RtcVars.wiredCryptKey);
-      gRT->SetVariable (L"boot-signature", gEfiAppleBootGuid,
-                        EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.booterSignature), RtcVars.booterSignature);
+      WriteNvramVariable (L"boot-image-key", gEfiAppleBootGuid,
+                          EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.wiredCryptKey), RtcVars.wiredCryptKey);
+      WriteNvramVariable (L"boot-signature", gEfiAppleBootGuid,
+                          EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof (RtcVars.booterSignature), RtcVars.booterSignature);
       DBG("variables boot-image-key and boot-signature saved\n");
     }
     
@@ -1130,9 +1130,9 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     //
     // Delete IOHibernateRTCVariables.
     //
-    Status = gRT->SetVariable(L"IOHibernateRTCVariables", gEfiAppleBootGuid,
-                              EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
-                              0, NULL);
+    Status = WriteNvramVariable(L"IOHibernateRTCVariables", gEfiAppleBootGuid,
+                                EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                                0, NULL);
     HasIORTCVariables = true;
   } else {
     //
@@ -1158,9 +1158,9 @@ PrepareHibernation (IN REFIT_VOLUME *Volume)
     Attributes |= EFI_VARIABLE_NON_VOLATILE;
   }
   
-  Status = gRT->SetVariable(L"boot-switch-vars", gEfiAppleBootGuid,
-                            Attributes,
-                            Size, Value);
+  Status = WriteNvramVariable(L"boot-switch-vars", gEfiAppleBootGuid,
+                              Attributes,
+                              Size, Value);
   
   //
   // Erase written boot-switch-vars buffer.
@@ -48,7 +48,6 @@ extern "C" {
 
 UINT32 mPropSize = 0;
 UINT8* mProperties = NULL;
-CHAR8* gDeviceProperties = NULL;
 
 UINT32 cPropSize = 0;
 UINT8* cProperties = NULL; //this is properties as string
@@ -11,7 +11,6 @@
 
 extern UINT32               mPropSize;
 extern UINT8                *mProperties;
-extern CHAR8                *gDeviceProperties;
 extern UINT32               cPropSize;
 extern UINT8                *cProperties;
 extern CHAR8                *BootOSName;
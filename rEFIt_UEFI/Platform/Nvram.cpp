@@ -84,6 +84,334 @@ GetEfiTimeInMs (
     return TimeMs;
 }
 
+//
+// Shadow copy of the NVRAM variable store.
+// Clover reads, compares and rewrites the same handful of variables many times while
+// it starts, and each GetVariable()/GetNextVariableName() can cost a trip through SMM
+// or a walk of the whole store on emulated NVRAM. The store is enumerated and read
+// once on first use; reads and compares are then served from memory and every write
+// made through this module goes to the firmware and is mirrored here.
+// The shadow belongs to the runtime services it was built from: it is rebuilt if
+// gRT's variable services are replaced (EmuVariable, OpenRuntime...), and it must be
+// invalidated whenever foreign code that may write variables has run.
+//
+class NvramShadowVariable
+{
+public:
+  EFI_GUID        Guid = EFI_GUID();
+  XStringW        Name = XStringW();
+  UINT32          Attributes = 0;
+  XBuffer<UINT8>  Data = XBuffer<UINT8>();
+  XBool           Known = false;      // Attributes, Data and Exists mirror the firmware
+  XBool           Exists = false;
+  UINT32          Hash = 0;
+  size_t          Next = MAX_XSIZE;   // next variable in the same hash bucket
+
+  NvramShadowVariable() {}
+  NvramShadowVariable(const NvramShadowVariable&) = delete;
+  NvramShadowVariable& operator=(const NvramShadowVariable&) = delete;
+};
+
+class NvramShadow
+{
+protected:
+  XObjArray<NvramShadowVariable>  Variables = XObjArray<NvramShadowVariable>();
+  XArray<size_t>                  Buckets = XArray<size_t>();
+  XArray<UINT8>                   Scratch = XArray<UINT8>();
+  EFI_GET_VARIABLE                GetVariable = NULL;
+  EFI_GET_NEXT_VARIABLE_NAME      GetNextVariableName = NULL;
+  EFI_SET_VARIABLE                SetVariable = NULL;
+  XBool                           Valid = false;
+  XBool                           Complete = false;   // every variable of the store is in Variables
+
+  static UINT32 hash(CONST CHAR16 *Name, const EFI_GUID& Guid);
+  XBool isCurrent() const;
+  void build();
+  void rehash(size_t Count);
+  NvramShadowVariable* find(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Hash);
+  NvramShadowVariable* add(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Hash);
+  void read(NvramShadowVariable& Variable);
+
+public:
+  NvramShadow() {}
+  NvramShadow(const NvramShadow&) = delete;
+  NvramShadow& operator=(const NvramShadow&) = delete;
+
+  void invalidate() { Valid = false; }
+  const NvramShadowVariable* lookup(CONST CHAR16 *Name, const EFI_GUID& Guid);
+  void written(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Attributes, UINTN DataSize, CONST void *Data, EFI_STATUS Status);
+  void names(XObjArray<NvramVariableKey>& Keys);
+};
+
+static NvramShadow gNvramShadow;
+
+/** FNV-1a over the name and the vendor guid. */
+UINT32 NvramShadow::hash(CONST CHAR16 *Name, const EFI_GUID& Guid)
+{
+  UINT32       Hash = 0x811C9DC5;
+  const UINT8 *GuidBytes = (const UINT8 *)&Guid;
+
+  for ( ; *Name != 0 ; ++Name ) {
+    Hash = (Hash ^ (UINT16)*Name) * 0x01000193;
+  }
+  for (size_t Index = 0; Index < sizeof(EFI_GUID); ++Index) {
+    Hash = (Hash ^ GuidBytes[Index]) * 0x01000193;
+  }
+  return Hash;
+}
+
+XBool NvramShadow::isCurrent() const
+{
+  return Valid &&
+         GetVariable == gRT->GetVariable &&
+         GetNextVariableName == gRT->GetNextVariableName &&
+         SetVariable == gRT->SetVariable;
+}
+
+void NvramShadow::rehash(size_t Count)
+{
+  Buckets.setSize(Count);
+  for (size_t Index = 0; Index < Count; ++Index) {
+    Buckets[Index] = MAX_XSIZE;
+  }
+  for (size_t Index = 0; Index < Variables.size(); ++Index) {
+    size_t Bucket = Variables[Index].Hash & (Count - 1);
+    Variables[Index].Next = Buckets[Bucket];
+    Buckets[Bucket] = Index;
+  }
+}
+
+NvramShadowVariable* NvramShadow::find(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Hash)
+{
+  for (size_t Index = Buckets[Hash & (Buckets.size() - 1)]; Index != MAX_XSIZE; Index = Variables[Index].Next) {
+    NvramShadowVariable& Variable = Variables[Index];
+    if (Variable.Hash == Hash && Variable.Guid == Guid && Variable.Name.isEqual(Name)) {
+      return &Variable;
+    }
+  }
+  return NULL;
+}
+
+NvramShadowVariable* NvramShadow::add(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Hash)
+{
+  NvramShadowVariable* Variable = new NvramShadowVariable;
+
+  Variable->Guid = Guid;
+  Variable->Name.takeValueFrom(Name);
+  Variable->Hash = Hash;
+  Variables.AddReference(Variable, true);
+  if (Variables.size() > Buckets.size()) {
+    rehash(Buckets.size() * 2);
+  } else {
+    size_t Bucket = Hash & (Buckets.size() - 1);
+    Variable->Next = Buckets[Bucket];
+    Buckets[Bucket] = Variables.size() - 1;
+  }
+  return Variable;
+}
+
+/** Reads one variable from the firmware, with a single GetVariable() call in the common case. */
+void NvramShadow::read(NvramShadowVariable& Variable)
+{
+  EFI_STATUS Status;
+  UINT32     Attributes = 0;
+  UINTN      DataSize = Scratch.size();
+
+  Status = gRT->GetVariable(Variable.Name.wc_str(), Variable.Guid, &Attributes, &DataSize, Scratch.data());
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    Scratch.setSize(DataSize);
+    Status = gRT->GetVariable(Variable.Name.wc_str(), Variable.Guid, &Attributes, &DataSize, Scratch.data());
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Variable.Known = true;
+    Variable.Exists = true;
+    Variable.Attributes = Attributes;
+    Variable.Data.setEmpty();
+    Variable.Data.ncpy(Scratch.data(), DataSize);
+  } else {
+    // EFI_NOT_FOUND is an answer, anything else will be asked again
+    Variable.Known = Status == EFI_NOT_FOUND;
+    Variable.Exists = false;
+    Variable.Attributes = 0;
+    Variable.Data.setEmpty();
+  }
+}
+
+/** Enumerates the store once and reads every variable. */
+void NvramShadow::build()
+{
+  EFI_STATUS  Status;
+  EFI_GUID    Guid;
+  CHAR16      *Name;
+  UINTN       NameSize;
+  UINTN       NewNameSize;
+
+  Variables.setEmpty();
+  rehash(256);
+  if (Scratch.size() == 0) {
+    Scratch.setSize(1024);
+  }
+  GetVariable = gRT->GetVariable;
+  GetNextVariableName = gRT->GetNextVariableName;
+  SetVariable = gRT->SetVariable;
+  Valid = true;
+  Complete = false;
+
+  NameSize = 128 * sizeof(CHAR16);
+  Name = (__typeof__(Name))AllocateZeroPool(NameSize);
+  if (Name == NULL) {
+    return;
+  }
+
+  while (true) {
+    NewNameSize = NameSize;
+    Status = gRT->GetNextVariableName(&NewNameSize, Name, &Guid);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      Name = (__typeof__(Name))ReallocatePool(NameSize, NewNameSize, Name);
+      if (Name == NULL) {
+        return;
+      }
+      NameSize = NewNameSize;
+      Status = gRT->GetNextVariableName(&NewNameSize, Name, &Guid);
+    }
+
+    if (Status == EFI_NOT_FOUND) {
+      Complete = true;
+      break;
+    }
+    if (EFI_ERROR(Status)) {
+      // missing variables will be read one by one
+      DBG("NvramShadow: GetNextVariableName returns %s\n", efiStrError(Status));
+      break;
+    }
+
+    UINT32 Hash = hash(Name, Guid);
+    if (find(Name, Guid, Hash) == NULL) {
+      read(*add(Name, Guid, Hash));
+    }
+  }
+  FreePool(Name);
+}
+
+/** Returns the variable, or NULL if it doesn't exist or can't be read. */
+const NvramShadowVariable* NvramShadow::lookup(CONST CHAR16 *Name, const EFI_GUID& Guid)
+{
+  NvramShadowVariable* Variable;
+  UINT32               Hash;
+
+  if (!isCurrent()) {
+    build();
+  }
+  Hash = hash(Name, Guid);
+  Variable = find(Name, Guid, Hash);
+  if (Variable == NULL) {
+    if (Complete) {
+      return NULL;
+    }
+    Variable = add(Name, Guid, Hash);
+  }
+  if (!Variable->Known) {
+    read(*Variable);
+  }
+  return Variable->Exists ? Variable : NULL;
+}
+
+/** Mirrors a SetVariable() call that has just been made. */
+void NvramShadow::written(CONST CHAR16 *Name, const EFI_GUID& Guid, UINT32 Attributes, UINTN DataSize, CONST void *Data, EFI_STATUS Status)
+{
+  NvramShadowVariable* Variable;
+  UINT32               Hash;
+  XBool                Delete;
+
+  if (!isCurrent()) {
+    // never built, or stale anyway : the next lookup rebuilds it
+    Valid = false;
+    return;
+  }
+  // a zero-length append leaves the variable as it was, it is not a delete
+  Delete = (DataSize == 0 && (Attributes & EFI_VARIABLE_APPEND_WRITE) == 0) ||
+           (Attributes & (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)) == 0;
+  if (!Delete && DataSize == 0) {
+    return;
+  }
+  Hash = hash(Name, Guid);
+  Variable = find(Name, Guid, Hash);
+  if (Variable == NULL) {
+    if (Complete && Delete) {
+      return;
+    }
+    Variable = add(Name, Guid, Hash);
+  }
+
+  if (Delete && (Status == EFI_SUCCESS || Status == EFI_NOT_FOUND)) {
+    Variable->Known = true;
+    Variable->Exists = false;
+    Variable->Attributes = 0;
+    Variable->Data.setEmpty();
+  } else if (EFI_ERROR(Status) ||
+             (Attributes & (EFI_VARIABLE_APPEND_WRITE | EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS | EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS)) != 0) {
+    // the resulting value isn't what we passed : read it back when needed
+    Variable->Known = false;
+    Variable->Exists = false;
+  } else {
+    Variable->Known = true;
+    Variable->Exists = true;
+    Variable->Attributes = Attributes;
+    Variable->Data.setEmpty();
+    Variable->Data.ncpy(Data, DataSize);
+  }
+}
+
+/** Returns the names of all existing variables, in enumeration order. */
+void NvramShadow::names(XObjArray<NvramVariableKey>& Keys)
+{
+  Keys.setEmpty();
+  if (!isCurrent()) {
+    build();
+  }
+  for (size_t Index = 0; Index < Variables.size(); ++Index) {
+    NvramShadowVariable& Variable = Variables[Index];
+    if (!Variable.Known) {
+      read(Variable);
+    }
+    if (Variable.Exists) {
+      NvramVariableKey* Key = new NvramVariableKey;
+      Key->Name = Variable.Name;
+      Key->Guid = Variable.Guid;
+      Keys.AddReference(Key, true);
+    }
+  }
+}
+
+/** Forgets everything known about NVRAM. Must be called after foreign code ran. */
+void InvalidateNvramShadow(void)
+{
+  gNvramShadow.invalidate();
+}
+
+void GetNvramVariableNames(XObjArray<NvramVariableKey>& Keys)
+{
+  gNvramShadow.names(Keys);
+}
+
+/** Writes NVRAM variable unconditionally. Use instead of gRT->SetVariable to keep the shadow right. */
+EFI_STATUS
+WriteNvramVariable (
+  IN  CONST CHAR16     *VariableName,
+  const EFI_GUID&      VendorGuid,
+  IN  UINT32           Attributes,
+  IN  UINTN            DataSize,
+  IN  CONST void       *Data
+  )
+{
+  EFI_STATUS Status;
+
+  Status = gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
+  gNvramShadow.written(VariableName, VendorGuid, Attributes, DataSize, Data, Status);
+  return Status;
+}
+
 /** Reads and returns value of NVRAM variable. */
 void *GetNvramVariable(
 	IN      CONST CHAR16   *VariableName,
@@ -91,37 +419,27 @@ void *GetNvramVariable(
 	OUT     UINT32   *Attributes    OPTIONAL,
 	OUT     UINTN    *DataSize      OPTIONAL)
 {
-  EFI_STATUS Status;
-  void       *Data       = NULL;
+  const NvramShadowVariable *Variable;
+  void                      *Data;
+
+  Variable = gNvramShadow.lookup(VariableName, VendorGuid);
+  if (Variable == NULL || Variable->Data.size() == 0) {
+    return NULL;
+  }
+
   //
-  // Pass in a zero size buffer to find the required buffer size.
+  // Allocate the buffer to return
   //
-  UINTN      IntDataSize = 0;
-  
-  Status = gRT->GetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
-  if (IntDataSize == 0) {
+  Data = (__typeof__(Data))AllocateZeroPool(Variable->Data.size() + 1);
+  if (Data == NULL) {
     return NULL;
   }
-
-  if (Status == EFI_BUFFER_TOO_SMALL) {
-    //
-    // Allocate the buffer to return
-    //
-    Data = (__typeof__(Data))AllocateZeroPool(IntDataSize + 1);
-    if (Data != NULL) {
-      //
-      // Read variable into the allocated buffer.
-      //
-      Status = gRT->GetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, Data);
-      if (EFI_ERROR(Status)) {
-        FreePool(Data);
-        IntDataSize = 0;
-        Data = NULL;
-      }
-    }
+  CopyMem(Data, Variable->Data.data(), Variable->Data.size());
+  if (Attributes != NULL) {
+    *Attributes = Variable->Attributes;
   }
   if (DataSize != NULL) {
-    *DataSize = IntDataSize;
+    *DataSize = Variable->Data.size();
   }
   return Data;
 }
@@ -132,28 +450,20 @@ XString8 GetNvramVariableAsXString8(
   const   EFI_GUID&  VendorGuid,
   OUT     UINT32         *Attributes    OPTIONAL)
 {
-  EFI_STATUS Status;
-  XString8 returnValue;
-  //
-  // Pass in a zero size buffer to find the required buffer size.
-  //
-  UINTN      IntDataSize = 0;
-  
-  Status = gRT->GetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, NULL);
-  if (IntDataSize == 0) {
+  const NvramShadowVariable *Variable;
+  XString8                  returnValue;
+  UINTN                     IntDataSize;
+
+  Variable = gNvramShadow.lookup(VariableName, VendorGuid);
+  if (Variable == NULL || Variable->Data.size() == 0) {
     return NullXString8;
   }
-
-  if (Status == EFI_BUFFER_TOO_SMALL) {
-    //
-    // Read variable into the allocated buffer.
-    //
-    Status = gRT->GetVariable(VariableName, VendorGuid, Attributes, &IntDataSize, returnValue.dataSized(IntDataSize+1));
-    if (EFI_ERROR(Status)) {
-      IntDataSize = 0;
-      returnValue.setEmpty();
-    }
+  if (Attributes != NULL) {
+    *Attributes = Variable->Attributes;
   }
+
+  IntDataSize = Variable->Data.size();
+  CopyMem(returnValue.dataSized(IntDataSize+1), Variable->Data.data(), IntDataSize);
   returnValue.dataSized(IntDataSize+1)[IntDataSize] = 0;
   returnValue.updateSize();
   return returnValue;
@@ -171,26 +481,25 @@ SetNvramVariable (
   )
 {
   EFI_STATUS Status = EFI_SUCCESS;
-  void   *OldData;
+  const NvramShadowVariable *OldVariable;
   UINTN  OldDataSize = 0;
   UINT32 OldAttributes = 0;
   
   DBG("SetNvramVariable (%ls, %s, 0x%X, %lld):", VariableName, VendorGuid.toXString8().c_str(), Attributes, DataSize);
-  OldData = (__typeof__(OldData))GetNvramVariable(VariableName, VendorGuid, &OldAttributes, &OldDataSize);
-  if (OldData != NULL) {
+  OldVariable = gNvramShadow.lookup(VariableName, VendorGuid);
+  if (OldVariable != NULL && OldVariable->Data.size() != 0) {
+    OldAttributes = OldVariable->Attributes;
+    OldDataSize = OldVariable->Data.size();
     // var already exists - check if it equal to new value
     DBG(" exists(0x%X, %lld)", OldAttributes, OldDataSize);
     if ((OldAttributes == Attributes) &&
         (OldDataSize == DataSize) &&
-        (CompareMem (OldData, Data, DataSize) == 0)) {
+        (CompareMem (OldVariable->Data.data(), Data, DataSize) == 0)) {
       // it's the same - do nothing
       DBG(", equal -> not writing again.\n");
-      FreePool(OldData);
       return EFI_SUCCESS;
     }
     
-    FreePool(OldData);
-    
     // not the same - delete previous one if attributes are different
     if (OldAttributes != Attributes) {
       Status = DeleteNvramVariable(VariableName, VendorGuid);
@@ -201,7 +510,7 @@ SetNvramVariable (
   }
 //  DBG("\n"); // for debug without Status
   
-  Status = gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, (void*)Data); // CONST missing in EFI_SET_VARIABLE->SetVariable
+  Status = WriteNvramVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
   DBG(" -> writing new (%s)\n", efiStrError(Status));
   return Status;
 }
@@ -228,16 +537,15 @@ AddNvramVariable (
   )
 {
   EFI_STATUS Status;
-  void       *OldData;
+  const NvramShadowVariable *OldVariable;
 
   DBG("AddNvramVariable (%ls, %s, 0x%X, %lld):", VariableName, VendorGuid.toXString8().c_str(), Attributes, DataSize);
-  OldData = (__typeof__(OldData))GetNvramVariable(VariableName, VendorGuid, NULL, NULL);
-  if (OldData == NULL) {
+  OldVariable = gNvramShadow.lookup(VariableName, VendorGuid);
+  if (OldVariable == NULL || OldVariable->Data.size() == 0) {
     // set new value
-    Status = gRT->SetVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
+    Status = WriteNvramVariable(VariableName, VendorGuid, Attributes, DataSize, Data);
     DBG(" -> writing new (%s)\n", efiStrError(Status));
   } else {
-	FreePool(OldData);
     DBG(" -> already exists, abort\n");
     Status = EFI_ABORTED;
   }
@@ -264,7 +572,7 @@ EFI_STATUS DeleteNvramVariable (
   EFI_STATUS Status;
     
   // Delete: attributes and data size = 0
-  Status = gRT->SetVariable (VariableName, VendorGuid, 0, 0, NULL);
+  Status = WriteNvramVariable (VariableName, VendorGuid, 0, 0, NULL);
   DBG("DeleteNvramVariable (%ls, %s):\n", VariableName, VendorGuid.toXString8().c_str());
     
   return Status;
@@ -272,7 +580,7 @@ EFI_STATUS DeleteNvramVariable (
 
 XBool
 IsDeletableVariable (
-  IN CHAR16    *Name,
+  IN CONST CHAR16    *Name,
   const EFI_GUID& Guid
   )
 {
@@ -354,65 +662,27 @@ EFI_STATUS
 ResetNativeNvram ()
 {
   EFI_STATUS      Status = EFI_NOT_FOUND;
-  EFI_GUID        Guid;
-  CHAR16          *Name;
-  UINTN           NameSize;
-  UINTN           NewNameSize;
-  XBool           Restart = true;
+  XObjArray<NvramVariableKey> Keys;
   UINTN           VolumeIndex;
   REFIT_VOLUME    *Volume;
   EFI_FILE	  *FileHandle;
 
   //DbgHeader("ResetNativeNvram: cleanup NVRAM variables");
 
-  NameSize = sizeof (CHAR16);
-  Name = (__typeof__(Name))AllocatePool(NameSize);
-  if (Name == NULL) {
-    return Status;
-  }
-    
-  while (true) {
-    if (Restart) {
-      Guid.setNull();
-      ZeroMem (Name, sizeof(Name));
-      Restart = false;
-    }
-      
-    NewNameSize = NameSize;
-    Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
-    if (Status == EFI_BUFFER_TOO_SMALL) {
-      Name = (__typeof__(Name))ReallocatePool (NameSize, NewNameSize, Name);
-      if (Name == NULL) {
-        return Status;
-      }
-
-      Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
-      NameSize = NewNameSize;
-    }
-
-    if (EFI_ERROR(Status)) {
-      break;
-    }
-
-    if (!EFI_ERROR(Status)) {
-      if (IsDeletableVariable (Name, Guid)) {
-        //DBG("Deleting %s:%ls...", Guid.toXString8().c_str(), Name);
-        Status = DeleteNvramVariable(Name, Guid);
-        if (!EFI_ERROR(Status)) {
-          //DBG("OK\n");
-          Restart = true;
-        } else {
-          //DBG("FAIL (%s)\n", efiStrError(Status));
-          break;
-        }
+  // Names are taken once : deleting doesn't need the enumeration to restart
+  GetNvramVariableNames(Keys);
+  for (size_t Index = 0; Index < Keys.size(); ++Index) {
+    if (IsDeletableVariable (Keys[Index].Name.wc_str(), Keys[Index].Guid)) {
+      //DBG("Deleting %s:%ls...", Keys[Index].Guid.toXString8().c_str(), Keys[Index].Name.wc_str());
+      Status = DeleteNvramVariable(Keys[Index].Name.wc_str(), Keys[Index].Guid);
+      if (EFI_ERROR(Status)) {
+        //DBG("FAIL (%s)\n", efiStrError(Status));
+        break;
       }
+      //DBG("OK\n");
     }
   }
 
-  if (Name) {
-    FreePool(Name);
-  }
-
   if (gFirmwareClover || gDriversFlags.EmuVariableLoaded) {
     //DBG("Searching volumes for nvram.plist\n");
     for (VolumeIndex = 0; VolumeIndex < Volumes.size(); ++VolumeIndex) {
@@ -446,7 +716,7 @@ ResetNativeNvram ()
 ///
 //  Print all fakesmc variables, i.e. SMC keys
 ///
-UINT32 KeyFromName(CHAR16 *Name)
+UINT32 KeyFromName(CONST CHAR16 *Name)
 {
   //fakesmc-key-CLKT-ui32: Size = 4, Data: 00 00 8C BE
   UINT32 Key;
@@ -455,7 +725,7 @@ UINT32 KeyFromName(CHAR16 *Name)
   return Key;
 }
 
-UINT32 TypeFromName(CHAR16 *Name)
+UINT32 TypeFromName(CONST CHAR16 *Name)
 {
   //fakesmc-key-CLKT-ui32: Size = 4, Data: 00 00 8C BE
   UINT32 Key;
@@ -481,10 +751,8 @@ void
 GetSmcKeys (XBool WriteToSMC)
 {
   EFI_STATUS                  Status;
-  CHAR16                      *Name;
-  EFI_GUID                    Guid;
-  UINTN                       NameSize;
-  UINTN                       NewNameSize;
+  XObjArray<NvramVariableKey> Keys;
+  CONST CHAR16                *Name;
   UINT8                       *Data;
   UINTN                       DataSize;
   INTN                        NumKey = 0;
@@ -494,11 +762,6 @@ GetSmcKeys (XBool WriteToSMC)
   }
   
 
-  NameSize = sizeof (CHAR16);
-  Name = (__typeof__(Name))AllocateZeroPool(NameSize);
-  if (Name == NULL) {
-    return;
-  }
   DbgHeader("Dump SMC keys from NVRAM");
   Status = gBS->LocateProtocol(gAppleSMCProtocolGuid, NULL, (void**)&gAppleSmc);
   if (!EFI_ERROR(Status)) {
@@ -508,28 +771,14 @@ GetSmcKeys (XBool WriteToSMC)
     gAppleSmc = NULL;
   }
 
-  while (true) {
-    NewNameSize = NameSize;
-    Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
-    if (Status == EFI_BUFFER_TOO_SMALL) {
-      Name = (__typeof__(Name))ReallocatePool (NameSize, NewNameSize, Name);
-      if (Name == NULL) {
-        return; //if something wrong then just do nothing
-      }
-
-      Status = gRT->GetNextVariableName (&NewNameSize, Name, &Guid);
-      NameSize = NewNameSize;
-    }
-
-    if (EFI_ERROR(Status)) {
-      break;  //no more variables
-    }
-
+  GetNvramVariableNames(Keys);
+  for (size_t KeyIndex = 0; KeyIndex < Keys.size(); ++KeyIndex) {
+    Name = Keys[KeyIndex].Name.wc_str();
     if (!StrStr(Name, L"fakesmc-key")) {
       continue; //the variable is not interesting for us
     }
 
-    Data = (__typeof__(Data))GetNvramVariable(Name, Guid, NULL, &DataSize);
+    Data = (__typeof__(Data))GetNvramVariable(Name, Keys[KeyIndex].Guid, NULL, &DataSize);
     if (Data) {
       UINTN                       Index;
       DBG("   %ls:", Name);
@@ -575,7 +824,6 @@ GetSmcKeys (XBool WriteToSMC)
       Status = gAppleSmc->SmcWriteValue(gAppleSmc, FourCharKey("RMde"), 1, (SMC_DATA *)&Mode);
     }
   }
-  FreePool(Name);
 }
 #if CHECK_SMC
 void DumpSmcKeys()
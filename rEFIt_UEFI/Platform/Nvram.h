@@ -76,12 +76,34 @@ DeleteNvramVariable (
   const EFI_GUID&  VendorGuid
   );
 
+EFI_STATUS
+WriteNvramVariable (
+  IN  CONST CHAR16     *VariableName,
+  const EFI_GUID&  VendorGuid,
+  IN  UINT32            Attributes,
+  IN  UINTN             DataSize,
+  IN  CONST void       *Data
+  );
+
+class NvramVariableKey
+{
+public:
+  XStringW  Name = XStringW();
+  EFI_GUID  Guid = EFI_GUID();
+};
+
+void
+GetNvramVariableNames (XObjArray<NvramVariableKey>& Keys);
+
+void
+InvalidateNvramShadow (void);
+
 void
 ResetNvram (void);
 
 XBool
 IsDeletableVariable (
-  IN CHAR16           *Name,
+  IN CONST CHAR16     *Name,
   const EFI_GUID& Guid
   );
 
@@ -296,14 +296,14 @@ SetBootCurrent(REFIT_MENU_ITEM_BOOTNUM *Entry)
     for (Index = 0; Index < BootIndex; Index++) {
       *Ptr++ = BootOrder[Index];
     }
-    Status = gRT->SetVariable (L"BootOrder",
-                               gEfiGlobalVariableGuid,
-                               EFI_VARIABLE_NON_VOLATILE
-                               | EFI_VARIABLE_BOOTSERVICE_ACCESS
-                               | EFI_VARIABLE_RUNTIME_ACCESS,
-                               BootOrderSize,
-                               BootOrderNew
-                               );
+    Status = WriteNvramVariable (L"BootOrder",
+                                 gEfiGlobalVariableGuid,
+                                 EFI_VARIABLE_NON_VOLATILE
+                                 | EFI_VARIABLE_BOOTSERVICE_ACCESS
+                                 | EFI_VARIABLE_RUNTIME_ACCESS,
+                                 BootOrderSize,
+                                 BootOrderNew
+                                 );
     if (EFI_ERROR(Status)) {
       DBG("Can't save BootOrder, status=%s\n", efiStrError(Status));
     }
@@ -1377,14 +1377,14 @@ SetDevices (LOADER_ENTRY *Entry)
   if (StringDirty) {
     EFI_PHYSICAL_ADDRESS BufferPtr = EFI_SYSTEM_TABLE_MAX_ADDRESS; //0xFE000000;
     
-    XBuffer<char> newDeviceProperties = devprop_generate_string(device_inject_string);
+    XBuffer<uint8_t> newDeviceProperties = devprop_generate_binary(device_inject_string);
 
-    size_t binaryPropSize = hex2bin(newDeviceProperties, NULL, 0);
+    size_t binaryPropSize = newDeviceProperties.size();
     if ( binaryPropSize > MAX_UINT32 ) {
-      MsgLog("devprop_generate_string(device_inject_string) is too big");
+      MsgLog("devprop_generate_binary(device_inject_string) is too big");
       newDeviceProperties.setEmpty();
     }else{
-      DBG("stringlength = %zu\n", newDeviceProperties.size());
+      DBG("stringlength = %zu\n", binaryPropSize * 2);
 
       UINTN nbPages = EFI_SIZE_TO_PAGES(binaryPropSize);
       Status = gBS->AllocatePages (
@@ -1400,9 +1400,8 @@ SetDevices (LOADER_ENTRY *Entry)
         //     DBG("\n");
         //     StringDirty = false;
         //-------
-        mPropSize = (UINT32)hex2bin(newDeviceProperties, mProperties, EFI_PAGES_TO_SIZE(nbPages)); // cast should be safe as hex2bin return <= MAXUINT32
-        // gDeviceProperties is not used
-        gDeviceProperties = newDeviceProperties.forgetDataWithoutFreeing(); // do this AFTER hex2bin
+        CopyMem(mProperties, newDeviceProperties.data(), binaryPropSize);
+        mPropSize = (UINT32)binaryPropSize; // cast is safe, checked above
         //     DBG("Final size of mProperties=%d\n", mPropSize);
         //---------
         //      Status = egSaveFile(&self.getSelfRootDir(),  SWPrintf("%ls\\misc\\devprop.bin", self.getCloverDirFullPath().wc_str()).wc_str()    , (UINT8*)mProperties, mPropSize);
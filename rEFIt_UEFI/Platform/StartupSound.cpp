@@ -55,173 +55,559 @@ extern UINTN EmbeddedSoundLength;
 
 EFI_AUDIO_IO_PROTOCOL *AudioIo = NULL;
 
+//
+// WAV playback is streamed: the header is parsed from the first chunks of the
+// file, then PCM is read in SOUND_CHUNK_SIZE pieces and converted straight into
+// the buffer handed to the codec. Formats the codec accepts as they are are
+// copied, anything else goes through the converter below to 48 kHz/16 bit.
+// With PlayAsync the playback starts once SOUND_PRIME_SIZE bytes are ready and
+// a timer event keeps converting ahead of the HDA DMA, so boot goes on at once.
+// The timer runs at TPL_CALLBACK, where the file system must not be used: the
+// rest of the data chunk is read into memory before it is started.
+//
+#define SOUND_CHUNK_SIZE      (16 * 1024)
+#define SOUND_PRIME_SIZE      (256 * 1024)  // more than the 2 BDL blocks HdaIo->StartStream copies at once
+#define SOUND_TIMER_PERIOD    EFI_TIMER_PERIOD_MILLISECONDS(10)
+#define SOUND_OUT_FREQ        48000
+#define SOUND_PHASES          64            // polyphase interpolator: 64 phases of a 4 tap cubic kernel
+#define SOUND_COEF_SHIFT      14
+
+// 4 taps of one channel, a SIMD register where the compiler has vector extensions
+#if defined(__GNUC__) || defined(__clang__)
+typedef INT32 SOUND_V4 __attribute__((vector_size(16)));
+#define SOUND_VECTOR 1
+#define SOUND_LANE(V, k) ((V)[k])
+#else
+typedef struct { INT32 v[4]; } SOUND_V4;
+#define SOUND_VECTOR 0
+#define SOUND_LANE(V, k) ((V).v[k])
+#endif
+
+typedef struct {
+  CHAR8   Id[RIFF_CHUNK_ID_SIZE];
+  UINT32  Size;
+} SOUND_CHUNK_HEADER;   // RIFF_CHUNK without the flexible Data member
+
+typedef struct {
+  EFI_FILE     *File;       // NULL when playing from memory
+  CONST UINT8  *Memory;
+  UINTN         MemoryLength;
+  UINT64        Position;
+  UINT8        *Loaded;     // Memory read from File by SoundSourceLoad, freed on close
+} SOUND_SOURCE;
+
+typedef struct {
+  SOUND_SOURCE  Source;
+  UINT64        DataLeft;       // bytes of the data chunk not read yet
+  UINT16        InChannels;
+  UINT16        InBlockAlign;   // bytes per input frame
+  UINT16        InSampleBytes;  // container size of one sample
+  UINT16        InBits;
+  UINT32        InFreq;
+  UINT16        OutChannels;
+  XBool         Passthrough;
+  UINT32        Step;           // input frames per output frame, 16.16
+  UINT32        Frac;           // position between History[1] and History[2], 16.16
+  SOUND_V4      History[2];     // last 4 input samples of each output channel
+  UINT8        *Chunk;
+  UINT8        *Out;
+  UINTN         OutLength;
+  UINTN         OutPosition;
+  UINTN         OutPages;
+  EFI_EVENT     Timer;
+} SOUND_STREAM;
+
+STATIC SOUND_V4      SoundCoef[SOUND_PHASES];
+STATIC XBool         SoundCoefReady = false;
+STATIC SOUND_STREAM *ActiveSoundStream = NULL;
+
+STATIC EFI_STATUS SoundSourceRead(SOUND_SOURCE *Source, void *Buffer, UINTN Length)
+{
+  EFI_STATUS Status;
+  UINTN      Size = Length;
+
+  if (Source->File == NULL) {
+    if (Source->Position + Length > Source->MemoryLength) {
+      return EFI_END_OF_FILE;
+    }
+    CopyMem(Buffer, Source->Memory + Source->Position, Length);
+  } else {
+    Status = Source->File->Read(Source->File, &Size, Buffer);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    if (Size != Length) {
+      return EFI_END_OF_FILE;
+    }
+  }
+  Source->Position += Length;
+  return EFI_SUCCESS;
+}
+
+STATIC EFI_STATUS SoundSourceSkip(SOUND_SOURCE *Source, UINT64 Length)
+{
+  Source->Position += Length;
+  if (Source->File == NULL) {
+    return (Source->Position <= Source->MemoryLength) ? EFI_SUCCESS : EFI_END_OF_FILE;
+  }
+  return Source->File->SetPosition(Source->File, Source->Position);
+}
+
+STATIC void SoundSourceClose(SOUND_SOURCE *Source)
+{
+  if (Source->File != NULL) {
+    Source->File->Close(Source->File);
+    Source->File = NULL;
+  }
+  if (Source->Loaded != NULL) {
+    FreePool(Source->Loaded);
+    Source->Loaded = NULL;
+  }
+}
+
+/** Walks the RIFF chunks up to "data" and fills the input format of Stream. */
+STATIC EFI_STATUS SoundParseHeader(SOUND_STREAM *Stream)
+{
+  EFI_STATUS            Status;
+  SOUND_CHUNK_HEADER    Chunk;
+  CHAR8                 Wave[RIFF_CHUNK_ID_SIZE];
+  WAVE_FORMAT_DATA_EX   Format;
+  XBool                 HaveFormat = false;
+
+  Status = SoundSourceRead(&Stream->Source, &Chunk, sizeof(Chunk));
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = SoundSourceRead(&Stream->Source, Wave, sizeof(Wave));
+  if (EFI_ERROR(Status) || AsciiStrnCmp(Chunk.Id, RIFF_CHUNK_ID, RIFF_CHUNK_ID_SIZE) ||
+      AsciiStrnCmp(Wave, WAVE_CHUNK_ID, RIFF_CHUNK_ID_SIZE)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  for (;;) {
+    Status = SoundSourceRead(&Stream->Source, &Chunk, sizeof(Chunk));
+    if (EFI_ERROR(Status)) {
+      return EFI_UNSUPPORTED;
+    }
+    if (!AsciiStrnCmp(Chunk.Id, WAVE_FORMAT_CHUNK_ID, RIFF_CHUNK_ID_SIZE)) {
+      UINT32 Size = MIN(Chunk.Size, (UINT32)sizeof(Format));
+      if (Size < sizeof(WAVE_FORMAT_DATA)) {
+        return EFI_UNSUPPORTED;
+      }
+      ZeroMem(&Format, sizeof(Format));
+      Status = SoundSourceRead(&Stream->Source, &Format, Size);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      // chunks are padded to an even size
+      Status = SoundSourceSkip(&Stream->Source, (Chunk.Size - Size) + (Chunk.Size & 1));
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      HaveFormat = true;
+    } else if (!AsciiStrnCmp(Chunk.Id, WAVE_DATA_CHUNK_ID, RIFF_CHUNK_ID_SIZE)) {
+      break;
+    } else {
+      Status = SoundSourceSkip(&Stream->Source, (UINT64)Chunk.Size + (Chunk.Size & 1));
+      if (EFI_ERROR(Status)) {
+        return EFI_UNSUPPORTED;
+      }
+    }
+  }
+  if (!HaveFormat) {
+    return EFI_UNSUPPORTED;
+  }
+  // integer PCM only, plain or as WAVE_FORMAT_EXTENSIBLE subformat
+  if (Format.Header.FormatTag != WAVE_FORMAT_PCM &&
+      !(Format.Header.FormatTag == WAVE_FORMAT_EXTENSIBLE && Format.SubFormat.Data1 == WAVE_FORMAT_PCM)) {
+    return EFI_UNSUPPORTED;
+  }
+  if (Format.Header.Channels == 0 || Format.Header.SamplesPerSec == 0 ||
+      Format.Header.BlockAlign == 0 || (Format.Header.BlockAlign % Format.Header.Channels) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  Stream->InChannels = Format.Header.Channels;
+  Stream->InBlockAlign = Format.Header.BlockAlign;
+  Stream->InSampleBytes = Format.Header.BlockAlign / Format.Header.Channels;
+  Stream->InBits = Format.Header.BitsPerSample;
+  Stream->InFreq = Format.Header.SamplesPerSec;
+  if (Stream->InSampleBytes == 0 || Stream->InSampleBytes > 4) {
+    return EFI_UNSUPPORTED;
+  }
+  Stream->DataLeft = Chunk.Size;
+  if (Stream->Source.File == NULL) {
+    Stream->DataLeft = MIN(Stream->DataLeft, Stream->Source.MemoryLength - Stream->Source.Position);
+  }
+  Stream->DataLeft -= Stream->DataLeft % Stream->InBlockAlign;
+  return EFI_SUCCESS;
+}
+
+/** Reads the rest of the data chunk into memory and plays from there, closing the file. */
+STATIC EFI_STATUS SoundSourceLoad(SOUND_STREAM *Stream)
+{
+  EFI_STATUS  Status;
+  UINTN       Length = (UINTN)Stream->DataLeft;
+  UINT8      *Data;
+
+  if (Stream->Source.File == NULL) {
+    return EFI_SUCCESS;
+  }
+  Data = (__typeof__(Data))AllocatePool(Length);
+  if (Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = Stream->Source.File->Read(Stream->Source.File, &Length, Data);
+  if (EFI_ERROR(Status)) {
+    FreePool(Data);
+    return Status;
+  }
+  SoundSourceClose(&Stream->Source);
+  Stream->Source.Memory = Data;
+  Stream->Source.MemoryLength = Length;
+  Stream->Source.Position = 0;
+  Stream->Source.Loaded = Data;
+  // the file may be shorter than its data chunk says
+  Stream->DataLeft = Length - Length % Stream->InBlockAlign;
+  return EFI_SUCCESS;
+}
+
+/**
+  Catmull-Rom coefficients for each phase, in fixed point.
+  With t = p / SOUND_PHASES:
+    c0 = (-t^3 + 2t^2 - t) / 2,  c1 = (3t^3 - 5t^2 + 2) / 2,
+    c2 = (-3t^3 + 4t^2 + t) / 2, c3 = (t^3 - t^2) / 2
+*/
+STATIC void SoundInitCoef(void)
+{
+  if (SoundCoefReady) {
+    return;
+  }
+  for (INT32 p = 0; p < SOUND_PHASES; p++) {
+    // t in Q6, so t^3 is Q18; everything is scaled to Q18 then down to Q14
+    INT32 t1 = p << 12;
+    INT32 t2 = (p * p) << 6;
+    INT32 t3 = p * p * p;
+    INT32 One = 1 << 18;
+    INT32 c[4];
+    c[0] = (-t3 + 2 * t2 - t1) / 2;
+    c[1] = (3 * t3 - 5 * t2 + 2 * One) / 2;
+    c[2] = (-3 * t3 + 4 * t2 + t1) / 2;
+    c[3] = (t3 - t2) / 2;
+    for (int k = 0; k < 4; k++) {
+      SOUND_LANE(SoundCoef[p], k) = c[k] >> (18 - SOUND_COEF_SHIFT);
+    }
+  }
+  SoundCoefReady = true;
+}
+
+/** One input sample scaled to the 16 bit range, whatever its container. */
+STATIC INT32 SoundSample(CONST UINT8 *p, UINT16 Bytes)
+{
+  switch (Bytes) {
+    case 1:
+      return ((INT32)p[0] - 128) * 256;  // 8 bit WAV data is unsigned
+    case 2:
+      return (INT16)(p[0] | (p[1] << 8));
+    case 3:
+      return (INT16)(p[1] | (p[2] << 8));
+    default:
+      return (INT16)(p[2] | (p[3] << 8));
+  }
+}
+
+STATIC INT16 SoundFilter(CONST SOUND_V4 *History, UINT32 Phase)
+{
+  INT32 Sum;
+#if SOUND_VECTOR
+  SOUND_V4 Prod = *History * SoundCoef[Phase];
+  Sum = Prod[0] + Prod[1] + Prod[2] + Prod[3];
+#else
+  Sum = 0;
+  for (int k = 0; k < 4; k++) {
+    Sum += SOUND_LANE(*History, k) * SOUND_LANE(SoundCoef[Phase], k);
+  }
+#endif
+  Sum = (Sum + (1 << (SOUND_COEF_SHIFT - 1))) >> SOUND_COEF_SHIFT;
+  if (Sum > 32767) {
+    Sum = 32767;
+  } else if (Sum < -32768) {
+    Sum = -32768;
+  }
+  return (INT16)Sum;
+}
+
+/** Converts Frames input frames to 16 bit, OutChannels, SOUND_OUT_FREQ and appends them to Out. */
+STATIC void SoundConvert(SOUND_STREAM *Stream, CONST UINT8 *In, UINTN Frames)
+{
+  INT16  *Out = (INT16 *)(Stream->Out + Stream->OutPosition);
+  UINTN   OutFrames = (Stream->OutLength - Stream->OutPosition) / (Stream->OutChannels * sizeof(INT16));
+
+  for (UINTN f = 0; f < Frames; f++, In += Stream->InBlockAlign) {
+    for (UINT16 c = 0; c < Stream->OutChannels; c++) {
+      SOUND_V4 *History = &Stream->History[c];
+      SOUND_LANE(*History, 0) = SOUND_LANE(*History, 1);
+      SOUND_LANE(*History, 1) = SOUND_LANE(*History, 2);
+      SOUND_LANE(*History, 2) = SOUND_LANE(*History, 3);
+      SOUND_LANE(*History, 3) = SoundSample(In + c * Stream->InSampleBytes, Stream->InSampleBytes);
+    }
+    // emit every output frame that falls between History[1] and History[2]
+    while (Stream->Frac < 0x10000) {
+      if (OutFrames == 0) {
+        Stream->OutPosition = Stream->OutLength;
+        return;
+      }
+      UINT32 Phase = Stream->Frac >> (16 - 6);   // 6 = log2(SOUND_PHASES)
+      for (UINT16 c = 0; c < Stream->OutChannels; c++) {
+        *Out++ = SoundFilter(&Stream->History[c], Phase);
+      }
+      OutFrames--;
+      Stream->Frac += Stream->Step;
+    }
+    Stream->Frac -= 0x10000;
+  }
+  Stream->OutPosition = (UINT8 *)Out - Stream->Out;
+}
+
+/** Sets up the converter from the input format of Stream. */
+STATIC void SoundConvertInit(SOUND_STREAM *Stream)
+{
+  SoundInitCoef();
+  Stream->Step = (UINT32)DivU64x32(LShiftU64(Stream->InFreq, 16), SOUND_OUT_FREQ);
+  Stream->Frac = 0;
+  ZeroMem(Stream->History, sizeof(Stream->History));
+}
+
+UINTN
+StartupSoundResample(CONST UINT8 *In, UINTN InLength, UINT16 InChannels, UINT16 InSampleBytes, UINT32 InFreq,
+                     UINT16 OutChannels, INT16 *Out, UINTN OutLength)
+{
+  SOUND_STREAM Stream;
+
+  if (InChannels == 0 || InSampleBytes == 0 || InSampleBytes > 4 || InFreq == 0 ||
+      OutChannels == 0 || OutChannels > MIN(InChannels, 2)) {
+    return 0;
+  }
+  ZeroMem(&Stream, sizeof(Stream));
+  Stream.InChannels = InChannels;
+  Stream.InSampleBytes = InSampleBytes;
+  Stream.InBlockAlign = InChannels * InSampleBytes;
+  Stream.InFreq = InFreq;
+  Stream.OutChannels = OutChannels;
+  Stream.Out = (UINT8 *)Out;
+  Stream.OutLength = OutLength;
+  SoundConvertInit(&Stream);
+  SoundConvert(&Stream, In, InLength / Stream.InBlockAlign);
+  return Stream.OutPosition;
+}
+
+/** Reads and converts up to one chunk. Returns false once the stream is complete. */
+STATIC XBool SoundStreamStep(SOUND_STREAM *Stream)
+{
+  UINTN Length;
+
+  if (Stream->DataLeft == 0 || Stream->OutPosition >= Stream->OutLength) {
+    return false;
+  }
+  Length = (UINTN)MIN(Stream->DataLeft, (UINT64)(SOUND_CHUNK_SIZE - SOUND_CHUNK_SIZE % Stream->InBlockAlign));
+  if (Stream->Passthrough) {
+    Length = MIN(Length, Stream->OutLength - Stream->OutPosition);
+    if (EFI_ERROR(SoundSourceRead(&Stream->Source, Stream->Out + Stream->OutPosition, Length))) {
+      return false;
+    }
+    Stream->OutPosition += Length;
+  } else {
+    if (EFI_ERROR(SoundSourceRead(&Stream->Source, Stream->Chunk, Length))) {
+      return false;
+    }
+    SoundConvert(Stream, Stream->Chunk, Length / Stream->InBlockAlign);
+  }
+  Stream->DataLeft -= Length;
+  return Stream->DataLeft != 0 && Stream->OutPosition < Stream->OutLength;
+}
+
+/** Releases everything but Out, which may still be played. */
+STATIC void SoundStreamFree(SOUND_STREAM *Stream)
+{
+  if (Stream->Timer != NULL) {
+    gBS->SetTimer(Stream->Timer, TimerCancel, 0);
+    gBS->CloseEvent(Stream->Timer);
+    Stream->Timer = NULL;
+  }
+  SoundSourceClose(&Stream->Source);
+  if (Stream->Chunk != NULL) {
+    FreePool(Stream->Chunk);
+  }
+  if (ActiveSoundStream == Stream) {
+    ActiveSoundStream = NULL;
+  }
+  FreePool(Stream);
+}
+
+STATIC void EFIAPI SoundStreamTimer(IN EFI_EVENT Event, IN void *Context)
+{
+  SOUND_STREAM *Stream = (SOUND_STREAM *)Context;
+  // the DMA consumes ~2 KB per 10 ms at 48 kHz stereo, one chunk per tick keeps well ahead
+  if (!SoundStreamStep(Stream)) {
+    SoundStreamFree(Stream);
+  }
+}
+
+STATIC XBool SoundFormat(UINT16 BitsPerSample, UINT32 SamplesPerSec,
+                         EFI_AUDIO_IO_PROTOCOL_BITS *Bits, EFI_AUDIO_IO_PROTOCOL_FREQ *Freq)
+{
+  switch (BitsPerSample) {
+    case 8:  *Bits = EfiAudioIoBits8;  break;
+    case 16: *Bits = EfiAudioIoBits16; break;
+    case 20: *Bits = EfiAudioIoBits20; break;
+    case 24: *Bits = EfiAudioIoBits24; break;
+    case 32: *Bits = EfiAudioIoBits32; break;
+    default: return false;
+  }
+  switch (SamplesPerSec) {
+    case 8000:   *Freq = EfiAudioIoFreq8kHz;   break;
+    case 11000:  *Freq = EfiAudioIoFreq11kHz;  break;
+    case 16000:  *Freq = EfiAudioIoFreq16kHz;  break;
+    case 22050:  *Freq = EfiAudioIoFreq22kHz;  break;
+    case 32000:  *Freq = EfiAudioIoFreq32kHz;  break;
+    case 44100:  *Freq = EfiAudioIoFreq44kHz;  break;
+    case 48000:  *Freq = EfiAudioIoFreq48kHz;  break;
+    case 88000:  *Freq = EfiAudioIoFreq88kHz;  break;
+    case 96000:  *Freq = EfiAudioIoFreq96kHz;  break;
+    case 192000: *Freq = EfiAudioIoFreq192kHz; break;
+    default: return false;
+  }
+  return true;
+}
 
 EFI_STATUS
 StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
 {
-  EFI_STATUS Status;
-  UINT8           *FileData = NULL;
-  UINTN           FileDataLength = 0U;
-  WAVE_FILE_DATA  WaveData;
+  EFI_STATUS      Status;
+  SOUND_STREAM    *Stream = NULL;
   UINT8           OutputVolume = DefaultAudioVolume;
-  UINT16          *TempData = NULL;
-  UINTN           Len;
-  
+  UINT64          InFrames;
+  UINT64          OutFrames;
+  EFI_AUDIO_IO_PROTOCOL_BITS bits;
+  EFI_AUDIO_IO_PROTOCOL_FREQ freq;
+
   if (OldChosenAudio >= AudioList.size()) {
     OldChosenAudio = 0; //security correction
   }
   size_t OutputIndex = (OldChosenAudio & 0xFF);
 
-  WaveData.Samples = NULL;
-  WaveData.SamplesLength = 0;
   if (!AudioIo) {
     Status = EFI_DEVICE_ERROR;
     //    DBG("not found AudioIo to play\n");
     goto DONE_ERROR;
   }
+  if (ActiveSoundStream != NULL) {
+    // a previous async sound is still being converted, its buffer is about to be replaced
+    EFI_TPL OldTpl = gBS->RaiseTPL(TPL_CALLBACK);
+    SoundStreamFree(ActiveSoundStream);
+    gBS->RestoreTPL(OldTpl);
+  }
 
+  Stream = (__typeof__(Stream))AllocateZeroPool(sizeof(*Stream));
+  if (Stream == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto DONE_ERROR;
+  }
   if (SoundFile) {
-    Status = egLoadFile(Dir, SoundFile, &FileData, &FileDataLength);
+    Status = Dir->Open(Dir, &Stream->Source.File, (CHAR16*)SoundFile, EFI_FILE_MODE_READ, 0); // const missing const EFI_FILE*->Open
     if (EFI_ERROR(Status)) {
+      Stream->Source.File = NULL;
 //      DBG("file sound read: %ls %s\n", SoundFile, efiStrError(Status));
       goto DONE_ERROR;
     }
   } else {
-    FileData = EmbeddedSound;
-    FileDataLength = EmbeddedSoundLength;
+    Stream->Source.Memory = EmbeddedSound;
+    Stream->Source.MemoryLength = EmbeddedSoundLength;
 //    DBG("got embedded sound\n");
   }
 
-  
-  Status = WaveGetFileData(FileData, (UINT32)FileDataLength, &WaveData); //
+  Status = SoundParseHeader(Stream);
   if (EFI_ERROR(Status)) {
     MsgLog(" wrong sound file, wave status=%s\n", efiStrError(Status));
-    //if error then data not allocated
     goto DONE_ERROR;
   }
-  Len = WaveData.SamplesLength; //byte length
-	MsgLog("  Channels: %hu  Sample rate: %u Hz  Bits: %hu\n", WaveData.Format->Channels, WaveData.Format->SamplesPerSec, WaveData.Format->BitsPerSample);
+  MsgLog("  Channels: %hu  Sample rate: %u Hz  Bits: %hu\n", Stream->InChannels, Stream->InFreq, Stream->InBits);
+  DBG("output to channel %zu with volume %d, len=%llu\n", OutputIndex, OutputVolume, Stream->DataLeft);
 
-  EFI_AUDIO_IO_PROTOCOL_BITS bits;
-  switch (WaveData.Format->BitsPerSample) {
-    case 8:
-      bits = EfiAudioIoBits8;
-      break;
-    case 16:
-      bits = EfiAudioIoBits16;
-      break;
-    case 20:
-      bits = EfiAudioIoBits20;
-      break;
-    case 24:
-      bits = EfiAudioIoBits24;
-      break;
-    case 32:
-      bits = EfiAudioIoBits32;
-      break;
-    default:
-      goto DONE_ERROR;
-  }
-
-  EFI_AUDIO_IO_PROTOCOL_FREQ freq;
-  switch (WaveData.Format->SamplesPerSec) {
-    case 8000:
-      freq = EfiAudioIoFreq8kHz;
-      break;
-    case 11000:
-      freq = EfiAudioIoFreq11kHz;
-      break;
-    case 16000:
-      freq = EfiAudioIoFreq16kHz;
-      break;
-    case 22050:
-      freq = EfiAudioIoFreq22kHz;
-      break;
-    case 32000:
-      freq = EfiAudioIoFreq32kHz;
-      break;
-    case 44100:
-      freq = EfiAudioIoFreq44kHz;
-      break;
-    case 48000:
-      freq = EfiAudioIoFreq48kHz;
-      break;
-    case 88000:
-      freq = EfiAudioIoFreq88kHz;
-      break;
-    case 96000:
-      freq = EfiAudioIoFreq96kHz;
-      break;
-    case 192000:
-      freq = EfiAudioIoFreq192kHz;
-      break;
-    default:
-      goto DONE_ERROR;
-  }
-
-  DBG("output to channel %zu with volume %d, len=%d\n", OutputIndex, OutputVolume, WaveData.SamplesLength);
-  DBG(" sound channels=%d bits=%d freq=%d\n", WaveData.Format->Channels, WaveData.Format->BitsPerSample, WaveData.Format->SamplesPerSec);
-
-  if (!WaveData.SamplesLength || !OutputVolume) {
-//    DBG("nothing to play\n"); //but data allocated
+  if (!Stream->DataLeft || !OutputVolume) {
+//    DBG("nothing to play\n");
     Status = EFI_NOT_FOUND;
     goto DONE_ERROR;
   }
 
-  if ((freq == EfiAudioIoFreq8kHz) && (bits == EfiAudioIoBits16)) {
-    //making conversion
-    Len *= 6; //8000<->48000
-    UINTN Ind, Out=0, Tact;
-    INT16 Tmp, Next;
-    float Delta;
-    INT16 *Ptr = (INT16*)WaveData.Samples;
-    if (!Ptr) {
-      Status = EFI_NOT_FOUND;
- //     DBG("not found wave data\n");
-      goto DONE_ERROR;
-    }
-//    TempData = (__typeof__(TempData))AllocateZeroPool(Len * sizeof(INT16));
-    TempData = (__typeof__(TempData))AllocateAlignedPages(EFI_SIZE_TO_PAGES(Len + 4095), 128);
-    Tmp = *(Ptr++);
-    for (Ind = 0; Ind < WaveData.SamplesLength / 2 - 1; Ind++) {
-      Next = *(Ptr++);
-      Delta = (Next - Tmp) / 6.f;
-      for (Tact = 0; Tact < 6; Tact++) {
-        TempData[Out++] = Tmp;
-        Tmp = (INT16)(Delta + Tmp + 0.5f);
-      }
-      Tmp = Next;
-    }
-    freq = EfiAudioIoFreq48kHz;
-    // Samples was allocated via AllocateAlignedPages, so it must not be freed with FreePool, but according to the number of pages allocated
-    FreeAlignedPages(WaveData.Samples,EFI_SIZE_TO_PAGES(WaveData.SamplesLength + 4095));
-    WaveData.SamplesLength *= 6;
-    DBG("sound converted to 48kHz\n");
-    WaveData.Samples = (UINT8*)TempData;
-  }
-
   // Setup playback.
   if (OutputIndex >= AudioList.size()) {
     OutputIndex = 0;
     DBG("wrong index for Audio output\n");
   }
-  Status = AudioIo->SetupPlayback(AudioIo, AudioList[OutputIndex].Index, OutputVolume,
-                                  freq, bits, (UINT8)(WaveData.Format->Channels));
-  if (EFI_ERROR(Status)) {
-    MsgLog("StartupSound: Error setting up playback: %s\n", efiStrError(Status));
+  // 8 kHz is listed by the protocol but rarely by codecs, it was always converted
+  Status = EFI_UNSUPPORTED;
+  if (Stream->InFreq != 8000 && SoundFormat(Stream->InBits, Stream->InFreq, &bits, &freq)) {
+    Status = AudioIo->SetupPlayback(AudioIo, AudioList[OutputIndex].Index, OutputVolume,
+                                    freq, bits, (UINT8)Stream->InChannels);
+  }
+  InFrames = Stream->DataLeft / Stream->InBlockAlign;
+  if (!EFI_ERROR(Status)) {
+    Stream->Passthrough = true;
+    Stream->OutLength = (UINTN)Stream->DataLeft;
+  } else {
+    Stream->OutChannels = MIN(Stream->InChannels, 2);
+    Status = AudioIo->SetupPlayback(AudioIo, AudioList[OutputIndex].Index, OutputVolume,
+                                    EfiAudioIoFreq48kHz, EfiAudioIoBits16, (UINT8)Stream->OutChannels);
+    if (EFI_ERROR(Status)) {
+      MsgLog("StartupSound: Error setting up playback: %s\n", efiStrError(Status));
+      goto DONE_ERROR;
+    }
+    SoundConvertInit(Stream);
+    OutFrames = DivU64x32(MultU64x32(InFrames, SOUND_OUT_FREQ), Stream->InFreq) + 1;
+    Stream->OutLength = (UINTN)OutFrames * Stream->OutChannels * sizeof(INT16);
+    Stream->Chunk = (__typeof__(Stream->Chunk))AllocatePool(SOUND_CHUNK_SIZE);
+    if (Stream->Chunk == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto DONE_ERROR;
+    }
+    DBG("sound converted to 48kHz/16bit, %hu channels\n", Stream->OutChannels);
+  }
+  Stream->OutPages = EFI_SIZE_TO_PAGES(Stream->OutLength + 4095);
+  Stream->Out = (__typeof__(Stream->Out))AllocateAlignedPages(Stream->OutPages, 128);
+  if (Stream->Out == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
     goto DONE_ERROR;
   }
-//  DBG("playback set\n");
+  // the tail stays silent if the file turns out shorter than announced
+  ZeroMem(Stream->Out, EFI_PAGES_TO_SIZE(Stream->OutPages));
+
   // Start playback.
   if (gSettings.GUI.PlayAsync) {
-    Status = AudioIo->StartPlaybackAsync(AudioIo, WaveData.Samples, WaveData.SamplesLength, 0, NULL, NULL);
+    while (Stream->OutPosition < SOUND_PRIME_SIZE && SoundStreamStep(Stream)) {}
+    Status = AudioIo->StartPlaybackAsync(AudioIo, Stream->Out, Stream->OutLength, 0, NULL, NULL);
 //    DBG("async started, status=%s\n", efiStrError(Status));
+    if (!EFI_ERROR(Status) && Stream->DataLeft != 0 && Stream->OutPosition < Stream->OutLength) {
+      // convert the rest behind our back, ahead of the DMA, from memory read while the start plays
+      if (!Stream->Passthrough && !EFI_ERROR(SoundSourceLoad(Stream)) &&
+          !EFI_ERROR(gBS->CreateEvent(EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, SoundStreamTimer, Stream, &Stream->Timer))) {
+        ActiveSoundStream = Stream;
+        gBS->SetTimer(Stream->Timer, TimerPeriodic, SOUND_TIMER_PERIOD);
+        return Status;
+      }
+      Stream->Timer = NULL;
+      // passthrough only reads, straight into the playing buffer
+      while (SoundStreamStep(Stream)) {}
+    }
+    if (!EFI_ERROR(Status)) {
+      // dont free sound when async play
+      // here we have memory leak with Stream->Out
+      // and we can't free memory up to stop AsyncPlay
+      Stream->Out = NULL;
+    }
   } else {
-    Status = AudioIo->StartPlayback(AudioIo, WaveData.Samples, WaveData.SamplesLength, 0);
+    while (SoundStreamStep(Stream)) {}
+    Status = AudioIo->StartPlayback(AudioIo, Stream->Out, Stream->OutLength, 0);
 //    DBG("sync started, status=%s\n", efiStrError(Status));
-//    if (!EFI_ERROR(Status)) {
-//      FreePool(TempData);
-//    }
   }
 
   if (EFI_ERROR(Status)) {
@@ -229,15 +615,11 @@ StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile)
   }
 
 DONE_ERROR:
-  if (FileData && SoundFile) {  //dont free embedded sound
-//    DBG("free sound\n");
-    FreePool(FileData);
-  }
-  if (!gSettings.GUI.PlayAsync && WaveData.Samples) {
-    //dont free sound when async play
-    // here we have memory leak with WaveData.Samples
-    // and we can't free memory up to stop AsyncPlay
-    FreeAlignedPages(WaveData.Samples, EFI_SIZE_TO_PAGES(WaveData.SamplesLength + 4095));
+  if (Stream != NULL) {
+    if (Stream->Out != NULL) {
+      FreeAlignedPages(Stream->Out, Stream->OutPages);
+    }
+    SoundStreamFree(Stream);
   }
 //  DBG("sound play end with status=%s\n", efiStrError(Status));
   return Status;
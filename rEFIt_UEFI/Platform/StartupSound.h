@@ -23,6 +23,15 @@ extern EFI_AUDIO_IO_PROTOCOL    *AudioIo;
 EFI_STATUS
 StartupSoundPlay(const EFI_FILE* Dir, CONST CHAR16* SoundFile);
 
+/**
+  Converts little endian PCM of InLength bytes to 48 kHz 16 bit with OutChannels (1 or 2,
+  at most InChannels) channels, the way startup sounds are played when the codec doesn't
+  take their format. Returns the number of bytes written to Out.
+*/
+UINTN
+StartupSoundResample(CONST UINT8 *In, UINTN InLength, UINT16 InChannels, UINT16 InSampleBytes, UINT32 InFreq,
+                     UINT16 OutChannels, INT16 *Out, UINTN OutLength);
+
 void GetOutputs();
 
 EFI_STATUS CheckSyncSound(XBool Stop);
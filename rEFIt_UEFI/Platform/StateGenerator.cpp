@@ -9,6 +9,7 @@
 #include "smbios.h"
 #include "AcpiPatcher.h"
 #include "Settings.h"
+#include "../Settings/SelfOem.h"
 
 extern "C" {
 #include <IndustryStandard/CpuId.h> // for CPUID_FEATURE_MSR
@@ -24,6 +25,27 @@ CONST UINT8 pss_ssdt_header[] =
 };
 
 
+/*
+ Generated SSDTs are cached in the config dir as ACPI\cache\SSDT-PSS.aml and SSDT-CST.aml.
+ Each file is the table itself followed by the generator inputs it was built from and a
+ SSDT_CACHE_TRAILER, so a cache hit costs one file read and a key comparison.
+ Set SSDT_CACHE_VERIFY to 1 to regenerate on every hit and compare against the cached copy.
+ */
+#ifndef SSDT_CACHE_VERIFY
+#define SSDT_CACHE_VERIFY 0
+#endif
+
+// bump whenever generate_pss_ssdt or generate_cst_ssdt output changes for the same inputs
+#define SSDT_CACHE_VERSION    1
+#define SSDT_CACHE_SIGNATURE  SIGNATURE_32('C', 'S', 'S', 'D')
+
+typedef struct {
+  UINT32 KeyLength;
+  UINT32 KeyCrc;
+  UINT32 Signature;
+} SSDT_CACHE_TRAILER;
+
+
 UINT8 cst_ssdt_header[] =
 {
   0x53, 0x53, 0x44, 0x54, 0xE7, 0x00, 0x00, 0x00, /* SSDT.... */
@@ -492,17 +514,18 @@ SSDT_TABLE *generate_pss_ssdt(UINTN Number)
         aml_add_byte(scop, gSettings.ACPI.SSDT.PluginType);
       }
 
-      aml_calculate_size(root);
-
-      ssdt = (SSDT_TABLE *)AllocateZeroPool(root->Size);
-      aml_write_node(root, (CHAR8*)ssdt, 0);
-      ssdt->Length = root->Size;
+      UINT32 ssdtSize;
+      ssdt = (SSDT_TABLE *)aml_generate(root, &ssdtSize);
+      aml_destroy_node(root);
+      if (!ssdt) {
+        MsgLog ("P-States SSDT: not enough memory\n");
+        return NULL;
+      }
+      ssdt->Length = ssdtSize;
       FixChecksum(ssdt);
       //ssdt->Checksum = 0;
       //ssdt->Checksum = (UINT8)(256 - Checksum8(ssdt, ssdt->Length));
 
-      aml_destroy_node(root);
-
       if (gSettings.ACPI.SSDT.Generate.GeneratePStates && !GlobalConfig.HWP) {
         if (gSettings.ACPI.SSDT.PluginType && gSettings.ACPI.SSDT.Generate.GeneratePluginType) {
           MsgLog ("SSDT with CPU P-States and plugin-type generated successfully\n");
@@ -711,22 +734,253 @@ SSDT_TABLE *generate_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, U
 
   }
   
-  aml_calculate_size(root);
-  
-  ssdt = (SSDT_TABLE *)AllocateZeroPool(root->Size);
+  UINT32 ssdtSize;
+  ssdt = (SSDT_TABLE *)aml_generate(root, &ssdtSize);
   
-  aml_write_node(root, (CHAR8*)ssdt, 0);
+  aml_destroy_node(root);
+  if (!ssdt) {
+    MsgLog ("C-States SSDT: not enough memory\n");
+    return NULL;
+  }
   
-  ssdt->Length = root->Size;
+  ssdt->Length = ssdtSize;
   FixChecksum(ssdt);
 //  ssdt->Checksum = 0;
 //  ssdt->Checksum = (UINT8)(256 - Checksum8((void*)ssdt, ssdt->Length));
   
-  aml_destroy_node(root);
-  
   //dumpPhysAddr("C-States SSDT content: ", ssdt, ssdt->Length);
   
   MsgLog ("SSDT with CPU C-States generated successfully\n");
   
   return ssdt;
 }
+
+static void ssdt_cache_key_cpus(XBuffer<UINT8>& key, UINT32 kind, UINTN Number)
+{
+  key.cat((UINT32)SSDT_CACHE_VERSION);
+  key.cat(kind);
+  key.cat((UINT64)Number);
+  key.ncat(acpi_cpu_score, acpi_cpu_score ? AsciiStrLen(acpi_cpu_score) + 1 : 0);
+  for (UINTN i = 0; i < Number && i < acpi_cpu_max; i++) {
+    if (acpi_cpu_name[i]) {
+      key.ncat(acpi_cpu_name[i], AsciiStrLen(acpi_cpu_name[i]) + 1);
+    } else {
+      key.cat((UINT8)0);
+    }
+  }
+}
+
+/*
+ Only models whose P-states come from MSR_PLATFORM_INFO are cached: the key reads that MSR.
+ Models handled through MSR_IA32_PERF_STATUS have their P-states read from the current
+ VID/FID and may get dynamic FSB switched on by the generator, others aren't supported.
+ Keep this list in sync with generate_pss_ssdt().
+ */
+static XBool pss_ssdt_cacheable(void)
+{
+  if (gCPUStructure.Vendor != CPU_VENDOR_INTEL || !(gCPUStructure.Features & CPUID_FEATURE_MSR) ||
+      gCPUStructure.Family != 0x06) {
+    return false;
+  }
+  switch (gCPUStructure.Model) {
+    case CPU_MODEL_FIELDS:        // Intel Core i5, i7, Xeon X34xx LGA1156 (45nm)
+    case CPU_MODEL_DALES:
+    case CPU_MODEL_CLARKDALE:     // Intel Core i3, i5 LGA1156 (32nm)
+    case CPU_MODEL_NEHALEM:       // Intel Core i7, Xeon W35xx, Xeon X55xx, Xeon E55xx LGA1366 (45nm)
+    case CPU_MODEL_NEHALEM_EX:    // Intel Xeon X75xx, Xeon X65xx, Xeon E75xx, Xeon E65x
+    case CPU_MODEL_WESTMERE:      // Intel Core i7, Xeon X56xx, Xeon E56xx, Xeon W36xx LGA1366 (32nm) 6 Core
+    case CPU_MODEL_WESTMERE_EX:   // Intel Xeon E7
+    case CPU_MODEL_SANDY_BRIDGE:  // Intel Core i3, i5, i7 LGA1155 (32nm)
+    case CPU_MODEL_JAKETOWN:      // Intel Xeon E3
+    case CPU_MODEL_ATOM_3700:
+    case CPU_MODEL_IVY_BRIDGE:
+    case CPU_MODEL_IVY_BRIDGE_E5:
+    case CPU_MODEL_HASWELL:
+    case CPU_MODEL_HASWELL_E:
+    case CPU_MODEL_HASWELL_ULT:
+    case CPU_MODEL_CRYSTALWELL:
+    case CPU_MODEL_HASWELL_U5:    // Broadwell Mobile
+    case CPU_MODEL_BROADWELL_HQ:
+    case CPU_MODEL_BROADWELL_E5:
+    case CPU_MODEL_BROADWELL_DE:
+    case CPU_MODEL_AIRMONT:
+    case CPU_MODEL_SKYLAKE_U:
+    case CPU_MODEL_SKYLAKE_D:
+    case CPU_MODEL_SKYLAKE_S:
+    case CPU_MODEL_GOLDMONT:
+    case CPU_MODEL_KABYLAKE1:
+    case CPU_MODEL_KABYLAKE2:
+    case CPU_MODEL_CANNONLAKE:
+    case CPU_MODEL_ICELAKE_A:
+    case CPU_MODEL_ICELAKE_C:
+    case CPU_MODEL_ICELAKE_D:
+    case CPU_MODEL_ICELAKE:
+    case CPU_MODEL_COMETLAKE_S:
+    case CPU_MODEL_COMETLAKE_Y:
+    case CPU_MODEL_COMETLAKE_U:
+    case CPU_MODEL_TIGERLAKE_C:
+    case CPU_MODEL_TIGERLAKE_D:
+    case CPU_MODEL_ROCKETLAKE:
+    case CPU_MODEL_ALDERLAKE:
+    case CPU_MODEL_ALDERLAKE_ULT:
+    case CPU_MODEL_RAPTORLAKE_B:
+    case CPU_MODEL_RAPTORLAKE_M:
+    case CPU_MODEL_RAPTORLAKE:
+    case CPU_MODEL_METEORLAKE:
+    case CPU_MODEL_ARROWLAKE:
+    case CPU_MODEL_ARROWLAKE_X:
+    case CPU_MODEL_ARROWLAKE_U:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void pss_ssdt_cache_key(XBuffer<UINT8>& key, UINTN Number)
+{
+  ssdt_cache_key_cpus(key, SIGNATURE_32('P', 'S', 'S', '_'), Number);
+  key.cat(gCPUStructure.Vendor);
+  key.cat(gCPUStructure.Family);
+  key.cat(gCPUStructure.Model);
+  key.cat(gCPUStructure.Features);
+  key.ncat(gCPUStructure.BrandString.c_str(), gCPUStructure.BrandString.sizeInBytesIncludingTerminator());
+  key.cat(gCPUStructure.FSBFrequency);
+  key.cat(gCPUStructure.Turbo1);
+  key.cat(gCPUStructure.Turbo4);
+  key.cat(AsmReadMsr64(MSR_PLATFORM_INFO));
+  key.cat((bool)gMobile);
+  key.cat((bool)GlobalConfig.Turbo);
+  key.cat((bool)GlobalConfig.HWP);
+  key.cat(gSettings.CPU.TDP);
+  key.cat((bool)gSettings.ACPI.SSDT.DoubleFirstState);
+  key.cat(gSettings.ACPI.SSDT.MinMultiplier);
+  key.cat(gSettings.ACPI.SSDT.MaxMultiplier);
+  key.cat(gSettings.ACPI.SSDT.PLimitDict);
+  key.cat(gSettings.ACPI.SSDT.UnderVoltStep);
+  key.cat(gSettings.ACPI.SSDT.PluginType);
+  key.cat((bool)gSettings.ACPI.SSDT.Generate.GeneratePStates);
+  key.cat((bool)gSettings.ACPI.SSDT.Generate.GeneratePluginType);
+  key.cat((bool)gSettings.ACPI.SSDT.Generate.GenerateAPSN);
+  key.cat((bool)gSettings.ACPI.SSDT.Generate.GenerateAPLF);
+}
+
+static void cst_ssdt_cache_key(XBuffer<UINT8>& key, EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, UINTN Number)
+{
+  ssdt_cache_key_cpus(key, SIGNATURE_32('C', 'S', 'T', '_'), Number);
+  key.cat(fadt->Pm1aEvtBlk);
+  key.cat(fadt->PLvl2Lat);
+  key.cat(fadt->PLvl3Lat);
+  key.cat((bool)GlobalConfig.EnableC2);
+  key.cat((bool)GlobalConfig.EnableC4);
+  key.cat((bool)GlobalConfig.EnableC6);
+  key.cat(GlobalConfig.C3Latency);
+  key.cat((bool)gSettings.ACPI.SSDT.EnableISS);
+  key.cat((bool)gSettings.ACPI.SSDT.EnableC7);
+}
+
+/*
+ Returns the cached table if the file exists and was generated from exactly this key.
+ The returned buffer is the whole file; only ssdt->Length bytes of it are the table.
+ */
+static SSDT_TABLE *ssdt_cache_load(CONST CHAR16 *FileName, const XBuffer<UINT8>& key, UINT32 keyCrc)
+{
+  UINT8 *buffer = NULL;
+  UINTN bufferLen = 0;
+  EFI_STATUS Status = egLoadFile(&selfOem.getConfigDir(), FileName, &buffer, &bufferLen);
+  if (EFI_ERROR(Status) || !buffer) {
+    return NULL;
+  }
+
+  SSDT_TABLE *ssdt = (SSDT_TABLE *)buffer;
+  if (bufferLen < sizeof(SSDT_TABLE) + sizeof(SSDT_CACHE_TRAILER)) {
+    FreePool(buffer);
+    return NULL;
+  }
+  SSDT_CACHE_TRAILER *trailer = (SSDT_CACHE_TRAILER *)(buffer + bufferLen - sizeof(SSDT_CACHE_TRAILER));
+  if (ReadUnaligned32(&trailer->Signature) != SSDT_CACHE_SIGNATURE ||
+      ReadUnaligned32(&trailer->KeyLength) != key.size() ||
+      ReadUnaligned32(&trailer->KeyCrc) != keyCrc ||
+      ssdt->Signature != EFI_ACPI_2_0_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE ||
+      ssdt->Length < sizeof(SSDT_TABLE) ||
+      (UINTN)ssdt->Length + key.size() + sizeof(SSDT_CACHE_TRAILER) != bufferLen ||
+      CompareMem(buffer + ssdt->Length, key.data(), key.size()) != 0 ||
+      Checksum8(ssdt, ssdt->Length) != 0) {
+    DBG("SSDT cache %ls is stale\n", FileName);
+    FreePool(buffer);
+    return NULL;
+  }
+  return ssdt;
+}
+
+static void ssdt_cache_save(CONST CHAR16 *FileName, SSDT_TABLE *ssdt, const XBuffer<UINT8>& key, UINT32 keyCrc)
+{
+  XBuffer<UINT8> file;
+  SSDT_CACHE_TRAILER trailer;
+
+  trailer.KeyLength = (UINT32)key.size();
+  trailer.KeyCrc = keyCrc;
+  trailer.Signature = SSDT_CACHE_SIGNATURE;
+  file.ncat(ssdt, ssdt->Length);
+  file.ncat(key.data(), key.size());
+  file.ncat(&trailer, sizeof(trailer));
+  EFI_STATUS Status = egSaveFile(&selfOem.getConfigDir(), FileName, file.data(), file.size());
+  if (EFI_ERROR(Status)) {
+    DBG("SSDT cache %ls not saved: %s\n", FileName, efiStrError(Status));
+  }
+}
+
+static SSDT_TABLE *ssdt_cache_lookup(CONST CHAR16 *FileName, const XBuffer<UINT8>& key,
+                                     EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, UINTN Number, XBool pss)
+{
+  UINT32 keyCrc = 0;
+  gBS->CalculateCrc32((void*)key.data(), key.size(), &keyCrc);
+
+  SSDT_TABLE *ssdt = ssdt_cache_load(FileName, key, keyCrc);
+  if (ssdt) {
+    MsgLog("SSDT %s loaded from cache %ls\n", pss ? "P-States" : "C-States", FileName);
+#if SSDT_CACHE_VERIFY
+    SSDT_TABLE *fresh = pss ? generate_pss_ssdt(Number) : generate_cst_ssdt(fadt, Number);
+    if (!fresh || fresh->Length != ssdt->Length || CompareMem(fresh, ssdt, ssdt->Length) != 0) {
+      MsgLog("SSDT cache %ls differs from regenerated table, using regenerated one\n", FileName);
+      FreePool(ssdt);
+      if (fresh) {
+        ssdt_cache_save(FileName, fresh, key, keyCrc);
+      }
+      return fresh;
+    }
+    MsgLog("SSDT cache %ls verified\n", FileName);
+    FreePool(fresh);
+#endif
+    return ssdt;
+  }
+
+  ssdt = pss ? generate_pss_ssdt(Number) : generate_cst_ssdt(fadt, Number);
+  if (ssdt) {
+    ssdt_cache_save(FileName, ssdt, key, keyCrc);
+  }
+  return ssdt;
+}
+
+SSDT_TABLE *cached_pss_ssdt(UINTN Number)
+{
+  if (Number == 0 || !pss_ssdt_cacheable()) {
+    return generate_pss_ssdt(Number);
+  }
+  // generate_pss_ssdt() clears it too, keep that on a cache hit
+  if (gCPUStructure.Model < CPU_MODEL_IVY_BRIDGE) {
+    gSettings.ACPI.SSDT.Generate.GenerateAPLF = false;
+  }
+  XBuffer<UINT8> key;
+  pss_ssdt_cache_key(key, Number);
+  return ssdt_cache_lookup(L"ACPI\\cache\\SSDT-PSS.aml", key, NULL, Number, true);
+}
+
+SSDT_TABLE *cached_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, UINTN Number)
+{
+  if (!fadt) {
+    return NULL;
+  }
+  XBuffer<UINT8> key;
+  cst_ssdt_cache_key(key, fadt, Number);
+  return ssdt_cache_lookup(L"ACPI\\cache\\SSDT-CST.aml", key, fadt, Number, false);
+}
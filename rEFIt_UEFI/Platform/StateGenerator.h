@@ -31,4 +31,9 @@ typedef EFI_ACPI_DESCRIPTION_HEADER SSDT_TABLE;
 SSDT_TABLE *generate_pss_ssdt(UINTN Number);
 SSDT_TABLE *generate_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, UINTN Number);
 
+// Same as above, but served from the on-disk SSDT cache when the generator inputs are unchanged.
+// The returned buffer must be freed with FreePool.
+SSDT_TABLE *cached_pss_ssdt(UINTN Number);
+SSDT_TABLE *cached_cst_ssdt(EFI_ACPI_2_0_FIXED_ACPI_DESCRIPTION_TABLE* fadt, UINTN Number);
+
 #endif /* !__LIBSAIO_ACPI_PATCHER_H */
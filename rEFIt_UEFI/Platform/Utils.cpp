@@ -101,6 +101,40 @@ XBool IsHexDigit(wchar_t c) {
 
 #ifdef __cplusplus
 
+const int8_t hexDigitValueTable[128] = {
+  -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+   0, 1, 2, 3, 4, 5, 6, 7,  8, 9,-1,-1,-1,-1,-1,-1,
+  -1,10,11,12,13,14,15,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+  -1,10,11,12,13,14,15,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+};
+
+static const char hexDigitsUpper[] = "0123456789ABCDEF";
+
+void bin2hex(const uint8_t *in, size_t inlen, char *out)
+{
+  for (size_t i = 0; i < inlen; i++) {
+    *out++ = hexDigitsUpper[in[i] >> 4];
+    *out++ = hexDigitsUpper[in[i] & 0xF];
+  }
+}
+
+void bin2hex(const uint8_t *in, size_t inlen, XBuffer<char>* out)
+{
+  char chunk[256];
+
+  while ( inlen > 0 ) {
+    size_t n = inlen < sizeof(chunk)/2 ? inlen : sizeof(chunk)/2;
+    bin2hex(in, n, chunk);
+    out->ncat(chunk, n*2);
+    in += n;
+    inlen -= n;
+  }
+}
+
 size_t hex2bin(const XBuffer<char>& buffer, uint8_t *out, size_t outlen)
 {
   return hex2bin(buffer.data(), buffer.size(), out, outlen);
@@ -49,11 +49,24 @@ UINT8       hexstrtouint8 (CONST CHAR8* buf); //one or two hex letters to one by
 #include "../cpp_foundation/XString.h"
 #include "../cpp_foundation/XBuffer.h"
 
+/*
+ * Value of an hex digit, -1 if c is not an hex digit. Table driven.
+ */
+extern const int8_t hexDigitValueTable[128];
+template <typename C>
+inline int hexDigitValue(C c) { return (uint32_t)c < 128 ? hexDigitValueTable[(uint32_t)c] : -1; }
+
+/*
+ * Upper case hex encoding of in. Write exactly 2*inlen chars into out, no terminator.
+ */
+void bin2hex(const uint8_t *in, size_t inlen, char *out);
+void bin2hex(const uint8_t *in, size_t inlen, XBuffer<char>* out);
+
 template <typename T, enable_if( is_char_ptr(T)  ||  is___String(T) )>
 size_t hex2bin(const T hex, size_t hexlen, uint8_t *out, size_t outlen)
 {
   size_t outidx = 0;
-  char  buf[3] = {0,0,0};
+  int hi, lo;
 
   if ( hex == NULL || hexlen <= 0 ) {
     //DBG("[ERROR] bin2hex input error\n"); //this is not error, this is empty value
@@ -78,19 +91,20 @@ size_t hex2bin(const T hex, size_t hexlen, uint8_t *out, size_t outlen)
       DebugLog(1, "[ERROR] bin2hex '%.*s' uneven char nuber\n", (int)hexlen, XString8().takeValueFrom(hex).c_str());
       return 0;
     }
-    if (!IsHexDigit(hex[hexidx]) || !IsHexDigit(hex[hexidx+1])) {
+    hi = hexDigitValue(hex[hexidx]);
+    lo = hexDigitValue(hex[hexidx+1]);
+    if ( hi < 0 || lo < 0 ) {
       if ( hexlen > 200 ) hexlen = 200; // Do not print more than 200 chars.
       DebugLog(1, "[ERROR] bin2hex '%.*s' syntax error\n", (int)hexlen, XString8().takeValueFrom(hex).c_str());
       return 0;
     }
-    buf[0] = (char)hex[hexidx++]; // safe cast, it's an hex digit
-    buf[1] = (char)hex[hexidx++]; // safe cast, it's an hex digit
+    hexidx += 2;
     if ( out != NULL ) {
       if ( outidx == outlen ) {
         DebugLog(1, "[ERROR] bin2hex '%.*s' outbuffer not big enough\n", (int)hexlen, XString8().takeValueFrom(hex).c_str());
         return 0;
       }
-      out[outidx] = hexstrtouint8(buf);
+      out[outidx] = (uint8_t)((hi << 4) | lo);
     }
     ++outidx;
   }
@@ -60,7 +60,7 @@ public:
   const REFIT_VOLUME& operator = ( const REFIT_VOLUME & ) = delete; // Can be defined if needed
   ~REFIT_VOLUME() {}
 
-  const XStringW getVolLabelOrOSXVolumeNameOrVolName() {
+  const XStringW& getVolLabelOrOSXVolumeNameOrVolName() const {
     if ( VolLabel.notEmpty() ) return VolLabel;
     if ( osxVolumeName.notEmpty() ) return osxVolumeName;
     return VolName;
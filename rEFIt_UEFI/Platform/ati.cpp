@@ -10,6 +10,7 @@
 #include "ati_reg.h"
 #include "smbios.h"
 #include "FixBiosDsdt.h"
+#include "card_vlist.h"
 #include "../include/Pci.h"
 #include "../include/Devices.h"
 #include "../Platform/Settings.h"
@@ -1873,6 +1874,12 @@ void get_vram_size(void)
   DBG("ATI: get_vram_size returned 0x%llX\n", card->vram_size);
 }
 
+static EFI_STATUS read_vbios_bytes(void *Context, UINTN Offset, UINTN Size, UINT8 *Buffer)
+{
+  CopyMem(Buffer, (UINT8 *)Context + Offset, Size);
+  return EFI_SUCCESS;
+}
+
 XBool read_vbios(XBool from_pci)
 {
   option_rom_header_t *rom_addr;
@@ -1901,7 +1908,17 @@ XBool read_vbios(XBool from_pci)
     return false;
   }
 
-  CopyMem(card->rom, (void *)rom_addr, card->rom_size);
+  if (!from_pci) {
+    // legacy space is a RAM shadow, faster than any cache
+    CopyMem(card->rom, (void *)rom_addr, card->rom_size);
+    return true;
+  }
+
+  // PCI ROM is read through MMIO: only the probe and image headers, unless the ROM changed since it was cached
+  if (!gVBiosCache->GetImage(card->pci_dev, "pcirom", read_vbios_bytes, (void *)rom_addr, card->rom, card->rom_size)) {
+    CopyMem(card->rom, (void *)rom_addr, card->rom_size);
+    gVBiosCache->PutImage(card->pci_dev, "pcirom", card->rom, card->rom_size);
+  }
   return true;
 }
 
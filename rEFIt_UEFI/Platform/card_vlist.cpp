@@ -7,6 +7,9 @@
 #include "nvidia.h"
 #include "../Platform/Settings.h"
 #include "card_vlist.h"
+#include "../Settings/Self.h"
+#include "../refit/lib.h"
+#include "../libeg/libeg.h"
 
 /*
  injection for NVIDIA card usage e.g (to be placed in the config.plist, under graphics tag): 
@@ -97,3 +100,105 @@ const SETTINGS_DATA::GraphicsClass::GRAPHIC_CARD* FindCardWithIds(UINT32 Id, UIN
   }
   return NULL;
 }
+
+static XStringW VBiosCacheFileName(const pci_dt_t* Dev, CONST CHAR8* Source)
+{
+  return SWPrintf("misc\\vbios\\%04hX_%04hX_%04hX_%04hX_%s.rom", Dev->vendor_id, Dev->device_id,
+                  Dev->subsys_id_union.subsys.vendor_id, Dev->subsys_id_union.subsys.device_id, Source);
+}
+
+XBool VBiosCache::LoadImage(const XStringW& FileName, XBuffer<UINT8>* Image)
+{
+  UINT8* Buffer = NULL;
+  UINTN  BufferLen = 0;
+
+  if ( !FileExists(&self.getCloverDir(), FileName) ) return false;
+  if ( EFI_ERROR(egLoadFile(&self.getCloverDir(), FileName.wc_str(), &Buffer, &BufferLen)) ) return false;
+  Image->setEmpty();
+  Image->ncpy(Buffer, BufferLen);
+  FreePool(Buffer);
+  return true;
+}
+
+void VBiosCache::SaveImage(const XStringW& FileName, const UINT8* Image, UINTN Size)
+{
+  EFI_STATUS Status = egSaveFile(&self.getCloverDir(), FileName.wc_str(), Image, Size);
+  if ( EFI_ERROR(Status) ) {
+    DBG("VBIOS cache: can't save %ls - %s\n", FileName.wc_str(), efiStrError(Status));
+  }
+}
+
+// Compares Size bytes at Offset of the cached image with the probe, or with the card beyond it
+static XBool VBiosCacheMatch(const XBuffer<UINT8>& Image, const UINT8* Probe, VBIOS_CACHE_READ Read, void* Context,
+                             UINTN Offset, UINTN Size)
+{
+  UINT8 Buffer[sizeof(PCI_DATA_STRUCTURE) + sizeof(PCI_EXPANSION_ROM_HEADER)];
+
+  if ( Offset + Size > Image.size() ) return false;
+  if ( Offset + Size <= VBIOS_CACHE_PROBE_SIZE ) return CompareMem(Image.data() + Offset, Probe + Offset, Size) == 0;
+  if ( Size > sizeof(Buffer) ) return false;
+  if ( EFI_ERROR(Read(Context, Offset, Size, Buffer)) ) return false;
+  return CompareMem(Image.data() + Offset, Buffer, Size) == 0;
+}
+
+// Checks the header, PCI data structure and last byte of every image of the cached ROM against the card
+static XBool VBiosCacheMatchImages(const XBuffer<UINT8>& Image, const UINT8* Probe, VBIOS_CACHE_READ Read, void* Context)
+{
+  UINTN Offset = 0;
+
+  for ( UINTN Count = 0 ; Count < 8  &&  Offset + sizeof(PCI_EXPANSION_ROM_HEADER) <= Image.size() ; Count++ ) {
+    const PCI_EXPANSION_ROM_HEADER* Header = (const PCI_EXPANSION_ROM_HEADER*)(Image.data() + Offset);
+    UINTN Length;
+    XBool Last;
+
+    if ( !VBiosCacheMatch(Image, Probe, Read, Context, Offset, sizeof(*Header)) ) return false;
+    if ( Header->Signature != PCI_EXPANSION_ROM_HEADER_SIGNATURE ) return Count > 0; // no more images
+    UINTN PcirOffset = Offset + Header->PcirOffset;
+    if ( Header->PcirOffset != 0  &&  PcirOffset + sizeof(PCI_DATA_STRUCTURE) <= Image.size()  &&
+         ((const PCI_DATA_STRUCTURE*)(Image.data() + PcirOffset))->Signature == PCI_DATA_STRUCTURE_SIGNATURE ) {
+      const PCI_DATA_STRUCTURE* Pcir = (const PCI_DATA_STRUCTURE*)(Image.data() + PcirOffset);
+      if ( !VBiosCacheMatch(Image, Probe, Read, Context, PcirOffset, sizeof(*Pcir)) ) return false;
+      Length = (UINTN)Pcir->ImageLength << 9;
+      Last = (Pcir->Indicator & 0x80) != 0;
+    } else {
+      // no PCI data structure : legacy size byte, and no way to find a next image
+      Length = (UINTN)Image[Offset + 2] << 9;
+      Last = true;
+    }
+    if ( Length == 0  ||  Offset + Length > Image.size() ) return Count > 0;
+    if ( !VBiosCacheMatch(Image, Probe, Read, Context, Offset + Length - 1, 1) ) return false;
+    if ( Last ) return true;
+    Offset += Length;
+  }
+  return true;
+}
+
+XBool VBiosCache::GetImage(const pci_dt_t* Dev, CONST CHAR8* Source, VBIOS_CACHE_READ Read, void* Context, UINT8* Rom, UINTN RomSize)
+{
+  UINT8          Probe[VBIOS_CACHE_PROBE_SIZE];
+  XBuffer<UINT8> Image;
+
+  if ( RomSize < VBIOS_CACHE_PROBE_SIZE ) return false;
+  if ( EFI_ERROR(Read(Context, 0, VBIOS_CACHE_PROBE_SIZE, Probe)) ) return false;
+  if ( Probe[0] != 0x55  ||  Probe[1] != 0xAA ) return false;
+  XStringW FileName = VBiosCacheFileName(Dev, Source);
+  if ( !LoadImage(FileName, &Image) ) return false;
+  if ( Image.size() != RomSize  ||
+       CompareMem(Image.data(), Probe, VBIOS_CACHE_PROBE_SIZE) != 0  ||
+       !VBiosCacheMatchImages(Image, Probe, Read, Context) ) {
+    DBG("VBIOS cache: %ls is outdated\n", FileName.wc_str());
+    return false;
+  }
+  CopyMem(Rom, Image.data(), RomSize);
+  DBG("VBIOS cache: using %ls\n", FileName.wc_str());
+  return true;
+}
+
+void VBiosCache::PutImage(const pci_dt_t* Dev, CONST CHAR8* Source, const UINT8* Rom, UINTN RomSize)
+{
+  if ( RomSize < VBIOS_CACHE_PROBE_SIZE  ||  Rom[0] != 0x55  ||  Rom[1] != 0xAA ) return;
+  SaveImage(VBiosCacheFileName(Dev, Source), Rom, RomSize);
+}
+
+static VBiosCache DefaultVBiosCache;
+VBiosCache* gVBiosCache = &DefaultVBiosCache;
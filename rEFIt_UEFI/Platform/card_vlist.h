@@ -10,6 +10,8 @@
 
 #include "../Platform/plist/plist.h"
 #include "../Platform/Settings.h"
+#include "../include/Pci.h"
+#include "../cpp_foundation/XBuffer.h"
 
 #define CARDLIST_SIGNATURE SIGNATURE_32('C','A','R','D')
 
@@ -20,6 +22,34 @@ FindCardWithIds (
   UINT32 SubId
   );
 
+//
+// Persistent cache of the video BIOS images read from the cards, in misc\vbios\ of the Clover dir,
+// so that the whole ROM is read through MMIO only when it changed.
+// A cached image is used if it has the size of the ROM and the card still has the same first
+// VBIOS_CACHE_PROBE_SIZE bytes and, for every image of the PCIR chain (legacy, EFI GOP...), the same
+// header, PCI data structure and last (checksum) byte. Other bytes of an image are not compared.
+//
+#define VBIOS_CACHE_PROBE_SIZE 0x200
+
+// Reads Size bytes at Offset of the ROM of the card
+typedef EFI_STATUS (*VBIOS_CACHE_READ)(void* Context, UINTN Offset, UINTN Size, UINT8* Buffer);
+
+class VBiosCache
+{
+public:
+  virtual ~VBiosCache() {}
+
+  virtual XBool LoadImage(const XStringW& FileName, XBuffer<UINT8>* Image);
+  virtual void SaveImage(const XStringW& FileName, const UINT8* Image, UINTN Size);
+
+  // Copies the cached image to Rom if the card, read through Read, still matches it
+  XBool GetImage(const pci_dt_t* Dev, CONST CHAR8* Source, VBIOS_CACHE_READ Read, void* Context, UINT8* Rom, UINTN RomSize);
+  // Remembers a valid image read from the card
+  void PutImage(const pci_dt_t* Dev, CONST CHAR8* Source, const UINT8* Rom, UINTN RomSize);
+};
+
+extern VBiosCache* gVBiosCache;
+
 //void
 //AddCard (
 //  CONST CHAR8 *Model,
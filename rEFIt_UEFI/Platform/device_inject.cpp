@@ -213,6 +213,7 @@ DevPropDevice *devprop_add_device_pci(DevPropString *StringBuf, pci_dt_t *PciDt,
 
   device->string = StringBuf;
   device->data = NULL;
+  device->data_allocated = 0;
 
 
   if(!StringBuf->entries) {
@@ -240,6 +241,14 @@ DevPropDevice *devprop_add_device_pci(DevPropString *StringBuf, pci_dt_t *PciDt,
 
 
 
+/*
+ * Records are appended in place to device->data, which grows geometrically.
+ * Layout of one record (unchanged) :
+ *   UINT32 name size in bytes (UTF-16 name + terminator + this field)
+ *   CHAR16 name[], CHAR16 0
+ *   UINT32 value size + 4
+ *   UINT8  value[]
+ */
 XBool devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, const UINT8 *vl, UINTN len)
 {
   UINT32 offset;
@@ -247,8 +256,8 @@ XBool devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, const UINT8 *vl,
   UINT32 length;
   UINT8 *data;
   UINTN i, l;
-  UINT32 *datalength;
-  UINT8 *newdata;
+  UINT32 needed;
+  UINT32 newAllocated;
 
   if(!device || !nm || !vl /*|| !len*/) //rehabman: allow zero length data
     return false;
@@ -259,9 +268,20 @@ XBool devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, const UINT8 *vl,
    DBG("\n"); */
   l = AsciiStrLen(nm);
   length = (UINT32)((l * 2) + len + (2 * sizeof(UINT32)) + 2);
-  data = (UINT8*)AllocateZeroPool(length);
-  if(!data)
-    return false;
+
+  offset = device->length - (24 + (6 * device->num_pci_devpaths));
+  needed = offset + length;
+  if (device->data == NULL || needed > device->data_allocated) {
+    newAllocated = device->data_allocated < 256 ? 256 : device->data_allocated;
+    while (newAllocated < needed) newAllocated *= 2;
+    data = (UINT8*)ReallocatePool(device->data_allocated, newAllocated, device->data);
+    if(!data)
+      return false;
+    device->data = data;
+    device->data_allocated = newAllocated;
+  }
+  data = device->data + offset;
+  ZeroMem(data, length);
 
   off= 0;
 
@@ -276,32 +296,14 @@ XBool devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, const UINT8 *vl,
 
   off += 2;
   l = len;
-  datalength = (UINT32*)&data[off];
-  *datalength = (UINT32)(l + 4);
+  *(UINT32*)&data[off] = (UINT32)(l + 4);
   off += 4;
-  for(i = 0 ; i < l ; i++, off++) {
-    data[off] = *vl++;
-  }
-
-  offset = device->length - (24 + (6 * device->num_pci_devpaths));
-
-  newdata = (UINT8*)AllocateZeroPool((length + offset));
-  if(!newdata) {
-    FreePool(data);
-    return false;
-  }
-  if((device->data) && (offset > 1)) {
- 		CopyMem((void*)newdata, (void*)device->data, offset);
-  }
-
-  CopyMem((void*)(newdata + offset), (void*)data, length);
+  CopyMem(&data[off], vl, l);
 
   device->length += length;
   device->string->length += length;
   device->numentries++;
-  device->data = newdata;
 
-  FreePool(data);
   return true;
 }
 
@@ -310,45 +312,60 @@ XBool devprop_add_value(DevPropDevice *device, const XString8& nm, const XBuffer
   return devprop_add_value(device, nm.data(), vl.data(), vl.size());
 }
 
-XBuffer<char> devprop_generate_string(DevPropString *StringBuf)
+// Most significant byte first, the same bytes as the former "%0nX" hex fields
+static void devprop_cat_be(XBuffer<uint8_t>& buffer, UINT32 value, UINTN nbBytes)
 {
-  UINTN len = StringBuf->length * 2;
-
-  XBuffer<char> buffer;
-  buffer.dataSized(len+1);
+  while ( nbBytes > 0 ) {
+    nbBytes--;
+    buffer.cat((uint8_t)(value >> (nbBytes * 8)));
+  }
+}
 
-//  DbgHeader("Devprop Generate String");
+XBuffer<uint8_t> devprop_generate_binary(DevPropString *StringBuf)
+{
+  XBuffer<uint8_t> buffer;
+  buffer.dataSized(StringBuf->length);
 
-  buffer.S8Catf("%08X%08X%04hX%04hX", SwapBytes32(StringBuf->length), StringBuf->WHAT2, SwapBytes16(StringBuf->numentries), StringBuf->WHAT3);
+  devprop_cat_be(buffer, SwapBytes32(StringBuf->length), 4);
+  devprop_cat_be(buffer, StringBuf->WHAT2, 4);
+  devprop_cat_be(buffer, SwapBytes16(StringBuf->numentries), 2);
+  devprop_cat_be(buffer, StringBuf->WHAT3, 2);
   for (int i = 0; i < StringBuf->numentries; i++) {
-    UINT8 *dataptr = StringBuf->entries[i]->data;
-    if (!dataptr) continue;
-    buffer.S8Catf("%08X%04hX%04hX", SwapBytes32(StringBuf->entries[i]->length),
-                SwapBytes16(StringBuf->entries[i]->numentries), StringBuf->entries[i]->WHAT2); //FIXME: wrong buffer sizes!
-
-    buffer.S8Catf("%02hhX%02hhX%04hX%08X%08X", StringBuf->entries[i]->acpi_dev_path.type,
-                StringBuf->entries[i]->acpi_dev_path.subtype,
-                SwapBytes16(StringBuf->entries[i]->acpi_dev_path.length),
-                SwapBytes32(StringBuf->entries[i]->acpi_dev_path._HID),
-                SwapBytes32(StringBuf->entries[i]->acpi_dev_path._UID));
-
-    for(int x = 0; x < StringBuf->entries[i]->num_pci_devpaths; x++) {
-      buffer.S8Catf("%02hhX%02hhX%04hX%02hhX%02hhX", StringBuf->entries[i]->pci_dev_path[x].type,
-                  StringBuf->entries[i]->pci_dev_path[x].subtype,
-                  SwapBytes16(StringBuf->entries[i]->pci_dev_path[x].length),
-                  StringBuf->entries[i]->pci_dev_path[x].function,
-                  StringBuf->entries[i]->pci_dev_path[x].device);
+    DevPropDevice *device = StringBuf->entries[i];
+    if (!device->data) continue;
+    devprop_cat_be(buffer, SwapBytes32(device->length), 4);
+    devprop_cat_be(buffer, SwapBytes16(device->numentries), 2);
+    devprop_cat_be(buffer, device->WHAT2, 2); //FIXME: wrong buffer sizes!
+
+    devprop_cat_be(buffer, device->acpi_dev_path.type, 1);
+    devprop_cat_be(buffer, device->acpi_dev_path.subtype, 1);
+    devprop_cat_be(buffer, SwapBytes16(device->acpi_dev_path.length), 2);
+    devprop_cat_be(buffer, SwapBytes32(device->acpi_dev_path._HID), 4);
+    devprop_cat_be(buffer, SwapBytes32(device->acpi_dev_path._UID), 4);
+
+    for(int x = 0; x < device->num_pci_devpaths; x++) {
+      devprop_cat_be(buffer, device->pci_dev_path[x].type, 1);
+      devprop_cat_be(buffer, device->pci_dev_path[x].subtype, 1);
+      devprop_cat_be(buffer, SwapBytes16(device->pci_dev_path[x].length), 2);
+      devprop_cat_be(buffer, device->pci_dev_path[x].function, 1);
+      devprop_cat_be(buffer, device->pci_dev_path[x].device, 1);
     }
 
-    buffer.S8Catf("%02hhX%02hhX%04hX", StringBuf->entries[i]->path_end.type,
-                StringBuf->entries[i]->path_end.subtype,
-                SwapBytes16(StringBuf->entries[i]->path_end.length));
-
-    for(UINT32 x = 0; x < (StringBuf->entries[i]->length) - (24 + (6 * StringBuf->entries[i]->num_pci_devpaths)); x++) {
-      buffer.S8Catf("%02hhX", *dataptr++);
-    }
+    devprop_cat_be(buffer, device->path_end.type, 1);
+    devprop_cat_be(buffer, device->path_end.subtype, 1);
+    devprop_cat_be(buffer, SwapBytes16(device->path_end.length), 2);
 
+    buffer.ncat(device->data, device->length - (24 + (6 * device->num_pci_devpaths)));
   }
+  return buffer;
+}
+
+XBuffer<char> devprop_generate_string(DevPropString *StringBuf)
+{
+  XBuffer<uint8_t> binary = devprop_generate_binary(StringBuf);
+  XBuffer<char> buffer;
+  buffer.dataSized(binary.size() * 2 + 1);
+  bin2hex(binary.data(), binary.size(), &buffer);
 //  DBG("string=%s\n", buffer.data());
   return buffer;
 }
@@ -365,6 +382,7 @@ void devprop_free_string()
       if(device_inject_string->entries[i]->data) {
         FreePool(device_inject_string->entries[i]->data);
       }
+      FreePool(device_inject_string->entries[i]);
     }
   }
   FreePool(device_inject_string->entries);
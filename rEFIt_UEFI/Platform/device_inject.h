@@ -93,6 +93,7 @@ struct DevPropDevice {
 
 	// ------------------------
 	UINT8	 num_pci_devpaths;
+	UINT32 data_allocated;								// allocated size of data, >= length - (24 + 6 * num_pci_devpaths)
 	struct DevPropString *string;
 	// ------------------------
 };
@@ -122,7 +123,8 @@ DevPropString	*devprop_create_string(void);
 DevPropDevice	*devprop_add_device_pci(DevPropString *string, pci_dt_t *PciDt, EFI_DEVICE_PATH_PROTOCOL *DevicePath);
 XBool			devprop_add_value(DevPropDevice *device, CONST CHAR8 *nm, const UINT8 *vl, UINTN len); // to be removed
 XBool     devprop_add_value(DevPropDevice *device, const XString8& nm, const XBuffer<uint8_t>& vl);
-XBuffer<char> devprop_generate_string(DevPropString *string);
+XBuffer<uint8_t> devprop_generate_binary(DevPropString *string); // EFI_DEVICE_PATH_PROPERTY_DATABASE payload
+XBuffer<char> devprop_generate_string(DevPropString *string); // same, hex encoded
 void		    devprop_free_string();
 
 XBool set_eth_props(pci_dt_t *eth_dev);
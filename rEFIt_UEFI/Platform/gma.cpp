@@ -88,7 +88,6 @@
 
 CONST CHAR16  *CFLFBPath  = L"/System/Library/Extensions/AppleIntelCFLGraphicsFramebuffer.kext";
 
-extern CHAR8*    gDeviceProperties;
 CONST UINT8 ClassFix[] =  { 0x00, 0x00, 0x03, 0x00 };
 
 
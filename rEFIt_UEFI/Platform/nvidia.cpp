@@ -1687,6 +1687,41 @@ static nvidia_card_info_t nvidia_card_exceptions[] = {
 };
 #endif
 
+typedef struct {
+  EFI_PCI_IO_PROTOCOL *PciIo;
+  UINT64              Offset;
+} NV_ROM_READ_CONTEXT;
+
+static EFI_STATUS read_nVidia_ROM_bytes(void *Context, UINTN Offset, UINTN Size, UINT8 *Buffer)
+{
+  NV_ROM_READ_CONTEXT *Rom = (NV_ROM_READ_CONTEXT *)Context;
+  return Rom->PciIo->Mem.Read(Rom->PciIo, EfiPciIoWidthUint8, 0, Rom->Offset + Offset, Size, Buffer);
+}
+
+// Reads the ROM at Offset of BAR0, unless the card still has the image cached by a previous boot
+static EFI_STATUS read_nVidia_ROM_cached(pci_dt_t *nvda_dev, EFI_PCI_IO_PROTOCOL *PciIo, UINT64 Offset, CONST CHAR8 *Source, UINT8 *rom)
+{
+  EFI_STATUS          Status;
+  NV_ROM_READ_CONTEXT Context = { PciIo, Offset };
+
+  if (gVBiosCache->GetImage(nvda_dev, Source, read_nVidia_ROM_bytes, &Context, rom, NVIDIA_ROM_SIZE)) {
+    return EFI_SUCCESS;
+  }
+
+  Status = PciIo->Mem.Read(
+                           PciIo,
+                           EfiPciIoWidthUint8,
+                           0,
+                           Offset,
+                           NVIDIA_ROM_SIZE,
+                           rom
+                           );
+  if (!EFI_ERROR(Status)) {
+    gVBiosCache->PutImage(nvda_dev, Source, rom, NVIDIA_ROM_SIZE);
+  }
+  return Status;
+}
+
 EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch)
 {
   EFI_STATUS Status;
@@ -1744,14 +1779,7 @@ EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch)
                                   );
   }
 
-  Status = PciIo->Mem.Read(
-                           PciIo,
-                           EfiPciIoWidthUint8,
-                           0,
-                           NV_PRAMIN_OFFSET,
-                           NVIDIA_ROM_SIZE,
-                           rom
-                           );
+  Status = read_nVidia_ROM_cached(nvda_dev, PciIo, NV_PRAMIN_OFFSET, "pramin", (UINT8*)rom);
 
   if (arch >= 0x50) {
     /*Status = */PciIo->Mem.Write(
@@ -1809,14 +1837,7 @@ EFI_STATUS read_nVidia_PROM(pci_dt_t *nvda_dev, void* rom)
                                 &value
                                 );
 
-  Status = PciIo->Mem.Read(
-                           PciIo,
-                           EfiPciIoWidthUint8,
-                           0,
-                           NV_PROM_OFFSET,
-                           NVIDIA_ROM_SIZE,
-                           rom
-                           );
+  Status = read_nVidia_ROM_cached(nvda_dev, PciIo, NV_PROM_OFFSET, "prom", (UINT8*)rom);
 
   value = NV_PBUS_PCI_NV_20_ROM_SHADOW_ENABLED;
   /*Status = */PciIo->Mem.Write(
@@ -54,7 +54,6 @@
 //#include "card_vlist.h"
 #include "../include/Pci.h"
 
-extern CHAR8* gDeviceProperties;
   
 //XBool setup_nvidia_devprop(pci_dt_t *nvda_dev);
 
@@ -187,4 +186,7 @@ setup_nvidia_devprop (
 
 CONST CHAR8* get_nvidia_model(UINT32 device_id, UINT32 subsys_id);
 
+EFI_STATUS read_nVidia_PRAMIN(pci_dt_t *nvda_dev, void* rom, UINT16 arch);
+EFI_STATUS read_nVidia_PROM(pci_dt_t *nvda_dev, void* rom);
+
 #endif /* !__LIBSAIO_NVIDIA_H */
@@ -1020,8 +1020,12 @@ void ConfigManager::GetUEFIMacAddress()
 
 EFI_STATUS ConfigManager::ReLoadConfig(const XStringW& ConfName)
 {
-  /* I'm pretty sure, one day, there will be other things to do than just LoadConfig */
-  return LoadConfig(ConfName);
+  EFI_STATUS Status = LoadConfig(ConfName);
+#ifdef ENABLE_SECURE_BOOT
+  // The secure boot lists are matched from what was compiled out of the previous settings
+  ReloadSecureBootLists();
+#endif // ENABLE_SECURE_BOOT
+  return Status;
 }
 
 EFI_STATUS ConfigManager::InitialisePlatform()
@@ -45,12 +45,14 @@ class XString8 : public XStringAbstract<char, XString8, LString8>
   public:
 	XString8() : XStringAbstract<char, XString8, LString8>() {};
 	XString8(const XString8& S) : XStringAbstract<char, XString8, LString8>(S) {}
+	XString8(XString8&& S) : XStringAbstract<char, XString8, LString8>(static_cast<XStringAbstract<char, XString8, LString8>&&>(S)) {}
 	XString8(const LString8& S) : XStringAbstract<char, XString8, LString8>(S) { }
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString8(const OtherXStringClass& S) : XStringAbstract<char, XString8, LString8>(S) {}
 
 	XString8& operator=(const XString8 &S) { this->XStringAbstract<char, XString8, LString8>::operator=(S); return *this; }
+	XString8& operator=(XString8 &&S) { stealValueFrom(&S); return *this; }
 
 	using XStringAbstract<char, XString8, LString8>::operator =;
 
@@ -109,12 +111,14 @@ class XString16 : public XStringAbstract<char16_t, XString16, LString16>
   public:
 	XString16() : XStringAbstract<char16_t, XString16, LString16>() {};
   XString16(const XString16& S) : XStringAbstract<char16_t, XString16, LString16>(S) {}
+  XString16(XString16&& S) : XStringAbstract<char16_t, XString16, LString16>(static_cast<XStringAbstract<char16_t, XString16, LString16>&&>(S)) {}
   XString16(const LString16& S) : XStringAbstract<char16_t, XString16, LString16>(S) {}
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString16(const OtherXStringClass& S) : XStringAbstract<char16_t, XString16, LString16>(S) {}
 
 	XString16& operator=(const XString16 &S) { this->XStringAbstract<char16_t, XString16, LString16>::operator=(S); return *this; }
+	XString16& operator=(XString16 &&S) { stealValueFrom(&S); return *this; }
 
 	using XStringAbstract<char16_t, XString16, LString16>::operator =;
 
@@ -140,12 +144,14 @@ class XString32 : public XStringAbstract<char32_t, XString32, LString32>
   public:
 	XString32() : XStringAbstract<char32_t, XString32 ,LString32>() {};
   XString32(const XString32& S) : XStringAbstract<char32_t, XString32 ,LString32>(S) {}
+  XString32(XString32&& S) : XStringAbstract<char32_t, XString32 ,LString32>(static_cast<XStringAbstract<char32_t, XString32 ,LString32>&&>(S)) {}
   XString32(const LString32& S) : XStringAbstract<char32_t, XString32 ,LString32>(S) {}
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
 	XString32(const OtherXStringClass& S) : XStringAbstract<char32_t, XString32, LString32>(S) {}
 
 	XString32& operator=(const XString32 &S) { this->XStringAbstract<char32_t, XString32 ,LString32>::operator=(S); return *this; }
+	XString32& operator=(XString32 &&S) { stealValueFrom(&S); return *this; }
 	
 	using XStringAbstract<char32_t, XString32 ,LString32>::operator =;
 
@@ -177,6 +183,7 @@ class XStringW : public XStringAbstract<wchar_t, XStringW, LStringW>
 public:
 	XStringW() : XStringAbstract<wchar_t, XStringW, LStringW>() {};
 	XStringW(const XStringW& S) : XStringAbstract<wchar_t, XStringW, LStringW>(S) {}
+	XStringW(XStringW&& S) : XStringAbstract<wchar_t, XStringW, LStringW>(static_cast<XStringAbstract<wchar_t, XStringW, LStringW>&&>(S)) {}
   XStringW(const LStringW& S) : XStringAbstract<wchar_t, XStringW, LStringW>(S) { }
 
 	template<class OtherXStringClass, enable_if( is___String(OtherXStringClass) && !is___LString(OtherXStringClass))> // enable_if is to avoid constructing with a non-corresponding LString. To avoid memory allocation.
@@ -184,6 +191,7 @@ public:
 	
 
 	XStringW& operator=(const XStringW &S) { this->XStringAbstract<wchar_t, XStringW, LStringW>::operator=(S); return *this; }
+	XStringW& operator=(XStringW &&S) { stealValueFrom(&S); return *this; }
 
 	using XStringAbstract<wchar_t, XStringW, LStringW>::operator =;
 
@@ -226,6 +234,53 @@ public:
 };
 
 
+//------------------------------------------------------------------------------------------------------------------
+/*
+ * Views : non-owning, never allocate. Can be built at runtime from a char pointer or any XString/LString of the same
+ * char type, and can be passed to everything that takes a __String (isEqual, contains, startWith, pathCat, + ...).
+ * The viewed buffer must outlive the view. Building a XString8/XStringW from a view copies the data.
+ */
+class XStringView : public __String<char, XString8, LString8>
+{
+  public:
+  #ifdef XSTRING_CACHING_OF_SIZE
+    XStringView(const char* s = nullptr) : __String<char, XString8, LString8>(s ? s : "", s ? utf8_size_of_utf8_string(s) : 0) {};
+    XStringView(const XString8& S) : __String<char, XString8, LString8>(S.s(), S.size()) {};
+    XStringView(const LString8& S) : __String<char, XString8, LString8>(S.s(), S.size()) {};
+    XStringView(const XStringView& V) : __String<char, XString8, LString8>(V.s(), V.size()) {};
+    XStringView& operator=(const XStringView& V) { __m_data = (char*)V.s(); __m_size = V.size(); return *this; }
+  #else
+    XStringView(const char* s = nullptr) : __String<char, XString8, LString8>(s ? s : "") {};
+    XStringView(const XString8& S) : __String<char, XString8, LString8>(S.s()) {};
+    XStringView(const LString8& S) : __String<char, XString8, LString8>(S.s()) {};
+    XStringView(const XStringView& V) : __String<char, XString8, LString8>(V.s()) {};
+    XStringView& operator=(const XStringView& V) { __m_data = (char*)V.s(); return *this; }
+  #endif
+
+  const char* c_str() const { return data(); }
+};
+
+class XStringWView : public __String<wchar_t, XStringW, LStringW>
+{
+  public:
+  #ifdef XSTRING_CACHING_OF_SIZE
+    XStringWView(const wchar_t* s = nullptr) : __String<wchar_t, XStringW, LStringW>(s ? s : L"", s ? wchar_size_of_wchar_string(s) : 0) {};
+    XStringWView(const XStringW& S) : __String<wchar_t, XStringW, LStringW>(S.s(), S.size()) {};
+    XStringWView(const LStringW& S) : __String<wchar_t, XStringW, LStringW>(S.s(), S.size()) {};
+    XStringWView(const XStringWView& V) : __String<wchar_t, XStringW, LStringW>(V.s(), V.size()) {};
+    XStringWView& operator=(const XStringWView& V) { __m_data = (wchar_t*)V.s(); __m_size = V.size(); return *this; }
+  #else
+    XStringWView(const wchar_t* s = nullptr) : __String<wchar_t, XStringW, LStringW>(s ? s : L"") {};
+    XStringWView(const XStringW& S) : __String<wchar_t, XStringW, LStringW>(S.s()) {};
+    XStringWView(const LStringW& S) : __String<wchar_t, XStringW, LStringW>(S.s()) {};
+    XStringWView(const XStringWView& V) : __String<wchar_t, XStringW, LStringW>(V.s()) {};
+    XStringWView& operator=(const XStringWView& V) { __m_data = (wchar_t*)V.s(); return *this; }
+  #endif
+
+  const wchar_t* wc_str() const { return data(); }
+};
+
+
 constexpr LString8 operator ""_XS8 ( const char* s, size_t len);
 constexpr LString16 operator ""_XS16 ( const char16_t* s, size_t len);
 constexpr LString32 operator ""_XS32 ( const char32_t* s, size_t len);
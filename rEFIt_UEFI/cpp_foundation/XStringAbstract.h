@@ -925,6 +925,8 @@ public:
 
 protected:
   static T nullChar;
+  static size_t heapAllocations; // number of AllocatePool/ReallocatePool done
+                                 // by this string class. For unit tests.
   size_t m_allocatedSize; // Must include null terminator. Real memory allocated
                           // is only m_allocatedSize (not m_allocatedSize+1)
 
@@ -932,6 +934,15 @@ protected:
   //  Init , Alloc
   // xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx
 
+  /*
+   * Free the heap buffer, if any. Literals are not freed.
+   * Doesn't reset __m_data or m_allocatedSize.
+   */
+  void freeData() {
+    if (m_allocatedSize > 0)
+      delete super::__m_data;
+  }
+
   /*
    * nNewSize must include null terminator.
    */
@@ -945,6 +956,7 @@ protected:
 		super::__m_data = (T*)ReallocatePool( m_allocatedSize * sizeof(T),
 			 nNewAllocatedSize * sizeof(T), super::__m_data);
     }
+    heapAllocations += 1;
     if (!super::__m_data) {
       log_technical_bug("XStringAbstract::Alloc(%zu) : Xrealloc(%" PRIuPTR
                         ", %lu, %zd) returned NULL. System halted\n",
@@ -1014,10 +1026,23 @@ public:
     *this = S;
   }
 
+  /* move ctor */
+#ifdef XSTRING_CACHING_OF_SIZE
+  XStringAbstract(XStringAbstract &&S)
+      : __String<T, ThisXStringClass, ThisLStringClass>(&nullChar, 0),
+        m_allocatedSize(0)
+#else
+  XStringAbstract(XStringAbstract &&S)
+      : __String<T, ThisXStringClass, ThisLStringClass>(&nullChar),
+        m_allocatedSize(0)
+#endif
+  {
+    stealValueFrom((ThisXStringClass *)&S);
+  }
+
     ~XStringAbstract() {
         // DBG_XSTRING("Destructor :%ls\n", data());
-        if (m_allocatedSize > 0)
-            delete super::__m_data;
+        freeData();
     }
 
 #ifdef XSTRING_CACHING_OF_SIZE
@@ -1038,6 +1063,12 @@ public:
       : __String<T, ThisXStringClass>(&nullChar), m_allocatedSize(0) {
     takeValueFrom(S);
   }
+  template <typename O, class OtherXStringClass>
+  explicit XStringAbstract<T, ThisXStringClass>(
+      const __String<O, OtherXStringClass> &S)
+      : __String<T, ThisXStringClass>(&nullChar, 0), m_allocatedSize(0) {
+    takeValueFrom(S);
+  }
 // TEMPORARILY DISABLED
 //	template<typename O>
 //	explicit __String<T, ThisXStringClass>(const O* S) { Init(0);
@@ -1076,6 +1107,15 @@ public:
         m_allocatedSize(0) {
     takeValueFrom(S);
   }
+  // From a view (or any other __String that is not an XString or a LString).
+  // Always copy, as a view doesn't own its data.
+  template <typename O, class OtherXStringClass>
+  explicit XStringAbstract(
+      const __String<O, OtherXStringClass, typename OtherXStringClass::ls_t> &S)
+      : __String<T, ThisXStringClass, ThisLStringClass>(&nullChar),
+        m_allocatedSize(0) {
+    takeValueFrom(S);
+  }
 
 //  TEMPORARILY DISABLED
 //	template<typename O>
@@ -1087,10 +1127,8 @@ public:
   XStringAbstract &operator=(const XStringAbstract &S) {
     if (S.data() && S.m_allocatedSize == 0) {
       // S points to a litteral
-      if (m_allocatedSize > 0) {
-        delete super::__m_data;
-        m_allocatedSize = 0;
-      }
+      freeData();
+      m_allocatedSize = 0;
       super::__m_data =
           (T *)S.data(); // because it's a litteral, we don't copy. We need to
                          // cast, but we won't modify.
@@ -1105,10 +1143,8 @@ public:
 
   /* Copy Assign */
   XStringAbstract &operator=(const ls_t &S) {
-    if (m_allocatedSize > 0) {
-      delete super::__m_data;
-      m_allocatedSize = 0;
-    }
+    freeData();
+    m_allocatedSize = 0;
     super::__m_data = (T *)S.data(); // because it's a litteral, we don't copy.
                                      // We need to cast, but we won't modify.
 #ifdef XSTRING_CACHING_OF_SIZE
@@ -1154,6 +1190,7 @@ protected:
 
 public:
   size_t allocatedSize() const { return m_allocatedSize; }
+  static size_t heapAllocationCount() { return heapAllocations; }
 
   void setEmpty() {
     if (m_allocatedSize <= 0)
@@ -1630,8 +1667,7 @@ public:
 
   /* size is in number of technical chars, NOT in bytes */
   ThisXStringClass &stealValueFrom(T *S, size_t allocatedSize) {
-    if (m_allocatedSize > 0)
-      delete super::__m_data;
+    freeData();
     super::__m_data = S;
 #ifdef XSTRING_CACHING_OF_SIZE
     super::__m_size = utf_size_of_utf_string(super::__m_data, super::__m_data);
@@ -1643,8 +1679,7 @@ public:
   // Not sure we should keep that. We cannot know the allocated size. Therefore,
   // a future realloc may fail as EDK want the old size.
   ThisXStringClass &stealValueFrom(T *S) {
-    if (m_allocatedSize > 0)
-      delete super::__m_data;
+    freeData();
     super::__m_data = S;
 #ifdef XSTRING_CACHING_OF_SIZE
     super::__m_size = utf_size_of_utf_string(super::__m_data, super::__m_data);
@@ -1656,8 +1691,9 @@ public:
   }
 
   ThisXStringClass &stealValueFrom(ThisXStringClass *S) {
-    if (m_allocatedSize > 0)
-      delete super::__m_data;
+    if (S == this)
+      return *((ThisXStringClass *)this);
+    freeData();
 #ifdef XSTRING_CACHING_OF_SIZE
     super::__m_size = S->size();
 #endif
@@ -1665,6 +1701,12 @@ public:
     // do not use forgetDataWithoutFreeing() : it will allocate m_data if m_data
     // points to a literal. We want to keep the literal and avoid an allocation
     super::__m_data = S->super::__m_data;
+    // S doesn't own the buffer anymore.
+    S->super::__m_data = &nullChar;
+    S->m_allocatedSize = 0;
+#ifdef XSTRING_CACHING_OF_SIZE
+    S->super::__m_size = 0;
+#endif
     return *((ThisXStringClass *)this);
   }
 
@@ -1712,11 +1754,44 @@ public:
     strcat(S);
     return *((ThisXStringClass *)this);
   }
+
+  //---------------------------------------------------------------------
+  //pathCat
+
+  /*
+   * Append a path component, with exactly one '\\' between the current path
+   * and the component. No temporary string is created.
+   */
+  template <typename O> ThisXStringClass &pathCat(const O *component) {
+    if (!component || !*component)
+      return *((ThisXStringClass *)this);
+    size_t currentSize = super::size();
+    bool endsWithSep =
+        currentSize > 0 && (super::__m_data[currentSize - 1] == '\\' ||
+                            super::__m_data[currentSize - 1] == '/');
+    bool startsWithSep = *component == '\\' || *component == '/';
+    if (endsWithSep && startsWithSep)
+      component += 1;
+    else if (currentSize > 0 && !endsWithSep && !startsWithSep)
+      strcat("\\");
+    strcat(component);
+    return *((ThisXStringClass *)this);
+  }
+  template <typename O, class OtherXStringClass>
+  ThisXStringClass &
+  pathCat(const __String<O, OtherXStringClass,
+                         typename OtherXStringClass::ls_t> &component) {
+    return pathCat(component.s());
+  }
 };
 
 template <class T, class ThisXStringClass, class ThisLStringClass>
 T XStringAbstract<T, ThisXStringClass, ThisLStringClass>::nullChar = 0;
 
+template <class T, class ThisXStringClass, class ThisLStringClass>
+size_t XStringAbstract<T, ThisXStringClass,
+                       ThisLStringClass>::heapAllocations = 0;
+
 //------------------------------------------------------- + operator
 
 template <typename T1, typename T2,
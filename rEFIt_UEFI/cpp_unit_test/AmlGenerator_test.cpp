@@ -0,0 +1,118 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/AmlGenerator.h"
+#include "AmlGenerator_test.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static const UINT8 amlTestHeader[] = {
+  0x53, 0x53, 0x44, 0x54, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x50, 0x6D, 0x52, 0x65, 0x66, 0x00,
+  0x43, 0x70, 0x75, 0x50, 0x6D, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x49, 0x4E, 0x54, 0x4C,
+  0x20, 0x03, 0x12, 0x20
+};
+static const UINT8 amlTestFixedHW[] = {
+  0x11, 0x14, 0x0A, 0x11, 0x82, 0x0C, 0x00, 0x7F, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x01, 0x79, 0x00
+};
+
+// Same shape as generate_pss_ssdt() and generate_cst_ssdt() output for one CPU
+static AML_CHUNK* aml_test_build_tree(UINT32 nbPStates)
+{
+  CHAR8 cpuName[] = "\\_PR_.CPU0";
+  AML_CHUNK* root = aml_create_node(NULL);
+  aml_add_buffer(root, amlTestHeader, sizeof(amlTestHeader));
+  AML_CHUNK* scop = aml_add_scope(root, cpuName);
+  AML_CHUNK* name = aml_add_name(scop, "PSS_");
+  AML_CHUNK* pack = aml_add_package(name);
+  for (UINT32 i = 0; i < nbPStates; i++) {
+    AML_CHUNK* pstt = aml_add_package(pack);
+    aml_add_dword(pstt, 3400 - i * 100);
+    aml_add_dword(pstt, 0);
+    aml_add_dword(pstt, 0x0000000A);
+    aml_add_dword(pstt, 0x0000000A);
+    aml_add_dword(pstt, (34 - i) << 8);
+    aml_add_dword(pstt, (34 - i) << 8);
+  }
+  AML_CHUNK* met = aml_add_method(scop, "_PSS", 0);
+  aml_add_return_name(met, "PSS_");
+  aml_add_name(scop, "_PPC");
+  aml_add_byte(scop, 0);
+  name = aml_add_name(scop, "CST_");
+  pack = aml_add_package(name);
+  aml_add_byte(pack, 2);
+  AML_CHUNK* tmpl = aml_add_package(pack);
+  aml_add_buffer(tmpl, amlTestFixedHW, sizeof(amlTestFixedHW));
+  aml_add_byte(tmpl, 0x01);
+  aml_add_word(tmpl, 0x0001);
+  aml_add_dword(tmpl, 0x000003e8);
+  tmpl = aml_add_package(pack);
+  aml_add_buffer(tmpl, amlTestFixedHW, sizeof(amlTestFixedHW));
+  aml_add_byte(tmpl, 0x07);
+  aml_add_word(tmpl, 0xF5);
+  aml_add_dword(tmpl, 0xC8);
+  met = aml_add_method(scop, "_CST", 0);
+  aml_add_return_name(met, "CST_");
+  return root;
+}
+
+// Output of the former two pass generator (aml_calculate_size + aml_write_node) for aml_test_build_tree(4)
+static const UINT8 expectedAml[] = {
+  0x53, 0x53, 0x44, 0x54, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x50, 0x6D, 0x52, 0x65, 0x66, 0x00,
+  0x43, 0x70, 0x75, 0x50, 0x6D, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x49, 0x4E, 0x54, 0x4C,
+  0x20, 0x03, 0x12, 0x20, 0x10, 0x4B, 0x0F, 0x08, 0x50, 0x53, 0x53, 0x5F, 0x12, 0x47, 0x08, 0x04,
+  0x12, 0x20, 0x06, 0x0C, 0x48, 0x0D, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0A, 0x00,
+  0x00, 0x00, 0x0C, 0x0A, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x22, 0x00, 0x00, 0x0C, 0x00, 0x22, 0x00,
+  0x00, 0x12, 0x20, 0x06, 0x0C, 0xE4, 0x0C, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0A,
+  0x00, 0x00, 0x00, 0x0C, 0x0A, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x21, 0x00, 0x00, 0x0C, 0x00, 0x21,
+  0x00, 0x00, 0x12, 0x20, 0x06, 0x0C, 0x80, 0x0C, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x0C,
+  0x0A, 0x00, 0x00, 0x00, 0x0C, 0x0A, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x20, 0x00, 0x00, 0x0C, 0x00,
+  0x20, 0x00, 0x00, 0x12, 0x20, 0x06, 0x0C, 0x1C, 0x0C, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0x00,
+  0x0C, 0x0A, 0x00, 0x00, 0x00, 0x0C, 0x0A, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x1F, 0x00, 0x00, 0x0C,
+  0x00, 0x1F, 0x00, 0x00, 0x14, 0x0B, 0x5F, 0x50, 0x53, 0x53, 0x00, 0xA4, 0x50, 0x53, 0x53, 0x5F,
+  0x08, 0x5F, 0x50, 0x50, 0x43, 0x00, 0x08, 0x43, 0x53, 0x54, 0x5F, 0x12, 0x48, 0x04, 0x03, 0x0A,
+  0x02, 0x12, 0x20, 0x04, 0x11, 0x14, 0x0A, 0x11, 0x82, 0x0C, 0x00, 0x7F, 0x01, 0x02, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x79, 0x00, 0x01, 0x0B, 0x01, 0x00, 0x0C, 0xE8, 0x03,
+  0x00, 0x00, 0x12, 0x21, 0x04, 0x11, 0x14, 0x0A, 0x11, 0x82, 0x0C, 0x00, 0x7F, 0x01, 0x02, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x79, 0x00, 0x0A, 0x07, 0x0B, 0xF5, 0x00, 0x0C,
+  0xC8, 0x00, 0x00, 0x00, 0x14, 0x0B, 0x5F, 0x43, 0x53, 0x54, 0x00, 0xA4, 0x43, 0x53, 0x54, 0x5F
+};
+
+int AmlGenerator_tests()
+{
+  {
+    UINT32 size;
+    AML_CHUNK* root = aml_test_build_tree(4);
+    CHAR8* aml = aml_generate(root, &size);
+    if ( aml == NULL ) return breakpoint(1);
+    if ( size != sizeof(expectedAml) ) return breakpoint(2);
+    if ( memcmp(aml, expectedAml, sizeof(expectedAml)) != 0 ) return breakpoint(3);
+    FreePool(aml);
+
+    // the two pass API still gives the same bytes
+    aml_calculate_size(root);
+    if ( root->Size != sizeof(expectedAml) ) return breakpoint(4);
+    aml = (CHAR8*)AllocateZeroPool(root->Size);
+    aml_write_node(root, aml, 0);
+    if ( memcmp(aml, expectedAml, sizeof(expectedAml)) != 0 ) return breakpoint(5);
+    FreePool(aml);
+    aml_destroy_node(root);
+  }
+  {
+    // PSS_ package bigger than 0xfff : 3 bytes package length
+    UINT32 size;
+    AML_CHUNK* root = aml_test_build_tree(130);
+    CHAR8* aml = aml_generate(root, &size);
+    if ( aml == NULL ) return breakpoint(10);
+    aml_calculate_size(root);
+    if ( root->Size != size ) return breakpoint(11);
+    CHAR8* aml2 = (CHAR8*)AllocateZeroPool(root->Size);
+    aml_write_node(root, aml2, 0);
+    if ( memcmp(aml, aml2, size) != 0 ) return breakpoint(12);
+    FreePool(aml);
+    FreePool(aml2);
+    aml_destroy_node(root);
+  }
+  return 0;
+}
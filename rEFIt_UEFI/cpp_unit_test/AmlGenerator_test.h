@@ -0,0 +1 @@
+int AmlGenerator_tests();
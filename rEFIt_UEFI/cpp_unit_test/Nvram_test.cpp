@@ -0,0 +1,239 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/Nvram.h"
+#include "Nvram_test.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+//
+// In-memory variable store behind a copy of gRT, counting every call
+//
+class MockVariable
+{
+public:
+  EFI_GUID        Guid = EFI_GUID();
+  XStringW        Name = XStringW();
+  UINT32          Attributes = 0;
+  XBuffer<UINT8>  Data = XBuffer<UINT8>();
+};
+
+static XObjArray<MockVariable> MockStore;
+static size_t MockGetCount;
+static size_t MockGetNextCount;
+static size_t MockSetCount;
+
+static constexpr const EFI_GUID MockGuid = { 0x5C1E2A7B, 0x0D3F, 0x4E62, { 0x9A, 0x14, 0x6B, 0x2C, 0x80, 0x3D, 0xE5, 0x71 } };
+
+static size_t MockFind(const CHAR16 *Name, const EFI_GUID& Guid)
+{
+  for ( size_t Index = 0 ; Index < MockStore.size() ; ++Index ) {
+    if ( MockStore[Index].Guid == Guid  &&  MockStore[Index].Name.isEqual(Name) ) return Index;
+  }
+  return MAX_XSIZE;
+}
+
+static EFI_STATUS EFIAPI MockGetVariable(const CHAR16 *Name, const EFI_GUID& Guid, UINT32 *Attributes, UINTN *DataSize, VOID *Data)
+{
+  ++MockGetCount;
+  size_t Index = MockFind(Name, Guid);
+  if ( Index == MAX_XSIZE ) return EFI_NOT_FOUND;
+  if ( Attributes != NULL ) *Attributes = MockStore[Index].Attributes;
+  if ( *DataSize < MockStore[Index].Data.size() ) {
+    *DataSize = MockStore[Index].Data.size();
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  *DataSize = MockStore[Index].Data.size();
+  CopyMem(Data, MockStore[Index].Data.data(), *DataSize);
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MockGetVariableOther(const CHAR16 *Name, const EFI_GUID& Guid, UINT32 *Attributes, UINTN *DataSize, VOID *Data)
+{
+  return MockGetVariable(Name, Guid, Attributes, DataSize, Data);
+}
+
+static EFI_STATUS EFIAPI MockGetNextVariableName(UINTN *NameSize, CHAR16 *Name, EFI_GUID *Guid)
+{
+  ++MockGetNextCount;
+  size_t Index = 0;
+  if ( Name[0] != 0 ) {
+    Index = MockFind(Name, *Guid);
+    if ( Index == MAX_XSIZE ) return EFI_INVALID_PARAMETER;
+    ++Index;
+  }
+  if ( Index >= MockStore.size() ) return EFI_NOT_FOUND;
+  if ( *NameSize < MockStore[Index].Name.sizeInBytesIncludingTerminator() ) {
+    *NameSize = MockStore[Index].Name.sizeInBytesIncludingTerminator();
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  *NameSize = MockStore[Index].Name.sizeInBytesIncludingTerminator();
+  CopyMem(Name, MockStore[Index].Name.wc_str(), *NameSize);
+  *Guid = MockStore[Index].Guid;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MockSetVariable(const CHAR16 *Name, const EFI_GUID& Guid, UINT32 Attributes, UINTN DataSize, const VOID *Data)
+{
+  ++MockSetCount;
+  size_t Index = MockFind(Name, Guid);
+  if ( DataSize == 0  &&  (Attributes & EFI_VARIABLE_APPEND_WRITE) != 0 ) return EFI_SUCCESS; // appends nothing
+  if ( DataSize == 0  ||  Attributes == 0 ) {
+    if ( Index == MAX_XSIZE ) return EFI_NOT_FOUND;
+    MockStore.RemoveAtIndex(Index);
+    return EFI_SUCCESS;
+  }
+  if ( Index == MAX_XSIZE ) {
+    MockVariable* Variable = new MockVariable;
+    Variable->Guid = Guid;
+    Variable->Name.takeValueFrom(Name);
+    Index = MockStore.AddReference(Variable, true);
+  } else if ( MockStore[Index].Attributes != Attributes ) {
+    return EFI_INVALID_PARAMETER; // like real firmware : delete first
+  }
+  MockStore[Index].Attributes = Attributes;
+  MockStore[Index].Data.setEmpty();
+  MockStore[Index].Data.ncpy(Data, DataSize);
+  return EFI_SUCCESS;
+}
+
+static void MockResetCounts()
+{
+  MockGetCount = 0;
+  MockGetNextCount = 0;
+  MockSetCount = 0;
+}
+
+static int Nvram_tests_with_mock(EFI_RUNTIME_SERVICES* MockRT)
+{
+  const UINT32 Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+  XObjArray<NvramVariableKey> Keys;
+  UINT8  Big[3000];
+  UINT32 Value;
+  UINT32 GotAttributes;
+  UINTN  GotSize;
+  void   *Got;
+
+  // 200 variables, one with a name longer than the first name buffer, one bigger than the first read buffer
+  for ( UINT32 i = 0 ; i < 200 ; i++ ) {
+    XStringW Name = SWPrintf("MockVar%03d", i);
+    if ( i == 100 ) {
+      for ( int j = 0 ; j < 20 ; j++ ) Name.strcat(L"-long-name");
+    }
+    Value = i;
+    if ( i == 150 ) {
+      SetMem(Big, sizeof(Big), 0x5A);
+      MockSetVariable(Name.wc_str(), MockGuid, Attributes, sizeof(Big), Big);
+    } else {
+      MockSetVariable(Name.wc_str(), MockGuid, Attributes, sizeof(Value), &Value);
+    }
+  }
+
+  // one enumeration, one read per variable, plus a retry for the long name and the big data
+  InvalidateNvramShadow();
+  MockResetCounts();
+  GetNvramVariableNames(Keys);
+  if ( Keys.size() != 200 ) return breakpoint(1);
+  if ( !Keys[0].Name.isEqual(L"MockVar000")  ||  Keys[0].Guid != MockGuid ) return breakpoint(2);
+  if ( !Keys[199].Name.isEqual(L"MockVar199") ) return breakpoint(3);
+  if ( MockGetNextCount != 202  ||  MockGetCount != 201  ||  MockSetCount != 0 ) return breakpoint(4);
+
+  // reads, including misses, are served from the shadow
+  MockResetCounts();
+  Got = GetNvramVariable(L"MockVar010", MockGuid, &GotAttributes, &GotSize);
+  if ( Got == NULL  ||  GotSize != sizeof(Value)  ||  GotAttributes != Attributes  ||  *(UINT32*)Got != 10 ) return breakpoint(10);
+  FreePool(Got);
+  Got = GetNvramVariable(L"MockVar150", MockGuid, NULL, &GotSize);
+  if ( Got == NULL  ||  GotSize != sizeof(Big)  ||  CompareMem(Got, Big, sizeof(Big)) != 0 ) return breakpoint(11);
+  FreePool(Got);
+  if ( GetNvramVariable(L"NoSuchVariable", MockGuid, NULL, NULL) != NULL ) return breakpoint(12);
+  if ( GetNvramVariableAsXString8(L"NoSuchVariable", MockGuid, NULL).notEmpty() ) return breakpoint(13);
+  if ( MockGetCount != 0  ||  MockGetNextCount != 0 ) return breakpoint(14);
+
+  // writing the same value does nothing
+  MockResetCounts();
+  Value = 20;
+  if ( SetNvramVariable(L"MockVar020", MockGuid, Attributes, sizeof(Value), &Value) != EFI_SUCCESS ) return breakpoint(20);
+  if ( AddNvramVariable(L"MockVar020", MockGuid, Attributes, sizeof(Value), &Value) != EFI_ABORTED ) return breakpoint(21);
+  if ( MockGetCount != 0  ||  MockSetCount != 0 ) return breakpoint(22);
+
+  // a new value is written through, once, and read back from the shadow
+  MockResetCounts();
+  Value = 0xC10FE4;
+  if ( SetNvramVariable(L"MockVar020", MockGuid, Attributes, sizeof(Value), &Value) != EFI_SUCCESS ) return breakpoint(30);
+  if ( MockSetCount != 1 ) return breakpoint(31);
+  Got = GetNvramVariable(L"MockVar020", MockGuid, NULL, &GotSize);
+  if ( Got == NULL  ||  GotSize != sizeof(Value)  ||  *(UINT32*)Got != 0xC10FE4 ) return breakpoint(32);
+  FreePool(Got);
+  if ( MockGetCount != 0 ) return breakpoint(33);
+
+  // new attributes : delete, then write
+  MockResetCounts();
+  if ( SetNvramVariable(L"MockVar021", MockGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, sizeof(Value), &Value) != EFI_SUCCESS ) return breakpoint(40);
+  if ( MockSetCount != 2 ) return breakpoint(41);
+  Got = GetNvramVariable(L"MockVar021", MockGuid, &GotAttributes, NULL);
+  if ( Got == NULL  ||  GotAttributes != EFI_VARIABLE_BOOTSERVICE_ACCESS ) return breakpoint(42);
+  FreePool(Got);
+
+  // delete, and the variable is gone without asking the firmware
+  MockResetCounts();
+  if ( DeleteNvramVariable(L"MockVar022", MockGuid) != EFI_SUCCESS ) return breakpoint(50);
+  if ( GetNvramVariable(L"MockVar022", MockGuid, NULL, NULL) != NULL ) return breakpoint(51);
+  if ( MockSetCount != 1  ||  MockGetCount != 0 ) return breakpoint(52);
+  GetNvramVariableNames(Keys);
+  if ( Keys.size() != 199 ) return breakpoint(53);
+
+  // a new variable, added through the shadow
+  MockResetCounts();
+  if ( AddNvramVariable(L"MockNew", MockGuid, Attributes, sizeof(Value), &Value) != EFI_SUCCESS ) return breakpoint(60);
+  Got = GetNvramVariable(L"MockNew", MockGuid, NULL, NULL);
+  if ( Got == NULL ) return breakpoint(61);
+  FreePool(Got);
+  if ( MockSetCount != 1  ||  MockGetCount != 0 ) return breakpoint(62);
+
+  // appending nothing isn't a delete, and the value is still known
+  MockResetCounts();
+  if ( WriteNvramVariable(L"MockNew", MockGuid, Attributes | EFI_VARIABLE_APPEND_WRITE, 0, NULL) != EFI_SUCCESS ) return breakpoint(63);
+  Got = GetNvramVariable(L"MockNew", MockGuid, NULL, &GotSize);
+  if ( Got == NULL  ||  GotSize != sizeof(Value)  ||  *(UINT32*)Got != 0xC10FE4 ) return breakpoint(64);
+  FreePool(Got);
+  if ( MockSetCount != 1  ||  MockGetCount != 0 ) return breakpoint(65);
+
+  // replaced runtime services : the shadow is rebuilt
+  MockRT->GetVariable = MockGetVariableOther;
+  MockResetCounts();
+  Got = GetNvramVariable(L"MockVar010", MockGuid, NULL, NULL);
+  if ( Got == NULL ) return breakpoint(70);
+  FreePool(Got);
+  if ( MockGetNextCount != 202  ||  MockGetCount != 200 ) return breakpoint(71); // the read buffer has kept its size
+
+  // foreign writer : invalidated shadow sees it
+  Value = 0xDEAD;
+  MockSetVariable(L"MockVar010", MockGuid, Attributes, sizeof(Value), &Value);
+  InvalidateNvramShadow();
+  Got = GetNvramVariable(L"MockVar010", MockGuid, NULL, NULL);
+  if ( Got == NULL  ||  *(UINT32*)Got != 0xDEAD ) return breakpoint(80);
+  FreePool(Got);
+
+  return 0;
+}
+
+int Nvram_tests()
+{
+  EFI_RUNTIME_SERVICES* SavedRT = gRT;
+  EFI_RUNTIME_SERVICES  MockRT = *gRT;
+  int ret;
+
+  MockRT.GetVariable = MockGetVariable;
+  MockRT.GetNextVariableName = MockGetNextVariableName;
+  MockRT.SetVariable = MockSetVariable;
+  gRT = &MockRT;
+
+  ret = Nvram_tests_with_mock(&MockRT);
+
+  gRT = SavedRT;
+  InvalidateNvramShadow();
+  MockStore.setEmpty();
+  return ret;
+}
@@ -0,0 +1 @@
+int Nvram_tests();
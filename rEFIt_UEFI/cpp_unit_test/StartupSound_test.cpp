@@ -0,0 +1,97 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/StartupSound.h"
+#include "StartupSound_test.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static INT16 In[256];
+static INT16 Out[512];
+
+int StartupSound_tests()
+{
+  UINTN Length;
+
+  // Same rate: every input frame gives one output frame, two frames late (cubic kernel history)
+  for ( int i = 0 ; i < 64 ; i++ ) In[i] = (INT16)(i * 1000 - 32000);
+  Length = StartupSoundResample((UINT8*)In, 64 * sizeof(INT16), 1, 2, 48000, 1, Out, sizeof(Out));
+  if ( Length != 64 * sizeof(INT16) ) return breakpoint(1);
+  if ( Out[0] != 0  ||  Out[1] != 0 ) return breakpoint(2);
+  for ( int i = 2 ; i < 64 ; i++ ) {
+    if ( Out[i] != In[i-2] ) return breakpoint(3);
+  }
+
+  // Sample containers: 8 bit is unsigned, 24 and 32 bit keep their upper 16 bits
+  {
+    UINT8 In8[4] = { 0x80, 0xFF, 0x00, 0x40 };
+    Length = StartupSoundResample(In8, sizeof(In8), 1, 1, 48000, 1, Out, sizeof(Out));
+    if ( Length != 4 * sizeof(INT16) ) return breakpoint(10);
+    if ( Out[2] != 0  ||  Out[3] != 127 * 256 ) return breakpoint(11);
+  }
+  {
+    UINT8 In24[12] = { 0x00, 0x34, 0x12,  0xFF, 0xFF, 0x80,  0, 0, 0,  0, 0, 0 };
+    Length = StartupSoundResample(In24, sizeof(In24), 1, 3, 48000, 1, Out, sizeof(Out));
+    if ( Length != 4 * sizeof(INT16) ) return breakpoint(12);
+    if ( Out[2] != 0x1234  ||  Out[3] != (INT16)0x80FF ) return breakpoint(13);
+  }
+  {
+    UINT8 In32[16] = { 0x78, 0x56, 0x34, 0x12,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0 };
+    Length = StartupSoundResample(In32, sizeof(In32), 1, 4, 48000, 1, Out, sizeof(Out));
+    if ( Length != 4 * sizeof(INT16) ) return breakpoint(14);
+    if ( Out[2] != 0x1234 ) return breakpoint(15);
+  }
+
+  // More than two channels: the first two are kept
+  for ( int f = 0 ; f < 16 ; f++ ) {
+    for ( int c = 0 ; c < 4 ; c++ ) In[f * 4 + c] = (INT16)(c * 1000 + f);
+  }
+  Length = StartupSoundResample((UINT8*)In, 16 * 4 * sizeof(INT16), 4, 2, 48000, 2, Out, sizeof(Out));
+  if ( Length != 16 * 2 * sizeof(INT16) ) return breakpoint(20);
+  for ( int f = 2 ; f < 16 ; f++ ) {
+    if ( Out[f * 2] != f - 2  ||  Out[f * 2 + 1] != 1000 + f - 2 ) return breakpoint(21);
+  }
+  // as many output channels as input at most
+  if ( StartupSoundResample((UINT8*)In, 16 * sizeof(INT16), 1, 2, 48000, 2, Out, sizeof(Out)) != 0 ) return breakpoint(22);
+
+  // Upsampling twice: a constant stays constant once the history is filled, whatever the phase
+  for ( int i = 0 ; i < 64 ; i++ ) In[i] = 10000;
+  Length = StartupSoundResample((UINT8*)In, 64 * sizeof(INT16), 1, 2, 24000, 1, Out, sizeof(Out));
+  if ( Length != 128 * sizeof(INT16) ) return breakpoint(30);
+  for ( int i = 6 ; i < 128 ; i++ ) {
+    if ( Out[i] < 10000 - 3  ||  Out[i] > 10000 + 3 ) return breakpoint(31);
+  }
+  // 44.1 kHz to 48 kHz: the interpolated phases of a ramp stay between its samples
+  for ( int i = 0 ; i < 256 ; i++ ) In[i] = (INT16)(i * 100);
+  Length = StartupSoundResample((UINT8*)In, 256 * sizeof(INT16), 1, 2, 44100, 1, Out, sizeof(Out));
+  if ( Length != 279 * sizeof(INT16) ) return breakpoint(32);
+  for ( int i = 4 ; i < 279 ; i++ ) {
+    if ( Out[i] < Out[i-1] ) return breakpoint(33);
+  }
+
+  // Downsampling twice: every other input frame
+  for ( int i = 0 ; i < 64 ; i++ ) In[i] = (INT16)(i * 500);
+  Length = StartupSoundResample((UINT8*)In, 64 * sizeof(INT16), 1, 2, 96000, 1, Out, sizeof(Out));
+  if ( Length != 32 * sizeof(INT16) ) return breakpoint(40);
+  for ( int i = 1 ; i < 32 ; i++ ) {
+    if ( Out[i] != In[i * 2 - 2] ) return breakpoint(41);
+  }
+
+  // The overshoot of the kernel on a full scale step is clipped, not wrapped
+  for ( int i = 0 ; i < 64 ; i++ ) In[i] = (i < 32) ? -32768 : 32767;
+  Length = StartupSoundResample((UINT8*)In, 64 * sizeof(INT16), 1, 2, 22050, 1, Out, sizeof(Out));
+  if ( Length == 0 ) return breakpoint(50);
+  for ( UINTN i = 8 ; i < Length / sizeof(INT16) ; i++ ) {
+    if ( Out[i] < Out[i-1] - 8 ) return breakpoint(51);
+  }
+
+  // Output stops at the end of the buffer
+  for ( int i = 0 ; i < 64 ; i++ ) In[i] = 1;
+  Out[5] = 0x5555;
+  Length = StartupSoundResample((UINT8*)In, 64 * sizeof(INT16), 1, 2, 48000, 1, Out, 5 * sizeof(INT16));
+  if ( Length != 5 * sizeof(INT16) ) return breakpoint(60);
+  if ( Out[5] != 0x5555 ) return breakpoint(61);
+
+  return 0;
+}
@@ -0,0 +1 @@
+int StartupSound_tests();
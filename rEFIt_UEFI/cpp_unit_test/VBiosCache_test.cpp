@@ -0,0 +1,197 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/card_vlist.h"
+#include "../Platform/nvidia.h"
+#include "VBiosCache_test.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+//
+// Fake card behind a copy of gBS, counting the ROM bytes read through MMIO
+//
+static UINT8  MockRom[NVIDIA_ROM_SIZE];
+static size_t MockRomReadCount;
+
+static EFI_STATUS EFIAPI MockPciRead(EFI_PCI_IO_PROTOCOL *This, EFI_PCI_IO_PROTOCOL_WIDTH Width, UINT32 Offset, UINTN Count, VOID *Buffer)
+{
+  SetMem(Buffer, Count << (Width & 0x03), 0);
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MockMemRead(EFI_PCI_IO_PROTOCOL *This, EFI_PCI_IO_PROTOCOL_WIDTH Width, UINT8 BarIndex, UINT64 Offset, UINTN Count, VOID *Buffer)
+{
+  UINTN Size = Count << (Width & 0x03);
+  if ( Offset < NV_PROM_OFFSET  ||  Offset + Size > NV_PROM_OFFSET + NVIDIA_ROM_SIZE ) return EFI_UNSUPPORTED;
+  CopyMem(Buffer, MockRom + (Offset - NV_PROM_OFFSET), Size);
+  MockRomReadCount += Size;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MockMemWrite(EFI_PCI_IO_PROTOCOL *This, EFI_PCI_IO_PROTOCOL_WIDTH Width, UINT8 BarIndex, UINT64 Offset, UINTN Count, VOID *Buffer)
+{
+  return EFI_SUCCESS; // ROM shadow on/off
+}
+
+static EFI_PCI_IO_PROTOCOL MockPciIo;
+
+static EFI_STATUS EFIAPI MockOpenProtocol(EFI_HANDLE Handle, const EFI_GUID& Protocol, VOID **Interface, EFI_HANDLE AgentHandle, EFI_HANDLE ControllerHandle, UINT32 Attributes)
+{
+  if ( Protocol != gEfiPciIoProtocolGuid ) return EFI_UNSUPPORTED;
+  *Interface = &MockPciIo;
+  return EFI_SUCCESS;
+}
+
+//
+// Cache kept in memory instead of the Clover dir
+//
+class MockVBiosCache : public VBiosCache
+{
+public:
+  XStringW        FileName = XStringW();
+  XBuffer<UINT8>  Image = XBuffer<UINT8>();
+  size_t          SaveCount = 0;
+
+  virtual XBool LoadImage(const XStringW& Name, XBuffer<UINT8>* Buffer) override
+  {
+    if ( Image.size() == 0  ||  !Name.isEqual(FileName) ) return false;
+    Buffer->setEmpty();
+    Buffer->ncpy(Image.data(), Image.size());
+    return true;
+  }
+  virtual void SaveImage(const XStringW& Name, const UINT8* Buffer, UINTN Size) override
+  {
+    ++SaveCount;
+    FileName = Name;
+    Image.setEmpty();
+    Image.ncpy(Buffer, Size);
+  }
+};
+
+// Option ROM image at Offset, with its PCI data structure
+static void MockRomImage(UINTN Offset, UINT16 PcirOffset, UINT16 Length512, UINT8 CodeType, XBool Last)
+{
+  PCI_EXPANSION_ROM_HEADER* Header = (PCI_EXPANSION_ROM_HEADER*)(MockRom + Offset);
+  PCI_DATA_STRUCTURE*       Pcir = (PCI_DATA_STRUCTURE*)(MockRom + Offset + PcirOffset);
+
+  Header->Signature = PCI_EXPANSION_ROM_HEADER_SIGNATURE;
+  MockRom[Offset + 2] = (UINT8)Length512;
+  Header->PcirOffset = PcirOffset;
+  ZeroMem(Pcir, sizeof(*Pcir));
+  Pcir->Signature = PCI_DATA_STRUCTURE_SIGNATURE;
+  Pcir->VendorId = 0x10DE;
+  Pcir->DeviceId = 0x1B80;
+  Pcir->Length = sizeof(*Pcir);
+  Pcir->ImageLength = Length512;
+  Pcir->CodeType = CodeType;
+  Pcir->Indicator = Last ? 0x80 : 0;
+}
+
+static int VBiosCache_tests_with_mock(MockVBiosCache* Cache)
+{
+  // probe, last byte of the legacy image, then header, PCIR and last byte of the GOP image
+  const size_t HitReadCount = VBIOS_CACHE_PROBE_SIZE + 1 + sizeof(PCI_EXPANSION_ROM_HEADER) + sizeof(PCI_DATA_STRUCTURE) + 1;
+  // nothing cached, or another probe ; an outdated image is read up to its first difference, then as a whole
+  const size_t MissReadCount = VBIOS_CACHE_PROBE_SIZE + NVIDIA_ROM_SIZE;
+  pci_dt_t Dev;
+  UINT8*   Rom = (UINT8*)AllocateZeroPool(NVIDIA_ROM_SIZE);
+
+  ZeroMem(&Dev, sizeof(Dev));
+  Dev.vendor_id = 0x10DE;
+  Dev.device_id = 0x1B80;
+  Dev.subsys_id_union.subsys.vendor_id = 0x1458;
+  Dev.subsys_id_union.subsys.device_id = 0x3702;
+
+  for ( UINTN i = 0 ; i < NVIDIA_ROM_SIZE ; i++ ) MockRom[i] = (UINT8)(i * 7 + (i >> 8));
+  MockRomImage(0, 0x40, 0x80, 0, false);      // 64KB legacy image
+  MockRomImage(0x10000, 0x1C, 0x40, 3, true); // 32KB EFI GOP image
+
+  // nothing cached : whole ROM is read, then saved
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(1);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(2);
+  if ( MockRomReadCount != MissReadCount ) return breakpoint(3);
+  if ( Cache->SaveCount != 1  ||  !Cache->FileName.isEqual(L"misc\\vbios\\10DE_1B80_1458_3702_prom.rom") ) return breakpoint(4);
+
+  // same ROM : only the probe and the image headers and checksums are read
+  MockRomReadCount = 0;
+  ZeroMem(Rom, NVIDIA_ROM_SIZE);
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(10);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(11);
+  if ( MockRomReadCount != HitReadCount ) return breakpoint(12);
+  if ( Cache->SaveCount != 1 ) return breakpoint(13);
+
+  // new legacy checksum : cache is outdated
+  MockRom[0xFFFF] ^= 0xFF;
+  MockRom[0x1000] ^= 0xFF;
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(20);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(21);
+  if ( MockRomReadCount <= NVIDIA_ROM_SIZE  ||  Cache->SaveCount != 2 ) return breakpoint(22);
+
+  // new header : cache is outdated
+  MockRom[0x100] ^= 0xFF;
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(30);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(31);
+  if ( MockRomReadCount <= NVIDIA_ROM_SIZE  ||  Cache->SaveCount != 3 ) return breakpoint(32);
+
+  // new GOP, same legacy image : cache is outdated
+  MockRom[0x17FFF] ^= 0xFF;
+  MockRom[0x12000] ^= 0xFF;
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(35);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(36);
+  if ( MockRomReadCount <= NVIDIA_ROM_SIZE  ||  Cache->SaveCount != 4 ) return breakpoint(37);
+
+  // smaller GOP : cache is outdated, then used again
+  MockRomImage(0x10000, 0x1C, 0x30, 3, true);
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(38);
+  if ( MockRomReadCount <= NVIDIA_ROM_SIZE  ||  Cache->SaveCount != 5 ) return breakpoint(39);
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(40);
+  if ( CompareMem(Rom, MockRom, NVIDIA_ROM_SIZE) != 0 ) return breakpoint(41);
+  if ( MockRomReadCount != HitReadCount  ||  Cache->SaveCount != 5 ) return breakpoint(42);
+
+  // another card : not the same file
+  Dev.subsys_id_union.subsys.device_id = 0x3703;
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(45);
+  if ( MockRomReadCount != MissReadCount ) return breakpoint(46);
+
+  // no option ROM signature : read every time, never saved
+  MockRom[0] = 0;
+  Cache->SaveCount = 0;
+  MockRomReadCount = 0;
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(50);
+  if ( read_nVidia_PROM(&Dev, Rom) != EFI_SUCCESS ) return breakpoint(51);
+  if ( MockRomReadCount != 2 * MissReadCount  ||  Cache->SaveCount != 0 ) return breakpoint(52);
+
+  FreePool(Rom);
+  return 0;
+}
+
+int VBiosCache_tests()
+{
+  EFI_BOOT_SERVICES* SavedBS = gBS;
+  EFI_BOOT_SERVICES  MockBS = *gBS;
+  VBiosCache*        SavedCache = gVBiosCache;
+  MockVBiosCache     Cache;
+  int ret;
+
+  ZeroMem(&MockPciIo, sizeof(MockPciIo));
+  MockPciIo.Pci.Read = MockPciRead;
+  MockPciIo.Mem.Read = MockMemRead;
+  MockPciIo.Mem.Write = MockMemWrite;
+  MockBS.OpenProtocol = MockOpenProtocol;
+  gBS = &MockBS;
+  gVBiosCache = &Cache;
+
+  ret = VBiosCache_tests_with_mock(&Cache);
+
+  gBS = SavedBS;
+  gVBiosCache = SavedCache;
+  return ret;
+}
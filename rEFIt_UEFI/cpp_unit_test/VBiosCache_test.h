@@ -0,0 +1 @@
+int VBiosCache_tests();
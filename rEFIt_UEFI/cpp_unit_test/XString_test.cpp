@@ -1728,6 +1728,93 @@ int XString_tests()
     }
   }
 
+  // Refilling a string whose buffer is big enough doesn't allocate.
+  {
+    XStringW xsw;
+    xsw.SWPrintf("icons\\%s.icns", "os_mac");
+    size_t nbAlloc = XStringW::heapAllocationCount();
+    xsw.SWPrintf("icons\\%s.png", "os_mac");
+    xsw.strcpy(L"os_mac");
+    if ( XStringW::heapAllocationCount() != nbAlloc || xsw != L"os_mac"_XSW ) {
+      nbTestFailed += 1;
+    }
+  }
+  {
+    XStringW xsw;
+    xsw.dataSized(64);
+    size_t nbAlloc = XStringW::heapAllocationCount();
+    xsw.takeValueFrom("EFI");
+    xsw.pathCat("CLOVER"_XS8);
+    xsw.pathCat(L"\\themes");
+    if ( XStringW::heapAllocationCount() != nbAlloc || xsw != L"EFI\\CLOVER\\themes"_XSW ) {
+      nbTestFailed += 1;
+    }
+  }
+  // Long strings : one allocation, moving doesn't allocate.
+  {
+    XString8 xs8;
+    xs8.dataSized(200);
+    size_t nbAlloc = XString8::heapAllocationCount();
+    for ( size_t i = 0 ; i < 100 ; ++i ) xs8.strcat("ab");
+    const char* p = xs8.s();
+    XString8 moved = static_cast<XString8&&>(xs8);
+    XString8 assigned;
+    assigned = static_cast<XString8&&>(moved);
+    if ( XString8::heapAllocationCount() != nbAlloc || assigned.s() != p || assigned.length() != 200 || moved.notEmpty() || xs8.notEmpty() ) {
+      nbTestFailed += 1;
+    }
+  }
+  // Ownership transfer.
+  {
+    XString8 xs8 = S8Printf("%d", 42);
+    char* p = xs8.forgetDataWithoutFreeing();
+    if ( p == NULL || strcmp(p, "42") != 0 || xs8.notEmpty() ) {
+      nbTestFailed += 1;
+    }
+    free(p);
+    XString8 src;
+    src.takeValueFrom("heap");
+    const char* srcData = src.s();
+    XString8 dst;
+    dst.stealValueFrom(&src);
+    if ( dst != "heap"_XS8 || src.notEmpty() || dst.s() != srcData ) {
+      nbTestFailed += 1;
+    }
+  }
+  // Views don't allocate and are accepted where a XString is.
+  {
+    char buf[] = "EFI\\CLOVER\\kexts";
+    size_t nbAlloc = XString8::heapAllocationCount();
+    XStringView view(buf);
+    XString8 xs8 = "EFI\\CLOVER\\kexts\\Other"_XS8;
+    if ( !xs8.startWith(view) || !xs8.contains(XStringView("kexts")) || !view.isEqualIC("efi\\clover\\KEXTS") || view != "EFI\\CLOVER\\kexts"_XS8 ) {
+      nbTestFailed += 1;
+    }
+    if ( XString8::heapAllocationCount() != nbAlloc ) {
+      nbTestFailed += 1;
+    }
+    XString8 copy = view;
+    buf[0] = 'X';
+    if ( copy != "EFI\\CLOVER\\kexts"_XS8 || view.c_str() != buf ) {
+      nbTestFailed += 1;
+    }
+  }
+  {
+    XStringWView view(L"Other");
+    XStringW path;
+    path.dataSized(64);
+    path.takeValueFrom(L"EFI\\CLOVER\\kexts\\");
+    size_t nbAlloc = XStringW::heapAllocationCount();
+    path.pathCat(view);
+    if ( path != L"EFI\\CLOVER\\kexts\\Other"_XSW || !path.endWithOrEqualToIC(XStringWView(L"OTHER")) || XStringW::heapAllocationCount() != nbAlloc ) {
+      nbTestFailed += 1;
+    }
+    XStringWView empty;
+    if ( empty.notEmpty() || !path.startWith(empty) ) {
+      nbTestFailed += 1;
+    }
+  }
+
 
 
 	TEST_ALL_CLASSES(testDefaultCtor, __TEST0);
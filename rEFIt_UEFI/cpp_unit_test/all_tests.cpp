@@ -29,6 +29,14 @@
 #if defined(JIEF_DEBUG) && defined(CLOVER_BUILD)
   #include "printlib-test.h"
 #endif
+#if defined(CLOVER_BUILD)
+  #include "devprop_test.h" // device_inject.cpp is only part of the Clover build
+  #include "AmlGenerator_test.h"
+  #include "lodepng_test.h"
+  #include "Nvram_test.h"
+  #include "VBiosCache_test.h"
+  #include "StartupSound_test.h"
+#endif
 
 
 /* On macOS
@@ -84,6 +92,38 @@ bool all_tests()
     printf("guid_tests() failed at test %d\n", ret);
     all_ok = false;
   }
+#if defined(CLOVER_BUILD)
+  ret = devprop_tests();
+  if ( ret != 0 ) {
+    printf("devprop_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = AmlGenerator_tests();
+  if ( ret != 0 ) {
+    printf("AmlGenerator_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = lodepng_tests();
+  if ( ret != 0 ) {
+    printf("lodepng_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = Nvram_tests();
+  if ( ret != 0 ) {
+    printf("Nvram_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = VBiosCache_tests();
+  if ( ret != 0 ) {
+    printf("VBiosCache_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+  ret = StartupSound_tests();
+  if ( ret != 0 ) {
+    printf("StartupSound_tests() failed at test %d\n", ret);
+    all_ok = false;
+  }
+#endif
   ret = strlen_tests();
   if ( ret != 0 ) {
     printf("strlen_tests() failed at test %d\n", ret);
@@ -0,0 +1,114 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../Platform/device_inject.h"
+#include "devprop_test.h"
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+// Output of the former hex devprop_generate_string() for the devices built below, after hex2bin
+static const uint8_t expectedDevprop[] = {
+  0xFB, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x93, 0x00, 0x00, 0x00,
+  0x04, 0x00, 0x00, 0x00, 0x02, 0x01, 0x0C, 0x00, 0xD0, 0x41, 0x03, 0x0A, 0x00, 0x00, 0x00, 0x00,
+  0x01, 0x01, 0x06, 0x00, 0x00, 0x02, 0x01, 0x01, 0x06, 0x00, 0x03, 0x01, 0x7F, 0xFF, 0x04, 0x00,
+  0x16, 0x00, 0x00, 0x00, 0x62, 0x00, 0x75, 0x00, 0x69, 0x00, 0x6C, 0x00, 0x74, 0x00, 0x2D, 0x00,
+  0x69, 0x00, 0x6E, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01, 0x18, 0x00, 0x00, 0x00, 0x64,
+  0x00, 0x65, 0x00, 0x76, 0x00, 0x69, 0x00, 0x63, 0x00, 0x65, 0x00, 0x2D, 0x00, 0x69, 0x00, 0x64,
+  0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x00, 0x00, 0x6D,
+  0x00, 0x6F, 0x00, 0x64, 0x00, 0x65, 0x00, 0x6C, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x43,
+  0x6C, 0x6F, 0x76, 0x65, 0x72, 0x20, 0x74, 0x65, 0x73, 0x74, 0x00, 0x10, 0x00, 0x00, 0x00, 0x65,
+  0x00, 0x6D, 0x00, 0x70, 0x00, 0x74, 0x00, 0x79, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x3E,
+  0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x01, 0x0C, 0x00, 0xD0, 0x41, 0x03, 0x0A, 0x80,
+  0x00, 0x00, 0x00, 0x01, 0x01, 0x06, 0x00, 0x03, 0x1B, 0x7F, 0xFF, 0x04, 0x00, 0x18, 0x00, 0x00,
+  0x00, 0x6C, 0x00, 0x61, 0x00, 0x79, 0x00, 0x6F, 0x00, 0x75, 0x00, 0x74, 0x00, 0x2D, 0x00, 0x69,
+  0x00, 0x64, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x1C, 0x00, 0x00, 0x00,
+};
+
+static DevPropDevice* devprop_test_add_device(DevPropString* StringBuf, UINT32 uid, UINT8 NumPaths, const UINT8* FuncDev)
+{
+  DevPropDevice* device = (__typeof__(device))AllocateZeroPool(sizeof(DevPropDevice));
+
+  device->acpi_dev_path.length = 0x0c;
+  device->acpi_dev_path.type = 0x02;
+  device->acpi_dev_path.subtype = 0x01;
+  device->acpi_dev_path._HID = 0x0a0341d0;
+  device->acpi_dev_path._UID = uid;
+  for ( UINT8 i = 0 ; i < NumPaths ; i++ ) {
+    device->pci_dev_path[i].type = 0x01;
+    device->pci_dev_path[i].subtype = 0x01;
+    device->pci_dev_path[i].length = 0x06;
+    device->pci_dev_path[i].function = FuncDev[i*2];
+    device->pci_dev_path[i].device = FuncDev[i*2+1];
+  }
+  device->num_pci_devpaths = NumPaths;
+  device->length = (UINT32)(24U + (6U * NumPaths));
+  device->path_end.length = 0x04;
+  device->path_end.type = 0x7f;
+  device->path_end.subtype = 0xff;
+  device->string = StringBuf;
+  StringBuf->length += device->length;
+  StringBuf->entries[StringBuf->numentries++] = device;
+  return device;
+}
+
+int devprop_tests()
+{
+  // hex encoder/decoder
+  {
+    uint8_t bin[256];
+    uint8_t bin2[256];
+    char hex[512];
+    for ( size_t i = 0 ; i < sizeof(bin) ; i++ ) bin[i] = (uint8_t)i;
+    bin2hex(bin, sizeof(bin), hex);
+    if ( hex[0] != '0' || hex[1] != '0' || hex[0x5A*2] != '5' || hex[0x5A*2+1] != 'A' || hex[510] != 'F' || hex[511] != 'F' ) return breakpoint(1);
+    if ( hex2bin(hex, sizeof(hex), bin2, sizeof(bin2)) != sizeof(bin2) ) return breakpoint(2);
+    if ( memcmp(bin, bin2, sizeof(bin)) != 0 ) return breakpoint(3);
+    if ( hex2bin("0a, fF 1c"_XS8, bin2, sizeof(bin2)) != 3 || bin2[0] != 0x0A || bin2[1] != 0xFF || bin2[2] != 0x1C ) return breakpoint(4);
+    if ( hex2bin("0g"_XS8, bin2, sizeof(bin2)) != 0 ) return breakpoint(5);
+    if ( hex2bin(L"12AB"_XSW, bin2, sizeof(bin2)) != 2 || bin2[0] != 0x12 || bin2[1] != 0xAB ) return breakpoint(6);
+  }
+
+  // binary serializer, byte for byte with the former hex serializer
+  {
+    DevPropString* StringBuf = (__typeof__(StringBuf))AllocateZeroPool(sizeof(DevPropString));
+    StringBuf->length = 12;
+    StringBuf->WHAT2 = 0x01000000;
+    StringBuf->entries = (__typeof__(StringBuf->entries))AllocateZeroPool(4 * sizeof(DevPropDevice*));
+
+    const UINT8 paths1[] = { 0x00,0x02, 0x03,0x01 };
+    const UINT8 paths2[] = { 0x03,0x1b };
+    const UINT8 paths3[] = { 0x00,0x14 };
+    DevPropDevice* device1 = devprop_test_add_device(StringBuf, 0, 2, paths1);
+    DevPropDevice* device2 = devprop_test_add_device(StringBuf, 0x80, 1, paths2);
+    devprop_test_add_device(StringBuf, 0, 1, paths3); // no property : skipped by the serializer
+
+    UINT8 builtin = 0x01;
+    UINT32 deviceId = 0x12345678;
+    UINT32 layoutId = 0x1c;
+    if ( !devprop_add_value(device1, "built-in", &builtin, 1) ) return breakpoint(10);
+    if ( !devprop_add_value(device1, "device-id", (UINT8*)&deviceId, 4) ) return breakpoint(10);
+    if ( !devprop_add_value(device1, "model", (const UINT8*)"Clover test", 12) ) return breakpoint(10);
+    if ( !devprop_add_value(device1, "empty", (const UINT8*)"", 0) ) return breakpoint(10);
+    if ( !devprop_add_value(device2, "layout-id", (UINT8*)&layoutId, 4) ) return breakpoint(10);
+
+    XBuffer<uint8_t> binary = devprop_generate_binary(StringBuf);
+    if ( binary.size() != sizeof(expectedDevprop) ) return breakpoint(11);
+    if ( memcmp(binary.data(), expectedDevprop, sizeof(expectedDevprop)) != 0 ) return breakpoint(12);
+
+    XBuffer<char> hexString = devprop_generate_string(StringBuf);
+    if ( hexString.size() != sizeof(expectedDevprop) * 2 ) return breakpoint(13);
+    uint8_t decoded[sizeof(expectedDevprop)];
+    if ( hex2bin(hexString, decoded, sizeof(decoded)) != sizeof(decoded) ) return breakpoint(14);
+    if ( memcmp(decoded, expectedDevprop, sizeof(expectedDevprop)) != 0 ) return breakpoint(15);
+
+    for ( int i = 0 ; i < StringBuf->numentries ; i++ ) {
+      if ( StringBuf->entries[i]->data ) FreePool(StringBuf->entries[i]->data);
+      FreePool(StringBuf->entries[i]);
+    }
+    FreePool(StringBuf->entries);
+    FreePool(StringBuf);
+  }
+
+  return 0;
+}
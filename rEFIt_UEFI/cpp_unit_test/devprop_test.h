@@ -0,0 +1 @@
+int devprop_tests();
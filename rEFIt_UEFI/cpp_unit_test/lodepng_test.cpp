@@ -0,0 +1,148 @@
+#include <Platform.h> // Only use angled for Platform, else, xcode project won't compile
+#include "../libeg/lodepng.h"
+#include "lodepng_test.h"
+
+// Test hooks in lodepng.cpp
+unsigned lode_png_test_unfilter(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length);
+unsigned lode_png_test_adler32(const unsigned char* data, unsigned len);
+
+static int breakpoint(int i)
+{
+  return i;
+}
+
+static UINT32 lodepngTestSeed;
+
+// Random bytes. With smallRange, only 0, 1, 2 and 255 to get many ties in the Paeth predictor
+static void lodepng_test_fill(UINT8* p, size_t n, bool smallRange)
+{
+  static const UINT8 small[4] = { 0, 1, 2, 255 };
+  for ( size_t i = 0; i < n; i++ ) {
+    lodepngTestSeed = lodepngTestSeed * 1103515245 + 12345;
+    UINT8 b = (UINT8)(lodepngTestSeed >> 16);
+    p[i] = smallRange ? small[b & 3] : b;
+  }
+}
+
+// Filters as written in the PNG specification, one byte at a time
+static UINT8 lodepng_test_paeth(int a, int b, int c)
+{
+  int p = a + b - c;
+  int pa = p > a ? p - a : a - p;
+  int pb = p > b ? p - b : b - p;
+  int pc = p > c ? p - c : c - p;
+  if ( pa <= pb && pa <= pc ) return (UINT8)a;
+  if ( pb <= pc ) return (UINT8)b;
+  return (UINT8)c;
+}
+
+static void lodepng_test_unfilter_ref(UINT8* recon, const UINT8* scanline, const UINT8* precon,
+                                      size_t bytewidth, UINT8 filterType, size_t length)
+{
+  for ( size_t i = 0; i < length; i++ ) {
+    int a = i >= bytewidth ? recon[i - bytewidth] : 0;
+    int b = precon ? precon[i] : 0;
+    int c = precon && i >= bytewidth ? precon[i - bytewidth] : 0;
+    int x = 0;
+    switch ( filterType ) {
+      case 1: x = a; break;
+      case 2: x = b; break;
+      case 3: x = (a + b) / 2; break;
+      case 4: x = lodepng_test_paeth(a, b, c); break;
+    }
+    recon[i] = (UINT8)(scanline[i] + x);
+  }
+}
+
+static UINT32 lodepng_test_crc32_ref(const UINT8* data, size_t len)
+{
+  UINT32 r = 0xffffffff;
+  for ( size_t i = 0; i < len; i++ ) {
+    r ^= data[i];
+    for ( int k = 0; k < 8; k++ ) r = (r >> 1) ^ (0xedb88320 & (0 - (r & 1)));
+  }
+  return r ^ 0xffffffff;
+}
+
+static UINT32 lodepng_test_adler32_ref(const UINT8* data, size_t len)
+{
+  UINT32 s1 = 1, s2 = 0;
+  for ( size_t i = 0; i < len; i++ ) {
+    s1 = (s1 + data[i]) % 65521;
+    s2 = (s2 + s1) % 65521;
+  }
+  return (s2 << 16) | s1;
+}
+
+// Every filter type, pixel size and length up to maxLength against the reference, with and without a
+// previous line, and in place like the decoder does it
+static int lodepng_test_unfilter_all(size_t maxLength, bool smallRange)
+{
+  static const size_t bytewidths[] = { 1, 2, 3, 4, 6, 8 };
+  UINT8* scanline = (UINT8*)AllocatePool(maxLength);
+  UINT8* precon = (UINT8*)AllocatePool(maxLength);
+  UINT8* expected = (UINT8*)AllocatePool(maxLength);
+  UINT8* recon = (UINT8*)AllocatePool(maxLength);
+  int ret = 0;
+  for ( size_t w = 0; w < sizeof(bytewidths) / sizeof(bytewidths[0]) && ret == 0; w++ ) {
+    size_t bytewidth = bytewidths[w];
+    for ( size_t length = bytewidth; length <= maxLength && ret == 0; length += bytewidth ) {
+      for ( UINT8 filterType = 0; filterType <= 4 && ret == 0; filterType++ ) {
+        for ( int withPrecon = 0; withPrecon < 2 && ret == 0; withPrecon++ ) {
+          const UINT8* p = withPrecon ? precon : NULL;
+          lodepng_test_fill(scanline, length, smallRange);
+          lodepng_test_fill(precon, length, smallRange);
+          lodepng_test_unfilter_ref(expected, scanline, p, bytewidth, filterType, length);
+          if ( lode_png_test_unfilter(recon, scanline, p, bytewidth, filterType, length) != 0 ) ret = 1;
+          else if ( memcmp(recon, expected, length) != 0 ) ret = 2;
+          else if ( lode_png_test_unfilter(scanline, scanline, p, bytewidth, filterType, length) != 0 ) ret = 3;
+          else if ( memcmp(scanline, expected, length) != 0 ) ret = 4;
+        }
+      }
+    }
+  }
+  FreePool(scanline);
+  FreePool(precon);
+  FreePool(expected);
+  FreePool(recon);
+  return ret;
+}
+
+int lodepng_tests()
+{
+  // known values
+  if ( lodepng_crc32((const UINT8*)"123456789", 9) != 0xCBF43926 ) return breakpoint(1);
+  if ( lode_png_test_adler32((const UINT8*)"Wikipedia", 9) != 0x11E60398 ) return breakpoint(2);
+
+  // checksums at every length and alignment around the 8 and 16 byte steps
+  {
+    UINT8 buf[16 + 300];
+    lodepngTestSeed = 1;
+    lodepng_test_fill(buf, sizeof(buf), false);
+    for ( size_t offset = 0; offset < 16; offset++ ) {
+      for ( size_t len = 0; len <= 300; len++ ) {
+        if ( lodepng_crc32(buf + offset, len) != lodepng_test_crc32_ref(buf + offset, len) ) return breakpoint(10);
+        if ( lode_png_test_adler32(buf + offset, (unsigned)len) != lodepng_test_adler32_ref(buf + offset, len) ) return breakpoint(11);
+      }
+    }
+  }
+  // long buffers: the Adler sums are only reduced every 5552 bytes, all 0xff is the worst case
+  {
+    size_t len = 3 * 5552 + 17;
+    UINT8* buf = (UINT8*)AllocatePool(len);
+    SetMem(buf, len, 0xff);
+    if ( lode_png_test_adler32(buf, (unsigned)len) != lodepng_test_adler32_ref(buf, len) ) return breakpoint(20);
+    if ( lodepng_crc32(buf, len) != lodepng_test_crc32_ref(buf, len) ) return breakpoint(21);
+    lodepng_test_fill(buf, len, false);
+    if ( lode_png_test_adler32(buf, (unsigned)len) != lodepng_test_adler32_ref(buf, len) ) return breakpoint(22);
+    if ( lodepng_crc32(buf, len) != lodepng_test_crc32_ref(buf, len) ) return breakpoint(23);
+    FreePool(buf);
+  }
+
+  int ret = lodepng_test_unfilter_all(100, false);
+  if ( ret != 0 ) return breakpoint(30 + ret);
+  ret = lodepng_test_unfilter_all(100, true);
+  if ( ret != 0 ) return breakpoint(40 + ret);
+  return 0;
+}
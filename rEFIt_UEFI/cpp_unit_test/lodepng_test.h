@@ -0,0 +1 @@
+int lodepng_tests();
@@ -2361,7 +2361,10 @@ void ScanLoader(void)
 
       for (UINTN i = 0; i < Volume->ApfsTargetUUIDArray.size(); i++) {
         const EFI_GUID &ApfsTargetUUID = Volume->ApfsTargetUUIDArray[i];
-        DBG("    APFSTargetUUID=%s\n", ApfsTargetUUID.toXString8().c_str());
+        // converted once : it's in every path built below
+        const XString8 TargetUUID = ApfsTargetUUID.toXString8();
+        DBG("    APFSTargetUUID=%s\n", TargetUUID.c_str());
+        XStringW TargetPath; // one buffer for all the paths of this target
         XStringW FullTitle;
         XStringW FullTitleRecovery;
         XStringW FullTitleInstaller;
@@ -2422,7 +2425,7 @@ void ScanLoader(void)
             UINTN fileLen = 0;
             targetNameFile.SWPrintf(
                 "%s\\System\\Library\\CoreServices\\.disk_label.contentDetails",
-                ApfsTargetUUID.toXString8().c_str());
+                TargetUUID.c_str());
             if (FileExists(bootVolume->RootDir, targetNameFile)) {
               EFI_STATUS Status =
                   egLoadFile(bootVolume->RootDir, targetNameFile.wc_str(),
@@ -2463,32 +2466,27 @@ void ScanLoader(void)
 
         FullTitle.SWCatf(
             " via %ls", Volume->getVolLabelOrOSXVolumeNameOrVolName().wc_str());
-        AddLoaderEntry(SWPrintf("\\%s\\System\\Library\\CoreServices\\boot.efi",
-                                ApfsTargetUUID.toXString8().c_str()),
-                       NullXString8Array, FullTitle, LoaderTitle, Volume, NULL,
-                       OSTYPE_OSX, 0);
+        TargetPath.SWPrintf("\\%s\\System\\Library\\CoreServices\\boot.efi",
+                            TargetUUID.c_str());
+        AddLoaderEntry(TargetPath, NullXString8Array, FullTitle, LoaderTitle,
+                       Volume, NULL, OSTYPE_OSX, 0);
 
         FullTitleRecovery.SWCatf(
             " via %ls", Volume->getVolLabelOrOSXVolumeNameOrVolName().wc_str());
-        if (!AddLoaderEntry(
-                SWPrintf("\\%s\\boot.efi",
-                         Volume->ApfsTargetUUIDArray[i].toXString8().c_str()),
-                NullXString8Array, FullTitleRecovery, L""_XSW, Volume, NULL,
-                OSTYPE_RECOVERY, 0)) {
+        TargetPath.SWPrintf("\\%s\\boot.efi", TargetUUID.c_str());
+        if (!AddLoaderEntry(TargetPath, NullXString8Array, FullTitleRecovery,
+                            L""_XSW, Volume, NULL, OSTYPE_RECOVERY, 0)) {
           // Try to add Recovery APFS entry as dmg
-          AddLoaderEntry(
-              SWPrintf("\\%s\\BaseSystem.dmg",
-                       Volume->ApfsTargetUUIDArray[i].toXString8().c_str()),
-              NullXString8Array, FullTitleRecovery, L""_XSW, Volume, NULL,
-              OSTYPE_RECOVERY, 0);
+          TargetPath.SWPrintf("\\%s\\BaseSystem.dmg", TargetUUID.c_str());
+          AddLoaderEntry(TargetPath, NullXString8Array, FullTitleRecovery,
+                         L""_XSW, Volume, NULL, OSTYPE_RECOVERY, 0);
         }
         // Try to add macOS install entry
         FullTitleInstaller.SWCatf(
             " via %ls", Volume->getVolLabelOrOSXVolumeNameOrVolName().wc_str());
 
-        XString8 installerPath =
-            SWPrintf("\\%s\\com.apple.installer",
-                     Volume->ApfsTargetUUIDArray[i].toXString8().c_str());
+        XStringW installerPath =
+            SWPrintf("\\%s\\com.apple.installer", TargetUUID.c_str());
         if (FileExists(Volume->RootDir, installerPath)) {
           XString8 rootDmg = GetAuthRootDmg(*Volume->RootDir, installerPath);
           rootDmg.replaceAll("%20"_XS8, " "_XS8);
@@ -2509,11 +2507,11 @@ void ScanLoader(void)
                 FileExists(*targetInstallVolume->RootDir,
                            rootDmg)) { // rootDmg empty is accepted, to be
                                        // compatible with previous code
-              AddLoaderEntry(
-                  SWPrintf("\\%s\\com.apple.installer\\boot.efi",
-                           Volume->ApfsTargetUUIDArray[i].toXString8().c_str()),
-                  NullXString8Array, FullTitleInstaller, LoaderTitleInstaller,
-                  Volume, NULL, OSTYPE_OSX_INSTALLER, 0);
+              TargetPath.SWPrintf("\\%s\\com.apple.installer\\boot.efi",
+                                  TargetUUID.c_str());
+              AddLoaderEntry(TargetPath, NullXString8Array, FullTitleInstaller,
+                             LoaderTitleInstaller, Volume, NULL,
+                             OSTYPE_OSX_INSTALLER, 0);
             } else {
               DBG("    Dead installer entry found (installer dmg boot file not "
                   "found : '%s')\n",
@@ -2524,7 +2522,7 @@ void ScanLoader(void)
           } else {
             DBG("    Dead installer entry found (target volume not found : "
                 "'%s')\n",
-                Volume->ApfsTargetUUIDArray[i].toXString8().c_str());
+                TargetUUID.c_str());
           }
         }
       }
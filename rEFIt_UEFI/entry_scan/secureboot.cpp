@@ -217,13 +217,219 @@ void DisableSecureBoot(void)
 STATIC EFI_SECURITY_FILE_AUTHENTICATION_STATE gSecurityFileAuthentication;
 STATIC EFI_SECURITY2_FILE_AUTHENTICATION      gSecurity2FileAuthentication;
 
+// Secure boot white and black lists compiled into one Aho-Corasick automaton so a device path
+//  is matched against every entry of both lists in a single pass
+#define SECURE_BOOT_LIST_WHITE   (1)
+#define SECURE_BOOT_LIST_BLACK   (2)
+// The device path has no text form, neither list applies
+#define SECURE_BOOT_LIST_NO_PATH (4)
+
+typedef struct {
+  // Lists with an entry ending at this node or at one of its suffixes
+  UINT8  Output;
+  CHAR16 Char;
+  UINT32 FirstChild;
+  UINT32 Sibling;
+  UINT32 Fail;
+} SECURE_BOOT_LIST_NODE;
+
+// Node 0 is the root, which is never a child so 0 also means no node
+STATIC SECURE_BOOT_LIST_NODE *mSecureBootListNodes = NULL;
+STATIC UINTN                  mSecureBootListNodeCount = 0;
+
+// Verdicts of the last device paths checked, these are checked again for every image load
+#define SECURE_BOOT_VERDICT_CACHE_SIZE (32)
+
+typedef struct {
+  EFI_DEVICE_PATH_PROTOCOL *DevicePath;
+  UINTN                     DevicePathSize;
+  UINT8                     Verdict;
+} SECURE_BOOT_VERDICT;
+
+STATIC SECURE_BOOT_VERDICT mSecureBootVerdicts[SECURE_BOOT_VERDICT_CACHE_SIZE];
+STATIC UINTN               mSecureBootVerdictNext = 0;
+
+STATIC UINT32 FindSecureBootListChild(IN UINT32 Node,
+                                      IN CHAR16 Char)
+{
+  UINT32 Child = mSecureBootListNodes[Node].FirstChild;
+  while ((Child != 0) && (mSecureBootListNodes[Child].Char != Char)) {
+    Child = mSecureBootListNodes[Child].Sibling;
+  }
+  return Child;
+}
+
+STATIC void AddSecureBootListEntries(IN const XStringWArray &List,
+                                     IN UINT8                ListBit)
+{
+  for (size_t Index = 0; Index < List.size(); ++Index) {
+    CONST CHAR16 *Entry = List[Index].wc_str();
+    UINT32        Node = 0;
+    if (List[Index].isEmpty()) {
+      continue;
+    }
+    for (; *Entry != L'\0'; ++Entry) {
+      UINT32 Child = FindSecureBootListChild(Node, *Entry);
+      if (Child == 0) {
+        Child = (UINT32)mSecureBootListNodeCount++;
+        mSecureBootListNodes[Child].Char = *Entry;
+        mSecureBootListNodes[Child].Sibling = mSecureBootListNodes[Node].FirstChild;
+        mSecureBootListNodes[Node].FirstChild = Child;
+      }
+      Node = Child;
+    }
+    mSecureBootListNodes[Node].Output |= ListBit;
+  }
+}
+
+STATIC void ClearSecureBootVerdicts(void)
+{
+  for (UINTN Index = 0; Index < SECURE_BOOT_VERDICT_CACHE_SIZE; ++Index) {
+    if (mSecureBootVerdicts[Index].DevicePath != NULL) {
+      FreePool(mSecureBootVerdicts[Index].DevicePath);
+    }
+    mSecureBootVerdicts[Index].DevicePath = NULL;
+    mSecureBootVerdicts[Index].DevicePathSize = 0;
+  }
+  mSecureBootVerdictNext = 0;
+}
+
+// Compile the white and black lists from settings
+STATIC void CompileSecureBootLists(void)
+{
+  UINTN   MaxNodes = 1;
+  UINT32 *Queue;
+  UINTN   Head = 0, Tail = 0;
+  ClearSecureBootVerdicts();
+  if (mSecureBootListNodes != NULL) {
+    FreePool(mSecureBootListNodes);
+    mSecureBootListNodes = NULL;
+  }
+  mSecureBootListNodeCount = 0;
+  // Every character of every entry is at most one node
+  for (size_t Index = 0; Index < gSettings.Boot.SecureBootWhiteList.size(); ++Index) {
+    MaxNodes += StrLen(gSettings.Boot.SecureBootWhiteList[Index].wc_str());
+  }
+  for (size_t Index = 0; Index < gSettings.Boot.SecureBootBlackList.size(); ++Index) {
+    MaxNodes += StrLen(gSettings.Boot.SecureBootBlackList[Index].wc_str());
+  }
+  mSecureBootListNodes = (__typeof__(mSecureBootListNodes))AllocateZeroPool(MaxNodes * sizeof(SECURE_BOOT_LIST_NODE));
+  Queue = (__typeof__(Queue))AllocatePool(MaxNodes * sizeof(UINT32));
+  if ((mSecureBootListNodes == NULL) || (Queue == NULL)) {
+    if (mSecureBootListNodes != NULL) {
+      FreePool(mSecureBootListNodes);
+      mSecureBootListNodes = NULL;
+    }
+    if (Queue != NULL) {
+      FreePool(Queue);
+    }
+    return;
+  }
+  mSecureBootListNodeCount = 1;
+  AddSecureBootListEntries(gSettings.Boot.SecureBootWhiteList, SECURE_BOOT_LIST_WHITE);
+  AddSecureBootListEntries(gSettings.Boot.SecureBootBlackList, SECURE_BOOT_LIST_BLACK);
+  // Breadth first, link each node to the node of its longest proper suffix
+  for (UINT32 Child = mSecureBootListNodes[0].FirstChild; Child != 0; Child = mSecureBootListNodes[Child].Sibling) {
+    Queue[Tail++] = Child;
+  }
+  while (Head < Tail) {
+    UINT32 Node = Queue[Head++];
+    for (UINT32 Child = mSecureBootListNodes[Node].FirstChild; Child != 0; Child = mSecureBootListNodes[Child].Sibling) {
+      UINT32 Fail = mSecureBootListNodes[Node].Fail;
+      UINT32 Next;
+      while (((Next = FindSecureBootListChild(Fail, mSecureBootListNodes[Child].Char)) == 0) && (Fail != 0)) {
+        Fail = mSecureBootListNodes[Fail].Fail;
+      }
+      mSecureBootListNodes[Child].Fail = Next;
+      mSecureBootListNodes[Child].Output |= mSecureBootListNodes[Next].Output;
+      Queue[Tail++] = Child;
+    }
+  }
+  FreePool(Queue);
+  DBG("Secure boot lists compiled: %llu white, %llu black, %llu nodes\n", (UINT64)gSettings.Boot.SecureBootWhiteList.size(),
+      (UINT64)gSettings.Boot.SecureBootBlackList.size(), (UINT64)mSecureBootListNodeCount);
+}
+
+// Get the lists that have an entry contained in the device path text, one entry at a time
+STATIC UINT8 MatchSecureBootListEntries(IN const XStringW &DevicePathStr)
+{
+  UINT8 Verdict = 0;
+  for (size_t Index = 0; Index < gSettings.Boot.SecureBootWhiteList.size(); ++Index) {
+    if ( gSettings.Boot.SecureBootWhiteList[Index].notEmpty() &&
+        DevicePathStr.contains(gSettings.Boot.SecureBootWhiteList[Index]) ) {
+      Verdict |= SECURE_BOOT_LIST_WHITE;
+      break;
+    }
+  }
+  for (size_t Index = 0; Index < gSettings.Boot.SecureBootBlackList.size(); ++Index) {
+    if ( gSettings.Boot.SecureBootBlackList[Index].notEmpty() &&
+        DevicePathStr.contains(gSettings.Boot.SecureBootBlackList[Index]) ) {
+      Verdict |= SECURE_BOOT_LIST_BLACK;
+      break;
+    }
+  }
+  return Verdict;
+}
+
+// Get the lists that have an entry contained in the device path text
+STATIC UINT8 MatchSecureBootLists(IN CONST CHAR16 *DevicePathStr)
+{
+  UINT32 Node = 0;
+  UINT8  Verdict = 0;
+  for (; *DevicePathStr != L'\0'; ++DevicePathStr) {
+    UINT32 Next;
+    while (((Next = FindSecureBootListChild(Node, *DevicePathStr)) == 0) && (Node != 0)) {
+      Node = mSecureBootListNodes[Node].Fail;
+    }
+    Node = Next;
+    Verdict |= mSecureBootListNodes[Node].Output;
+    if (Verdict == (SECURE_BOOT_LIST_WHITE | SECURE_BOOT_LIST_BLACK)) {
+      break;
+    }
+  }
+  return Verdict;
+}
+
+// Get the lists matching an image device path, from cache if it was checked before
+STATIC UINT8 GetSecureBootListVerdict(IN CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath)
+{
+  UINTN    DevicePathSize = GetDevicePathSize(DevicePath);
+  UINT8    Verdict;
+  XStringW DevicePathStr;
+  for (UINTN Index = 0; Index < SECURE_BOOT_VERDICT_CACHE_SIZE; ++Index) {
+    if ((mSecureBootVerdicts[Index].DevicePathSize == DevicePathSize) &&
+        (mSecureBootVerdicts[Index].DevicePath != NULL) &&
+        (CompareMem(mSecureBootVerdicts[Index].DevicePath, DevicePath, DevicePathSize) == 0)) {
+      return mSecureBootVerdicts[Index].Verdict;
+    }
+  }
+  DevicePathStr = FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL *)DevicePath);
+  if ( DevicePathStr.isEmpty() ) {
+    Verdict = SECURE_BOOT_LIST_NO_PATH;
+  } else if (mSecureBootListNodes == NULL) {
+    // The lists could not be compiled, match them directly and don't remember it
+    return MatchSecureBootListEntries(DevicePathStr);
+  } else {
+    Verdict = MatchSecureBootLists(DevicePathStr.wc_str());
+  }
+  // Replace the oldest verdict
+  SECURE_BOOT_VERDICT *Cached = &mSecureBootVerdicts[mSecureBootVerdictNext];
+  mSecureBootVerdictNext = (mSecureBootVerdictNext + 1) % SECURE_BOOT_VERDICT_CACHE_SIZE;
+  if (Cached->DevicePath != NULL) {
+    FreePool(Cached->DevicePath);
+  }
+  Cached->DevicePath = (__typeof__(Cached->DevicePath))AllocateCopyPool(DevicePathSize, DevicePath);
+  Cached->DevicePathSize = (Cached->DevicePath != NULL) ? DevicePathSize : 0;
+  Cached->Verdict = Verdict;
+  return Verdict;
+}
+
 // Pre check the secure boot policy
 STATIC XBool EFIAPI
 PrecheckSecureBootPolicy(IN OUT EFI_STATUS                     *AuthenticationStatus,
                          IN     CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath)
 {
-  XStringW DevicePathStr;
-  UINTN   Index;
+  UINT8 Verdict;
   if ((AuthenticationStatus == NULL) || (DevicePath == NULL)) {
     return false;
   }
@@ -235,57 +441,43 @@ PrecheckSecureBootPolicy(IN OUT EFI_STATUS                     *AuthenticationSt
 
   case SECURE_BOOT_POLICY_WHITELIST:
     // Check the white list for this image
-    DevicePathStr = FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL *)DevicePath);
-    if ( DevicePathStr.isEmpty() ) {
+    Verdict = GetSecureBootListVerdict(DevicePath);
+    if ((Verdict & SECURE_BOOT_LIST_NO_PATH) != 0) {
       return false;
     }
-    for (Index = 0; Index < gSettings.Boot.SecureBootWhiteList.size(); ++Index) {
-      if ( gSettings.Boot.SecureBootWhiteList[Index].notEmpty() &&
-          DevicePathStr.contains(gSettings.Boot.SecureBootWhiteList[Index]) ) {
-        // White listed
-        *AuthenticationStatus = EFI_SUCCESS;
-        return true;
-      }
+    if ((Verdict & SECURE_BOOT_LIST_WHITE) != 0) {
+      // White listed
+      *AuthenticationStatus = EFI_SUCCESS;
     }
     return true;
 
   case SECURE_BOOT_POLICY_BLACKLIST:
     // Check the black list for this image
-    DevicePathStr = FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL *)DevicePath);
-    if ( DevicePathStr.isEmpty() ) {
+    Verdict = GetSecureBootListVerdict(DevicePath);
+    if ((Verdict & SECURE_BOOT_LIST_NO_PATH) != 0) {
       return false;
     }
-    for (Index = 0; Index < gSettings.Boot.SecureBootBlackList.size(); ++Index) {
-      if ( gSettings.Boot.SecureBootBlackList[Index].notEmpty() &&
-          DevicePathStr.contains(gSettings.Boot.SecureBootBlackList[Index]) ) {
-        // Black listed
-        return true;
-      }
+    if ((Verdict & SECURE_BOOT_LIST_BLACK) == 0) {
+      // Not black listed
+      *AuthenticationStatus = EFI_SUCCESS;
     }
-    *AuthenticationStatus = EFI_SUCCESS;
     return true;
 
   case SECURE_BOOT_POLICY_USER:
-    DevicePathStr = FileDevicePathToXStringW((EFI_DEVICE_PATH_PROTOCOL *)DevicePath);
-    if ( DevicePathStr.isEmpty() ) {
+    Verdict = GetSecureBootListVerdict(DevicePath);
+    if ((Verdict & SECURE_BOOT_LIST_NO_PATH) != 0) {
       return false;
     }
     // Check the black list for this image
-    for (Index = 0; Index < gSettings.Boot.SecureBootBlackList.size(); ++Index) {
-      if ( gSettings.Boot.SecureBootBlackList[Index].notEmpty() &&
-          DevicePathStr.contains(gSettings.Boot.SecureBootBlackList[Index]) ) {
-        // Black listed
-        return true;
-      }
+    if ((Verdict & SECURE_BOOT_LIST_BLACK) != 0) {
+      // Black listed
+      return true;
     }
     // Check the white list for this image
-    for (Index = 0; Index < gSettings.Boot.SecureBootWhiteList.size(); ++Index) {
-      if ( gSettings.Boot.SecureBootWhiteList[Index].notEmpty() &&
-          DevicePathStr.contains(gSettings.Boot.SecureBootWhiteList[Index]) ) {
-        // White listed
-        *AuthenticationStatus = EFI_SUCCESS;
-        return true;
-      }
+    if ((Verdict & SECURE_BOOT_LIST_WHITE) != 0) {
+      // White listed
+      *AuthenticationStatus = EFI_SUCCESS;
+      return true;
     }
     break;
   }
@@ -485,6 +677,14 @@ void InitializeSecureBoot(void)
   if (GlobalConfig.SecureBootSetupMode) {
     GlobalConfig.SecureBoot = 0;
   }
+  // Settings were (re)loaded, compile the lists again
+  CompileSecureBootLists();
+}
+
+// Compile the secure boot lists of reloaded settings
+void ReloadSecureBootLists(void)
+{
+  CompileSecureBootLists();
 }
 
 #endif // ENABLE_SECURE_BOOT
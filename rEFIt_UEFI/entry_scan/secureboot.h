@@ -28,6 +28,7 @@
 
 #ifdef ENABLE_SECURE_BOOT
 void InitializeSecureBoot(void);
+void ReloadSecureBootLists(void);
 #endif
 
 #endif /* ENTRY_SCAN_SECUREBOOT_H_ */
@@ -61,259 +61,345 @@
 #define PKCS1_1_5_SIZE (CERT_SIZE + sizeof(EFI_GUID))
 #define EFIGUID_SIZE (CERT_SIZE + sizeof(EFI_GUID))
 
-// Check database for signature
-STATIC EFI_STATUS CheckSignatureIsInDatabase(IN void             *Database,
-                                             IN UINTN             DatabaseSize,
-                                             const EFI_GUID& SignatureType,
-                                             IN void             *Signature,
-                                             IN UINTN             SignatureSize)
+// Signatures of a database hashed by type, size and content so membership is O(1)
+// Entries point into the databases they were added from, which must outlive the set
+typedef struct {
+  CONST EFI_GUID *SignatureType;
+  CONST UINT8    *Signature;
+  UINTN           SignatureSize;
+  UINT32          Hash;
+} SIGNATURE_SET_ENTRY;
+
+typedef struct {
+  SIGNATURE_SET_ENTRY *Entries;
+  UINTN                Capacity;
+  UINTN                Count;
+} SIGNATURE_SET;
+
+// The authorized database as last read, indexed so images can be checked without reading NVRAM
+STATIC void          *mAuthorizedDatabase = NULL;
+STATIC UINTN          mAuthorizedDatabaseSize = 0;
+STATIC SIGNATURE_SET  mAuthorizedSet = { NULL, 0, 0 };
+STATIC XBool          mAuthorizedSetValid = false;
+
+// FNV-1a over the signature type and data
+STATIC UINT32 HashSignature(const EFI_GUID&  SignatureType,
+                            CONST UINT8     *Signature,
+                            UINTN            SignatureSize)
 {
-  UINT8 *DatabasePtr;
-  UINT8 *DatabaseEnd;
-  // Check parameters
-  if ( SignatureType.isNull()  ||  Signature == NULL  ||  SignatureSize == 0 ) {
-    return EFI_INVALID_PARAMETER;
+  CONST UINT8 *Type = (CONST UINT8 *)&SignatureType;
+  UINT32       Hash = 2166136261U ^ (UINT32)SignatureSize;
+  UINTN        Index;
+  for (Index = 0; Index < sizeof(EFI_GUID); ++Index) {
+    Hash = (Hash ^ Type[Index]) * 16777619U;
   }
-  if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    return EFI_NOT_FOUND;
+  for (Index = 0; Index < SignatureSize; ++Index) {
+    Hash = (Hash ^ Signature[Index]) * 16777619U;
   }
-  // Get the database start and end
-  DatabasePtr = (UINT8 *)Database;
-  DatabaseEnd = DatabasePtr + DatabaseSize;
-  // Traverse the database
-  while (DatabasePtr < DatabaseEnd) {
-    EFI_SIGNATURE_LIST *SignatureList = (EFI_SIGNATURE_LIST *)DatabasePtr;
-    UINT8              *Ptr, *End;
-    // Check the list is valid
-    if ((SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
-      return EFI_INVALID_PARAMETER;
-    }
-    // Check if this signature list can contain the signature
-    if (((SignatureSize + sizeof(EFI_GUID)) == SignatureList->SignatureSize)  &&  SignatureType == SignatureList->SignatureType ) {
-      // Get signature list data start
-      UINTN Offset = SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST);
-      Ptr = ((UINT8 *)SignatureList) + Offset;
-      End = Ptr + (SignatureList->SignatureListSize - Offset);
-      Ptr += sizeof(EFI_GUID);
-      // Check for the signature
-      while (Ptr < End) {
-        if (CompareMem(Ptr, Signature, SignatureSize) == 0) {
-          // The signature was found
-          return EFI_SUCCESS;
-        }
-        Ptr += SignatureList->SignatureSize;
-      }
+  return Hash;
+}
+
+STATIC void FreeSignatureSet(IN OUT SIGNATURE_SET *Set)
+{
+  if (Set->Entries != NULL) {
+    FreePool(Set->Entries);
+  }
+  Set->Entries = NULL;
+  Set->Capacity = 0;
+  Set->Count = 0;
+}
+
+// Find the slot holding the signature or the empty slot where it belongs
+STATIC SIGNATURE_SET_ENTRY *FindSignatureSlot(IN SIGNATURE_SET_ENTRY *Entries,
+                                              IN UINTN                Capacity,
+                                              const EFI_GUID&         SignatureType,
+                                              IN CONST UINT8         *Signature,
+                                              IN UINTN                SignatureSize,
+                                              IN UINT32               Hash)
+{
+  UINTN Mask = Capacity - 1;
+  UINTN Index = Hash & Mask;
+  while (Entries[Index].Signature != NULL) {
+    SIGNATURE_SET_ENTRY *Entry = &Entries[Index];
+    if ((Entry->Hash == Hash) && (Entry->SignatureSize == SignatureSize) &&
+        *Entry->SignatureType == SignatureType &&
+        (CompareMem(Entry->Signature, Signature, SignatureSize) == 0)) {
+      return Entry;
     }
-    // Get the next signature list
-    DatabasePtr += SignatureList->SignatureListSize;
+    Index = (Index + 1) & Mask;
   }
-  return EFI_NOT_FOUND;
+  return &Entries[Index];
 }
 
-// Append a signature to a signature list
-STATIC EFI_STATUS AppendSignatureToList(IN OUT EFI_SIGNATURE_LIST **SignatureList,
-                                        const  EFI_GUID&       SignatureType,
-                                        IN     void                *Signature,
-                                        IN     UINTN                SignatureSize)
+STATIC XBool IsSignatureInSet(IN CONST SIGNATURE_SET *Set,
+                              const EFI_GUID&         SignatureType,
+                              IN CONST UINT8         *Signature,
+                              IN UINTN                SignatureSize)
 {
-  EFI_SIGNATURE_LIST *OldSignatureList;
-  EFI_SIGNATURE_LIST *NewSignatureList;
-  UINT8              *Ptr, *End;
-  UINTN               Offset;
-  UINT32              DataSize = (UINT32)(SignatureSize + sizeof(EFI_GUID));
-  // Check parameters
-  if ( SignatureList == NULL  ||  SignatureType.isNull()  ||  Signature == NULL  ||  SignatureSize == 0 ) {
-    return EFI_INVALID_PARAMETER;
+  if ((Set == NULL) || (Set->Count == 0)) {
+    return false;
   }
-  // Check if there is an old signature list
-  OldSignatureList = *SignatureList;
-  if (OldSignatureList == NULL) {
-    // There is no list so create a new signature list
-    NewSignatureList = (EFI_SIGNATURE_LIST *)AllocateZeroPool(sizeof(EFI_SIGNATURE_LIST) + DataSize);
-    if (NewSignatureList == NULL) {
+  return FindSignatureSlot(Set->Entries, Set->Capacity, SignatureType, Signature, SignatureSize,
+                           HashSignature(SignatureType, Signature, SignatureSize))->Signature != NULL;
+}
+
+// Add a signature to the set, EFI_ALREADY_STARTED if it was already there
+STATIC EFI_STATUS InsertSignatureInSet(IN OUT SIGNATURE_SET *Set,
+                                       const EFI_GUID&       SignatureType,
+                                       IN CONST UINT8       *Signature,
+                                       IN UINTN              SignatureSize)
+{
+  UINT32               Hash = HashSignature(SignatureType, Signature, SignatureSize);
+  SIGNATURE_SET_ENTRY *Slot;
+  // Keep the table at most half full
+  if (((Set->Count + 1) * 2) > Set->Capacity) {
+    UINTN                NewCapacity = (Set->Capacity == 0) ? 64 : (Set->Capacity * 2);
+    SIGNATURE_SET_ENTRY *NewEntries = (SIGNATURE_SET_ENTRY *)AllocateZeroPool(NewCapacity * sizeof(SIGNATURE_SET_ENTRY));
+    UINTN                Index;
+    if (NewEntries == NULL) {
       return EFI_OUT_OF_RESOURCES;
     }
-    // Copy the signature to the list
-    NewSignatureList->SignatureType = SignatureType;
-    NewSignatureList->SignatureListSize = (UINT32)(DataSize + sizeof(EFI_SIGNATURE_LIST));
-    NewSignatureList->SignatureSize = (UINT32)DataSize;
-    *SignatureList = NewSignatureList;
-    return EFI_SUCCESS;
-  }
-  // Check the signature type and size matches this list
-  if ((OldSignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (OldSignatureList->SignatureSize <= sizeof(EFI_GUID)) ||
-      (DataSize != OldSignatureList->SignatureSize) ||
-      SignatureType != OldSignatureList->SignatureType ) {
-    return EFI_INVALID_PARAMETER;
-  }
-  // Get the start of signatures data but offset by sizeof(EFI_GUID) so we can skip owner
-  Offset = sizeof(EFI_SIGNATURE_LIST) + OldSignatureList->SignatureHeaderSize;
-  Ptr = ((UINT8 *)OldSignatureList) + Offset;
-  End = Ptr + (OldSignatureList->SignatureListSize - Offset);
-  Ptr += sizeof(EFI_GUID);
-  // Check the signature doesn't already exist in list
-  while (Ptr < End) {
-    if (CompareMem(Ptr + sizeof(EFI_GUID), Signature, SignatureSize) == 0) {
-      // Just pretend like we added it if it exists already
-      return EFI_SUCCESS;
+    for (Index = 0; Index < Set->Capacity; ++Index) {
+      SIGNATURE_SET_ENTRY *Entry = &Set->Entries[Index];
+      if (Entry->Signature != NULL) {
+        *FindSignatureSlot(NewEntries, NewCapacity, *Entry->SignatureType, Entry->Signature, Entry->SignatureSize, Entry->Hash) = *Entry;
+      }
+    }
+    if (Set->Entries != NULL) {
+      FreePool(Set->Entries);
     }
-    Ptr += OldSignatureList->SignatureSize;
+    Set->Entries = NewEntries;
+    Set->Capacity = NewCapacity;
   }
-  // Create a new list for signatures
-  NewSignatureList = (EFI_SIGNATURE_LIST *)AllocateZeroPool(OldSignatureList->SignatureListSize + DataSize);
-  if (NewSignatureList == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Slot = FindSignatureSlot(Set->Entries, Set->Capacity, SignatureType, Signature, SignatureSize, Hash);
+  if (Slot->Signature != NULL) {
+    return EFI_ALREADY_STARTED;
   }
-  // Copy old list to new
-  CopyMem(NewSignatureList, OldSignatureList, OldSignatureList->SignatureListSize);
-  // Increase list size
-  NewSignatureList->SignatureListSize += DataSize;
-  // Copy new signature
-  CopyMem(((UINT8 *)NewSignatureList) + OldSignatureList->SignatureListSize + sizeof(EFI_GUID), Signature, SignatureSize);
-  // Update the list and free old
-  *SignatureList = NewSignatureList;
-  FreePool(OldSignatureList);
+  Slot->SignatureType = &SignatureType;
+  Slot->Signature = Signature;
+  Slot->SignatureSize = SignatureSize;
+  Slot->Hash = Hash;
+  ++(Set->Count);
   return EFI_SUCCESS;
 }
 
-// Append a signature list to a signature database
-STATIC EFI_STATUS AppendSignatureListToDatabase(IN OUT void               **Database,
-                                                IN OUT UINTN               *DatabaseSize,
-                                                IN     EFI_SIGNATURE_LIST  *SignatureList)
+// Check a signature list lies within the database and can hold signatures
+STATIC XBool IsSignatureListValid(IN EFI_SIGNATURE_LIST *SignatureList,
+                                  IN UINT8              *DatabaseEnd)
 {
-  EFI_SIGNATURE_LIST *List = NULL;
-  UINT8              *Ptr, *End;
-  UINT8              *OldDatabase;
-  UINT8              *NewDatabase;
-  UINTN               OldDatabaseSize;
-  UINTN               NewDatabaseSize;
-  UINTN               Size;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) || (SignatureList == NULL) ||
-      (SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
-    return EFI_INVALID_PARAMETER;
+  UINT8 *ListPtr = (UINT8 *)SignatureList;
+  if ((ListPtr + sizeof(EFI_SIGNATURE_LIST)) > DatabaseEnd) {
+    return false;
   }
-  // Get old database
-  OldDatabase = (UINT8 *)*Database;
-  OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    // No database so just set it to the signature list
-    NewDatabaseSize = SignatureList->SignatureListSize;
-    NewDatabase = (UINT8 *)AllocatePool(NewDatabaseSize);
-    if (NewDatabase == NULL) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-    // Free the old database if needed
-    if (OldDatabase != NULL) {
-      FreePool(OldDatabase);
-    }
-    // Copy the signature list to the database
-    CopyMem(*Database = NewDatabase, SignatureList, *DatabaseSize = NewDatabaseSize);
+  return (SignatureList->SignatureListSize > sizeof(EFI_SIGNATURE_LIST)) &&
+         (SignatureList->SignatureSize > sizeof(EFI_GUID)) &&
+         (SignatureList->SignatureListSize <= (UINTN)(DatabaseEnd - ListPtr)) &&
+         ((sizeof(EFI_SIGNATURE_LIST) + SignatureList->SignatureHeaderSize) <= SignatureList->SignatureListSize);
+}
+
+// Add every signature of a database to the set
+STATIC EFI_STATUS AddDatabaseToSignatureSet(IN OUT SIGNATURE_SET *Set,
+                                            IN     void          *Database,
+                                            IN     UINTN          DatabaseSize)
+{
+  UINT8 *DatabasePtr = (UINT8 *)Database;
+  UINT8 *DatabaseEnd = DatabasePtr + DatabaseSize;
+  if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_SUCCESS;
   }
-  // Rebuild the signature list with only signatures that aren't found in database
-  Ptr = ((UINT8 *)SignatureList) + SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  End = ((UINT8 *)SignatureList) + SignatureList->SignatureListSize;
-  Size = (SignatureList->SignatureSize - sizeof(EFI_GUID));
-  while (Ptr < End) {
-    // Check signature is already in database
-    EFI_STATUS Status = CheckSignatureIsInDatabase(OldDatabase, OldDatabaseSize, SignatureList->SignatureType, Ptr, Size);
-    if (Status == EFI_NOT_FOUND) {
-      // Add to new signature list if not found in database
-      Status = AppendSignatureToList(&List, SignatureList->SignatureType, Ptr, Size);
+  while (DatabasePtr < DatabaseEnd) {
+    EFI_SIGNATURE_LIST *SignatureList = (EFI_SIGNATURE_LIST *)DatabasePtr;
+    UINT8              *Ptr, *End;
+    if (!IsSignatureListValid(SignatureList, DatabaseEnd)) {
+      return EFI_INVALID_PARAMETER;
     }
-    if (EFI_ERROR(Status)) {
-      if (List != NULL) {
-        FreePool(List);
+    Ptr = DatabasePtr + sizeof(EFI_SIGNATURE_LIST) + SignatureList->SignatureHeaderSize;
+    End = DatabasePtr + SignatureList->SignatureListSize;
+    while ((Ptr + SignatureList->SignatureSize) <= End) {
+      EFI_STATUS Status = InsertSignatureInSet(Set, SignatureList->SignatureType, Ptr + sizeof(EFI_GUID), SignatureList->SignatureSize - sizeof(EFI_GUID));
+      if (EFI_ERROR(Status) && (Status != EFI_ALREADY_STARTED)) {
+        return Status;
       }
-      return Status;
+      Ptr += SignatureList->SignatureSize;
     }
-    Ptr += SignatureList->SignatureSize;
-  }
-  // Check any signatures remain to be added
-  if (List == NULL) {
-    return EFI_SUCCESS;
+    DatabasePtr += SignatureList->SignatureListSize;
   }
-  // Check the list is valid
-  if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (List->SignatureSize <= sizeof(EFI_GUID))) {
-    FreePool(List);
-    // Unsure if this should return an error or success
-    return EFI_SUCCESS;
+  return EFI_SUCCESS;
+}
+
+// Count how many signatures of a database are in the set
+STATIC UINTN CountDatabaseSignaturesInSet(IN  CONST SIGNATURE_SET *Set,
+                                          IN  void                *Database,
+                                          IN  UINTN                DatabaseSize,
+                                          OUT UINTN               *Total)
+{
+  UINT8 *DatabasePtr = (UINT8 *)Database;
+  UINT8 *DatabaseEnd = DatabasePtr + DatabaseSize;
+  UINTN  Found = 0;
+  *Total = 0;
+  while (DatabasePtr < DatabaseEnd) {
+    EFI_SIGNATURE_LIST *SignatureList = (EFI_SIGNATURE_LIST *)DatabasePtr;
+    UINT8              *Ptr, *End;
+    if (!IsSignatureListValid(SignatureList, DatabaseEnd)) {
+      break;
+    }
+    Ptr = DatabasePtr + sizeof(EFI_SIGNATURE_LIST) + SignatureList->SignatureHeaderSize;
+    End = DatabasePtr + SignatureList->SignatureListSize;
+    while ((Ptr + SignatureList->SignatureSize) <= End) {
+      if (IsSignatureInSet(Set, SignatureList->SignatureType, Ptr + sizeof(EFI_GUID), SignatureList->SignatureSize - sizeof(EFI_GUID))) {
+        ++Found;
+      }
+      ++(*Total);
+      Ptr += SignatureList->SignatureSize;
+    }
+    DatabasePtr += SignatureList->SignatureListSize;
   }
-  // Create a new database
-  NewDatabaseSize = OldDatabaseSize + List->SignatureListSize;
-  NewDatabase = (UINT8 *)AllocatePool(NewDatabaseSize);
-  if (NewDatabase == NULL) {
-    FreePool(List);
-    return EFI_OUT_OF_RESOURCES;
+  return Found;
+}
+
+STATIC void InvalidateAuthorizedSignatureSet(void)
+{
+  FreeSignatureSet(&mAuthorizedSet);
+  if (mAuthorizedDatabase != NULL) {
+    FreePool(mAuthorizedDatabase);
+    mAuthorizedDatabase = NULL;
   }
-  // Copy original database and free it
-  CopyMem(*Database = NewDatabase, OldDatabase, OldDatabaseSize);
-  FreePool(OldDatabase);
-  // Append signature list to end of database
-  CopyMem(NewDatabase + OldDatabaseSize, List, List->SignatureListSize);
-  *DatabaseSize = NewDatabaseSize;
-  FreePool(List);
-  return EFI_SUCCESS;
+  mAuthorizedDatabaseSize = 0;
+  mAuthorizedSetValid = false;
 }
 
-// Append a signature to a signature database
-EFI_STATUS AppendSignatureToDatabase(IN OUT void          **Database,
-                                     IN OUT UINTN          *DatabaseSize,
-                                     const  EFI_GUID&  SignatureType,
-                                     IN     void           *Signature,
-                                     IN     UINTN           SignatureSize)
+// Get the index of the authorized database, reading it only if it was changed since last time
+STATIC CONST SIGNATURE_SET *GetAuthorizedSignatureSet(void)
 {
-  // Create a new signature list
-  EFI_SIGNATURE_LIST *List = NULL;
-  EFI_STATUS          Status = AppendSignatureToList(&List, SignatureType, Signature, SignatureSize);
-  if (EFI_ERROR(Status)) {
-    if (List != NULL) {
-      FreePool(List);
+  if (!mAuthorizedSetValid) {
+    mAuthorizedDatabase = GetAuthorizedDatabase(&mAuthorizedDatabaseSize);
+    if (EFI_ERROR(AddDatabaseToSignatureSet(&mAuthorizedSet, mAuthorizedDatabase, mAuthorizedDatabaseSize))) {
+      InvalidateAuthorizedSignatureSet();
+      return NULL;
     }
-    return Status;
+    DBG("Authorized database indexed: %llu signatures\n", (UINT64)mAuthorizedSet.Count);
+    mAuthorizedSetValid = true;
   }
-  // Add the signature list to database
-  Status = AppendSignatureListToDatabase(Database, DatabaseSize, List);
-  FreePool(List);
-  return Status;
+  return &mAuthorizedSet;
 }
 
-// Append a signature database to another signature database
+// Append a signature database to another signature database, skipping signatures already present
 EFI_STATUS AppendSignatureDatabaseToDatabase(IN OUT void  **Database,
                                              IN OUT UINTN  *DatabaseSize,
                                              IN     void   *SignatureDatabase,
                                              IN     UINTN   SignatureDatabaseSize)
 {
-  UINT8 *Ptr, *End;
+  EFI_STATUS     Status;
+  SIGNATURE_SET  Set = { NULL, 0, 0 };
+  UINT8         *OldDatabase;
+  UINT8         *NewDatabase;
+  UINTN          OldDatabaseSize;
+  UINTN          NewDatabaseSize;
+  UINT8         *Ptr, *End;
   // Check parameters
   if ((Database == NULL) || (DatabaseSize == NULL) ||
       (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
-  // Get the signature database start
+  // Get old database, an empty one is replaced
+  OldDatabase = (UINT8 *)*Database;
+  OldDatabaseSize = *DatabaseSize;
+  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
+    OldDatabaseSize = 0;
+  }
+  // Index the old database once instead of searching it for every signature
+  Status = AddDatabaseToSignatureSet(&Set, OldDatabase, OldDatabaseSize);
+  if (EFI_ERROR(Status)) {
+    FreeSignatureSet(&Set);
+    return Status;
+  }
+  // The appended lists can't be larger than the ones they are taken from
+  NewDatabase = (UINT8 *)AllocatePool(OldDatabaseSize + SignatureDatabaseSize);
+  if (NewDatabase == NULL) {
+    FreeSignatureSet(&Set);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(NewDatabase, OldDatabase, OldDatabaseSize);
+  NewDatabaseSize = OldDatabaseSize;
+  // Copy each signature list with only the signatures that aren't found yet
   Ptr = (UINT8 *)SignatureDatabase;
   End = Ptr + SignatureDatabaseSize;
   while (Ptr < End) {
-    // Get each signature list in signature database
     EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      return EFI_INVALID_PARAMETER;
+    EFI_SIGNATURE_LIST *NewList = (EFI_SIGNATURE_LIST *)(NewDatabase + NewDatabaseSize);
+    UINTN               Offset;
+    UINTN               NewListSize;
+    if (!IsSignatureListValid(List, End)) {
+      Status = EFI_INVALID_PARAMETER;
+      break;
+    }
+    Offset = sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    CopyMem(NewList, List, Offset);
+    NewListSize = Offset;
+    while ((Offset + List->SignatureSize) <= List->SignatureListSize) {
+      Status = InsertSignatureInSet(&Set, List->SignatureType, Ptr + Offset + sizeof(EFI_GUID), List->SignatureSize - sizeof(EFI_GUID));
+      if (Status == EFI_SUCCESS) {
+        CopyMem(((UINT8 *)NewList) + NewListSize, Ptr + Offset, List->SignatureSize);
+        NewListSize += List->SignatureSize;
+      } else if (Status != EFI_ALREADY_STARTED) {
+        break;
+      }
+      Status = EFI_SUCCESS;
+      Offset += List->SignatureSize;
     }
-    // Add the signature list to the database
-    Status = AppendSignatureListToDatabase(Database, DatabaseSize, List);
     if (EFI_ERROR(Status)) {
-      return Status;
+      break;
+    }
+    // Keep the list only if it got any signature
+    if (NewListSize > (sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize)) {
+      NewList->SignatureListSize = (UINT32)NewListSize;
+      NewDatabaseSize += NewListSize;
     }
     Ptr += List->SignatureListSize;
   }
+  FreeSignatureSet(&Set);
+  if (EFI_ERROR(Status) || (NewDatabaseSize == OldDatabaseSize)) {
+    // Nothing was added
+    FreePool(NewDatabase);
+    return Status;
+  }
+  if (OldDatabase != NULL) {
+    FreePool(OldDatabase);
+  }
+  *Database = NewDatabase;
+  *DatabaseSize = NewDatabaseSize;
   return EFI_SUCCESS;
 }
 
+// Append a signature to a signature database
+EFI_STATUS AppendSignatureToDatabase(IN OUT void          **Database,
+                                     IN OUT UINTN          *DatabaseSize,
+                                     const  EFI_GUID&  SignatureType,
+                                     IN     void           *Signature,
+                                     IN     UINTN           SignatureSize)
+{
+  EFI_SIGNATURE_LIST *List;
+  UINTN               ListSize = sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID) + SignatureSize;
+  EFI_STATUS          Status;
+  // Check parameters
+  if ( SignatureType.isNull()  ||  Signature == NULL  ||  SignatureSize == 0 ) {
+    return EFI_INVALID_PARAMETER;
+  }
+  // Create a signature list with only this signature
+  List = (EFI_SIGNATURE_LIST *)AllocateZeroPool(ListSize);
+  if (List == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  List->SignatureType = SignatureType;
+  List->SignatureListSize = (UINT32)ListSize;
+  List->SignatureSize = (UINT32)(sizeof(EFI_GUID) + SignatureSize);
+  CopyMem(((UINT8 *)List) + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID), Signature, SignatureSize);
+  // Add the signature list to database
+  Status = AppendSignatureDatabaseToDatabase(Database, DatabaseSize, List, ListSize);
+  FreePool(List);
+  return Status;
+}
+
 // Add image signature database to authorized database
 EFI_STATUS AppendImageDatabaseToAuthorizedDatabase(IN void  *Database,
                                                    IN UINTN  DatabaseSize)
@@ -321,10 +407,18 @@ EFI_STATUS AppendImageDatabaseToAuthorizedDatabase(IN void  *Database,
   EFI_STATUS  Status;
   void       *AuthDatabase;
   UINTN       AuthDatabaseSize;
+  CONST SIGNATURE_SET *AuthSet;
+  UINTN       Total;
   // Check parameters
   if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
+  // Nothing to write if every signature is already authorized
+  AuthSet = GetAuthorizedSignatureSet();
+  if ((AuthSet != NULL) && (CountDatabaseSignaturesInSet(AuthSet, Database, DatabaseSize, &Total) == Total) && (Total != 0)) {
+    DBG("Image signatures already authorized\n");
+    return EFI_SUCCESS;
+  }
   // Get the authorized database
   AuthDatabase = GetAuthorizedDatabase(&AuthDatabaseSize);
   // Add the signature database to the authorized database
@@ -349,154 +443,87 @@ EFI_STATUS AppendImageDatabaseToAuthorizedDatabase(IN void  *Database,
   return Status;
 }
 
-STATIC EFI_STATUS RemoveSignatureFromDatabase(IN OUT void           **Database,
-                                              IN OUT UINTN           *DatabaseSize,
-                                              const  EFI_GUID&   SignatureType,
-                                              IN     void            *Signature,
-                                              IN     UINTN            SignatureSize)
+// Remove the signatures of a signature database from another signature database
+STATIC EFI_STATUS RemoveSignatureDatabaseFromDatabase(IN OUT void  **Database,
+                                                      IN OUT UINTN  *DatabaseSize,
+                                                      IN     void   *SignatureDatabase,
+                                                      IN     UINTN   SignatureDatabaseSize)
 {
-  UINT8 *Ptr, *End;
-  void  *OldDatabase;
-  void  *NewDatabase = NULL;
-  UINTN  OldDatabaseSize;
-  UINTN  NewDatabaseSize = 0;
+  EFI_STATUS     Status;
+  SIGNATURE_SET  Set = { NULL, 0, 0 };
+  UINT8         *OldDatabase;
+  UINT8         *NewDatabase;
+  UINTN          OldDatabaseSize;
+  UINTN          NewDatabaseSize = 0;
+  UINT8         *Ptr, *End;
   // Check parameters
-  if ( Database == NULL  ||  DatabaseSize == NULL  ||  SignatureType.isNull()  ||  Signature == NULL  ||  SignatureSize <= sizeof(EFI_SIGNATURE_LIST) ) {
+  if ((Database == NULL) || (DatabaseSize == NULL) ||
+      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
+  // Get old database
   OldDatabase = (UINT8 *)*Database;
   OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    // Nothing to do if the database is empty
+  if ((OldDatabase == NULL) || (OldDatabaseSize == 0)) {
+    // Nothing to remove
     return EFI_SUCCESS;
   }
-  // Get the signature database start
-  Ptr = (UINT8 *)OldDatabase;
+  // Index the signatures to remove
+  Status = AddDatabaseToSignatureSet(&Set, SignatureDatabase, SignatureDatabaseSize);
+  if (EFI_ERROR(Status)) {
+    FreeSignatureSet(&Set);
+    return Status;
+  }
+  NewDatabase = (UINT8 *)AllocatePool(OldDatabaseSize);
+  if (NewDatabase == NULL) {
+    FreeSignatureSet(&Set);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  // Copy each signature list without the removed signatures
+  Ptr = OldDatabase;
   End = Ptr + OldDatabaseSize;
   while (Ptr < End) {
-    // Get each signature list in signature database
     EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status = EFI_SUCCESS;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      if (NewDatabase != NULL) {
-        FreePool(NewDatabase);
-      }
-      return EFI_INVALID_PARAMETER;
+    EFI_SIGNATURE_LIST *NewList = (EFI_SIGNATURE_LIST *)(NewDatabase + NewDatabaseSize);
+    UINTN               Offset;
+    UINTN               NewListSize;
+    if (!IsSignatureListValid(List, End)) {
+      Status = EFI_INVALID_PARAMETER;
+      break;
     }
-    // Check this signature could be found in this list
-    if ( List->SignatureSize - sizeof(EFI_GUID) == SignatureSize  &&  SignatureType == List->SignatureType ) {
-      // Remove the signature list from the database
-      UINT8 *ListPtr = Ptr + List->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-      UINT8 *ListEnd = Ptr + List->SignatureListSize;
-      EFI_SIGNATURE_LIST *NewList = NULL;
-      while (ListPtr < ListEnd) {
-        // Compare the signatures
-        if (CompareMem(Ptr, Signature, SignatureSize) != 0) {
-          // Not a match so append it to new list
-          Status = AppendSignatureToList(&NewList, SignatureType, Ptr, SignatureSize);
-          if (EFI_ERROR(Status)) {
-            if (NewList != NULL) {
-              FreePool(NewList);
-            }
-            if (NewDatabase != NULL) {
-              FreePool(NewDatabase);
-            }
-            return Status;
-          }
-        }
-        ListPtr += List->SignatureSize;
-      }
-      // Append new list if any
-      if (NewList != NULL) {
-        Status = AppendSignatureListToDatabase(&NewDatabase, &NewDatabaseSize, NewList);
-        FreePool(NewList);
+    Offset = sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize;
+    CopyMem(NewList, List, Offset);
+    NewListSize = Offset;
+    while ((Offset + List->SignatureSize) <= List->SignatureListSize) {
+      if (!IsSignatureInSet(&Set, List->SignatureType, Ptr + Offset + sizeof(EFI_GUID), List->SignatureSize - sizeof(EFI_GUID))) {
+        CopyMem(((UINT8 *)NewList) + NewListSize, Ptr + Offset, List->SignatureSize);
+        NewListSize += List->SignatureSize;
       }
-    } else {
-      // Append this whole list as it can't hold the signature
-      Status = AppendSignatureListToDatabase(&NewDatabase, &NewDatabaseSize, List);
+      Offset += List->SignatureSize;
     }
-    if (EFI_ERROR(Status)) {
-      if (NewDatabase != NULL) {
-        FreePool(NewDatabase);
-      }
-      return Status;
+    // Drop the list if no signature is left
+    if (NewListSize > (sizeof(EFI_SIGNATURE_LIST) + List->SignatureHeaderSize)) {
+      NewList->SignatureListSize = (UINT32)NewListSize;
+      NewDatabaseSize += NewListSize;
     }
     Ptr += List->SignatureListSize;
   }
+  FreeSignatureSet(&Set);
+  if (EFI_ERROR(Status)) {
+    FreePool(NewDatabase);
+    return Status;
+  }
   // Set new database
+  if (NewDatabaseSize == 0) {
+    FreePool(NewDatabase);
+    NewDatabase = NULL;
+  }
   *Database = NewDatabase;
   *DatabaseSize = NewDatabaseSize;
   FreePool(OldDatabase);
   return EFI_SUCCESS;
 }
 
-STATIC EFI_STATUS RemoveSignatureListFromDatabase(IN OUT void               **Database,
-                                                  IN OUT UINTN               *DatabaseSize,
-                                                  IN     EFI_SIGNATURE_LIST  *SignatureList)
-{
-  UINT8              *Ptr, *End;
-  UINT8              *OldDatabase;
-  UINTN               OldDatabaseSize;
-  UINTN               Size;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) || (SignatureList == NULL) ||
-      (SignatureList->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) ||
-      (SignatureList->SignatureSize <= sizeof(EFI_GUID))) {
-    return EFI_INVALID_PARAMETER;
-  }
-  // Get old database
-  OldDatabase = (UINT8 *)*Database;
-  OldDatabaseSize = *DatabaseSize;
-  if ((OldDatabase == NULL) || (OldDatabaseSize == 0)) {
-    // Nothing to remove
-    return EFI_SUCCESS;
-  }
-  // Remove the signatures found in the list from the database
-  Ptr = ((UINT8 *)SignatureList) + SignatureList->SignatureHeaderSize + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  End = ((UINT8 *)SignatureList) + SignatureList->SignatureListSize;
-  Size = (SignatureList->SignatureSize - sizeof(EFI_GUID));
-  while (Ptr < End) {
-    // Remove signature from database
-    EFI_STATUS Status = RemoveSignatureFromDatabase(Database, DatabaseSize, SignatureList->SignatureType, Ptr, Size);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
-    Ptr += SignatureList->SignatureSize;
-  }
-  return EFI_SUCCESS;
-}
-
-STATIC EFI_STATUS RemoveSignatureDatabaseFromDatabase(IN OUT void  **Database,
-                                                      IN OUT UINTN  *DatabaseSize,
-                                                      IN     void   *SignatureDatabase,
-                                                      IN     UINTN   SignatureDatabaseSize)
-{
-  UINT8 *Ptr, *End;
-  // Check parameters
-  if ((Database == NULL) || (DatabaseSize == NULL) ||
-      (SignatureDatabase == NULL) || (SignatureDatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
-    return EFI_INVALID_PARAMETER;
-  }
-  // Get the signature database start
-  Ptr = (UINT8 *)SignatureDatabase;
-  End = Ptr + SignatureDatabaseSize;
-  while (Ptr < End) {
-    // Get each signature list in signature database
-    EFI_SIGNATURE_LIST *List = (EFI_SIGNATURE_LIST *)Ptr;
-    EFI_STATUS          Status;
-    if ((List->SignatureListSize <= sizeof(EFI_SIGNATURE_LIST)) || (List->SignatureSize <= sizeof(EFI_GUID))) {
-      return EFI_INVALID_PARAMETER;
-    }
-    // Remove the signature list from the database
-    Status = RemoveSignatureListFromDatabase(Database, DatabaseSize, List);
-    if (EFI_ERROR(Status)) {
-      return Status;
-    }
-    Ptr += List->SignatureListSize;
-  }
-  return EFI_SUCCESS;
-}
-
 // Remove image signature database from authorized database
 EFI_STATUS RemoveImageDatabaseFromAuthorizedDatabase(IN void  *Database,
                                                      IN UINTN  DatabaseSize)
@@ -504,10 +531,18 @@ EFI_STATUS RemoveImageDatabaseFromAuthorizedDatabase(IN void  *Database,
   EFI_STATUS  Status;
   void       *AuthDatabase;
   UINTN       AuthDatabaseSize;
+  CONST SIGNATURE_SET *AuthSet;
+  UINTN       Total;
   // Check parameters
   if ((Database == NULL) || (DatabaseSize <= sizeof(EFI_SIGNATURE_LIST))) {
     return EFI_INVALID_PARAMETER;
   }
+  // Nothing to write if no signature is authorized
+  AuthSet = GetAuthorizedSignatureSet();
+  if ((AuthSet != NULL) && (CountDatabaseSignaturesInSet(AuthSet, Database, DatabaseSize, &Total) == 0) && (Total != 0)) {
+    DBG("Image signatures not in authorized database\n");
+    return EFI_SUCCESS;
+  }
   // Get the authorized database
   AuthDatabase = GetAuthorizedDatabase(&AuthDatabaseSize);
   // Remove the signature database from the authorized database
@@ -537,6 +572,7 @@ void *GetAuthorizedDatabase(UINTN *DatabaseSize)
 EFI_STATUS SetAuthorizedDatabase(IN void  *Database,
                                  IN UINTN  DatabaseSize)
 {
+   InvalidateAuthorizedSignatureSet();
    return SetSignatureDatabase(AUTHORIZED_DATABASE_NAME, AUTHORIZED_DATABASE_GUID, Database, DatabaseSize);
 }
 
@@ -546,44 +582,287 @@ EFI_STATUS ClearAuthorizedDatabase(void)
    return SetAuthorizedDatabase(NULL, 0);
 }
 
-// Create a secure boot image signature
-STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
-                                          IN UINT64  FileSize,
-                                          IN UINTN  *DatabaseSize)
+// SHA-256 used for image hashes, with the x86 SHA extensions when the CPU has them
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SECURE_HASH_SHA_EXT 1
+#else
+#define SECURE_HASH_SHA_EXT 0
+#endif
+
+typedef struct {
+  SHA256_CTX  Ctx;
+  XBool       UseShaExt;
+  UINT32      State[8];
+  UINT8       Block[64];
+  UINTN       BlockUsed;
+  UINT64      Length;
+} SECURE_HASH_SHA256;
+
+#if SECURE_HASH_SHA_EXT
+
+typedef int       SHA_V4SI  __attribute__((vector_size(16)));
+typedef unsigned  SHA_V4SU  __attribute__((vector_size(16)));
+typedef long long SHA_V2DI  __attribute__((vector_size(16)));
+typedef char      SHA_V16QI __attribute__((vector_size(16)));
+typedef short     SHA_V8HI  __attribute__((vector_size(16)));
+
+STATIC CONST UINT32 mSha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Byte swap each 32 bit word of the message
+STATIC CONST UINT8 mSha256ByteSwap[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+
+#ifdef __clang__
+#define SHA_ALIGNR(a, b, n) ((SHA_V4SI)__builtin_ia32_palignr128((SHA_V16QI)(a), (SHA_V16QI)(b), (n)))
+#else
+#define SHA_ALIGNR(a, b, n) ((SHA_V4SI)__builtin_ia32_palignr128((SHA_V2DI)(a), (SHA_V2DI)(b), (n) * 8))
+#endif
+#define SHA_BLEND(a, b, m)  ((SHA_V4SI)__builtin_ia32_pblendw128((SHA_V8HI)(a), (SHA_V8HI)(b), (m)))
+#define SHA_ADD(a, b)       ((SHA_V4SI)((SHA_V4SU)(a) + (SHA_V4SU)(b)))
+// Load four big endian message words
+#define SHA_LOAD(d, n)      __extension__({ SHA_V16QI Raw_; __builtin_memcpy(&Raw_, (d) + (n) * 16, sizeof(Raw_)); (SHA_V4SI)__builtin_ia32_pshufb128(Raw_, Mask); })
+// W[i..i+3] from W[i-16..i-1]
+#define SHA_SCHEDULE(m0, m1, m2, m3) \
+  m0 = __builtin_ia32_sha256msg2(SHA_ADD(__builtin_ia32_sha256msg1(m0, m1), SHA_ALIGNR(m3, m2, 4)), m3)
+// Four rounds with W[i..i+3]
+#define SHA_ROUNDS(m, n) \
+  do { \
+    SHA_V4SI K_; \
+    __builtin_memcpy(&K_, &mSha256K[(n) * 4], sizeof(K_)); \
+    Wk = SHA_ADD(m, K_); \
+    State1 = __builtin_ia32_sha256rnds2(State1, State0, Wk); \
+    Wk = __builtin_ia32_pshufd(Wk, 0x0E); \
+    State0 = __builtin_ia32_sha256rnds2(State0, State1, Wk); \
+  } while (0)
+
+// Process 64 byte blocks with SHA256RNDS2/SHA256MSG1/SHA256MSG2
+__attribute__((target("sha,sse4.1,ssse3")))
+STATIC void Sha256BlocksShaExt(IN OUT UINT32      *State,
+                               IN     CONST UINT8 *Data,
+                               IN     UINTN        Blocks)
 {
-  UINTN                                Index, Size = 0;
-  UINTN                                BytesHashed, HashSize;
-  UINT8                               *Database = NULL;
-  UINT8                               *ImageBase = (UINT8 *)FileBuffer;
-  UINT8                               *HashBase = ImageBase;
-  UINT8                               *HashPtr;
-  SHA256_CTX                           HashCtx;
-  EFI_SIGNATURE_LIST                  *SignatureListPtr;
-  EFI_IMAGE_SECTION_HEADER            *Sections = NULL;
-  EFI_IMAGE_SECTION_HEADER            *SectionPtr;
-  EFI_IMAGE_SECTION_HEADER            *SectionEnd;
-  EFI_IMAGE_DOS_HEADER                *DosHeader;
-  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  PeHeader;
-  UINT32                               PeHeaderOffset;
+  SHA_V4SI  State0, State1, Tmp, Wk;
+  SHA_V16QI Mask;
+  __builtin_memcpy(&Mask, mSha256ByteSwap, sizeof(Mask));
+  __builtin_memcpy(&Tmp, &State[0], sizeof(Tmp));
+  __builtin_memcpy(&State1, &State[4], sizeof(State1));
+  // Reorder the state as the instructions expect it: ABEF and CDGH
+  Tmp = __builtin_ia32_pshufd(Tmp, 0xB1);
+  State1 = __builtin_ia32_pshufd(State1, 0x1B);
+  State0 = SHA_ALIGNR(Tmp, State1, 8);
+  State1 = SHA_BLEND(State1, Tmp, 0xF0);
+  while (Blocks-- > 0) {
+    SHA_V4SI Abef = State0;
+    SHA_V4SI Cdgh = State1;
+    SHA_V4SI Msg0 = SHA_LOAD(Data, 0);
+    SHA_V4SI Msg1 = SHA_LOAD(Data, 1);
+    SHA_V4SI Msg2 = SHA_LOAD(Data, 2);
+    SHA_V4SI Msg3 = SHA_LOAD(Data, 3);
+    SHA_ROUNDS(Msg0, 0);
+    SHA_ROUNDS(Msg1, 1);
+    SHA_ROUNDS(Msg2, 2);
+    SHA_ROUNDS(Msg3, 3);
+    for (UINTN Index = 4; Index < 16; Index += 4) {
+      SHA_SCHEDULE(Msg0, Msg1, Msg2, Msg3);
+      SHA_ROUNDS(Msg0, Index);
+      SHA_SCHEDULE(Msg1, Msg2, Msg3, Msg0);
+      SHA_ROUNDS(Msg1, Index + 1);
+      SHA_SCHEDULE(Msg2, Msg3, Msg0, Msg1);
+      SHA_ROUNDS(Msg2, Index + 2);
+      SHA_SCHEDULE(Msg3, Msg0, Msg1, Msg2);
+      SHA_ROUNDS(Msg3, Index + 3);
+    }
+    State0 = SHA_ADD(State0, Abef);
+    State1 = SHA_ADD(State1, Cdgh);
+    Data += 64;
+  }
+  // Back to ABCD and EFGH
+  Tmp = __builtin_ia32_pshufd(State0, 0x1B);
+  State1 = __builtin_ia32_pshufd(State1, 0xB1);
+  State0 = SHA_BLEND(Tmp, State1, 0xF0);
+  State1 = SHA_ALIGNR(State1, Tmp, 8);
+  __builtin_memcpy(&State[0], &State0, sizeof(State0));
+  __builtin_memcpy(&State[4], &State1, sizeof(State1));
+}
+
+#undef SHA_ALIGNR
+#undef SHA_BLEND
+#undef SHA_ADD
+#undef SHA_LOAD
+#undef SHA_SCHEDULE
+#undef SHA_ROUNDS
+
+STATIC XBool HasShaExtensions(void)
+{
+  STATIC INTN Supported = -1;
+  if (Supported < 0) {
+    UINT32 MaxLeaf, Ecx, Ebx;
+    Supported = 0;
+    AsmCpuid(0, &MaxLeaf, NULL, NULL, NULL);
+    if (MaxLeaf >= 7) {
+      AsmCpuid(1, NULL, NULL, &Ecx, NULL);
+      AsmCpuidEx(7, 0, NULL, &Ebx, NULL, NULL);
+      // SSSE3, SSE4.1 and SHA
+      if (((Ecx & BIT9) != 0) && ((Ecx & BIT19) != 0) && ((Ebx & BIT29) != 0)) {
+        Supported = 1;
+      }
+    }
+    DBG("SHA-256 %s SHA extensions\n", Supported ? "with" : "without");
+  }
+  return Supported != 0;
+}
+
+#endif // SECURE_HASH_SHA_EXT
+
+STATIC XBool Sha256Init(OUT SECURE_HASH_SHA256 *Hash)
+{
+  STATIC CONST UINT32 InitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+#if SECURE_HASH_SHA_EXT
+  Hash->UseShaExt = HasShaExtensions();
+#else
+  Hash->UseShaExt = false;
+#endif
+  if (!Hash->UseShaExt) {
+    return SHA256_Init(&Hash->Ctx) != 0;
+  }
+  CopyMem(Hash->State, InitialState, sizeof(InitialState));
+  Hash->BlockUsed = 0;
+  Hash->Length = 0;
+  return true;
+}
+
+STATIC XBool Sha256Update(IN OUT SECURE_HASH_SHA256 *Hash,
+                          IN     CONST UINT8        *Data,
+                          IN     UINTN               Size)
+{
+  if (!Hash->UseShaExt) {
+    return SHA256_Update(&Hash->Ctx, Data, Size) != 0;
+  }
+#if SECURE_HASH_SHA_EXT
+  Hash->Length += Size;
+  // Complete a partial block first
+  if (Hash->BlockUsed != 0) {
+    UINTN Fill = MIN(Size, sizeof(Hash->Block) - Hash->BlockUsed);
+    CopyMem(Hash->Block + Hash->BlockUsed, Data, Fill);
+    Hash->BlockUsed += Fill;
+    Data += Fill;
+    Size -= Fill;
+    if (Hash->BlockUsed < sizeof(Hash->Block)) {
+      return true;
+    }
+    Sha256BlocksShaExt(Hash->State, Hash->Block, 1);
+    Hash->BlockUsed = 0;
+  }
+  // Whole blocks straight from the data
+  if (Size >= sizeof(Hash->Block)) {
+    Sha256BlocksShaExt(Hash->State, Data, Size / sizeof(Hash->Block));
+    Data += Size & ~(sizeof(Hash->Block) - 1);
+    Size &= sizeof(Hash->Block) - 1;
+  }
+  CopyMem(Hash->Block, Data, Size);
+  Hash->BlockUsed = Size;
+#endif
+  return true;
+}
+
+STATIC XBool Sha256Final(IN OUT SECURE_HASH_SHA256 *Hash,
+                         OUT    UINT8              *Digest)
+{
+  if (!Hash->UseShaExt) {
+    return SHA256_Final(Digest, &Hash->Ctx) != 0;
+  }
+#if SECURE_HASH_SHA_EXT
+  UINT64 Bits = Hash->Length * 8;
+  UINTN  Index;
+  // Pad with 0x80, zeros and the big endian length in bits
+  Hash->Block[Hash->BlockUsed++] = 0x80;
+  if (Hash->BlockUsed > (sizeof(Hash->Block) - sizeof(UINT64))) {
+    ZeroMem(Hash->Block + Hash->BlockUsed, sizeof(Hash->Block) - Hash->BlockUsed);
+    Sha256BlocksShaExt(Hash->State, Hash->Block, 1);
+    Hash->BlockUsed = 0;
+  }
+  ZeroMem(Hash->Block + Hash->BlockUsed, sizeof(Hash->Block) - sizeof(UINT64) - Hash->BlockUsed);
+  for (Index = 0; Index < sizeof(UINT64); ++Index) {
+    Hash->Block[sizeof(Hash->Block) - 1 - Index] = (UINT8)(Bits >> (Index * 8));
+  }
+  Sha256BlocksShaExt(Hash->State, Hash->Block, 1);
+  for (Index = 0; Index < 8; ++Index) {
+    Digest[Index * 4]     = (UINT8)(Hash->State[Index] >> 24);
+    Digest[Index * 4 + 1] = (UINT8)(Hash->State[Index] >> 16);
+    Digest[Index * 4 + 2] = (UINT8)(Hash->State[Index] >> 8);
+    Digest[Index * 4 + 3] = (UINT8)Hash->State[Index];
+  }
+#endif
+  return true;
+}
+
+// A range of the image that is part of the Authenticode hash
+typedef struct {
+  UINT64 Offset;
+  UINT64 Size;
+} AUTHENTICODE_RANGE;
+
+// Add a range to hash, checking it is inside the file
+STATIC XBool AddAuthenticodeRange(IN OUT AUTHENTICODE_RANGE *Ranges,
+                                  IN OUT UINTN              *Count,
+                                  IN     UINT64              Offset,
+                                  IN     UINT64              Size,
+                                  IN     UINT64              FileSize)
+{
+  if ((Offset > FileSize) || (Size > (FileSize - Offset))) {
+    return false;
+  }
+  if (Size != 0) {
+    Ranges[*Count].Offset = Offset;
+    Ranges[*Count].Size = Size;
+    ++(*Count);
+  }
+  return true;
+}
+
+// Get the ranges of a PE image that make up its Authenticode hash, in hashing order
+STATIC AUTHENTICODE_RANGE *GetAuthenticodeRanges(IN  CONST UINT8 *ImageBase,
+                                                 IN  UINT64       FileSize,
+                                                 OUT UINTN       *RangeCount)
+{
+  UINTN                                Index, FirstSection, Count = 0;
+  UINT64                               ChecksumOffset, HeadersEnd, BytesHashed;
+  UINT64                               SecDirOffset = 0;
   UINT32                               CertSize = 0;
+  UINT32                               NumberOfRvaAndSizes;
+  UINT32                               PeHeaderOffset;
+  UINT16                               NumberOfSections;
   UINT16                               Magic;
-  // Check parameters
-  if (DatabaseSize == NULL) {
-    return NULL;
-  }
-  *DatabaseSize = 0;
-  if ((FileBuffer == NULL) || (FileSize == 0)) {
+  AUTHENTICODE_RANGE                  *Ranges;
+  CONST EFI_IMAGE_SECTION_HEADER      *SectionPtr;
+  CONST EFI_IMAGE_DOS_HEADER          *DosHeader;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  PeHeader;
+  *RangeCount = 0;
+  // Check for DOS PE header
+  if (FileSize < sizeof(EFI_IMAGE_DOS_HEADER)) {
     return NULL;
   }
-  // Check for DOS PE header
-  DosHeader = (EFI_IMAGE_DOS_HEADER *)FileBuffer;
+  DosHeader = (CONST EFI_IMAGE_DOS_HEADER *)ImageBase;
   if (DosHeader->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
     PeHeaderOffset = DosHeader->e_lfanew;
   } else {
     PeHeaderOffset = 0;
   }
   // Check for PE header
-  PeHeader.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(((UINT8 *)FileBuffer) + PeHeaderOffset);
+  if ((PeHeaderOffset > FileSize) || ((FileSize - PeHeaderOffset) < sizeof(EFI_IMAGE_NT_HEADERS32))) {
+    return NULL;
+  }
+  PeHeader.Pe32 = (EFI_IMAGE_NT_HEADERS32 *)(ImageBase + PeHeaderOffset);
   if (PeHeader.Pe32->Signature != EFI_IMAGE_NT_SIGNATURE) {
     // Invalid PE image
     return NULL;
@@ -595,115 +874,129 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   } else {
     Magic = PeHeader.Pe32->OptionalHeader.Magic;
   }
-  // Check magic number to get size
+  // Check magic number to get the checksum and security directory
   if (Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
     // PE32
-    HashPtr = (UINT8 *)(&(PeHeader.Pe32->OptionalHeader.CheckSum));
+    ChecksumOffset = (UINT64)((CONST UINT8 *)&(PeHeader.Pe32->OptionalHeader.CheckSum) - ImageBase);
+    NumberOfRvaAndSizes = PeHeader.Pe32->OptionalHeader.NumberOfRvaAndSizes;
+    if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      SecDirOffset = (UINT64)((CONST UINT8 *)&(PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - ImageBase);
+    }
   } else if (Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
     // PE32+
-    HashPtr = (UINT8 *)(&(PeHeader.Pe32Plus->OptionalHeader.CheckSum));
+    if ((FileSize - PeHeaderOffset) < sizeof(EFI_IMAGE_NT_HEADERS64)) {
+      return NULL;
+    }
+    ChecksumOffset = (UINT64)((CONST UINT8 *)&(PeHeader.Pe32Plus->OptionalHeader.CheckSum) - ImageBase);
+    NumberOfRvaAndSizes = PeHeader.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes;
+    if (NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
+      SecDirOffset = (UINT64)((CONST UINT8 *)&(PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]) - ImageBase);
+    }
   } else {
     // Invalid image
-    DBG("Invalid image: 0x%llX (0x%llX)\n", uintptr_t(FileBuffer), FileSize);
+    DBG("Invalid image: 0x%llX (0x%llX)\n", uintptr_t(ImageBase), FileSize);
     return NULL;
   }
-  HashSize = (UINTN)(HashPtr - HashBase);
-  // Initialize the hash context
-  if (SHA256_Init(&HashCtx) == 0) {
-    goto Failed;
+  if (SecDirOffset != 0) {
+    if ((FileSize - SecDirOffset) < sizeof(EFI_IMAGE_DATA_DIRECTORY)) {
+      return NULL;
+    }
+    CertSize = ((CONST EFI_IMAGE_DATA_DIRECTORY *)(ImageBase + SecDirOffset))->Size;
   }
-  // Begin hashing the pe image
-  if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-    goto Failed;
+  // Same field offset for both PE32 and PE32+
+  HeadersEnd = PeHeader.Pe32->OptionalHeader.SizeOfHeaders;
+  // Get the image section headers
+  NumberOfSections = PeHeader.Pe32->FileHeader.NumberOfSections;
+  Index = PeHeaderOffset + sizeof(UINT32) + sizeof(EFI_IMAGE_FILE_HEADER) + PeHeader.Pe32->FileHeader.SizeOfOptionalHeader;
+  if ((Index > FileSize) || (((FileSize - Index) / sizeof(EFI_IMAGE_SECTION_HEADER)) < NumberOfSections)) {
+    return NULL;
   }
-  // Skip the checksum
-  HashBase = HashPtr + sizeof(UINT32);
-  // Skip over the security directory if present
-  if (Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
-    // PE32
-    if (PeHeader.Pe32->OptionalHeader.NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-      // Hash before the security directory
-      HashPtr = (UINT8 *)(&(PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]));
-      HashSize = (HashPtr - HashBase);
-      if (HashSize != 0) {
-        if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-          goto Failed;
-        }
-      }
-      // Set to point at the remaining data if any
-      HashBase = (UINT8 *)(&(PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1]));
-      CertSize = PeHeader.Pe32->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-    }
-    BytesHashed = PeHeader.Pe32->OptionalHeader.SizeOfHeaders;
-  } else {
-    // PE32+
-    if (PeHeader.Pe32Plus->OptionalHeader.NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_SECURITY) {
-      // Hash before the security directory
-      HashPtr = (UINT8 *)(&(PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY]));
-      HashSize = (HashPtr - HashBase);
-      if (HashSize != 0) {
-        if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-          goto Failed;
-        }
-      }
-      // Set to point at the remaining data if any
-      HashBase = (UINT8 *)(&(PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY + 1]));
-      CertSize = PeHeader.Pe32Plus->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_SECURITY].Size;
-    }
-    BytesHashed = PeHeader.Pe32->OptionalHeader.SizeOfHeaders;
+  SectionPtr = (CONST EFI_IMAGE_SECTION_HEADER *)(ImageBase + Index);
+  // Headers in at most three pieces, each section and the trailing data
+  Ranges = (__typeof__(Ranges))AllocatePool(sizeof(AUTHENTICODE_RANGE) * (NumberOfSections + 4));
+  if (Ranges == NULL) {
+    return NULL;
+  }
+  // Hash the headers, skipping the checksum and the security directory entry
+  if (!AddAuthenticodeRange(Ranges, &Count, 0, ChecksumOffset, FileSize)) {
+    goto Failed;
   }
-  // Hash the rest of the data directories if any
-  HashSize = BytesHashed - (UINTN)(HashBase - ImageBase);
-  if (HashSize != 0) {
-    if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
+  BytesHashed = ChecksumOffset + sizeof(UINT32);
+  if (SecDirOffset != 0) {
+    if (!AddAuthenticodeRange(Ranges, &Count, BytesHashed, SecDirOffset - BytesHashed, FileSize)) {
       goto Failed;
     }
+    BytesHashed = SecDirOffset + sizeof(EFI_IMAGE_DATA_DIRECTORY);
   }
-  // Get the image section headers
-  SectionPtr = (EFI_IMAGE_SECTION_HEADER *)(ImageBase + PeHeaderOffset + sizeof(EFI_IMAGE_FILE_HEADER) +
-                                            sizeof(UINT32) + PeHeader.Pe32->FileHeader.SizeOfOptionalHeader);
-  // Allocate a new array for the image section headers
-  Sections = (__typeof__(Sections))AllocateZeroPool(sizeof(EFI_IMAGE_SECTION_HEADER) * PeHeader.Pe32->FileHeader.NumberOfSections);
-  if (Sections == NULL) {
+  if ((HeadersEnd < BytesHashed) ||
+      !AddAuthenticodeRange(Ranges, &Count, BytesHashed, HeadersEnd - BytesHashed, FileSize)) {
     goto Failed;
   }
-  // Sort the image section headers
-  Index = 0;
-  while (Index < PeHeader.Pe32->FileHeader.NumberOfSections) {
-    UINTN Pos = Index++;
-    while ((Pos > 0) && (SectionPtr->PointerToRawData < Sections[Pos - 1].PointerToRawData)) {
-      CopyMem(&Sections[Pos], &Sections[Pos - 1], sizeof(EFI_IMAGE_SECTION_HEADER));
-      --Pos;
-    }
-    CopyMem(&Sections[Pos], SectionPtr++, sizeof(EFI_IMAGE_SECTION_HEADER));
-  }
-  // Hash each image section
-  SectionEnd = Sections + PeHeader.Pe32->FileHeader.NumberOfSections;
-  for (SectionPtr = Sections; SectionPtr < SectionEnd; ++SectionPtr) {
+  BytesHashed = HeadersEnd;
+  FirstSection = Count;
+  // Sort the image sections by file offset, keeping the header order for equal offsets
+  for (Index = 0; Index < NumberOfSections; ++Index, ++SectionPtr) {
+    UINTN Pos = Count;
     // Nothing to do if no size
     if (SectionPtr->SizeOfRawData == 0) {
       continue;
     }
-    // Calculate hash base and size
-    HashBase  = ImageBase + SectionPtr->PointerToRawData;
-    HashSize  = (UINTN)SectionPtr->SizeOfRawData;
-    // Hash the image section
-    if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
+    if (!AddAuthenticodeRange(Ranges, &Count, SectionPtr->PointerToRawData, SectionPtr->SizeOfRawData, FileSize)) {
       goto Failed;
     }
-    BytesHashed += HashSize;
+    while ((Pos > FirstSection) && (Ranges[Pos].Offset < Ranges[Pos - 1].Offset)) {
+      AUTHENTICODE_RANGE Tmp = Ranges[Pos - 1];
+      Ranges[Pos - 1] = Ranges[Pos];
+      Ranges[Pos] = Tmp;
+      --Pos;
+    }
+    BytesHashed += SectionPtr->SizeOfRawData;
   }
-  // Hash any data remaining after the sections
+  // Hash any data remaining after the sections, except the certificates
   if (BytesHashed < FileSize) {
-    HashBase = ImageBase + BytesHashed;
     if (FileSize < (BytesHashed + CertSize)) {
       goto Failed;
     }
-    HashSize = (UINTN)(FileSize - (BytesHashed + CertSize));
-    if (HashSize != 0) {
-      if (SHA256_Update(&HashCtx, HashBase, HashSize) == 0) {
-        goto Failed;
-      }
+    AddAuthenticodeRange(Ranges, &Count, BytesHashed, FileSize - (BytesHashed + CertSize), FileSize);
+  }
+  *RangeCount = Count;
+  return Ranges;
+
+Failed:
+  FreePool(Ranges);
+  return NULL;
+}
+
+// Create a secure boot image signature
+STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
+                                          IN UINT64  FileSize,
+                                          IN UINTN  *DatabaseSize)
+{
+  UINTN                Index, RangeCount = 0, Size = 0;
+  UINT8               *Database = NULL;
+  AUTHENTICODE_RANGE  *Ranges;
+  SECURE_HASH_SHA256   Hash;
+  EFI_SIGNATURE_LIST  *SignatureListPtr;
+  // Check parameters
+  if (DatabaseSize == NULL) {
+    return NULL;
+  }
+  *DatabaseSize = 0;
+  if ((FileBuffer == NULL) || (FileSize == 0)) {
+    return NULL;
+  }
+  // Get the parts of the image to hash
+  Ranges = GetAuthenticodeRanges((CONST UINT8 *)FileBuffer, FileSize, &RangeCount);
+  if (Ranges == NULL) {
+    return NULL;
+  }
+  // Hash the image
+  if (!Sha256Init(&Hash)) {
+    goto Failed;
+  }
+  for (Index = 0; Index < RangeCount; ++Index) {
+    if (!Sha256Update(&Hash, ((CONST UINT8 *)FileBuffer) + Ranges[Index].Offset, (UINTN)Ranges[Index].Size)) {
+      goto Failed;
     }
   }
   // Create the signature list
@@ -718,12 +1011,11 @@ STATIC void *CreateImageSignatureDatabase(IN void   *FileBuffer,
   SignatureListPtr->SignatureListSize = (UINT32)Size;
   SignatureListPtr->SignatureSize = (UINT32)(Size - sizeof(EFI_SIGNATURE_LIST));
   // Finalize the hash by placing it in the signature list
-  HashPtr = ((UINT8 *)(Database)) + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID);
-  if (SHA256_Final(HashPtr, &HashCtx) == 0) {
+  if (!Sha256Final(&Hash, Database + sizeof(EFI_SIGNATURE_LIST) + sizeof(EFI_GUID))) {
     goto Failed;
   }
   // Cleanup and return success
-  FreePool(Sections);
+  FreePool(Ranges);
   *DatabaseSize = Size;
   return Database;
 
@@ -732,9 +1024,7 @@ Failed:
   if (Database != NULL) {
     FreePool(Database);
   }
-  if (Sections != NULL) {
-    FreePool(Sections);
-  }
+  FreePool(Ranges);
   return NULL;
 }
 
@@ -39,6 +39,7 @@
 
 #include <Platform.h>
 #include "../Platform/Settings.h"
+#include "../Platform/Nvram.h"
 #include "entry_scan.h"
 
 #include <Guid/ImageAuthentication.h>
@@ -74,7 +75,7 @@
 EFI_STATUS ClearSecureBootKeys(void)
 {
   // Clear the platform database
-  return gRT->SetVariable(PLATFORM_DATABASE_NAME, PLATFORM_DATABASE_GUID, SET_DATABASE_ATTRIBUTES, sizeof(gSecureBootPlatformNullSignedKey), (void *)gSecureBootPlatformNullSignedKey);
+  return WriteNvramVariable(PLATFORM_DATABASE_NAME, PLATFORM_DATABASE_GUID, SET_DATABASE_ATTRIBUTES, sizeof(gSecureBootPlatformNullSignedKey), (void *)gSecureBootPlatformNullSignedKey);
 }
 
 // Enroll the secure boot keys
@@ -229,7 +230,7 @@ EFI_STATUS EnrollSecureBootKeys(IN void    *AuthorizedDatabase,
   // Unsure if default platform database should be enrolled.....???
   // Set the platform database - NOT ENROLLING DEFAULT PLATFORM DATABASE, ONLY CLOVER SHOULD OWN PLATFORM(?)
   DBG("Setting the platform database ...\n");
-  Status = gRT->SetVariable(PLATFORM_DATABASE_NAME, PLATFORM_DATABASE_GUID, SET_DATABASE_ATTRIBUTES, sizeof(gSecureBootPlatformSignedKey), (void *)gSecureBootPlatformSignedKey);
+  Status = WriteNvramVariable(PLATFORM_DATABASE_NAME, PLATFORM_DATABASE_GUID, SET_DATABASE_ATTRIBUTES, sizeof(gSecureBootPlatformSignedKey), (void *)gSecureBootPlatformSignedKey);
 
   return Status;
 }
@@ -497,7 +498,7 @@ EFI_STATUS SetSignedVariable(const wchar_t*    DatabaseName,
   }
   DBG("Writing secure variable 0x%llX (0x%llX) ...\n", uintptr_t(Authentication), Size);
   // Write the database variable
-  Status = gRT->SetVariable(DatabaseName, DatabaseGuid, SET_DATABASE_ATTRIBUTES, Size, Authentication);
+  Status = WriteNvramVariable(DatabaseName, DatabaseGuid, SET_DATABASE_ATTRIBUTES, Size, Authentication);
   // Cleanup the authentication buffer
   FreePool(Authentication);
   return Status;
@@ -1579,6 +1579,20 @@ void REFIT_MENU_SCREEN::ScrollingBar()
   Total.Compose(ScrollEnd.XPos - ScrollTotal.XPos, ScrollEnd.YPos - ScrollTotal.YPos, ThemeX->ScrollEndImage, false);
   Total.Draw(ScrollTotal.XPos, ScrollTotal.YPos, ThemeX->ScrollWidth / 16.f); //ScrollWidth can be set in theme.plist but usually=16
 }
+/*
+ * Copy a menu title into Text, shortened with ".." if it doesn't fit in a fixed width font.
+ * Text's buffer is reused : painting a menu doesn't allocate a string per row.
+ */
+static void CopyMenuTitle(XStringW& Text, const XStringW& Title)
+{
+  if (!ThemeX->TypeSVG && !ThemeX->Proportional && Title.length() > MenuMaxTextLen) {
+    Text.strncpy(Title.wc_str(), MenuMaxTextLen - 3);
+    Text.strcat(L"..");
+  } else {
+    Text.strcpy(Title.wc_str());
+  }
+}
+
 /**
  * Graphical menu.
  */
@@ -1706,10 +1720,7 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
 
       for (INTN i = ScrollState.FirstVisible, j = 0; i <= ScrollState.LastVisible; i++, j++) {
         REFIT_ABSTRACT_MENU_ENTRY *Entry = &Entries[i];
-        ResultString = Entry->Title; //create a copy to modify later
-        if (!ThemeX->TypeSVG && !ThemeX->Proportional && ResultString.length() > MenuMaxTextLen) {
-          ResultString = ResultString.subString(0,MenuMaxTextLen-3) + L".."_XSW;
-        }
+        CopyMenuTitle(ResultString, Entry->Title); //create a copy to modify later
         TitleLen = ResultString.length();
         Entry->Place.XPos = EntriesPosX;
         Entry->Place.YPos = EntriesPosY + j * ThemeX->TextHeight;
@@ -1732,7 +1743,8 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
             ThemeX->Buttons[(inputDialogEntry->Item->BValue)?3:2].DrawOnBack(ctrlX, ctrlY, ThemeX->Background);
           } else {
             // text input
-            ResultString += inputDialogEntry->Item->SValue + L" "_XSW;
+            ResultString.strcat(inputDialogEntry->Item->SValue);
+            ResultString.strcat(L' ');
             // set cursor to beginning if it is outside of screen
             if (!ThemeX->TypeSVG && !ThemeX->Proportional && (TitleLen + (INTN)Entry->Row) * ScaledWidth > MenuWidth) {
               Entry->Row = 0;
@@ -1783,10 +1795,7 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
       REFIT_ABSTRACT_MENU_ENTRY *EntryC = &Entries[ScrollState.CurrentSelection];
 
       // last selection
-      ResultString = EntryL->Title;
-      if (!ThemeX->TypeSVG && !ThemeX->Proportional && ResultString.length() > MenuMaxTextLen) {
-        ResultString = ResultString.subString(0,MenuMaxTextLen-3) + L".."_XSW;
-      }
+      CopyMenuTitle(ResultString, EntryL->Title);
       TitleLen = ResultString.length();
       //clovy//PlaceCentre = (TextHeight - (INTN)(Buttons[2]->Height * GlobalConfig.Scale)) / 2;
       //clovy//PlaceCentre = (PlaceCentre>0)?PlaceCentre:0;
@@ -1809,7 +1818,8 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
                        ctrlTextX, EntryL->Place.YPos, 0xFFFF, MenuWidth);
           ThemeX->Buttons[(inputDialogEntry->Item->BValue)?3:2].DrawOnBack(ctrlX, EntryL->Place.YPos + PlaceCentre, ThemeX->Background);
         } else {
-          ResultString += (inputDialogEntry->Item->SValue.wc_str() + inputDialogEntry->Item->LineShift) + L" "_XSW;
+          ResultString.strcat(inputDialogEntry->Item->SValue.wc_str() + inputDialogEntry->Item->LineShift);
+          ResultString.strcat(L' ');
           DrawMenuText(ResultString, 0,
                        EntriesPosX, EntryL->Place.YPos, TitleLen + EntryL->Row, MenuWidth);
           ThemeX->FillRectAreaOfScreen(MenuWidth + ((ctrlTextX + EntriesPosX) >> 1), EntryL->Place.YPos, ctrlTextX - EntriesPosX, ThemeX->TextHeight); //clean tail
@@ -1842,10 +1852,7 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
       }
 
       // current selection
-      ResultString = EntryC->Title;
-      if (!ThemeX->TypeSVG && !ThemeX->Proportional && ResultString.length() > MenuMaxTextLen) {
-        ResultString = ResultString.subString(0,MenuMaxTextLen-3) + L".."_XSW;
-      }
+      CopyMenuTitle(ResultString, EntryC->Title);
       TitleLen = ResultString.length();
       if ( EntryC->getREFIT_MENU_SWITCH() ) {
         if (EntryC->getREFIT_MENU_SWITCH()->Item->IValue == 3) {
@@ -1868,7 +1875,8 @@ void REFIT_MENU_SCREEN::GraphicsMenuStyle(IN UINTN Function, IN CONST CHAR16 *Pa
                        ctrlTextX, EntryC->Place.YPos, 0xFFFF, MenuWidth);
           ThemeX->Buttons[(inputDialogEntry->Item->BValue)?3:2].DrawOnBack(ctrlX, EntryC->Place.YPos + PlaceCentre, ThemeX->Background);
         } else {
-          ResultString += (inputDialogEntry->Item->SValue.wc_str() + inputDialogEntry->Item->LineShift) + L" "_XSW;
+          ResultString.strcat(inputDialogEntry->Item->SValue.wc_str() + inputDialogEntry->Item->LineShift);
+          ResultString.strcat(L' ');
           DrawMenuText(ResultString, MenuWidth,
                        EntriesPosX, EntryC->Place.YPos, TitleLen + EntryC->Row, MenuWidth);
         }
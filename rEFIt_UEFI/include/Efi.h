@@ -100,6 +100,7 @@ extern "C" {
 #include <Protocol/LoadedImage.h>
 #include <Protocol/UnicodeCollation.h>
 #include <Protocol/ScsiIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/LegacyBios.h>
 #include <Protocol/EdidActive.h>
 #include <Protocol/PlatformDriverOverride.h>
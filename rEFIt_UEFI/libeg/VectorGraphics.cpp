@@ -339,7 +339,7 @@ EFI_STATUS XTheme::LoadSvgFrame(NSVGparser* SVGParser, INTN i, OUT XImage* XFram
 //textType = 0-help 1-message 2-menu 3-test
 //return text width in pixels
 //it is not theme member!
-INTN renderSVGtext(XImage* TextBufferXY_ptr, INTN posX, INTN posY, const textFaces& textFace, const XStringW& string, UINTN Cursor)
+INTN renderSVGtext(XImage* TextBufferXY_ptr, INTN posX, INTN posY, const textFaces& textFace, const XStringWView& string, UINTN Cursor)
 {
   XImage& TextBufferXY = *TextBufferXY_ptr;
   INTN Width;
@@ -419,7 +419,7 @@ INTN renderSVGtext(XImage* TextBufferXY_ptr, INTN posX, INTN posY, const textFac
 }
 
 
-INTN renderSVGtext(XImage* TextBufferXY_ptr, INTN posX, INTN posY, INTN textType, const XStringW& string, UINTN Cursor)
+INTN renderSVGtext(XImage* TextBufferXY_ptr, INTN posX, INTN posY, INTN textType, const XStringWView& string, UINTN Cursor)
 {
   if (!ThemeX->getTextFace(textType).valid) {
     for (decltype(textType) i=0; i<4; i++) {
@@ -11,7 +11,7 @@
 #include "../cpp_foundation/XString.h"
 #include "XImage.h"
 
-INTN renderSVGtext(XImage* TextBufferXY, INTN posX, INTN posY, INTN textType, const XStringW& string, UINTN Cursor);
+INTN renderSVGtext(XImage* TextBufferXY, INTN posX, INTN posY, INTN textType, const XStringWView& string, UINTN Cursor);
 
 void testSVG(void);
 
@@ -95,14 +95,19 @@ void FILM::GetFrames(XTheme& TheTheme /*, const XStringW& Path*/) // Path alread
 {
   const EFI_FILE *ThemeDir = &TheTheme.getThemeDir();
   EFI_STATUS Status;
+  XStringW Name; // one buffer for all frame names
   LastIndex = 0;
   for (INTN Index = 0; Index < NumFrames; Index++) {
     XImage NewImage;
-    Status = EFI_NOT_FOUND;
-    XStringW Name = SWPrintf("%ls\\%ls_%03lld.png", Path.wc_str(), Path.wc_str(), Index);
+    UINT8 *FileData = NULL;
+    UINTN FileDataLength = 0;
+    Name.SWPrintf("%ls\\%ls_%03lld.png", Path.wc_str(), Path.wc_str(), Index);
 //     DBG("try to load %ls\n", Name.wc_str()); //fine
-    if (FileExists(ThemeDir, Name)) {
-      Status = NewImage.LoadXImage(ThemeDir, Name);
+    // the name is complete : load it directly instead of letting LoadXImage try the icons folder and extensions
+    Status = egLoadFile(ThemeDir, Name.wc_str(), &FileData, &FileDataLength);
+    if (!EFI_ERROR(Status)) {
+      Status = NewImage.FromPNG(FileData, FileDataLength);
+      FreePool(FileData);
     }
 //      DBG("  read status=%s\n", efiStrError(Status));
     if (!EFI_ERROR(Status)) {
@@ -210,22 +210,27 @@ void XIcon::GetEmbedded()
 }
 
 //copy from XImage for our purpose
-EFI_STATUS XIcon::LoadXImage(const EFI_FILE *BaseDir, const char* IconName)
+//dont call this procedure for SVG theme BaseDir == NULL?
+//it can be used for other files
+template <class NameView>
+static EFI_STATUS LoadXIconFiles(XIcon& Icon, const EFI_FILE *BaseDir, const NameView& IconName)
 {
-  return LoadXImage(BaseDir, XStringW().takeValueFrom(IconName));
+  XStringW NightName;
+  EFI_STATUS Status = Icon.Image.LoadXImage(BaseDir, IconName);
+  NightName.strcat(IconName);
+  NightName.strcat("_night");
+  Icon.ImageNight.LoadXImage(BaseDir, NightName);
+  return Status;
 }
 
-EFI_STATUS XIcon::LoadXImage(const EFI_FILE *BaseDir, const wchar_t* LIconName)
+EFI_STATUS XIcon::LoadXImage(const EFI_FILE *BaseDir, const XStringView& IconName)
 {
-  return LoadXImage(BaseDir, XStringW().takeValueFrom(LIconName));
+  return LoadXIconFiles(*this, BaseDir, IconName);
 }
-//dont call this procedure for SVG theme BaseDir == NULL?
-//it can be used for other files
-EFI_STATUS XIcon::LoadXImage(const EFI_FILE *BaseDir, const XStringW& IconName)
+
+EFI_STATUS XIcon::LoadXImage(const EFI_FILE *BaseDir, const XStringWView& IconName)
 {
-  EFI_STATUS Status = Image.LoadXImage(BaseDir, IconName);
-  ImageNight.LoadXImage(BaseDir, IconName + L"_night"_XSW);
-  return Status;
+  return LoadXIconFiles(*this, BaseDir, IconName);
 }
 
 const XImage& XIcon::GetBest(XBool night) const
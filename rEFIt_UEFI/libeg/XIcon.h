@@ -31,9 +31,8 @@ public:
   XBool isEmpty() const  { return Image.isEmpty()  &&  ImageNight.isEmpty(); }
   void setEmpty()  { Id = 0; Name.setEmpty(); Image.setEmpty(); ImageNight.setEmpty(); Native = false; }
   
-  EFI_STATUS LoadXImage(const EFI_FILE *Dir, const XStringW& FileName); //for example LoadImage(ThemeDir, L"icons\\" + Name);
-  EFI_STATUS LoadXImage(const EFI_FILE *Dir, const wchar_t* LIconName);
-  EFI_STATUS LoadXImage(const EFI_FILE *Dir, const char* IconName);
+  EFI_STATUS LoadXImage(const EFI_FILE *Dir, const XStringView& IconName); //for example LoadImage(ThemeDir, "func_about");
+  EFI_STATUS LoadXImage(const EFI_FILE *Dir, const XStringWView& IconName);
   void GetEmbedded();
 
   // Default are not valid, as usual. We delete them. If needed, proper ones can be created
@@ -622,23 +622,18 @@ void XImage::DrawOnBack(INTN XPos, INTN YPos, const XImage& Plate) const
  * SVG themes filled separately after ThemeName defined so the procedure just return EFI_SUCCESS
  * The function always create new image and will not be used to get a link to existing image
  */
-EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const char* IconName)
-{
-  return LoadXImage(BaseDir, XStringW().takeValueFrom(IconName));
-}
-
-EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const wchar_t* LIconName)
-{
-  return LoadXImage(BaseDir, XStringW().takeValueFrom(LIconName));
-}
-
 //dont call this procedure for SVG theme BaseDir == NULL?
 //it can be used for other files
-EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const XString8& IconName)
+// IconName is a char or a wchar_t view. All names are built in the same FileName buffer.
+template <class NameView>
+static EFI_STATUS LoadXImageFile(XImage& Image, const EFI_FILE *BaseDir, const NameView& IconName)
 {
+  static const char* const Prefix[] = { "icons\\", "icons\\", "", "" };
+  static const char* const Suffix[] = { ".icns", ".png", ".png", "" }; //last one may already contain extension, for example Logo.png
   EFI_STATUS      Status = EFI_NOT_FOUND;
   UINT8           *FileData = NULL;
   UINTN           FileDataLength = 0;
+  XStringW        FileName;
 
 //  if (TypeSVG) { //make a copy of SVG image
 //    XImage NewImage = Theme.GetIcon(IconName);
@@ -651,33 +646,38 @@ EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const XString8& IconName)
     return EFI_NOT_FOUND;
   
   // load file
-  XStringW FileName = L"icons\\" + IconName + L".icns";
-  Status = egLoadFile(BaseDir, FileName.wc_str(), &FileData, &FileDataLength);
-  if (EFI_ERROR(Status)) {
-    FileName = L"icons\\" + IconName + L".png";
+  for (size_t i = 0; i < sizeof(Prefix) / sizeof(Prefix[0]); i++) {
+    FileName.strcpy(Prefix[i]);
+    FileName.strcat(IconName);
+    FileName.strcat(Suffix[i]);
     Status = egLoadFile(BaseDir, FileName.wc_str(), &FileData, &FileDataLength);
-    if (EFI_ERROR(Status)) {
-      FileName = IconName + L".png";
-      Status = egLoadFile(BaseDir, FileName.wc_str(), &FileData, &FileDataLength);
-      if (EFI_ERROR(Status)) {
-        FileName = IconName; //may be it already contain extension, for example Logo.png
-        Status = egLoadFile(BaseDir, FileName.wc_str(), &FileData, &FileDataLength);
-        if (EFI_ERROR(Status)) {
-          return Status;
-        }
-      }
+    if (!EFI_ERROR(Status)) {
+      break;
     }
   }
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
 
   // decode it
-  Status = FromPNG(FileData, FileDataLength);  
+  Status = Image.FromPNG(FileData, FileDataLength);
   if (EFI_ERROR(Status)) {
-    DBG("%s not decoded. Status=%s\n", IconName.c_str(), efiStrError(Status));
+    DBG("%ls not decoded. Status=%s\n", FileName.wc_str(), efiStrError(Status));
   }
   FreePool(FileData);
   return Status;
 }
 
+EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const XStringView& IconName)
+{
+  return LoadXImageFile(*this, BaseDir, IconName);
+}
+
+EFI_STATUS XImage::LoadXImage(const EFI_FILE *BaseDir, const XStringWView& IconName)
+{
+  return LoadXImageFile(*this, BaseDir, IconName);
+}
+
 //EnsureImageSize should create new object with new sizes
 //while compose uses old object
 void XImage::EnsureImageSize(IN UINTN NewWidth, IN UINTN NewHeight)
@@ -168,11 +168,8 @@ public:
   void LoadFontImage(IN XBool UseEmbedded, IN INTN Rows, IN INTN Cols);
   void PrepareFont();
   INTN GetEmpty(const XImage& Buffer, const EFI_GRAPHICS_OUTPUT_BLT_PIXEL& FirstPixel, INTN MaxWidth, INTN Start, INTN Step);
-  INTN RenderText(IN const XStringW& Text, OUT XImage* CompImage_ptr,
+  INTN RenderText(IN const XStringWView& Text, OUT XImage* CompImage_ptr,
                     IN INTN PosX, IN INTN PosY, IN UINTN Cursor, INTN textType, float textScale = 0.f);
-  //overload for UTF8 text
-  INTN RenderText(IN const XString8& Text, OUT XImage* CompImage_ptr,
-                          IN INTN PosX, IN INTN PosY, IN UINTN Cursor, INTN textType, float textScale = 0.f);
   void MeasureText(IN const XStringW& Text, OUT INTN *Width, OUT INTN *Height);
 
 
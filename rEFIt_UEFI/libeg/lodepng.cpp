@@ -160,6 +160,35 @@ void lodepng_free(void* ptr);
 #define LODEPNG_RESTRICT /* not available */
 #endif
 
+/* the fast inflate loop keeps its bits in a 64-bit buffer, use it where that is a native register */
+#if defined(MDE_CPU_X64) || defined(MDE_CPU_AARCH64) || defined(__x86_64__) || defined(__aarch64__) || defined(_M_X64)
+#define LODEPNG_FAST_INFLATE
+#endif
+
+/* x86-64 always has SSE2. SSSE3 code is only run after checking CPUID, see lodepng_cpu_ssse3.
+__builtin_shufflevector needs clang or GCC 12 */
+#if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12))
+#define LODEPNG_SSE
+#endif
+
+#ifdef LODEPNG_SSE
+typedef char lodepng_v16qi __attribute__((vector_size(16)));
+typedef unsigned char lodepng_v16qu __attribute__((vector_size(16)));
+typedef short lodepng_v8hi __attribute__((vector_size(16)));
+typedef unsigned lodepng_v4su __attribute__((vector_size(16)));
+typedef unsigned long long lodepng_v2du __attribute__((vector_size(16)));
+
+static unsigned lodepng_cpu_ssse3(void) {
+  static int has_ssse3 = -1;
+  if(has_ssse3 < 0) {
+    UINT32 ecx;
+    AsmCpuid(1, NULL, NULL, &ecx, NULL);
+    has_ssse3 = (ecx >> 9u) & 1u;
+  }
+  return (unsigned)has_ssse3;
+}
+#endif /*LODEPNG_SSE*/
+
 /* Replacements for C library functions such as memcpy and strlen, to support platforms
 where a full C library is not available. The compiler can recognize them and compile
 to something as fast. */
@@ -739,6 +768,7 @@ typedef struct HuffmanTree {
   /* for reading only */
   unsigned char* table_len; /*length of symbol from lookup table, or max length if secondary lookup needed*/
   unsigned short* table_value; /*value of symbol from lookup table, or pointer to secondary table if needed*/
+  unsigned* table_fast; /*wide table for the fast inflate loop, see HuffmanTree_makeFastTable*/
 } HuffmanTree;
 
 static void HuffmanTree_init(HuffmanTree* tree) {
@@ -746,6 +776,7 @@ static void HuffmanTree_init(HuffmanTree* tree) {
   tree->lengths = 0;
   tree->table_len = 0;
   tree->table_value = 0;
+  tree->table_fast = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree) {
@@ -753,6 +784,7 @@ static void HuffmanTree_cleanup(HuffmanTree* tree) {
   lodepng_free(tree->lengths);
   lodepng_free(tree->table_len);
   lodepng_free(tree->table_value);
+  lodepng_free(tree->table_fast);
 }
 
 /* amount of bits for first huffman table lookup (aka root bits), see HuffmanTree_makeTable and huffmanDecodeSymbol.*/
@@ -1215,6 +1247,72 @@ static unsigned huffmanDecodeSymbol(LodePNGBitReader* reader, const HuffmanTree*
     return codetree->table_value[index2];
   }
 }
+#ifdef LODEPNG_FAST_INFLATE
+/*
+Wide lookup tables for the fast inflate loop, indexed by the next FASTBITS_LL or FASTBITS_D bits of input.
+An entry resolves everything that fits in those bits: one or two literals, or a length or distance code
+together with its base value and number of extra bits. Anything else (end code, longer codes, invalid
+symbols) is left 0 and decoded through the regular table.
+Entry layout: bits 0-7 code length(s), bits 8-10 kind, bits 11-15 extra bits, bits 16-31 value.
+*/
+#define FASTBITS_LL 10u
+#define FASTBITS_D 8u
+#define FAST_SLOW 0u /*decode with the regular table*/
+#define FAST_LITERAL 1u
+#define FAST_LITERAL2 2u /*value holds the first literal in the low byte and the second in the high byte*/
+#define FAST_LENGTH 3u
+#define FAST_DISTANCE 4u
+#define FAST_ENTRY(len, kind, extra, value) ((unsigned)(len) | ((kind) << 8u) | ((unsigned)(extra) << 11u) | ((unsigned)(value) << 16u))
+#define FAST_LEN(entry) ((entry) & 255u)
+#define FAST_KIND(entry) (((entry) >> 8u) & 7u)
+#define FAST_EXTRA(entry) (((entry) >> 11u) & 31u)
+#define FAST_VALUE(entry) ((entry) >> 16u)
+
+/*fill the fast table of a literal/length (isdistance 0) or distance (isdistance 1) tree*/
+static unsigned HuffmanTree_makeFastTable(HuffmanTree* tree, unsigned isdistance) {
+  unsigned fastbits = isdistance ? FASTBITS_D : FASTBITS_LL;
+  size_t size = (size_t)1u << fastbits;
+  unsigned symbol;
+  size_t j;
+
+  tree->table_fast = (unsigned*)lodepng_malloc(size * sizeof(unsigned)); /*zeroed, so FAST_SLOW*/
+  if(!tree->table_fast) return 83; /*alloc fail*/
+
+  for(symbol = 0; symbol != tree->numcodes; ++symbol) {
+    unsigned l = tree->lengths[symbol];
+    unsigned entry;
+    if(l == 0 || l > fastbits) continue;
+    if(isdistance) {
+      if(symbol > 29) continue; /*codes 30-31 are an error, reported by the regular path*/
+      entry = FAST_ENTRY(l, FAST_DISTANCE, DISTANCEEXTRA[symbol], DISTANCEBASE[symbol]);
+    } else if(symbol <= 255) {
+      entry = FAST_ENTRY(l, FAST_LITERAL, 0, symbol);
+    } else if(symbol >= FIRST_LENGTH_CODE_INDEX && symbol <= LAST_LENGTH_CODE_INDEX) {
+      entry = FAST_ENTRY(l, FAST_LENGTH, LENGTHEXTRA[symbol - FIRST_LENGTH_CODE_INDEX],
+                         LENGTHBASE[symbol - FIRST_LENGTH_CODE_INDEX]);
+    } else {
+      continue; /*end code and unused codes*/
+    }
+    /*the bit reader reads the code LSB first, the remaining bits of the index can be anything*/
+    for(j = reverseBits(tree->codes[symbol], l); j < size; j += (size_t)1u << l) tree->table_fast[j] = entry;
+  }
+
+  if(!isdistance) {
+    /*pair up literals when the second one also fits in the table bits. Going down, the entry for the
+    second literal (at a lower index) is still a single literal when it is read.*/
+    for(j = size; j-- > 0;) {
+      unsigned entry = tree->table_fast[j];
+      unsigned l = FAST_LEN(entry), second;
+      if(FAST_KIND(entry) != FAST_LITERAL || l >= fastbits) continue;
+      second = tree->table_fast[j >> l];
+      if(FAST_KIND(second) != FAST_LITERAL || l + FAST_LEN(second) > fastbits) continue;
+      tree->table_fast[j] = FAST_ENTRY(l + FAST_LEN(second), FAST_LITERAL2, 0,
+                                       FAST_VALUE(entry) | (FAST_VALUE(second) << 8u));
+    }
+  }
+  return 0;
+}
+#endif /*LODEPNG_FAST_INFLATE*/
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -1364,12 +1462,177 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+#ifdef LODEPNG_FAST_INFLATE
+/*symbols a huffman block decodes with the regular loop before it builds the fast tables*/
+#define FAST_MIN_SYMBOLS 256u
+/*output space the fast loop needs before each symbol: the longest match plus the 8-byte copy overrun*/
+#define FAST_OUT_MARGIN (258u + 8u)
+
+static LODEPNG_INLINE UINT64 lodepng_read64le(const unsigned char* p) {
+  return (UINT64)p[0] | ((UINT64)p[1] << 8u) | ((UINT64)p[2] << 16u) | ((UINT64)p[3] << 24u) |
+         ((UINT64)p[4] << 32u) | ((UINT64)p[5] << 40u) | ((UINT64)p[6] << 48u) | ((UINT64)p[7] << 56u);
+}
+
+#if defined(__GNUC__)
+#define LODEPNG_COPY8(dst, src) __builtin_memcpy((dst), (src), 8)
+#else
+#define LODEPNG_COPY8(dst, src) lodepng_memcpy((dst), (src), 8)
+#endif
+
+/*huffmanDecodeSymbol on the 64-bit buffer of the fast loop, for what the fast table leaves to the regular table*/
+static LODEPNG_INLINE unsigned huffmanDecodeSymbolWide(UINT64* bitbuf, unsigned* bitcount, const HuffmanTree* codetree) {
+  unsigned code = (unsigned)*bitbuf & ((1u << FIRSTBITS) - 1u);
+  unsigned l = codetree->table_len[code];
+  unsigned value = codetree->table_value[code];
+  if(l > FIRSTBITS) {
+    unsigned index2 = value + ((unsigned)(*bitbuf >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+    l = codetree->table_len[index2];
+    value = codetree->table_value[index2];
+  }
+  *bitbuf >>= l;
+  *bitcount -= l;
+  return value;
+}
+
+/*
+Decode symbols of a huffman block with a 64-bit bit buffer, the fast tables and 8-byte match copies, as
+long as at least 8 input bytes remain for a refill. Sets *done when the end code is reached, otherwise the
+regular loop in inflateHuffmanBlock finishes the block from the updated bit pointer.
+*/
+static unsigned inflateHuffmanBlockFast(ucvector* out, size_t* pos, LodePNGBitReader* reader,
+                                        const HuffmanTree* tree_ll, const HuffmanTree* tree_d, unsigned* done) {
+  /*locals, so the byte stores to the output can't force reloads of these*/
+  const unsigned char* in = reader->data;
+  const unsigned* table_ll = tree_ll->table_fast;
+  const unsigned* table_d = tree_d->table_fast;
+  unsigned char* data = out->data;
+  size_t outpos = *pos;
+  size_t bytepos = reader->bp >> 3u;
+  unsigned bitcount = 0;
+  UINT64 bitbuf = 0;
+  unsigned error = 0;
+
+  if(bytepos + 8u > reader->size) return 0;
+  /*start at the current bit of the first byte*/
+  bitbuf = lodepng_read64le(in + bytepos);
+  bytepos += 7u;
+  bitcount = 56u;
+  bitbuf >>= reader->bp & 7u;
+  bitcount -= (unsigned)(reader->bp & 7u);
+
+  while(bytepos + 8u <= reader->size) {
+    unsigned entry, length, distance, code;
+    unsigned char* dst;
+    const unsigned char* src;
+
+    /*refill to at least 56 bits: enough for a literal/length code, its extra bits, a distance code and its
+    extra bits (15 + 5 + 15 + 13)*/
+    bitbuf |= lodepng_read64le(in + bytepos) << bitcount;
+    bytepos += (63u - bitcount) >> 3u;
+    bitcount |= 56u;
+
+    if(out->allocsize - outpos < FAST_OUT_MARGIN) {
+      if(!ucvector_resize(out, outpos + FAST_OUT_MARGIN)) ERROR_BREAK(83 /*alloc fail*/);
+      data = out->data;
+    }
+
+    entry = table_ll[bitbuf & ((1u << FASTBITS_LL) - 1u)];
+    if(FAST_KIND(entry) == FAST_LITERAL2) {
+      data[outpos++] = (unsigned char)FAST_VALUE(entry);
+      data[outpos++] = (unsigned char)(FAST_VALUE(entry) >> 8u);
+      bitbuf >>= FAST_LEN(entry);
+      bitcount -= FAST_LEN(entry);
+      continue;
+    } else if(FAST_KIND(entry) == FAST_LITERAL) {
+      data[outpos++] = (unsigned char)FAST_VALUE(entry);
+      bitbuf >>= FAST_LEN(entry);
+      bitcount -= FAST_LEN(entry);
+      continue;
+    } else if(FAST_KIND(entry) == FAST_LENGTH) {
+      bitbuf >>= FAST_LEN(entry);
+      bitcount -= FAST_LEN(entry);
+      length = FAST_VALUE(entry) + ((unsigned)bitbuf & ((1u << FAST_EXTRA(entry)) - 1u));
+      bitbuf >>= FAST_EXTRA(entry);
+      bitcount -= FAST_EXTRA(entry);
+    } else {
+      code = huffmanDecodeSymbolWide(&bitbuf, &bitcount, tree_ll);
+      if(code <= 255) {
+        data[outpos++] = (unsigned char)code;
+        continue;
+      } else if(code == 256) {
+        *done = 1;
+        break; /*end code*/
+      } else if(code >= FIRST_LENGTH_CODE_INDEX && code <= LAST_LENGTH_CODE_INDEX) {
+        unsigned numextrabits_l = LENGTHEXTRA[code - FIRST_LENGTH_CODE_INDEX];
+        length = LENGTHBASE[code - FIRST_LENGTH_CODE_INDEX] + ((unsigned)bitbuf & ((1u << numextrabits_l) - 1u));
+        bitbuf >>= numextrabits_l;
+        bitcount -= numextrabits_l;
+      } else /*if(code == INVALIDSYMBOL)*/ {
+        ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+      }
+    }
+
+    entry = table_d[bitbuf & ((1u << FASTBITS_D) - 1u)];
+    if(FAST_KIND(entry) == FAST_DISTANCE) {
+      bitbuf >>= FAST_LEN(entry);
+      bitcount -= FAST_LEN(entry);
+      distance = FAST_VALUE(entry) + ((unsigned)bitbuf & ((1u << FAST_EXTRA(entry)) - 1u));
+      bitbuf >>= FAST_EXTRA(entry);
+      bitcount -= FAST_EXTRA(entry);
+    } else {
+      unsigned numextrabits_d;
+      code = huffmanDecodeSymbolWide(&bitbuf, &bitcount, tree_d);
+      if(code > 29) {
+        if(code <= 31) {
+          ERROR_BREAK(18); /*error: invalid distance code (30-31 are never used)*/
+        } else /* if(code == INVALIDSYMBOL) */{
+          ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+        }
+      }
+      numextrabits_d = DISTANCEEXTRA[code];
+      distance = DISTANCEBASE[code] + ((unsigned)bitbuf & ((1u << numextrabits_d) - 1u));
+      bitbuf >>= numextrabits_d;
+      bitcount -= numextrabits_d;
+    }
+
+    if(distance > outpos) ERROR_BREAK(52); /*too long backward distance*/
+    dst = data + outpos;
+    src = dst - distance;
+    outpos += length;
+    if(distance >= 8u) {
+      /*each 8-byte load is complete before the store that could overlap it, the overrun is in the margin*/
+      unsigned i;
+      for(i = 0; i < length; i += 8u) LODEPNG_COPY8(dst + i, src + i);
+    } else {
+      /*a short distance repeats a pattern: copy bytewise until the pattern can be read from at least
+      8 bytes back, then copy 8 bytes at a time*/
+      unsigned period = distance * ((8u + distance - 1u) / distance);
+      unsigned i, head = period - distance;
+      if(head > length) head = length;
+      for(i = 0; i < head; ++i) dst[i] = src[i];
+      src = dst + head - period;
+      for(; i < length; i += 8u, src += 8u) LODEPNG_COPY8(dst + i, src);
+    }
+  }
+
+  /*give back the bits read ahead, whole bytes included*/
+  reader->bp = (bytepos << 3u) - bitcount;
+  *pos = outpos;
+  out->size = outpos;
+  return error;
+}
+#endif /*LODEPNG_FAST_INFLATE*/
+
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
 static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader* reader,
                                     unsigned btype) {
   unsigned error = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
+#ifdef LODEPNG_FAST_INFLATE
+  unsigned numsymbols = 0; /*symbols decoded by the loop below*/
+  unsigned done = 0; /*end code reached by the fast loop*/
+#endif /*LODEPNG_FAST_INFLATE*/
 
   HuffmanTree_init(&tree_ll);
   HuffmanTree_init(&tree_d);
@@ -1450,6 +1713,15 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
       /* TODO: revise error codes 10,11,50: the above comment is no longer valid */
       ERROR_BREAK(51); /*error, bit pointer jumps past memory*/
     }
+#ifdef LODEPNG_FAST_INFLATE
+    /*switch to the fast loop once the block is long enough to pay for building its tables*/
+    if(++numsymbols == FAST_MIN_SYMBOLS) {
+      error = HuffmanTree_makeFastTable(&tree_ll, 0);
+      if(!error) error = HuffmanTree_makeFastTable(&tree_d, 1);
+      if(!error) error = inflateHuffmanBlockFast(out, pos, reader, &tree_ll, &tree_d, &done);
+      if(done) break;
+    }
+#endif /*LODEPNG_FAST_INFLATE*/
   }
 
   HuffmanTree_cleanup(&tree_ll);
@@ -2242,10 +2514,53 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+#ifdef LODEPNG_SSE
+/*update_adler32 16 bytes at a time: PSADBW sums the bytes for s1, PMADDUBSW and PMADDWD weigh them for s2*/
+__attribute__((target("ssse3")))
+static unsigned update_adler32_ssse3(unsigned adler, const unsigned char* data, unsigned len) {
+  const lodepng_v16qi weights = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+  const lodepng_v8hi ones = {1, 1, 1, 1, 1, 1, 1, 1};
+  const lodepng_v16qi zero = {0};
+  unsigned s1 = adler & 0xffffu;
+  unsigned s2 = (adler >> 16u) & 0xffffu;
+
+  while(len >= 16u) {
+    /*at most 5552 bytes before the sums overflow, as in the scalar version*/
+    unsigned blocks = len / 16u > 5552u / 16u ? 5552u / 16u : len / 16u;
+    lodepng_v4su vs1 = {0, 0, 0, 0};
+    lodepng_v4su vs2 = {s2, 0, 0, 0};
+    lodepng_v4su vps = {s1 * blocks, 0, 0, 0}; /*s1 before each block, times 16 at the end*/
+    len -= blocks * 16u;
+    do {
+      lodepng_v16qi bytes;
+      __builtin_memcpy(&bytes, data, sizeof(bytes));
+      vps += vs1;
+      vs1 += (lodepng_v4su)__builtin_ia32_psadbw128(bytes, zero);
+      vs2 += (lodepng_v4su)__builtin_ia32_pmaddwd128(__builtin_ia32_pmaddubsw128(bytes, weights), ones);
+      data += 16;
+    } while(--blocks);
+    vs2 += vps << 4u;
+    s1 = (s1 + vs1[0] + vs1[1] + vs1[2] + vs1[3]) % 65521u;
+    s2 = (vs2[0] + vs2[1] + vs2[2] + vs2[3]) % 65521u;
+  }
+
+  while(len != 0u) {
+    s1 += (*data++);
+    s2 += s1;
+    --len;
+  }
+  return ((s2 % 65521u) << 16u) | (s1 % 65521u);
+}
+#endif /*LODEPNG_SSE*/
+
 static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
   unsigned s1 = adler & 0xffffu;
   unsigned s2 = (adler >> 16u) & 0xffffu;
 
+#ifdef LODEPNG_SSE
+  if(lodepng_cpu_ssse3()) return update_adler32_ssse3(adler, data, len);
+#endif /*LODEPNG_SSE*/
+
   while(len != 0u) {
     unsigned i;
     /*at least 5552 sums can be done before the sums overflow, saving a lot of module divisions*/
@@ -2267,6 +2582,11 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
   return update_adler32(1u, data, len);
 }
 
+/* Public for testing only. */
+unsigned lode_png_test_adler32(const unsigned char* data, unsigned len) {
+  return adler32(data, len);
+}
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2485,14 +2805,47 @@ static unsigned lodepng_crc32_table[256] = {
   3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
 };
 
-/*Return the CRC of the bytes buf[0..len-1].*/
-unsigned lodepng_crc32(const unsigned char* data, size_t length) {
-  unsigned r = 0xffffffffu;
+/*lodepng_crc32_table extended for slicing-by-8: table k gives the CRC of a byte followed by k zero bytes*/
+static unsigned lodepng_crc32_table8[8][256];
+static unsigned lodepng_crc32_table8_ready = 0;
+
+static void lodepng_crc32_init_table8(void) {
+  unsigned i, k;
+  for(i = 0; i != 256; ++i) lodepng_crc32_table8[0][i] = lodepng_crc32_table[i];
+  for(k = 1; k != 8; ++k) {
+    for(i = 0; i != 256; ++i) {
+      unsigned c = lodepng_crc32_table8[k - 1][i];
+      lodepng_crc32_table8[k][i] = lodepng_crc32_table[c & 0xffu] ^ (c >> 8u);
+    }
+  }
+  lodepng_crc32_table8_ready = 1;
+}
+
+/*bytewise CRC, also used for the last bytes of lodepng_crc32*/
+static unsigned lodepng_crc32_bytes(unsigned r, const unsigned char* data, size_t length) {
   size_t i;
   for(i = 0; i < length; ++i) {
     r = lodepng_crc32_table[(r ^ data[i]) & 0xffu] ^ (r >> 8u);
   }
-  return r ^ 0xffffffffu;
+  return r;
+}
+
+/*Return the CRC of the bytes buf[0..len-1].*/
+unsigned lodepng_crc32(const unsigned char* data, size_t length) {
+  unsigned r = 0xffffffffu;
+  if(!lodepng_crc32_table8_ready) lodepng_crc32_init_table8();
+  /*8 bytes per step, 8 independent table lookups*/
+  while(length >= 8u) {
+    unsigned lo = r ^ ((unsigned)data[0] | ((unsigned)data[1] << 8u) | ((unsigned)data[2] << 16u) | ((unsigned)data[3] << 24u));
+    unsigned hi = (unsigned)data[4] | ((unsigned)data[5] << 8u) | ((unsigned)data[6] << 16u) | ((unsigned)data[7] << 24u);
+    r = lodepng_crc32_table8[7][lo & 0xffu] ^ lodepng_crc32_table8[6][(lo >> 8u) & 0xffu] ^
+        lodepng_crc32_table8[5][(lo >> 16u) & 0xffu] ^ lodepng_crc32_table8[4][lo >> 24u] ^
+        lodepng_crc32_table8[3][hi & 0xffu] ^ lodepng_crc32_table8[2][(hi >> 8u) & 0xffu] ^
+        lodepng_crc32_table8[1][(hi >> 16u) & 0xffu] ^ lodepng_crc32_table8[0][hi >> 24u];
+    data += 8;
+    length -= 8u;
+  }
+  return lodepng_crc32_bytes(r, data, length) ^ 0xffffffffu;
 }
 #else /* !LODEPNG_NO_COMPILE_CRC */
 unsigned lodepng_crc32(const unsigned char* data, size_t length);
@@ -4149,6 +4502,129 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SSE
+static LODEPNG_INLINE unsigned unfilterLoadBytes(const unsigned char* p, size_t bytewidth) {
+  unsigned v = (unsigned)p[0] | ((unsigned)p[1] << 8u) | ((unsigned)p[2] << 16u);
+  if(bytewidth == 4) v |= (unsigned)p[3] << 24u;
+  return v;
+}
+
+static LODEPNG_INLINE void unfilterStoreBytes(unsigned char* p, unsigned v, size_t bytewidth) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8u);
+  p[2] = (unsigned char)(v >> 16u);
+  if(bytewidth == 4) p[3] = (unsigned char)(v >> 24u);
+}
+
+/*a 3- or 4-byte pixel, widened to the low 16-bit lanes (PUNPCKLBW)*/
+static LODEPNG_INLINE lodepng_v8hi unfilterLoadPixel(const unsigned char* p, size_t bytewidth) {
+  const lodepng_v16qu zero = {0};
+  lodepng_v4su x = {unfilterLoadBytes(p, bytewidth), 0, 0, 0};
+  return (lodepng_v8hi)__builtin_shufflevector((lodepng_v16qu)x, zero,
+                                               0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+}
+
+/*stores the first bytewidth 16-bit lanes, which must be in range 0-255 (PACKUSWB)*/
+static LODEPNG_INLINE void unfilterStorePixel(unsigned char* p, lodepng_v8hi pixel, size_t bytewidth) {
+  unfilterStoreBytes(p, ((lodepng_v4su)__builtin_ia32_packuswb128(pixel, pixel))[0], bytewidth);
+}
+
+/*
+Vector versions of the filters where the scalar loop is slowest: Up for any pixel size, Sub for 3 and 4
+bytes per pixel, Paeth for 3 and 4 bytes per pixel with a previous line. Returns 1 if the
+scanline was handled, 0 to fall back to unfilterScanline. Every chunk is loaded before it is stored, so
+recon may be scanline like in unfilterScanline.
+*/
+static unsigned unfilterScanlineSse(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                    size_t bytewidth, unsigned char filterType, size_t length) {
+  size_t i = 0;
+  if(filterType == 2 && precon) {
+    for(; i + 16 <= length; i += 16) {
+      lodepng_v16qu s, p;
+      __builtin_memcpy(&s, &scanline[i], 16);
+      __builtin_memcpy(&p, &precon[i], 16);
+      s += p;
+      __builtin_memcpy(&recon[i], &s, 16);
+    }
+    for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+    return 1;
+  }
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+  if(length < bytewidth) return 0;
+
+  if(filterType == 1) {
+    unsigned long long prev = 0;
+    for(i = 0; i != bytewidth; ++i) {
+      recon[i] = scanline[i];
+      prev |= (unsigned long long)scanline[i] << (8u * i);
+    }
+    if(bytewidth == 4) {
+      /*prefix sum of 4 pixels: within each 64-bit half, then the low half into the high half*/
+      for(; i + 16 <= length; i += 16) {
+        lodepng_v16qu x;
+        lodepng_v4su u;
+        __builtin_memcpy(&x, &scanline[i], 16);
+        x += (lodepng_v16qu)((lodepng_v2du)x << 32u);
+        u = (lodepng_v4su)x;
+        x += (lodepng_v16qu)(lodepng_v4su){0, 0, u[1], u[1]};
+        x += (lodepng_v16qu)(lodepng_v4su){(unsigned)prev, (unsigned)prev, (unsigned)prev, (unsigned)prev};
+        __builtin_memcpy(&recon[i], &x, 16);
+        prev = ((lodepng_v4su)x)[3];
+      }
+    } else {
+      /*4 pixels of 3 bytes in the low 12 bytes. 128-bit shifts by 3 and 6 bytes are done on the 64-bit halves*/
+      for(; i + 16 <= length; i += 12) {
+        lodepng_v2du x, t;
+        __builtin_memcpy(&x, &scanline[i], 16);
+        t = x << 24u;
+        t[1] |= x[0] >> 40u;
+        x = (lodepng_v2du)((lodepng_v16qu)x + (lodepng_v16qu)t);
+        t = x << 48u;
+        t[1] |= x[0] >> 16u;
+        x = (lodepng_v2du)((lodepng_v16qu)x + (lodepng_v16qu)t);
+        t[0] = prev | (prev << 24u) | (prev << 48u);
+        t[1] = (prev >> 16u) | (prev << 8u);
+        x = (lodepng_v2du)((lodepng_v16qu)x + (lodepng_v16qu)t);
+        __builtin_memcpy(&recon[i], &x, 8);
+        __builtin_memcpy(&recon[i + 8], &((const unsigned char*)&x)[8], 4);
+        prev = (x[1] >> 8u) & 0xffffffu;
+      }
+    }
+    for(; i < length; ++i) recon[i] = scanline[i] + recon[i - bytewidth];
+    return 1;
+  }
+
+  if(filterType != 4 || !precon) return 0;
+
+  /*Paeth, one pixel per step in 16-bit lanes with the previous pixel kept in a register. Average is left to
+  the scalar loop, which is as fast since each step only depends on the byte bytewidth before*/
+  {
+    lodepng_v8hi a = {0}, c = {0};
+    for(; i + bytewidth <= length; i += bytewidth) {
+      lodepng_v8hi b = unfilterLoadPixel(&precon[i], bytewidth);
+      lodepng_v8hi s = unfilterLoadPixel(&scanline[i], bytewidth);
+      /*branchless paethPredictor, lanes of all ones where the comparison holds*/
+      lodepng_v8hi pa = b - c, pb = a - c, pc = a + b - c - c, m;
+      m = pa >> 15; pa = (pa ^ m) - m;
+      m = pb >> 15; pb = (pb ^ m) - m;
+      m = pc >> 15; pc = (pc ^ m) - m;
+      m = (lodepng_v8hi)(pb < pa);
+      a = (b & m) | (a & ~m);
+      pa = (pb & m) | (pa & ~m);
+      m = (lodepng_v8hi)(pc < pa);
+      a = (s + ((c & m) | (a & ~m))) & 0xff;
+      unfilterStorePixel(&recon[i], a, bytewidth);
+      c = b;
+    }
+    for(; i < length; ++i) {
+      if(i < bytewidth) recon[i] = scanline[i] + precon[i];
+      else recon[i] = scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]);
+    }
+  }
+  return 1;
+}
+#endif /*LODEPNG_SSE*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length) {
   /*
@@ -4161,6 +4637,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SSE
+  if(unfilterScanlineSse(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif /*LODEPNG_SSE*/
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -4246,6 +4725,12 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
+/* Public for testing only. Unfilters one scanline like the decoder does, with the vector version where there is one. */
+unsigned lode_png_test_unfilter(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length) {
+  return unfilterScanline(recon, scanline, precon, bytewidth, filterType, length);
+}
+
 static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp) {
   /*
   For PNG filter method 0
@@ -48,6 +48,7 @@
 #include "../Settings/Self.h"
 #include "../Settings/SelfOem.h"
 #include "../Platform/Volumes.h"
+#include "../Platform/cpu.h"
 #include "../libeg/XTheme.h"
 
 #include "../include/OC.h"
@@ -276,7 +277,122 @@ EFI_STATUS ExtractLegacyLoaderPaths(EFI_DEVICE_PATH **PathList, UINTN MaxPaths,
 // volume functions
 //
 
-static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT XBool *Bootable)
+//
+// Boot sector prefetch. ScanVolumes queues the first 2048 bytes of every
+// BlockIo2 capable handle before probing starts, so reads on slow media
+// (USB, optical) overlap instead of being issued one after another by
+// ScanVolumeBootcode. Handles without BlockIo2 keep the synchronous path.
+//
+#define VOLUME_PREFETCH_SIZE  2048
+
+typedef struct {
+  EFI_HANDLE              Handle;
+  EFI_BLOCK_IO2_TOKEN     Token;
+  UINT8                  *Buffer;
+  EFI_STATUS              Status;
+  XBool                   Pending;
+} VOLUME_PREFETCH;
+
+static UINT64 TscToMicroseconds(UINT64 Ticks)
+{
+  if (gCPUStructure.TSCFrequency == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder(MultU64x32(Ticks, 1000000), gCPUStructure.TSCFrequency, NULL);
+}
+
+static void VolumePrefetchStart(OUT VOLUME_PREFETCH *Prefetch, IN EFI_HANDLE Handle)
+{
+  EFI_STATUS              Status;
+  EFI_BLOCK_IO2_PROTOCOL *BlockIo2 = NULL;
+  EFI_BLOCK_IO_MEDIA     *Media;
+
+  Prefetch->Handle = Handle;
+  Prefetch->Token.Event = NULL;
+  Prefetch->Buffer = NULL;
+  Prefetch->Status = EFI_NOT_READY;
+  Prefetch->Pending = false;
+
+  Status = gBS->HandleProtocol(Handle, &gEfiBlockIo2ProtocolGuid, (void **)&BlockIo2);
+  if (EFI_ERROR(Status) || BlockIo2 == NULL) {
+    return;
+  }
+  Media = BlockIo2->Media;
+  if (!Media->MediaPresent || Media->BlockSize > VOLUME_PREFETCH_SIZE) {
+    return;
+  }
+  Status = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &Prefetch->Token.Event);
+  if (EFI_ERROR(Status)) {
+    Prefetch->Token.Event = NULL;
+    return;
+  }
+  Prefetch->Buffer = (__typeof__(Prefetch->Buffer))AllocateAlignedPages(EFI_SIZE_TO_PAGES(VOLUME_PREFETCH_SIZE), 16);
+  if (Prefetch->Buffer == NULL) {
+    gBS->CloseEvent(Prefetch->Token.Event);
+    Prefetch->Token.Event = NULL;
+    return;
+  }
+  ZeroMem(Prefetch->Buffer, VOLUME_PREFETCH_SIZE);
+  // same start LBA as ScanVolume uses: El Torito images start at block 0x10
+  Prefetch->Token.TransactionStatus = EFI_NOT_READY;
+  Status = BlockIo2->ReadBlocksEx(BlockIo2, Media->MediaId, (Media->BlockSize == 2048) ? 0x10 : 0,
+                                  &Prefetch->Token, VOLUME_PREFETCH_SIZE, Prefetch->Buffer);
+  if (EFI_ERROR(Status)) {
+    Prefetch->Status = Status;
+    return;
+  }
+  Prefetch->Pending = true;
+}
+
+//wait for the queued read, returns the sector data or NULL if the caller must read it itself
+static const UINT8 *VolumePrefetchWait(IN OUT VOLUME_PREFETCH *Prefetch)
+{
+  if (Prefetch->Pending) {
+    while (gBS->CheckEvent(Prefetch->Token.Event) == EFI_NOT_READY) {
+      CpuPause();
+    }
+    Prefetch->Status = Prefetch->Token.TransactionStatus;
+    Prefetch->Pending = false;
+  }
+  if (Prefetch->Buffer == NULL || EFI_ERROR(Prefetch->Status)) {
+    return NULL;
+  }
+  return Prefetch->Buffer;
+}
+
+static void VolumePrefetchFree(IN OUT VOLUME_PREFETCH *Prefetch)
+{
+  // never release a buffer the driver may still write into
+  VolumePrefetchWait(Prefetch);
+  if (Prefetch->Buffer != NULL) {
+    FreeAlignedPages(Prefetch->Buffer, EFI_SIZE_TO_PAGES(VOLUME_PREFETCH_SIZE));
+    Prefetch->Buffer = NULL;
+  }
+  if (Prefetch->Token.Event != NULL) {
+    gBS->CloseEvent(Prefetch->Token.Event);
+    Prefetch->Token.Event = NULL;
+  }
+}
+
+//
+// Whole disk lookup for the second pass of ScanVolumes: open addressing on
+// the BlockIo instance, which is what identifies a whole disk volume.
+//
+typedef struct {
+  EFI_BLOCK_IO_PROTOCOL  *BlockIO;
+  REFIT_VOLUME           *Volume;
+} WHOLE_DISK_SLOT;
+
+static UINTN WholeDiskSlot(IN CONST WHOLE_DISK_SLOT *Table, IN UINTN Mask, IN CONST EFI_BLOCK_IO_PROTOCOL *BlockIO)
+{
+  UINTN Slot = (UINTN)((UINT32)((UINTN)BlockIO >> 3) * 0x9E3779B1U) & Mask;
+  while (Table[Slot].BlockIO != NULL && Table[Slot].BlockIO != BlockIO) {
+    Slot = (Slot + 1) & Mask;
+  }
+  return Slot;
+}
+
+static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT XBool *Bootable, IN CONST UINT8 *Prefetched = NULL)
 {
   EFI_STATUS              Status;
   UINT8                  *SectorBuffer;
@@ -305,9 +421,14 @@ static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT XBool *Bootable)
   SectorBuffer = (__typeof__(SectorBuffer))AllocateAlignedPages(EFI_SIZE_TO_PAGES (2048), 16); //align to 16 byte?! Poher
   ZeroMem((CHAR8*)&SectorBuffer[0], 2048);
   // look at the boot sector (this is used for both hard disks and El Torito images!)
-  Status = Volume->BlockIO->ReadBlocks(Volume->BlockIO, Volume->BlockIO->Media->MediaId,
-                                       Volume->BlockIOOffset /*start lba*/,
-                                       2048, SectorBuffer);
+  if (Prefetched != NULL) {
+    CopyMem(SectorBuffer, Prefetched, 2048);
+    Status = EFI_SUCCESS;
+  } else {
+    Status = Volume->BlockIO->ReadBlocks(Volume->BlockIO, Volume->BlockIO->Media->MediaId,
+                                         Volume->BlockIOOffset /*start lba*/,
+                                         2048, SectorBuffer);
+  }
   if (!EFI_ERROR(Status) && (SectorBuffer[1] != 0)) {
     // calc crc checksum of first 2 sectors - it's used later for legacy boot BIOS drive num detection
     // note: possible future issues with AF 4K disks
@@ -560,7 +681,8 @@ static void ScanVolumeBootcode(IN OUT REFIT_VOLUME *Volume, OUT XBool *Bootable)
 }
 
 //at start we have only Volume->DeviceHandle
-static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
+//Prefetch, if not NULL, holds the BlockIo2 read of the boot sector queued by ScanVolumes
+static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume, IN OUT VOLUME_PREFETCH *Prefetch = NULL)
 {
   EFI_STATUS              Status;
   HARDDRIVE_DEVICE_PATH   *HdPath     = NULL;
@@ -606,12 +728,12 @@ static EFI_STATUS ScanVolume(IN OUT REFIT_VOLUME *Volume)
 //    DBG("        Found optical drive\n");
     Volume->DiskKind = DISK_KIND_OPTICAL;
     Volume->BlockIOOffset = 0x10; // offset already applied for FS but not for blockio
-    ScanVolumeBootcode(Volume, &Bootable);
+    ScanVolumeBootcode(Volume, &Bootable, Prefetch ? VolumePrefetchWait(Prefetch) : NULL);
   } else {
     //        DBG("        Found HD drive\n");
     Volume->BlockIOOffset = 0;
     // scan for bootcode and MBR table
-    ScanVolumeBootcode(Volume, &Bootable);
+    ScanVolumeBootcode(Volume, &Bootable, Prefetch ? VolumePrefetchWait(Prefetch) : NULL);
  //     DBG("        ScanVolumeBootcode success\n");
     // detect device type
     apd<EFI_DEVICE_PATH*> DevicePath = DuplicateDevicePath(Volume->DevicePath);
@@ -962,6 +1084,11 @@ void ScanVolumes(void)
   UINTN                   PartitionIndex;
   UINT8                   *SectorBuffer1, *SectorBuffer2;
   UINTN                   SectorSum, i;
+  VOLUME_PREFETCH         *Prefetch = NULL;
+  WHOLE_DISK_SLOT         *WholeDisks = NULL;
+  UINTN                   WholeDiskMask = 0;
+  UINT64                  ScanStart, PassStart, WaitTicks, ProbeTicks;
+  UINT64                  TotalWait = 0, TotalProbe = 0;
   //  EFI_DEVICE_PATH_PROTOCOL  *VolumeDevicePath;
   //  EFI_GUID                *Guid; //for debug only
   //  EFI_INPUT_KEY Key;
@@ -974,6 +1101,14 @@ void ScanVolumes(void)
   if (Status == EFI_NOT_FOUND)
     return;
 	DBG("Found %llu volumes with blockIO\n", HandleCount);
+  ScanStart = AsmReadTsc();
+  // queue all boot sector reads first, they complete while earlier volumes are probed
+  Prefetch = (__typeof__(Prefetch))AllocateZeroPool(HandleCount * sizeof(VOLUME_PREFETCH));
+  if (Prefetch != NULL) {
+    for (UINTN HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+      VolumePrefetchStart(&Prefetch[HandleIndex], Handles[HandleIndex]);
+    }
+  }
   // first pass: collect information about all handles
   for (UINTN HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
     
@@ -987,7 +1122,16 @@ void ScanVolumes(void)
     
     Volume->Hidden = false; // default to not hidden
     
-    Status = ScanVolume(Volume);
+    PassStart = AsmReadTsc();
+    if (Prefetch != NULL) {
+      VolumePrefetchWait(&Prefetch[HandleIndex]);
+    }
+    WaitTicks = AsmReadTsc() - PassStart;
+    Status = ScanVolume(Volume, Prefetch ? &Prefetch[HandleIndex] : NULL);
+    ProbeTicks = AsmReadTsc() - PassStart;
+    TotalWait += WaitTicks;
+    TotalProbe += ProbeTicks;
+    DBG("          probe %llu us (boot sector wait %llu us)\n", TscToMicroseconds(ProbeTicks), TscToMicroseconds(WaitTicks));
 #ifdef JIEF_DEBUG
   DBG("          kind=%d\n", Volume->DiskKind);
 #endif
@@ -1036,6 +1180,21 @@ void ScanVolumes(void)
     //    DBG("SelfVolume Nr %d created\n", VolumesCount);
   }
   
+  // index whole disk volumes by BlockIO, later entries win like the former linear search
+  PassStart = AsmReadTsc();
+  for (WholeDiskMask = 16; WholeDiskMask < Volumes.size() * 2; WholeDiskMask <<= 1) {}
+  WholeDisks = (__typeof__(WholeDisks))AllocateZeroPool(WholeDiskMask * sizeof(WHOLE_DISK_SLOT));
+  WholeDiskMask--;
+  if (WholeDisks != NULL) {
+    for (VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
+      if (Volumes[VolumeIndex].BlockIO != NULL && Volumes[VolumeIndex].BlockIOOffset == 0) {
+        UINTN Slot = WholeDiskSlot(WholeDisks, WholeDiskMask, Volumes[VolumeIndex].BlockIO);
+        WholeDisks[Slot].BlockIO = Volumes[VolumeIndex].BlockIO;
+        WholeDisks[Slot].Volume = &Volumes[VolumeIndex];
+      }
+    }
+  }
+
   // second pass: relate partitions and whole disk devices
   for (VolumeIndex = 0; VolumeIndex < Volumes.size(); VolumeIndex++) {
     REFIT_VOLUME* Volume = &Volumes[VolumeIndex];
@@ -1057,10 +1216,14 @@ void ScanVolumes(void)
     WholeDiskVolume = NULL;
     if (Volume->BlockIO != NULL && Volume->WholeDiskBlockIO != NULL &&
         Volume->BlockIO != Volume->WholeDiskBlockIO) {
-      for (VolumeIndex2 = 0; VolumeIndex2 < Volumes.size(); VolumeIndex2++) {
-        if (Volumes[VolumeIndex2].BlockIO == Volume->WholeDiskBlockIO &&
-            Volumes[VolumeIndex2].BlockIOOffset == 0)
-          WholeDiskVolume = &Volumes[VolumeIndex2];
+      if (WholeDisks != NULL) {
+        WholeDiskVolume = WholeDisks[WholeDiskSlot(WholeDisks, WholeDiskMask, Volume->WholeDiskBlockIO)].Volume;
+      } else {
+        for (VolumeIndex2 = 0; VolumeIndex2 < Volumes.size(); VolumeIndex2++) {
+          if (Volumes[VolumeIndex2].BlockIO == Volume->WholeDiskBlockIO &&
+              Volumes[VolumeIndex2].BlockIOOffset == 0)
+            WholeDiskVolume = &Volumes[VolumeIndex2];
+        }
       }
     }
     if (WholeDiskVolume != NULL && WholeDiskVolume->MbrPartitionTable != NULL) {
@@ -1075,10 +1238,18 @@ void ScanVolumes(void)
           continue;
         
         // compare boot sector read through offset vs. directly
-        Status = Volume->BlockIO->ReadBlocks(Volume->BlockIO, Volume->BlockIO->Media->MediaId,
-                                             Volume->BlockIOOffset, 512, SectorBuffer1);
-        if (EFI_ERROR(Status))
-          break;
+        // the partition's first sector is already in the prefetch buffer when it came from BlockIo2
+        if (Prefetch != NULL && Volume->Index < HandleCount &&
+            Prefetch[Volume->Index].Handle == Volume->DeviceHandle &&
+            Volume->BlockIOOffset == 0 && Volume->BlockIO->Media->BlockSize == 512 &&
+            VolumePrefetchWait(&Prefetch[Volume->Index]) != NULL) {
+          CopyMem(SectorBuffer1, Prefetch[Volume->Index].Buffer, 512);
+        } else {
+          Status = Volume->BlockIO->ReadBlocks(Volume->BlockIO, Volume->BlockIO->Media->MediaId,
+                                               Volume->BlockIOOffset, 512, SectorBuffer1);
+          if (EFI_ERROR(Status))
+            break;
+        }
         Status = Volume->WholeDiskBlockIO->ReadBlocks(Volume->WholeDiskBlockIO, Volume->WholeDiskBlockIO->Media->MediaId,
                                                       MbrTable[PartitionIndex].StartLBA, 512, SectorBuffer2);
         if (EFI_ERROR(Status))
@@ -1107,6 +1278,18 @@ void ScanVolumes(void)
     }
     
   }
+  if (WholeDisks != NULL) {
+    FreePool(WholeDisks);
+  }
+  if (Prefetch != NULL) {
+    for (UINTN HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
+      VolumePrefetchFree(&Prefetch[HandleIndex]);
+    }
+    FreePool(Prefetch);
+  }
+  DBG("ScanVolumes: %zu volumes in %llu us (boot sector wait %llu us, probe %llu us, relate %llu us)\n",
+      Volumes.size(), TscToMicroseconds(AsmReadTsc() - ScanStart), TscToMicroseconds(TotalWait),
+      TscToMicroseconds(TotalProbe), TscToMicroseconds(AsmReadTsc() - PassStart));
 }
 
 static void UninitVolumes(void)
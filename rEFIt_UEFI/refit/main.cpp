@@ -507,6 +507,8 @@ static EFI_STATUS StartEFILoadedImage(IN EFI_HANDLE ChildImageHandle,
   gBS->SetWatchdogTimer(0x0000, 0x0000, 0x0000, NULL);
 
   ReinitRefitLib();
+  // the image may have written NVRAM behind our back
+  InvalidateNvramShadow();
   // control returns here when the child image calls Exit()
   if (ImageTitle.notEmpty()) {
     snwprintf(ErrorInfo, 512, "returned from %ls", ImageTitle.s());
@@ -2235,11 +2237,11 @@ void LOADER_ENTRY::StartLoader()
       SavePreBootLog = false;
     } else {
       // delete boot-switch-vars if exists
-      Status = gRT->SetVariable(L"boot-switch-vars", gEfiAppleBootGuid,
-                                EFI_VARIABLE_NON_VOLATILE |
-                                    EFI_VARIABLE_BOOTSERVICE_ACCESS |
-                                    EFI_VARIABLE_RUNTIME_ACCESS,
-                                0, NULL);
+      Status = WriteNvramVariable(L"boot-switch-vars", gEfiAppleBootGuid,
+                                  EFI_VARIABLE_NON_VOLATILE |
+                                      EFI_VARIABLE_BOOTSERVICE_ACCESS |
+                                      EFI_VARIABLE_RUNTIME_ACCESS,
+                                  0, NULL);
       DeleteNvramVariable(L"IOHibernateRTCVariables", gEfiAppleBootGuid);
       DeleteNvramVariable(L"boot-image", gEfiAppleBootGuid);
     }
@@ -2967,13 +2969,15 @@ static void LoadDrivers(void) {
 
     // Boot speedup: remove temporary "BiosVideoBlockSwitchMode" RT var
     // to unlock mode switching in CsmVideo
-    gRT->SetVariable(L"BiosVideoBlockSwitchMode", gEfiGlobalVariableGuid,
-                     EFI_VARIABLE_BOOTSERVICE_ACCESS, 0, NULL);
+    WriteNvramVariable(L"BiosVideoBlockSwitchMode", gEfiGlobalVariableGuid,
+                       EFI_VARIABLE_BOOTSERVICE_ACCESS, 0, NULL);
   } else {
     BdsLibConnectAllEfi(); // jief : without any driver loaded, i couldn't see
                            // my CD, unless I call BdsLibConnectAllEfi
   }
   ReinitRefitLib();
+  // connected drivers may have written NVRAM behind our back
+  InvalidateNvramShadow();
 }
 
 INTN FindDefaultEntry(void) {